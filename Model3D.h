@@ -8,6 +8,26 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <vector>
+
+#include "mesh_lod.h"
+#include "meshlet.h"
+#include "render_queue.h"
+
+// one SubMesh of the model: its own material, LOD chain and meshlets inside the shared EBO
+struct ModelPart {
+	int material; // index into the model's materials, -1 for the default material
+	std::vector<MeshLod> lods;
+	int current_lod;
+	glm::vec3 bounds_center; // object space bounding sphere, for the LOD distance
+	float bounds_radius;
+	std::vector<Meshlet> meshlets; // tile level 0, empty: level 0 is drawn whole
+	bool culled; // draw_counts/draw_offsets hold the surviving meshlets instead of the current level
+	unsigned int visible_meshlets;
+	std::vector<GLsizei> draw_counts;
+	std::vector<const void*> draw_offsets;
+};
+
 class Model3D {
 	private:
 		float pos_x;
@@ -20,6 +40,46 @@ class Model3D {
 		float scl_y;
 		float scl_z;
 		unsigned int mesh_indices_size; // for drawing
+		GLenum index_type; // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, matches the bound EBO
+		std::vector<ModelPart> parts; // empty: the first mesh_indices_size indices are drawn
+		// the matrices the model is drawn with, rebuilt by modelMatrix()/updateTransform() only when stale
+		ObjectTransform cached_transform;
+		glm::mat4 cached_view_projection; // the one cached_transform.mvp was built with
+		bool model_dirty; // position, rotation or scale changed since the model and normal matrix were built
+		bool mvp_dirty;
+
+		glm::mat4 transformation() const {
+			glm::mat4 transformation_matrix = glm::mat4(1.0f);
+			transformation_matrix = glm::translate(transformation_matrix,
+				glm::vec3(pos_x, pos_y, pos_z));
+			transformation_matrix = glm::scale(transformation_matrix,
+				glm::vec3(scl_x, scl_y, scl_z));
+			transformation_matrix = glm::rotate(transformation_matrix, glm::radians(rot_x), glm::vec3(1, 0, 0));
+			transformation_matrix = glm::rotate(transformation_matrix, glm::radians(rot_y), glm::vec3(0, 1, 0));
+			transformation_matrix = glm::rotate(transformation_matrix, glm::radians(rot_z), glm::vec3(0, 0, 1));
+			return transformation_matrix;
+		}
+
+		// the model matrix, rebuilt with the normal matrix after a position, rotation or scale change
+		const glm::mat4& modelMatrix() {
+			if (model_dirty) {
+				cached_transform.model = transformation();
+				cached_transform.normal = normalMatrix(cached_transform.model);
+				model_dirty = false;
+				mvp_dirty = true;
+			}
+			return cached_transform.model;
+		}
+
+		// fills the part's ranges with its current level unless cull() left the surviving meshlets there
+		void prepareRanges(ModelPart& part) const {
+			if (part.culled)
+				return;
+			size_t index_size = index_type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+			const MeshLod& lod = part.lods[part.current_lod];
+			part.draw_counts.assign(1, (GLsizei)lod.indexCount);
+			part.draw_offsets.assign(1, (const void*)(lod.firstIndex * index_size));
+		}
 
 	public:
 		Model3D(glm::vec3 cameraPos, unsigned int mesh_indices_size, glm::vec3 cameraFront) {
@@ -35,14 +95,165 @@ class Model3D {
 			scl_y = 1.f;
 			scl_z = 1.f;
 			this->mesh_indices_size = mesh_indices_size;
+			index_type = GL_UNSIGNED_INT;
+			model_dirty = true;
+			mvp_dirty = true;
+		}
+
+		// places the model at a fixed position, e.g. for meshes built by buildIndexedMesh
+		Model3D(glm::vec3 position, glm::vec3 scale, unsigned int mesh_indices_size, GLenum index_type) {
+			pos_x = position.x;
+			pos_y = position.y;
+			pos_z = position.z;
+			rot_x = 0.f;
+			rot_y = 0.f;
+			rot_z = 0.f;
+			scl_x = scale.x;
+			scl_y = scale.y;
+			scl_z = scale.z;
+			this->mesh_indices_size = mesh_indices_size;
+			this->index_type = index_type;
+			model_dirty = true;
+			mvp_dirty = true;
+		}
+
+		// rotation in degrees around the x, y and z axes
+		void setRotation(float x, float y, float z) {
+			if (x == rot_x && y == rot_y && z == rot_z)
+				return;
+			rot_x = x;
+			rot_y = y;
+			rot_z = z;
+			model_dirty = true;
+		}
+
+		// the cached matrices for the camera's viewProjection (projection * view); the model and normal
+		// matrix are rebuilt only after the model moved, the MVP only after that or a camera change
+		const ObjectTransform& updateTransform(const glm::mat4& viewProjection) {
+			modelMatrix();
+			if (mvp_dirty || viewProjection != cached_view_projection) {
+				cached_transform.mvp = viewProjection * cached_transform.model;
+				cached_view_projection = viewProjection;
+				mvp_dirty = false;
+			}
+			return cached_transform;
 		}
 		
+		// SubMeshes from buildModel with the LODs and meshlets they index, all inside the bound EBO
+		void setSubMeshes(const std::vector<SubMesh>& submeshes, const std::vector<MeshLod>& lods,
+			const std::vector<Meshlet>& meshlets) {
+			parts.clear();
+			for (size_t i = 0; i < submeshes.size(); i++) {
+				const SubMesh& submesh = submeshes[i];
+				if (submesh.lodCount == 0)
+					continue;
+				ModelPart part;
+				part.material = submesh.material;
+				part.lods.assign(lods.begin() + submesh.firstLod, lods.begin() + submesh.firstLod + submesh.lodCount);
+				part.current_lod = 0;
+				glm::vec3 boundsMin(submesh.boundsMin[0], submesh.boundsMin[1], submesh.boundsMin[2]);
+				glm::vec3 boundsMax(submesh.boundsMax[0], submesh.boundsMax[1], submesh.boundsMax[2]);
+				part.bounds_center = (boundsMin + boundsMax) * 0.5f;
+				part.bounds_radius = glm::length(boundsMax - boundsMin) * 0.5f;
+				part.meshlets.assign(meshlets.begin() + submesh.firstMeshlet,
+					meshlets.begin() + submesh.firstMeshlet + submesh.meshletCount);
+				part.culled = false;
+				part.visible_meshlets = 0;
+				parts.push_back(part);
+			}
+		}
+
+		// culls each part's level 0 meshlets against the camera (viewProjection = projection * view)
+		// the next draw only submits the survivors; other levels are always drawn whole
+		void cull(glm::vec3 cameraPos, const glm::mat4& viewProjection) {
+			const glm::mat4& model = modelMatrix();
+			for (size_t i = 0; i < parts.size(); i++) {
+				ModelPart& part = parts[i];
+				part.culled = part.current_lod == 0 && !part.meshlets.empty();
+				if (part.culled)
+					part.visible_meshlets = cullMeshlets(part.meshlets, model, viewProjection, cameraPos, index_type,
+						part.draw_counts, part.draw_offsets);
+			}
+		}
+
+		unsigned int visibleMeshlets() const {
+			unsigned int visible = 0;
+			for (size_t i = 0; i < parts.size(); i++)
+				visible += parts[i].culled ? parts[i].visible_meshlets : (unsigned int)parts[i].meshlets.size();
+			return visible;
+		}
+
+		int lod(size_t part = 0) const {
+			return part < parts.size() ? parts[part].current_lod : 0;
+		}
+
+		// picks, per part, the level whose error projects to at most LOD_MAX_PIXEL_ERROR pixels on screen
+		// viewportHeight in pixels; projection is the perspective matrix the model is drawn with
+		void updateLod(glm::vec3 cameraPos, const glm::mat4& projection, float viewportHeight) {
+			const glm::mat4& model = modelMatrix();
+			float scale = glm::max(scl_x, glm::max(scl_y, scl_z));
+			float pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f;
+			for (size_t i = 0; i < parts.size(); i++) {
+				ModelPart& part = parts[i];
+				if (part.lods.size() < 2)
+					continue;
+				glm::vec3 center = glm::vec3(model * glm::vec4(part.bounds_center, 1.0f));
+				// nearest point of the bounding sphere, so big parts refine before the camera enters them
+				float distance = glm::length(center - cameraPos) - part.bounds_radius * scale;
+
+				int finest = selectLod(part.lods, scale, distance, pixelsPerUnit, LOD_MAX_PIXEL_ERROR);
+				int coarsest = selectLod(part.lods, scale, distance, pixelsPerUnit,
+					LOD_MAX_PIXEL_ERROR * (1.f - LOD_HYSTERESIS));
+				if (finest < part.current_lod)
+					part.current_lod = finest; // too coarse now, refine right away
+				else if (coarsest > part.current_lod)
+					part.current_lod = coarsest;
+			}
+		}
+
+		// draws every part with whatever material and VAO are bound
 		void draw(unsigned int transformLoc) {
-			glm::mat4 transformation_matrix = glm::mat4(1.0f);
-			transformation_matrix = glm::translate(transformation_matrix,
-				glm::vec3(pos_x, pos_y, pos_z));
 			// new uniform variable
-			glUniformMatrix4fv(transformLoc, 1, GL_FALSE, value_ptr(transformation_matrix));
-			glDrawElements(GL_TRIANGLES, mesh_indices_size, GL_UNSIGNED_INT, 0);
+			glUniformMatrix4fv(transformLoc, 1, GL_FALSE, value_ptr(modelMatrix()));
+			if (parts.empty()) {
+				glDrawElements(GL_TRIANGLES, mesh_indices_size, index_type, 0);
+				return;
+			}
+			for (size_t i = 0; i < parts.size(); i++) {
+				ModelPart& part = parts[i];
+				prepareRanges(part);
+				if (part.draw_counts.empty())
+					continue;
+				if (GLAD_GL_VERSION_1_4) {
+					glMultiDrawElements(GL_TRIANGLES, part.draw_counts.data(), index_type, part.draw_offsets.data(),
+						(GLsizei)part.draw_counts.size());
+				} else {
+					for (size_t r = 0; r < part.draw_counts.size(); r++)
+						glDrawElements(GL_TRIANGLES, part.draw_counts[r], index_type, part.draw_offsets[r]);
+				}
+			}
+		}
+
+		// queues every part with its material and the variant of shaders it needs under lighting;
+		// materialBase is the sort id of materials[0], defaultMaterial (sort id 0) is used for parts without one
+		// viewProjection = projection * view of the camera, for the MVP
+		void submit(RenderQueue& queue, const glm::mat4& viewProjection, ShaderVariants& shaders,
+			ShaderVariantKey lighting, const GpuMesh& mesh, const std::vector<Material>& materials,
+			unsigned int materialBase, const Material& defaultMaterial) {
+			const ObjectTransform& transformation_matrix = updateTransform(viewProjection);
+			if (parts.empty()) {
+				const void* offset = 0;
+				GLsizei count = (GLsizei)mesh_indices_size;
+				queue.submit(shaders, lighting, defaultMaterial, 0, mesh, transformation_matrix, &count, &offset, 1);
+				return;
+			}
+			for (size_t i = 0; i < parts.size(); i++) {
+				ModelPart& part = parts[i];
+				prepareRanges(part);
+				bool hasMaterial = part.material >= 0 && part.material < (int)materials.size();
+				queue.submit(shaders, lighting, hasMaterial ? materials[part.material] : defaultMaterial,
+					hasMaterial ? materialBase + part.material : 0, mesh, transformation_matrix,
+					part.draw_counts.data(), part.draw_offsets.data(), part.draw_counts.size());
+			}
 		}
 };
\ No newline at end of file
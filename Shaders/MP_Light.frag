@@ -1,15 +1,20 @@
 #version 330 core
+// feature keys (shader_variants.h), defined after the #version line for each variant:
+//   NORMAL_MAP, ALPHA_TEST, SPOTLIGHT and NUM_POINT_LIGHTS
 out vec4 FragColor;
 
 struct Material {
     sampler2D diffuse;
     sampler2D specular;
+    sampler2D normal; // tangent space x and y (BC5), flat (0.5, 0.5) when the material has none
     float shininess;
+    float alpha;
 }; 
 
+// the light structs are laid out for std140 (a float after each vec3), mirrored by the *LightBlock
+// structs in light.h
 struct DirLight {
     vec3 direction;
-	
     vec3 ambient;
     vec3 diffuse;
     vec3 specular;
@@ -17,46 +22,62 @@ struct DirLight {
 
 struct PointLight {
     vec3 position;
-    
     float constant;
-    float linear;
-    float quadratic;
-	
     vec3 ambient;
+    float linear;
     vec3 diffuse;
+    float quadratic;
     vec3 specular;
 };
 
 struct SpotLight {
     vec3 position;
-    vec3 direction;
     float cutOff;
+    vec3 direction;
     float outerCutOff;
-  
+    vec3 ambient;
     float constant;
+    vec3 diffuse;
     float linear;
+    vec3 specular;
     float quadratic;
-  
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;       
 };
 
-#define NR_POINT_LIGHTS 1
+// MAX_POINT_LIGHTS in frame_uniforms.h
+#define MAX_POINT_LIGHTS 4
+#ifndef NUM_POINT_LIGHTS
+#define NUM_POINT_LIGHTS 0
+#endif
 
 in vec3 fragPos;
 in vec3 normCoord;
 in vec2 texCoord;
 
+#ifdef NORMAL_MAP
 in mat3 TBN;
+#endif
+
+// per frame, shared by all programs (frame_uniforms.h)
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+};
+
+layout (std140) uniform Lights {
+    DirLight dirLight;
+    SpotLight spotLight;
+    PointLight pointLights[MAX_POINT_LIGHTS];
+};
 
-uniform vec3 viewPos;
-uniform DirLight dirLight;
-uniform PointLight pointLights[NR_POINT_LIGHTS];
-uniform SpotLight spotLight;
 uniform Material material;
 
+// the material's maps at texCoord, sampled once for all lights
+vec3 diffuseTexel;
+vec3 specularTexel;
+
 // function prototypes
+vec3 SampleNormal(sampler2D map, vec2 uv);
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
@@ -64,7 +85,18 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 void main()
 {    
     // properties
+    vec4 diffuseSample = texture(material.diffuse, texCoord);
+#ifdef ALPHA_TEST
+    if (diffuseSample.a < 0.1)
+        discard;
+#endif
+    diffuseTexel = diffuseSample.rgb;
+    specularTexel = texture(material.specular, texCoord).rgb;
+#ifdef NORMAL_MAP
+    vec3 norm = normalize(TBN * SampleNormal(material.normal, texCoord));
+#else
     vec3 norm = normalize(normCoord);
+#endif
     vec3 viewDir = normalize(viewPos - fragPos);
     
     // == =====================================================
@@ -78,13 +110,17 @@ void main()
     vec3 result = CalcDirLight(dirLight, norm, viewDir);
     
     // phase 2: point lights
-    //for(int i = 0; i < NR_POINT_LIGHTS; i++)
-        //result += CalcPointLight(pointLights[i], norm, fragPos, viewDir);    
+#if NUM_POINT_LIGHTS > 0
+    for(int i = 0; i < NUM_POINT_LIGHTS; i++)
+        result += CalcPointLight(pointLights[i], norm, fragPos, viewDir);
+#endif
     
     // phase 3: spot light
-    result += CalcSpotLight(spotLight, norm, fragPos, viewDir);    
+#ifdef SPOTLIGHT
+    result += CalcSpotLight(spotLight, norm, fragPos, viewDir);
+#endif
     
-    FragColor = vec4(result, 1.0);
+    FragColor = vec4(result, material.alpha);
 }
 
 // calculates the color when using a directional light.
@@ -97,9 +133,9 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, texCoord));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, texCoord));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, texCoord));
+    vec3 ambient = light.ambient * diffuseTexel;
+    vec3 diffuse = light.diffuse * diff * diffuseTexel;
+    vec3 specular = light.specular * spec * specularTexel;
     return (ambient + diffuse + specular);
 }
 
@@ -116,9 +152,9 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float distance = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, texCoord));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, texCoord));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, texCoord));
+    vec3 ambient = light.ambient * diffuseTexel;
+    vec3 diffuse = light.diffuse * diff * diffuseTexel;
+    vec3 specular = light.specular * spec * specularTexel;
     ambient *= attenuation;
     diffuse *= attenuation;
     specular *= attenuation;
@@ -142,11 +178,19 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float epsilon = light.cutOff - light.outerCutOff;
     float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
     // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, texCoord));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, texCoord));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, texCoord));
+    vec3 ambient = light.ambient * diffuseTexel;
+    vec3 diffuse = light.diffuse * diff * diffuseTexel;
+    vec3 specular = light.specular * spec * specularTexel;
     ambient *= attenuation * intensity;
     diffuse *= attenuation * intensity;
     specular *= attenuation * intensity;
     return (ambient + diffuse + specular);
-}
\ No newline at end of file
+}
+
+// normal maps keep x and y only (BC5 has two channels), z is rebuilt from the unit length;
+// uncompressed ones still carry z but go through the same path
+vec3 SampleNormal(sampler2D map, vec2 uv)
+{
+    vec2 xy = texture(map, uv).rg * 2.0 - 1.0;
+    return vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+}
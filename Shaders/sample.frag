@@ -1,4 +1,5 @@
 #version 330 core
+// feature keys (shader_variants.h): NORMAL_MAP, ALPHA_TEST
 
 uniform sampler2D tex0;
 
@@ -20,7 +21,9 @@ in vec2 texCoord;
 in vec3 normCoord;
 in vec3 fragPos;
 
+#ifdef NORMAL_MAP
 in mat3 TBN;
+#endif
 
 out vec4 Fragcolor;
 
@@ -28,16 +31,23 @@ void main()
 {
     vec4 pixelColor = texture(tex0, texCoord);
 
+#ifdef ALPHA_TEST
     if(pixelColor.a < 0.1) {
         discard;
         // below here is ignored
     }
-
-    // gets rgb data of texture
-    vec3 normal = texture(norm_tex, texCoord).rgb;
-    // converts RGB -> XYZ; 0 == -1 ; 1 == 1
-    normal = normalize(normal * 2.0 - 1.0);
+#endif
+
+#ifdef NORMAL_MAP
+    // gets rg data of texture (BC5 normal maps have no blue)
+    vec2 normalXY = texture(norm_tex, texCoord).rg;
+    // converts RG -> XY; 0 == -1 ; 1 == 1, and Z from the unit length
+    normalXY = normalXY * 2.0 - 1.0;
+    vec3 normal = vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0)));
     normal = normalize(TBN * normal);
+#else
+    vec3 normal = normalize(normCoord);
+#endif
 
     vec3 lightDir = normalize(lightPos - fragPos);
     float diff = max(dot(normal, lightDir), 0.0);
@@ -58,7 +68,7 @@ void main()
     diffuse *= attenuation;
     ambientCol *= attenuation;
 
-    vec4 brick_wall = vec4(1.0f, 1.0f, 1.0f, 0.6f) * texture(tex0, texCoord); // we make the brick wall texture 0.6 opacity by changing alpha 
+    vec4 brick_wall = vec4(1.0f, 1.0f, 1.0f, 0.6f) * pixelColor; // we make the brick wall texture 0.6 opacity by changing alpha 
     vec4 mixColor = mix(brick_wall, texture(tex2, texCoord), texture(tex2, texCoord).a); // mix the transparent brick wall with yae.png based on alpha of yae.png
     Fragcolor = vec4(specColor + diffuse + ambientCol, 1.0) * mixColor;
 }
\ No newline at end of file
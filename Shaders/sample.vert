@@ -1,37 +1,60 @@
 #version 330 core
 
-layout (location = 0) in vec3 aPos;
+// float vertices: position, normal, uv and tangent (w = bitangent sign) as is
+// compact vertices: unorm16 position in the mesh AABB with the bitangent sign in w,
+// octahedral snorm16 normal and tangent in .xy, half float uv
+layout (location = 0) in vec4 aPos;
 layout (location = 1) in vec3 vertexNormal;
 layout (location = 2) in vec2 aTex;
-layout (location = 3) in vec3 m_tan;
-layout (location = 4) in vec3 m_btan;
+layout (location = 3) in vec4 m_tan;
 
 out vec2 texCoord;
 out vec3 normCoord;
 out vec3 fragPos;
 
+#ifdef NORMAL_MAP // feature key (shader_variants.h), the fragment shader only needs TBN with a normal map
 out mat3 TBN;
-
-uniform mat4 transform;
-uniform mat4 projection;
-uniform mat4 view;
+#endif
+
+// per object, built on the CPU when the object or the camera moves (ObjectTransform in render_queue.h)
+uniform mat4 transform;    // model matrix
+uniform mat3 normalMatrix; // inverse transpose of transform's upper 3x3
+uniform mat4 mvp;          // projection * view * transform
+
+uniform vec3 positionOffset; // AABB min for compact vertices, 0 otherwise
+uniform vec3 positionScale;  // AABB size for compact vertices, 1 otherwise
+uniform bool octEncoded;
+
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
 
 void main(){
-	gl_Position = projection * view * transform * vec4(aPos, 1.0);
-	
+	vec3 localPos = positionOffset + aPos.xyz * positionScale;
+	vec3 localNormal = octEncoded ? octDecode(vertexNormal.xy) : vertexNormal;
+
+	gl_Position = mvp * vec4(localPos, 1.0);
+
 	texCoord = aTex;
-	
-	mat3 modelMat = mat3(
-		transpose(inverse(transform))
-		);
-
-	normCoord = modelMat * vertexNormal;
-	
-	vec3 T = normalize(modelMat * m_tan);
-	vec3 B = normalize(modelMat * m_btan);
+
+	normCoord = normalMatrix * localNormal;
+
+#ifdef NORMAL_MAP
+	vec3 localTangent = octEncoded ? octDecode(m_tan.xy) : m_tan.xyz;
+	float bitangentSign = octEncoded ? aPos.w * 2.0 - 1.0 : m_tan.w;
 	vec3 N = normalize(normCoord);
+	vec3 T = normalize(normalMatrix * localTangent);
+	// re-orthogonalize after the model transform, then rebuild the bitangent
+	T = normalize(T - dot(T, N) * N);
+	vec3 B = cross(N, T) * bitangentSign;
 
 	TBN = mat3(T, B, N);
+#endif
 
-	fragPos = vec3(transform * vec4(aPos,1.0));
-}
\ No newline at end of file
+	fragPos = vec3(transform * vec4(localPos,1.0));
+}
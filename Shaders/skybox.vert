@@ -4,14 +4,18 @@ layout(location = 0) in vec3 aPos;
 
 out vec3 texCoord;
 
-uniform mat4 projection;
-
-uniform mat4 view;
+// per frame, shared by all programs (frame_uniforms.h)
+layout (std140) uniform Camera {
+	mat4 view;
+	mat4 projection;
+	vec3 viewPos;
+};
 
 void main()
 {
+	// the camera's rotation only, the sky doesn't move with it
 	vec4 pos = projection *
-				view *
+				mat4(mat3(view)) *
 				vec4(aPos,1.0);
 
 	gl_Position = vec4(pos.x, pos.y, pos.w, pos.w);
@@ -0,0 +1,714 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mesh_cache.h"
+#include "mesh_stream.h"
+#include "stb_image.h"
+#include "texture_container.h"
+#include "upload_ring.h"
+
+// tiny_obj_loader.h has to be included before this header (main.cpp owns the implementation)
+
+// loads assets on worker threads so the window is interactive from the first frame:
+// workers read files, decode images and import meshes; finished payloads go onto a lock-free
+// queue that the render thread drains in update() under a time budget, issuing the GL uploads.
+// Textures are created up front with a 1x1 placeholder, the real image replaces it under the
+// same GL name, so whatever already refers to the texture picks it up without being told.
+// The six faces of a cube map are queued separately and load on six workers at once.
+// Images come with their mip chain from a TextureContainer (decoded, filtered and block compressed once,
+// mapped after that) and go through an UploadRing: with persistent mapping the worker copies every level into the
+// mapped PBO, and the render thread only issues glTexSubImage2D from the buffer.
+// With shareContent() on, a worker that has loaded an asset checks the hash it computed for the texture
+// container or mesh cache against everything loaded so far. A duplicate is neither staged nor uploaded:
+// update() deletes its placeholder (or asset) and takeDuplicates() says what it duplicates, for whoever
+// handed it out to point its users there instead (ResourceManager does).
+
+// GL upload time per frame, in milliseconds; at least one upload runs every frame regardless
+const double ASSET_UPLOAD_BUDGET_MS = 2.0;
+// pixel unpack buffer the images are staged in; larger images upload from client memory
+const size_t ASSET_UPLOAD_RING_SIZE = 64 * 1024 * 1024;
+
+enum AssetKind {
+    ASSET_TEXTURE,
+    ASSET_CUBEMAP,
+    ASSET_MESH
+};
+
+enum MeshAssetState {
+    MESH_ASSET_LOADING,
+    MESH_ASSET_READY,  // mesh and gpu are valid
+    MESH_ASSET_FAILED  // error says why
+};
+
+// owned by the AssetLoader; only touch it on the render thread once state leaves MESH_ASSET_LOADING
+struct MeshAsset {
+    std::string path;
+    VertexFormat format;
+    MeshAssetState state;
+    CachedMesh mesh;
+    GpuMesh gpu;
+    std::string warning;
+    std::string error;
+    bool discarded; // deleteMesh() while loading, freed instead of uploaded
+};
+
+// an image with every mip level, rows top to bottom unless the job asked for them flipped
+struct JobImage {
+    TextureContainer container; // closed when the image could not be loaded
+    std::string error;
+    bool staged;       // levels copied into the upload ring at ringOffset
+    size_t ringOffset;
+};
+
+// an asset update() deleted instead of uploading, since original has the same content; texture and mesh
+// are gone by then, only good for looking up whoever asked for them
+struct DuplicateAsset {
+    AssetKind kind;
+    GLuint texture; // textures and cube maps
+    GLuint original;
+    const MeshAsset* mesh; // meshes
+    const MeshAsset* originalMesh;
+};
+
+// whatever an asset's content was loaded into first
+struct ContentOwner {
+    GLuint texture;
+    MeshAsset* mesh;
+};
+
+struct AssetJob {
+    AssetKind kind;
+    std::string paths[6]; // one for textures and meshes, +X -X +Y -Y +Z -Z for cubemaps
+    bool flip;            // flip images vertically (OBJ uvs start at the bottom)
+    TextureContent content;
+    GLuint texture;       // placeholder to replace
+    JobImage images[6];
+    MeshAsset* mesh;
+    std::atomic<int> nextFace;  // cube map face the next worker to pick the job up loads
+    std::atomic<int> partsLeft; // queue entries (cube map faces) not done yet
+    bool loaded;
+    bool discard;   // deleteTexture() before the upload
+    unsigned long long contentKey; // with shareContent(), once loaded
+    bool duplicate; // another job owned contentKey when this one was loaded
+    AssetJob* next; // link in the finished stack
+};
+
+inline GLenum imageFormat(int channels)
+{
+    return channels == 1 ? GL_RED : channels == 2 ? GL_RG : channels == 3 ? GL_RGB : GL_RGBA;
+}
+
+// multiple producers push, the render thread takes everything at once, so there is no ABA
+class FinishedJobStack {
+public:
+    FinishedJobStack() : head(NULL) {}
+
+    void push(AssetJob* job)
+    {
+        job->next = head.load(std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(job->next, job, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+    }
+
+    // oldest first
+    AssetJob* takeAll()
+    {
+        AssetJob* newestFirst = head.exchange(NULL, std::memory_order_acquire);
+        AssetJob* oldestFirst = NULL;
+        while (newestFirst) {
+            AssetJob* next = newestFirst->next;
+            newestFirst->next = oldestFirst;
+            oldestFirst = newestFirst;
+            newestFirst = next;
+        }
+        return oldestFirst;
+    }
+
+private:
+    std::atomic<AssetJob*> head;
+};
+
+struct AssetUploadStats {
+    unsigned int uploads;
+    unsigned int waiting; // finished but over this frame's budget
+    double milliseconds;
+};
+
+class AssetLoader {
+public:
+    // threads = 0 leaves one hardware thread to the renderer
+    // needs a current GL context, for the upload ring
+    explicit AssetLoader(unsigned int threads = 0) : stopping(false), inFlight(0), sharing(false)
+    {
+        ring.create(ASSET_UPLOAD_RING_SIZE);
+        if (threads == 0) {
+            unsigned int hardware = std::thread::hardware_concurrency();
+            threads = hardware > 1 ? hardware - 1 : 1;
+        }
+        for (unsigned int i = 0; i < threads; i++)
+            workers.push_back(std::thread(&AssetLoader::work, this));
+    }
+
+    ~AssetLoader()
+    {
+        release();
+    }
+
+    // stops the workers, drops unfinished jobs and frees the upload ring; call before the GL context goes away
+    void release()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        // a worker may be waiting for ring space that the render thread will not free anymore
+        ring.cancel();
+        for (size_t i = 0; i < workers.size(); i++)
+            workers[i].join();
+        workers.clear();
+        // a cube map is queued once per face, dropped with its last entry
+        for (size_t i = 0; i < queued.size(); i++)
+            if (finishPart(queued[i]))
+                dropJob(queued[i]);
+        queued.clear();
+        for (AssetJob* job = finished.takeAll(); job; ) {
+            AssetJob* next = job->next;
+            dropJob(job);
+            job = next;
+        }
+        for (size_t i = 0; i < pending.size(); i++)
+            dropJob(pending[i]);
+        pending.clear();
+        textureJobs.clear();
+        duplicates.clear();
+        {
+            std::lock_guard<std::mutex> lock(contentMutex);
+            contents.clear();
+            textureContents.clear();
+            meshContents.clear();
+        }
+        inFlight = 0;
+        ring.release();
+    }
+
+    // a mipmapped 2D texture that shows placeholder until path is loaded and uploaded
+    GLuint loadTexture(const std::string& path, bool flip, glm::vec4 placeholder = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f),
+        TextureContent content = TEXTURE_COLOR)
+    {
+        AssetJob* job = newJob(ASSET_TEXTURE, flip);
+        job->content = content;
+        job->paths[0] = path;
+        glGenTextures(1, &job->texture);
+        glBindTexture(GL_TEXTURE_2D, job->texture);
+        uploadPlaceholder(GL_TEXTURE_2D, placeholder);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        GLuint texture = job->texture;
+        textureJobs[texture] = job;
+        enqueue(job);
+        return texture;
+    }
+
+    // a cube map of faces (+X -X +Y -Y +Z -Z) that shows placeholder until all six are in
+    GLuint loadCubemap(const std::string faces[6], bool flip, glm::vec4 placeholder = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f))
+    {
+        AssetJob* job = newJob(ASSET_CUBEMAP, flip);
+        glGenTextures(1, &job->texture);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, job->texture);
+        for (int i = 0; i < 6; i++) {
+            job->paths[i] = faces[i];
+            uploadPlaceholder(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, placeholder);
+        }
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        GLuint texture = job->texture;
+        textureJobs[texture] = job;
+        enqueue(job);
+        return texture;
+    }
+
+    // imported through loadMesh (mesh cache, streaming for huge files); poll state every frame
+    MeshAsset* loadMesh(const std::string& path, VertexFormat format)
+    {
+        meshes.push_back(std::unique_ptr<MeshAsset>(new MeshAsset()));
+        MeshAsset* asset = meshes.back().get();
+        asset->path = path;
+        asset->format = format;
+        asset->state = MESH_ASSET_LOADING;
+        asset->discarded = false;
+        AssetJob* job = newJob(ASSET_MESH, false);
+        job->paths[0] = path;
+        job->mesh = asset;
+        enqueue(job);
+        return asset;
+    }
+
+    // drop assets whose content is already loaded instead of uploading them again, see takeDuplicates();
+    // set it before the first load
+    void shareContent(bool share)
+    {
+        sharing.store(share);
+    }
+
+    // a texture from loadTexture()/loadCubemap(); one still loading is deleted once its worker is done
+    void deleteTexture(GLuint texture)
+    {
+        forgetContent(texture, NULL);
+        std::map<GLuint, AssetJob*>::iterator found = textureJobs.find(texture);
+        if (found != textureJobs.end())
+            found->second->discard = true;
+        else
+            glDeleteTextures(1, &texture);
+    }
+
+    // frees the GL buffers and the mapping of a mesh from loadMesh(); asset is gone afterwards
+    void deleteMesh(MeshAsset* asset)
+    {
+        forgetContent(0, asset);
+        if (asset->state == MESH_ASSET_LOADING) {
+            asset->discarded = true;
+            return;
+        }
+        if (asset->state == MESH_ASSET_READY)
+            releaseMesh(asset->gpu);
+        eraseMesh(asset);
+    }
+
+    // render thread, once per frame: uploads finished assets until budgetMs is spent
+    AssetUploadStats update(double budgetMs = ASSET_UPLOAD_BUDGET_MS)
+    {
+        ring.retire();
+        for (AssetJob* job = finished.takeAll(); job; job = job->next)
+            pending.push_back(job);
+
+        AssetUploadStats stats = { 0, 0, 0.0 };
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        while (!pending.empty()) {
+            stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (stats.uploads > 0 && stats.milliseconds >= budgetMs)
+                break;
+            AssetJob* job = pending.front();
+            pending.pop_front();
+            upload(job);
+            if (job->kind != ASSET_MESH)
+                textureJobs.erase(job->texture);
+            freeJob(job);
+            inFlight--;
+            stats.uploads++;
+        }
+        stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        stats.waiting = (unsigned int)pending.size();
+        return stats;
+    }
+
+    // render thread: every duplicate update() dropped since the last call, oldest first
+    std::vector<DuplicateAsset> takeDuplicates()
+    {
+        std::vector<DuplicateAsset> taken;
+        taken.swap(duplicates);
+        return taken;
+    }
+
+    // nothing requested is still loading or waiting for its upload
+    bool idle() const
+    {
+        return inFlight.load() == 0;
+    }
+
+private:
+    AssetJob* newJob(AssetKind kind, bool flip)
+    {
+        AssetJob* job = new AssetJob();
+        job->kind = kind;
+        job->flip = flip;
+        job->content = TEXTURE_COLOR;
+        job->texture = 0;
+        for (int i = 0; i < 6; i++) {
+            job->images[i].staged = false;
+            job->images[i].ringOffset = 0;
+        }
+        job->mesh = NULL;
+        job->nextFace.store(0);
+        job->partsLeft.store(kind == ASSET_CUBEMAP ? 6 : 1);
+        job->loaded = false;
+        job->discard = false;
+        job->contentKey = 0;
+        job->duplicate = false;
+        job->next = NULL;
+        return job;
+    }
+
+    void enqueue(AssetJob* job)
+    {
+        inFlight++;
+        int parts = job->partsLeft.load();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (int i = 0; i < parts; i++)
+                queued.push_back(job);
+        }
+        if (parts > 1)
+            wake.notify_all();
+        else
+            wake.notify_one();
+    }
+
+    // true for whoever finishes the last part of job; that thread sees everything the others wrote to it
+    static bool finishPart(AssetJob* job)
+    {
+        return job->partsLeft.fetch_sub(1) == 1;
+    }
+
+    static void uploadPlaceholder(GLenum target, glm::vec4 color)
+    {
+        unsigned char texel[4];
+        for (int i = 0; i < 4; i++)
+            texel[i] = (unsigned char)(glm::clamp(color[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+        glTexImage2D(target, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+    }
+
+    // worker thread; wait for ring space only if the job holds none yet
+    bool prepare(const std::string& path, bool flip, TextureContent content, JobImage& image, bool wait)
+    {
+        if (!loadTextureContainer(path, flip, content, image.container, &image.error))
+            return false;
+        stage(image, wait);
+        return true;
+    }
+
+    // worker thread: every level in one go; from a mapped container this is the only time the pixels are touched
+    void stage(JobImage& image, bool wait)
+    {
+        size_t offset;
+        const TextureContainer& container = image.container;
+        unsigned char* staging = ring.mode() == UPLOAD_RING_PERSISTENT ? ring.reserve(container.dataSize(), offset, wait) : NULL;
+        if (staging) {
+            std::memcpy(staging, container.data(), container.dataSize());
+            image.staged = true;
+            image.ringOffset = offset;
+        }
+    }
+
+    // worker thread, once job is loaded: the first job with its content owns it, later ones are duplicates.
+    // The hashes are the ones the texture container and mesh cache were checked against
+    void claimContent(AssetJob* job)
+    {
+        if (!sharing.load())
+            return;
+        unsigned long long seed = (unsigned long long)job->kind << 32;
+        unsigned long long key;
+        if (job->kind == ASSET_MESH) {
+            unsigned long long source = job->mesh->mesh.sourceHash();
+            key = hashBytes((const char*)&source, sizeof(source), seed | job->mesh->format);
+        } else {
+            key = seed;
+            for (int i = 0; i < (job->kind == ASSET_CUBEMAP ? 6 : 1); i++) {
+                unsigned long long source = job->images[i].container.sourceHash();
+                key = hashBytes((const char*)&source, sizeof(source), key);
+            }
+        }
+        job->contentKey = key;
+        std::lock_guard<std::mutex> lock(contentMutex);
+        if (contents.count(key)) {
+            job->duplicate = true;
+            return;
+        }
+        ownContent(job);
+    }
+
+    // contentMutex held
+    void ownContent(const AssetJob* job)
+    {
+        ContentOwner owner = { job->texture, job->mesh };
+        contents[job->contentKey] = owner;
+        if (job->mesh)
+            meshContents[job->mesh] = job->contentKey;
+        else
+            textureContents[job->texture] = job->contentKey;
+    }
+
+    // render thread: what a duplicate's content belongs to now; false when that was deleted in the meantime,
+    // then the duplicate owns it and is uploaded after all
+    bool contentOwner(const AssetJob* job, ContentOwner& owner)
+    {
+        std::lock_guard<std::mutex> lock(contentMutex);
+        std::map<unsigned long long, ContentOwner>::iterator found = contents.find(job->contentKey);
+        if (found != contents.end() && !discarded(found->second)) {
+            owner = found->second;
+            return true;
+        }
+        ownContent(job);
+        return false;
+    }
+
+    // render thread: deleted while its job was still running, forgotten once the job is done
+    bool discarded(const ContentOwner& owner)
+    {
+        if (owner.mesh)
+            return owner.mesh->discarded;
+        std::map<GLuint, AssetJob*>::iterator job = textureJobs.find(owner.texture);
+        return job != textureJobs.end() && job->second->discard;
+    }
+
+    // render thread: texture or mesh is going away, a later load with its content is not a duplicate
+    void forgetContent(GLuint texture, const MeshAsset* mesh)
+    {
+        std::lock_guard<std::mutex> lock(contentMutex);
+        if (mesh) {
+            std::map<const MeshAsset*, unsigned long long>::iterator found = meshContents.find(mesh);
+            if (found != meshContents.end()) {
+                std::map<unsigned long long, ContentOwner>::iterator owned = contents.find(found->second);
+                if (owned != contents.end() && owned->second.mesh == mesh)
+                    contents.erase(owned);
+                meshContents.erase(found);
+            }
+        } else {
+            std::map<GLuint, unsigned long long>::iterator found = textureContents.find(texture);
+            if (found != textureContents.end()) {
+                std::map<unsigned long long, ContentOwner>::iterator owned = contents.find(found->second);
+                if (owned != contents.end() && !owned->second.mesh && owned->second.texture == texture)
+                    contents.erase(owned);
+                textureContents.erase(found);
+            }
+        }
+    }
+
+    // worker thread: everything that does not need the GL context; true once the whole job is done
+    bool run(AssetJob* job)
+    {
+        if (job->kind == ASSET_TEXTURE) {
+            JobImage& image = job->images[0];
+            job->loaded = loadTextureContainer(job->paths[0], job->flip, job->content, image.container, &image.error);
+            if (job->loaded)
+                claimContent(job);
+            // a duplicate keeps its container only in case what it duplicates is deleted before the upload
+            if (job->loaded && !job->duplicate)
+                stage(image, true);
+        } else if (job->kind == ASSET_CUBEMAP) {
+            // the other faces keep their ring regions until the whole cube map is uploaded, so no face
+            // may wait for space; a face that finds the ring full uploads from its container instead
+            int face = job->nextFace.fetch_add(1);
+            prepare(job->paths[face], job->flip, TEXTURE_COLOR, job->images[face], false);
+            if (!finishPart(job))
+                return false;
+            job->loaded = true;
+            for (int i = 0; i < 6; i++)
+                job->loaded = job->loaded && job->images[i].container.isOpen();
+            for (int i = 1; i < 6 && job->loaded; i++) {
+                const TextureContainer& face = job->images[i].container;
+                const TextureContainer& first = job->images[0].container;
+                if (face.width() != first.width() || face.height() != first.height()) {
+                    job->images[i].error = "cube map faces differ in size";
+                    job->loaded = false;
+                } else if (face.blockFormat() != first.blockFormat()) {
+                    // one face translucent (BC3) and the others not
+                    job->images[i].error = "cube map faces differ in format";
+                    job->loaded = false;
+                }
+            }
+            // the faces are staged by now, a duplicate gives their regions back without uploading them
+            if (job->loaded)
+                claimContent(job);
+        } else {
+            MeshAsset* asset = job->mesh;
+            job->loaded = ::loadMesh(asset->path, asset->mesh, &asset->warning, &asset->error, asset->format);
+            if (job->loaded)
+                claimContent(job);
+        }
+        return true;
+    }
+
+    // render thread: immutable storage for every level when the driver has it; faces share one format.
+    // false when the levels are left for uploadLevels to define (compressed, without texture storage)
+    static bool allocateLevels(GLenum target, const JobImage* images, int faces)
+    {
+        const TextureContainer& first = images[0].container;
+        bool alpha = false;
+        for (int i = 0; i < faces; i++)
+            alpha = alpha || images[i].container.channels() == 4;
+        BlockFormat blockFormat = first.blockFormat();
+        if (GLAD_GL_VERSION_4_2 || GLAD_GL_ARB_texture_storage) {
+            GLenum internalFormat = blockFormat != BLOCK_NONE ? blockInternalFormat(blockFormat) : alpha ? GL_RGBA8 : GL_RGB8;
+            glTexStorage2D(target, first.levelCount(), internalFormat, first.width(), first.height());
+            return true;
+        }
+        glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, first.levelCount() - 1);
+        // compressed levels cannot be allocated without their data
+        if (blockFormat != BLOCK_NONE)
+            return false;
+        for (int i = 0; i < faces; i++) {
+            GLenum face = faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + i : target;
+            for (unsigned int l = 0; l < first.levelCount(); l++)
+                glTexImage2D(face, l, alpha ? GL_RGBA : GL_RGB, first.level(l).width, first.level(l).height, 0,
+                    imageFormat(images[i].container.channels()), GL_UNSIGNED_BYTE, NULL);
+        }
+        return true;
+    }
+
+    // render thread: every level of image into face, through the ring when it can; define creates the
+    // levels instead of filling allocated ones
+    void uploadLevels(GLenum face, const JobImage& image, bool define)
+    {
+        const TextureContainer& container = image.container;
+        const unsigned char* base = container.data();
+        size_t offset;
+        if (image.staged) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring.name());
+            base = (const unsigned char*)NULL + image.ringOffset;
+        } else if (ring.mode() == UPLOAD_RING_ORPHANING) {
+            unsigned char* staging = ring.map(container.dataSize(), offset);
+            if (staging) {
+                std::memcpy(staging, container.data(), container.dataSize());
+                if (ring.unmap())
+                    base = (const unsigned char*)NULL + offset;
+                else
+                    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            }
+        }
+        // with a buffer bound the pointers are offsets into it, and the calls return without reading the pixels
+        GLenum format = imageFormat(container.channels());
+        GLenum blockFormat = blockInternalFormat(container.blockFormat());
+        for (unsigned int l = 0; l < container.levelCount(); l++) {
+            const TextureLevel& level = container.level(l);
+            if (!blockFormat)
+                glTexSubImage2D(face, l, 0, 0, level.width, level.height, format, GL_UNSIGNED_BYTE, base + level.offset);
+            else if (define)
+                glCompressedTexImage2D(face, l, blockFormat, level.width, level.height, 0, (GLsizei)level.size, base + level.offset);
+            else
+                glCompressedTexSubImage2D(face, l, 0, 0, level.width, level.height, blockFormat, (GLsizei)level.size,
+                    base + level.offset);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    // render thread
+    void upload(AssetJob* job)
+    {
+        if (job->kind == ASSET_MESH) {
+            MeshAsset* asset = job->mesh;
+            if (asset->discarded) {
+                eraseMesh(asset);
+                return;
+            }
+            ContentOwner owner;
+            if (job->duplicate && contentOwner(job, owner)) {
+                DuplicateAsset duplicate = { ASSET_MESH, 0, 0, asset, owner.mesh };
+                duplicates.push_back(duplicate);
+                eraseMesh(asset);
+                return;
+            }
+            if (job->loaded)
+                asset->gpu = uploadMesh(asset->mesh);
+            asset->state = job->loaded ? MESH_ASSET_READY : MESH_ASSET_FAILED;
+            return;
+        }
+        int faces = job->kind == ASSET_CUBEMAP ? 6 : 1;
+        ContentOwner owner;
+        if (job->discard) {
+            forgetContent(job->texture, NULL);
+            glDeleteTextures(1, &job->texture);
+        } else if (job->duplicate && contentOwner(job, owner)) {
+            glDeleteTextures(1, &job->texture);
+            DuplicateAsset duplicate = { job->kind, job->texture, owner.texture, NULL, NULL };
+            duplicates.push_back(duplicate);
+        } else if (!job->loaded) {
+            for (int i = 0; i < faces; i++)
+                if (!job->images[i].error.empty())
+                    std::cout << "ERROR::TEXTURE::LOAD_FAILED: " << job->paths[i] << "\n" << job->images[i].error << std::endl;
+        } else {
+            // rows of 1 and 3 channel images are not 4 byte aligned
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            GLenum target = job->kind == ASSET_TEXTURE ? GL_TEXTURE_2D : GL_TEXTURE_CUBE_MAP;
+            glBindTexture(target, job->texture);
+            bool allocated = allocateLevels(target, job->images, faces);
+            for (int i = 0; i < faces; i++)
+                uploadLevels(faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + i : target, job->images[i], !allocated);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        }
+        // the staged regions are reused once the GPU has read them (right away for a failed cube map)
+        for (int i = 0; i < faces; i++)
+            if (job->images[i].staged)
+                ring.fence(job->images[i].ringOffset);
+    }
+
+    void eraseMesh(MeshAsset* asset)
+    {
+        forgetContent(0, asset);
+        for (size_t i = 0; i < meshes.size(); i++) {
+            if (meshes[i].get() == asset) {
+                meshes.erase(meshes.begin() + i);
+                return;
+            }
+        }
+    }
+
+    // a job that will never be uploaded; its texture was already given up on or lives on as a placeholder
+    static void dropJob(AssetJob* job)
+    {
+        if (job->discard)
+            glDeleteTextures(1, &job->texture);
+        freeJob(job);
+    }
+
+    static void freeJob(AssetJob* job)
+    {
+        delete job;
+    }
+
+    void work()
+    {
+        for (;;) {
+            AssetJob* job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                while (!stopping && queued.empty())
+                    wake.wait(lock);
+                if (stopping)
+                    return;
+                job = queued.front();
+                queued.pop_front();
+            }
+            if (run(job))
+                finished.push(job);
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<AssetJob*> queued; // guarded by mutex
+    bool stopping;                // guarded by mutex
+    FinishedJobStack finished;
+    std::deque<AssetJob*> pending; // render thread: finished, waiting for budget
+    std::atomic<unsigned int> inFlight;
+    std::vector<std::unique_ptr<MeshAsset> > meshes;
+    std::map<GLuint, AssetJob*> textureJobs; // render thread: textures whose job is not uploaded yet
+    std::vector<DuplicateAsset> duplicates;  // render thread: dropped since the last takeDuplicates()
+    std::atomic<bool> sharing;
+    std::mutex contentMutex;
+    std::map<unsigned long long, ContentOwner> contents; // guarded by contentMutex: content key -> owner
+    std::map<GLuint, unsigned long long> textureContents; // guarded by contentMutex: owners' keys
+    std::map<const MeshAsset*, unsigned long long> meshContents;
+    UploadRing ring;
+};
+#endif
@@ -0,0 +1,32 @@
+#ifndef BENCH_FILES_H
+#define BENCH_FILES_H
+
+#include <cstdio>
+#include <vector>
+
+// helpers shared by the image decoding benchmarks
+
+// the whole file; false when it is missing or empty
+inline bool readFile(const char* path, std::vector<unsigned char>& bytes)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    bytes.resize(size > 0 ? size : 0);
+    bool ok = size > 0 && fread(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    fclose(file);
+    return ok;
+}
+
+// FNV-1a, the hashes the decode checks compare against
+inline unsigned int hashPixels(const unsigned char* pixels, size_t size)
+{
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ pixels[i]) * 16777619u;
+    return hash;
+}
+#endif
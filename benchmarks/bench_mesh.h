@@ -0,0 +1,48 @@
+#ifndef BENCH_MESH_H
+#define BENCH_MESH_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+#include "mesh.h"
+
+// test meshes shared by the mesh benchmarks; tiny_obj_loader.h has to be included first, as for mesh.h
+
+// rings x segments uv sphere with radius 1 + bump sin(5 theta) sin(5 phi), closed: the first and last
+// column share positions (the uv seam) and the zero area triangles at the poles are left out.
+// A bump of 0.3 makes it occlude itself from most directions
+inline MeshData makeBumpySphere(int rings, int segments, float bump)
+{
+    MeshData mesh;
+    for (int r = 0; r <= rings; r++) {
+        float theta = 3.14159265f * r / rings;
+        for (int s = 0; s <= segments; s++) {
+            float phi = 2.0f * 3.14159265f * (s % segments) / segments;
+            float radius = 1.0f + bump * std::sin(5.0f * theta) * std::sin(5.0f * phi);
+            glm::vec3 direction(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            glm::vec3 p = direction * radius;
+            GLfloat vertex[VERTEX_FLOATS] = { p.x, p.y, p.z, direction.x, direction.y, direction.z,
+                (float)s / segments, (float)r / rings, 1.0f, 0.0f, 0.0f, 1.0f };
+            mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + VERTEX_FLOATS);
+        }
+    }
+    for (int r = 0; r < rings; r++) {
+        for (int s = 0; s < segments; s++) {
+            GLuint a = r * (segments + 1) + s;
+            GLuint b = a + segments + 1;
+            if (r > 0) {
+                GLuint top[3] = { a, a + 1, b };
+                mesh.indices.insert(mesh.indices.end(), top, top + 3);
+            }
+            if (r < rings - 1) {
+                GLuint bottom[3] = { a + 1, b + 1, b };
+                mesh.indices.insert(mesh.indices.end(), bottom, bottom + 3);
+            }
+        }
+    }
+    mesh.boundsMin = glm::vec3(-1.0f - bump);
+    mesh.boundsMax = glm::vec3(1.0f + bump);
+    return mesh;
+}
+#endif
@@ -0,0 +1,191 @@
+// Encodes images into the block formats of block_compression.h and decodes them again, reporting the
+// encode time and the quality (PSNR against the source) without a GPU. "check" runs synthetic images
+// through every format against quality floors and compares the SSE2 palette fit with the scalar one.
+//
+// build (from the repository root):
+//   g++ -O2 -std=c++14 -I. -IDependencies/include benchmarks/block_compression_bench.cpp -o block_compression_bench
+//   cl /O2 /EHsc /I. /IDependencies\include benchmarks\block_compression_bench.cpp
+// (add -DBLOCK_COMPRESSION_NO_SIMD to time the scalar palette fit)
+// run:
+//   block_compression_bench check
+//   block_compression_bench 3D/Wood066_1K_Color.jpg 3D/12/yae.png 3D/Quiz_3/Models/brickwall_normal.jpg
+
+#include "block_compression.h"
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+static const char* formatName(BlockFormat format)
+{
+    static const char* names[] = { "none", "BC1", "BC3", "BC5", "BC7" };
+    return names[format];
+}
+
+// over the masked RGBA channels of the decoded texels; 99 for an exact match
+static double psnr(const unsigned char* pixels, unsigned int width, unsigned int height, unsigned int channels,
+    const unsigned char* rgba, unsigned int mask)
+{
+    double sum = 0.0;
+    size_t count = 0;
+    for (size_t i = 0; i < (size_t)width * height; i++) {
+        unsigned char source[4];
+        const unsigned char* p = pixels + i * channels;
+        source[0] = p[0];
+        source[1] = channels >= 3 ? p[1] : p[0];
+        source[2] = channels >= 3 ? p[2] : p[0];
+        source[3] = channels == 4 ? p[3] : channels == 2 ? p[1] : 255;
+        for (int c = 0; c < 4; c++) {
+            if (mask >> c & 1) {
+                double d = (double)source[c] - rgba[i * 4 + c];
+                sum += d * d;
+                count++;
+            }
+        }
+    }
+    double mse = sum / count;
+    return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+}
+
+struct Result {
+    double milliseconds;
+    double quality;
+    size_t bytes;
+};
+
+static Result roundTrip(const unsigned char* pixels, unsigned int width, unsigned int height, unsigned int channels,
+    BlockFormat format, unsigned int mask)
+{
+    std::vector<unsigned char> blocks(compressedSize(format, width, height));
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    compressImage(pixels, width, height, channels, format, blocks.data());
+    Result result;
+    result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::vector<unsigned char> rgba((size_t)width * height * 4);
+    if (!decompressImage(blocks.data(), width, height, format, rgba.data()))
+        printf("%s: undecodable block\n", formatName(format));
+    result.quality = psnr(pixels, width, height, channels, rgba.data(), mask);
+    result.bytes = blocks.size();
+    return result;
+}
+
+static bool check()
+{
+    bool ok = true;
+
+    // identical fits, scalar and SSE2, on random blocks and palettes
+    srand(1);
+    int mismatches = 0;
+    for (int trial = 0; trial < 10000; trial++) {
+        unsigned char texels[64], palette[64], a[16], b[16];
+        for (int i = 0; i < 64; i++) {
+            texels[i] = (unsigned char)(rand() & 255);
+            palette[i] = (unsigned char)(rand() & 255);
+        }
+        unsigned int channels = trial % 2 ? BLOCK_CHANNELS_RGBA : 1u << (trial / 2 % 4);
+        unsigned int e0 = fitPaletteScalar(texels, palette, 16, channels, a);
+        unsigned int e1 = fitPalette(texels, palette, 16, channels, b);
+        if (e0 != e1 || std::memcmp(a, b, 16) != 0)
+            mismatches++;
+    }
+#ifdef BLOCK_COMPRESSION_SSE2
+    printf("palette fit: SSE2 against scalar, %d mismatches in 10000 blocks: %s\n", mismatches, mismatches ? "WRONG" : "ok");
+#else
+    printf("palette fit: scalar build, nothing to compare\n");
+#endif
+    ok = ok && mismatches == 0;
+
+    // a smooth color field, the same with a cutout alpha and a bumpy normal map, 130x70 for partial blocks
+    const unsigned int width = 130, height = 70;
+    std::vector<unsigned char> color(width * height * 4), opaque(width * height * 3), normals(width * height * 3);
+    for (unsigned int y = 0; y < height; y++) {
+        for (unsigned int x = 0; x < width; x++) {
+            unsigned char* c = &color[(y * width + x) * 4];
+            c[0] = (unsigned char)(x * 255 / width);
+            c[1] = (unsigned char)(y * 255 / height);
+            c[2] = (unsigned char)(128 + 100 * std::sin(x * 0.1) * std::cos(y * 0.13));
+            c[3] = (x / 9 + y / 7) % 3 == 0 ? 0 : (x / 9 + y / 7) % 3 == 1 ? 255 : (unsigned char)(x * 2);
+            std::memcpy(&opaque[(y * width + x) * 3], c, 3);
+            float nx = 0.4f * std::sin(x * 0.2f), ny = 0.4f * std::cos(y * 0.17f);
+            float nz = std::sqrt(1.0f - nx * nx - ny * ny);
+            unsigned char* n = &normals[(y * width + x) * 3];
+            n[0] = (unsigned char)((nx * 0.5f + 0.5f) * 255.0f + 0.5f);
+            n[1] = (unsigned char)((ny * 0.5f + 0.5f) * 255.0f + 0.5f);
+            n[2] = (unsigned char)((nz * 0.5f + 0.5f) * 255.0f + 0.5f);
+        }
+    }
+    struct Case {
+        const unsigned char* pixels;
+        unsigned int channels;
+        BlockFormat format;
+        unsigned int mask;
+        double floor;
+    } cases[] = {
+        { opaque.data(), 3, BLOCK_BC1, BLOCK_CHANNELS_RGB, 36.0 },
+        { opaque.data(), 3, BLOCK_BC7, BLOCK_CHANNELS_RGB, 40.0 },
+        { color.data(), 4, BLOCK_BC3, 8, 40.0 },
+        { color.data(), 4, BLOCK_BC7, BLOCK_CHANNELS_RGBA, 36.0 },
+        { normals.data(), 3, BLOCK_BC5, 3, 44.0 },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        const Case& c = cases[i];
+        Result result = roundTrip(c.pixels, width, height, c.channels, c.format, c.mask);
+        bool pass = result.quality >= c.floor;
+        printf("%s (%s): %.1f dB (floor %.0f): %s\n", formatName(c.format), c.mask == 8 ? "alpha" : c.mask == 3 ? "xy" :
+            c.mask == BLOCK_CHANNELS_RGB ? "rgb" : "rgba", result.quality, c.floor, pass ? "ok" : "WRONG");
+        ok = ok && pass;
+    }
+
+    // cutout alpha keeps 0 and 255 exact (the six value BC4 mode)
+    std::vector<unsigned char> blocks(compressedSize(BLOCK_BC3, width, height)), rgba(width * height * 4);
+    compressImage(color.data(), width, height, 4, BLOCK_BC3, blocks.data());
+    decompressImage(blocks.data(), width, height, BLOCK_BC3, rgba.data());
+    int wrongCutouts = 0;
+    for (size_t i = 0; i < (size_t)width * height; i++)
+        if ((color[i * 4 + 3] == 0 || color[i * 4 + 3] == 255) && rgba[i * 4 + 3] != color[i * 4 + 3])
+            wrongCutouts++;
+    printf("BC3 cutout texels off: %d: %s\n", wrongCutouts, wrongCutouts ? "WRONG" : "ok");
+    return ok && wrongCutouts == 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || std::string(argv[1]) == "check")
+        return check() ? 0 : 1;
+
+    for (int i = 1; i < argc; i++) {
+        int width, height, channels;
+        unsigned char* pixels = stbi_load(argv[i], &width, &height, &channels, 0);
+        if (!pixels) {
+            printf("%s: %s\n", argv[i], stbi_failure_reason());
+            continue;
+        }
+        std::string path = argv[i];
+        bool normalMap = path.find("normal") != std::string::npos || path.find("_N.") != std::string::npos;
+        bool alpha = hasTranslucency(pixels, (size_t)width * height, channels);
+        // what the loader picks, plus BC1 and BC7 side by side for opaque color
+        std::vector<BlockFormat> formats;
+        if (normalMap)
+            formats.push_back(BLOCK_BC5);
+        else if (alpha)
+            formats.push_back(BLOCK_BC3), formats.push_back(BLOCK_BC7);
+        else
+            formats.push_back(BLOCK_BC1), formats.push_back(BLOCK_BC7);
+        // drivers store RGB8 as RGBA8
+        size_t uncompressed = (size_t)width * height * 4;
+        printf("%s (%dx%dx%d):\n", argv[i], width, height, channels);
+        for (size_t f = 0; f < formats.size(); f++) {
+            unsigned int mask = formats[f] == BLOCK_BC5 ? 3 : alpha ? BLOCK_CHANNELS_RGBA : BLOCK_CHANNELS_RGB;
+            Result result = roundTrip(pixels, width, height, channels, formats[f], mask);
+            printf("  %s: %.1f ms, %.2f dB, %zu KB (%.0fx smaller)\n", formatName(formats[f]), result.milliseconds,
+                result.quality, result.bytes / 1024, (double)uncompressed / result.bytes);
+        }
+        stbi_image_free(pixels);
+    }
+    return 0;
+}
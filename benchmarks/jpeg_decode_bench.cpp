@@ -0,0 +1,287 @@
+// Times stbi_load_from_memory on JPEGs already read into memory, with the image's own channel count (what the
+// texture loaders ask for) and with 4, and prints a hash of the decoded pixels. "check" runs the IDCT,
+// 2x2 upsampling and YCbCr-to-RGB kernels on random input and compares them with the generic C versions, then
+// decodes the repository's JPEGs and compares the hashes with the ones the stock stb_image 2.27 decoder
+// produced. "kernels" times each kernel alone: generic C, SSE2 and AVX2.
+//
+// build (from the repository root):
+//   g++ -O2 -std=c++14 -I. -IDependencies/include benchmarks/jpeg_decode_bench.cpp -o jpeg_decode_bench
+//   cl /O2 /EHsc /I. /IDependencies\include benchmarks\jpeg_decode_bench.cpp
+// (add -DSTBI_NO_AVX2 to decode with the SSE2 kernels, -DSTBI_NO_SIMD for the generic C ones)
+// run (from the repository root):
+//   jpeg_decode_bench check
+//   jpeg_decode_bench kernels
+//   jpeg_decode_bench 3D/13Mats/brickwall.jpg 3D/Wood066_1K_Color.jpg 3D/Objects/textures/Eye_D.jpg
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "bench_files.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const char* kernelSet()
+{
+#ifdef STBI_AVX2
+    if (stbi__avx2_available())
+        return "AVX2";
+#endif
+#ifdef STBI_SSE2
+    return "SSE2";
+#else
+    return "generic C";
+#endif
+}
+
+typedef void (*IdctKernel)(stbi_uc* out, int out_stride, short data[64]);
+typedef void (*ColorKernel)(stbi_uc* out, const stbi_uc* y, const stbi_uc* pcb, const stbi_uc* pcr, int count, int step);
+typedef stbi_uc* (*UpsampleKernel)(stbi_uc* out, stbi_uc* in_near, stbi_uc* in_far, int w, int hs);
+
+struct Kernels {
+    const char* name;
+    IdctKernel idct;
+    ColorKernel color;
+    UpsampleKernel upsample;
+};
+
+// the generic C kernels first
+static std::vector<Kernels> availableKernels()
+{
+    std::vector<Kernels> kernels;
+    Kernels generic = { "generic C", stbi__idct_block, stbi__YCbCr_to_RGB_row, stbi__resample_row_hv_2 };
+    kernels.push_back(generic);
+#ifdef STBI_SSE2
+    Kernels sse2 = { "SSE2", stbi__idct_simd, stbi__YCbCr_to_RGB_simd, stbi__resample_row_hv_2_simd };
+    kernels.push_back(sse2);
+#endif
+#ifdef STBI_AVX2
+    if (stbi__avx2_available()) {
+        Kernels avx2 = { "AVX2", stbi__idct_avx2, stbi__YCbCr_to_RGB_avx2, stbi__resample_row_hv_2_avx2 };
+        kernels.push_back(avx2);
+    }
+#endif
+    return kernels;
+}
+
+// dequantized coefficients like a real stream has them: mostly zero past the first few, the DC the largest
+static void randomBlock(short* data)
+{
+    for (int i = 0; i < 64; i++) {
+        int range = i == 0 ? 1024 : (rand() % 4 == 0 ? 512 : 0);
+        data[i] = range ? (short)(rand() % (2 * range) - range) : 0;
+    }
+}
+
+static bool checkKernels(const Kernels& reference, const Kernels& kernels)
+{
+    // outputs get a guard band, the kernels may not write past count*step (+1 for the generic fourth byte)
+    const int guard = 64;
+    bool idctOk = true, colorOk = true, upsampleOk = true;
+    for (int run = 0; run < 20000 && idctOk; run++) {
+        STBI_SIMD_ALIGN(short, data[64]);
+        STBI_SIMD_ALIGN(short, copy[64]);
+        randomBlock(data);
+        memcpy(copy, data, sizeof(copy));
+        // stride wider than 8 like the component buffers
+        unsigned char expected[16 * 8], actual[16 * 8];
+        memset(expected, 0xcd, sizeof(expected));
+        memset(actual, 0xcd, sizeof(actual));
+        reference.idct(expected, 16, data);
+        kernels.idct(actual, 16, copy);
+        idctOk = memcmp(expected, actual, sizeof(expected)) == 0;
+    }
+    for (int count = 1; count <= 200 && colorOk; count++) {
+        std::vector<unsigned char> y(count), cb(count), cr(count);
+        for (int i = 0; i < count; i++) {
+            y[i] = (unsigned char)rand();
+            cb[i] = (unsigned char)rand();
+            cr[i] = (unsigned char)rand();
+        }
+        for (int step = 3; step <= 4; step++) {
+            std::vector<unsigned char> expected(count * step + guard, 0xcd), actual(count * step + guard, 0xcd);
+            reference.color(expected.data(), y.data(), cb.data(), cr.data(), count, step);
+            kernels.color(actual.data(), y.data(), cb.data(), cr.data(), count, step);
+            colorOk = colorOk && expected == actual;
+        }
+    }
+    for (int w = 1; w <= 200 && upsampleOk; w++) {
+        std::vector<unsigned char> inNear(w), inFar(w);
+        for (int i = 0; i < w; i++) {
+            inNear[i] = (unsigned char)rand();
+            inFar[i] = (unsigned char)rand();
+        }
+        std::vector<unsigned char> expected(w * 2 + guard, 0xcd), actual(w * 2 + guard, 0xcd);
+        reference.upsample(expected.data(), inNear.data(), inFar.data(), w, 2);
+        kernels.upsample(actual.data(), inNear.data(), inFar.data(), w, 2);
+        upsampleOk = expected == actual;
+    }
+    printf("%s kernels against %s: idct %s, YCbCr to RGB(A) %s, 2x2 upsampling %s\n", kernels.name, reference.name,
+        idctOk ? "ok" : "WRONG", colorOk ? "ok" : "WRONG", upsampleOk ? "ok" : "WRONG");
+    return idctOk && colorOk && upsampleOk;
+}
+
+struct Decode {
+    bool ok;
+    int width, height, channels;
+    unsigned int hash;
+    double milliseconds; // best of the runs
+};
+
+static Decode decode(const std::vector<unsigned char>& bytes, int components, int runs)
+{
+    Decode result = { false, 0, 0, 0, 0, 0.0 };
+    for (int run = 0; run < runs; run++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        unsigned char* pixels = stbi_load_from_memory(bytes.data(), (int)bytes.size(), &result.width, &result.height,
+            &result.channels, components);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (!pixels)
+            return result;
+        if (run == 0 || ms < result.milliseconds)
+            result.milliseconds = ms;
+        if (run == 0)
+            result.hash = hashPixels(pixels,
+                (size_t)result.width * result.height * (components ? components : result.channels));
+        stbi_image_free(pixels);
+    }
+    result.ok = true;
+    return result;
+}
+
+static bool check()
+{
+    bool ok = true;
+    std::vector<Kernels> kernels = availableKernels();
+    for (size_t i = 1; i < kernels.size(); i++)
+        ok = checkKernels(kernels[0], kernels[i]) && ok;
+    if (kernels.size() == 1)
+        printf("no SIMD kernels in this build\n");
+
+    struct Expected {
+        const char* path;
+        unsigned int hash;  // own channel count
+        unsigned int hash4; // 4 channels
+    } expected[] = {
+        { "3D/13Mats/brickwall.jpg", 0x8553ad01u, 0xe553cef5u },
+        { "3D/13Mats/brickwall_normal.jpg", 0x16b863a8u, 0xaf7fcab8u },
+        { "3D/Grass001_1K_Color.jpg", 0x5b61bf12u, 0x126d40feu },
+        { "3D/Marble016_1K_Color.jpg", 0x20d56afcu, 0x5c6781a4u },
+        { "3D/Objects/textures/Eye_D.jpg", 0x0673196cu, 0x94b3cdbcu },
+        { "3D/Objects/textures/Eye_N.jpg", 0x747e9552u, 0x50dedcdeu },
+        { "3D/Objects/textures/REF 1.jpg", 0x8721ca0cu, 0xd2b4835au },
+        { "3D/Wood066_1K_Color.jpg", 0xaf84a945u, 0xd2b0546bu },
+        { "3D/balls/Pokeball3.jpg", 0xe0a739c3u, 0x0a86e1c9u },
+        { "3D/partenza.jpg", 0x927bf830u, 0xf0f90906u },
+    };
+    printf("decoding with the %s kernels\n", kernelSet());
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        std::vector<unsigned char> bytes;
+        if (!readFile(expected[i].path, bytes)) {
+            printf("%s: cannot read (run from the repository root)\n", expected[i].path);
+            ok = false;
+            continue;
+        }
+        Decode own = decode(bytes, 0, 1);
+        Decode four = decode(bytes, 4, 1);
+        bool same = own.ok && own.hash == expected[i].hash && four.ok && four.hash == expected[i].hash4;
+        printf("%s: %08x %08x (expect %08x %08x): %s\n", expected[i].path, own.hash, four.hash, expected[i].hash,
+            expected[i].hash4, same ? "ok" : "WRONG");
+        ok = ok && same;
+    }
+    return ok;
+}
+
+template <typename Work>
+static double bestMilliseconds(int runs, Work work)
+{
+    double best = 0.0;
+    for (int run = 0; run < runs; run++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        work();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (run == 0 || ms < best)
+            best = ms;
+    }
+    return best;
+}
+
+// a 1024x1024 image's worth of work per kernel
+static void timeKernels()
+{
+    const int size = 1024, blocks = size * size / 64;
+    std::vector<short> coefficients(blocks * 64 + 8);
+    // 16-byte aligned for the SSE2 loads
+    short* aligned = (short*)(((size_t)coefficients.data() + 15) & ~(size_t)15);
+    for (int b = 0; b < blocks; b++)
+        randomBlock(aligned + b * 64);
+    std::vector<unsigned char> plane(size * size), y(size), cb(size), cr(size), rows(size * 4 + 64);
+    for (int i = 0; i < size; i++) {
+        y[i] = (unsigned char)rand();
+        cb[i] = (unsigned char)rand();
+        cr[i] = (unsigned char)rand();
+    }
+
+    std::vector<Kernels> kernels = availableKernels();
+    double baseline[4] = { 0.0, 0.0, 0.0, 0.0 };
+    for (size_t k = 0; k < kernels.size(); k++) {
+        const Kernels& kernel = kernels[k];
+        double times[4];
+        times[0] = bestMilliseconds(10, [&]() {
+            for (int b = 0; b < blocks; b++)
+                kernel.idct(plane.data() + (b / (size / 8)) * 8 * size + (b % (size / 8)) * 8, size, aligned + b * 64);
+        });
+        // 4:2:0 chroma: size/2 wide rows, upsampled for every output row
+        times[1] = bestMilliseconds(10, [&]() {
+            for (int row = 0; row < size; row++)
+                kernel.upsample(rows.data(), plane.data() + (row / 2) * size, plane.data() + (row / 2) * size + size, size / 2, 2);
+        });
+        for (int step = 3; step <= 4; step++)
+            times[step - 1] = bestMilliseconds(10, [&]() {
+                for (int row = 0; row < size; row++)
+                    kernel.color(rows.data(), y.data(), cb.data(), cr.data(), size, step);
+            });
+        if (k == 0)
+            memcpy(baseline, times, sizeof(baseline));
+        printf("%-9s idct %.2f ms (%.1fx), 2x2 upsampling %.2f ms (%.1fx), YCbCr to RGB %.2f ms (%.1fx), "
+            "to RGBA %.2f ms (%.1fx)\n", kernel.name, times[0], baseline[0] / times[0], times[1],
+            baseline[1] / times[1], times[2], baseline[2] / times[2], times[3], baseline[3] / times[3]);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || std::string(argv[1]) == "check")
+        return check() ? 0 : 1;
+    if (std::string(argv[1]) == "kernels") {
+        timeKernels();
+        return 0;
+    }
+
+    printf("%s kernels\n", kernelSet());
+    double total = 0.0, total4 = 0.0;
+    for (int i = 1; i < argc; i++) {
+        std::vector<unsigned char> bytes;
+        if (!readFile(argv[i], bytes)) {
+            printf("%s: cannot read\n", argv[i]);
+            continue;
+        }
+        Decode own = decode(bytes, 0, 10);
+        Decode four = decode(bytes, 4, 10);
+        if (!own.ok || !four.ok) {
+            printf("%s: %s\n", argv[i], stbi_failure_reason());
+            continue;
+        }
+        double megapixels = (double)own.width * own.height / 1e6;
+        printf("%s (%dx%dx%d, %zu KB): %.2f ms, %.0f Mpixel/s (4 channels %.2f ms), hash %08x\n", argv[i], own.width,
+            own.height, own.channels, bytes.size() / 1024, own.milliseconds, megapixels / (own.milliseconds / 1000.0),
+            four.milliseconds, own.hash);
+        total += own.milliseconds;
+        total4 += four.milliseconds;
+    }
+    printf("total %.2f ms (4 channels %.2f ms)\n", total, total4);
+    return 0;
+}
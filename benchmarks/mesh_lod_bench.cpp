@@ -0,0 +1,128 @@
+// Times generateLods on a bumpy sphere and checks each level: triangle count against
+// MESH_LOD_RATIOS, (almost) no inward facing triangles, and the measured distance from
+// the full mesh's vertices to the level's surface, which must not exceed the error the
+// level reports (selectLod relies on it as a bound). The distance along the radius is
+// printed too; it is larger wherever the ray meets the level's triangles at a slant.
+// Also prints which level Model3D's selection picks as the sphere moves away.
+//
+// build (from the repository root):
+//   g++ -O2 -std=c++14 -I. -IDependencies/include benchmarks/mesh_lod_bench.cpp -o mesh_lod_bench
+//   cl /O2 /EHsc /I. /IDependencies\include benchmarks\mesh_lod_bench.cpp
+
+// mesh.h expects the tinyobj declarations
+#include "tiny_obj_loader.h"
+#include "mesh_lod.h"
+#include "bench_mesh.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+static glm::vec3 positionOf(const MeshData& mesh, GLuint v)
+{
+    const GLfloat* p = &mesh.vertices[(size_t)v * VERTEX_FLOATS];
+    return glm::vec3(p[0], p[1], p[2]);
+}
+
+// largest distance from the full mesh's vertices to the closest point of the level's surface,
+// every 97th vertex against every triangle
+static float surfaceDistance(const MeshData& mesh, const MeshLod& lod)
+{
+    double worst = 0.0;
+    for (GLuint v = 0; v < mesh.vertexCount(); v += 97) {
+        glm::dvec3 target = glm::dvec3(positionOf(mesh, v));
+        double best = 1e300;
+        for (unsigned int i = lod.firstIndex; i < lod.firstIndex + lod.indexCount; i += 3) {
+            best = std::min(best, pointTriangleDistance(target, glm::dvec3(positionOf(mesh, mesh.indices[i])),
+                glm::dvec3(positionOf(mesh, mesh.indices[i + 1])), glm::dvec3(positionOf(mesh, mesh.indices[i + 2]))));
+        }
+        worst = std::max(worst, best);
+    }
+    return (float)worst;
+}
+
+// the same along the radial direction, sampled by ray casting from the centre (the sphere is star shaped)
+static float radialDistance(const MeshData& mesh, const MeshLod& lod)
+{
+    float worst = 0.0f;
+    for (GLuint v = 0; v < mesh.vertexCount(); v += 97) {
+        glm::vec3 target = positionOf(mesh, v);
+        glm::vec3 direction = glm::normalize(target);
+        float best = 1e30f;
+        for (unsigned int i = lod.firstIndex; i < lod.firstIndex + lod.indexCount; i += 3) {
+            glm::vec3 p0 = positionOf(mesh, mesh.indices[i]);
+            glm::vec3 p1 = positionOf(mesh, mesh.indices[i + 1]);
+            glm::vec3 p2 = positionOf(mesh, mesh.indices[i + 2]);
+            glm::vec3 e1 = p1 - p0, e2 = p2 - p0;
+            glm::vec3 h = glm::cross(direction, e2);
+            float det = glm::dot(e1, h);
+            if (std::fabs(det) < 1e-12f)
+                continue;
+            float u = glm::dot(-p0, h) / det;
+            glm::vec3 q = glm::cross(-p0, e1);
+            float w = glm::dot(direction, q) / det;
+            if (u < -1e-5f || w < -1e-5f || u + w > 1.00001f)
+                continue;
+            float t = glm::dot(e2, q) / det;
+            if (t > 0.0f)
+                best = std::min(best, std::fabs(t - glm::length(target)));
+        }
+        if (best < 1e30f)
+            worst = std::max(worst, best);
+    }
+    return worst;
+}
+
+int main()
+{
+    MeshData mesh = makeBumpySphere(250, 500, 0.1f);
+    optimizeMesh(mesh);
+    size_t fullIndices = mesh.indices.size();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    generateLods(mesh);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printf("%u vertices, %u triangles, generateLods %.1f ms\n", mesh.vertexCount(), (unsigned int)(fullIndices / 3), ms);
+    printf("%s\n\n", describeLods(mesh.lods).c_str());
+
+    bool ok = mesh.lods.size() == (size_t)MESH_MAX_LODS;
+    for (size_t level = 1; level < mesh.lods.size(); level++) {
+        const MeshLod& lod = mesh.lods[level];
+        float ratio = (float)lod.indexCount / (float)fullIndices;
+        unsigned int flipped = 0;
+        for (unsigned int i = lod.firstIndex; i < lod.firstIndex + lod.indexCount; i += 3) {
+            glm::vec3 p0 = positionOf(mesh, mesh.indices[i]);
+            glm::vec3 p1 = positionOf(mesh, mesh.indices[i + 1]);
+            glm::vec3 p2 = positionOf(mesh, mesh.indices[i + 2]);
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            // outward winding on a star shaped mesh
+            if (glm::dot(normal, p0 + p1 + p2) <= 0.0f)
+                flipped++;
+        }
+        float distance = surfaceDistance(mesh, lod);
+        bool bounded = distance <= lod.error * 1.0001f;
+        printf("level %zu: %5.2f%% of the triangles (target %5.2f%%), %u inward facing, reported error %.5f, "
+            "measured %.5f (radial %.5f)%s\n", level, ratio * 100.0f, MESH_LOD_RATIOS[level - 1] * 100.0f, flipped,
+            lod.error, distance, radialDistance(mesh, lod), bounded ? "" : " ERROR UNDERSTATED");
+        // a handful fold over where the uv sphere's slivers meet the locked poles
+        ok = ok && flipped * 1000 <= lod.indexCount / 3 && ratio <= MESH_LOD_RATIOS[level - 1] * 1.01f && bounded;
+    }
+
+    // what Model3D would draw at 750 px and a 60 degree fov, approaching and receding
+    float pixelsPerUnit = 1.0f / std::tan(glm::radians(30.0f)) * 750.0f * 0.5f;
+    int current = 0;
+    printf("\ndistance -> level:");
+    for (int step = 0; step < 40; step++) {
+        float distance = 0.05f * std::pow(1.4f, (float)(step < 20 ? step : 39 - step));
+        int finest = selectLod(mesh.lods, 1.0f, distance, pixelsPerUnit, LOD_MAX_PIXEL_ERROR);
+        int coarsest = selectLod(mesh.lods, 1.0f, distance, pixelsPerUnit, LOD_MAX_PIXEL_ERROR * (1.f - LOD_HYSTERESIS));
+        if (finest < current)
+            current = finest;
+        else if (coarsest > current)
+            current = coarsest;
+        printf(" %g:%d", distance, current);
+    }
+    printf("\n%s\n", ok ? "all levels valid" : "LEVELS INVALID");
+    return ok ? 0 : 1;
+}
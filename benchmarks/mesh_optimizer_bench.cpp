@@ -0,0 +1,167 @@
+// Checks the import-time reordering in mesh_optimizer.h without a GPU:
+// post-transform cache efficiency comes from analyzeVertexCache, overdraw from
+// a small depth-tested rasterizer looking at the mesh from 14 directions.
+// The test mesh is a bumpy sphere with its triangles shuffled, the way an
+// exporter that writes faces in material or smoothing-group order leaves it.
+//
+// build (from the repository root):
+//   g++ -O2 -std=c++14 -I. -IDependencies/include benchmarks/mesh_optimizer_bench.cpp -o mesh_optimizer_bench
+//   cl /O2 /EHsc /I. /IDependencies\include benchmarks\mesh_optimizer_bench.cpp
+
+// mesh.h expects the tinyobj declarations
+#include "tiny_obj_loader.h"
+#include "mesh_optimizer.h"
+#include "bench_mesh.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static const int OVERDRAW_RESOLUTION = 256;
+
+static void shuffleTriangles(MeshData& mesh, unsigned int seed)
+{
+    size_t triangleCount = mesh.indices.size() / 3;
+    std::vector<size_t> order(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++)
+        order[t] = t;
+    std::shuffle(order.begin(), order.end(), std::mt19937(seed));
+    std::vector<GLuint> shuffled;
+    shuffled.reserve(mesh.indices.size());
+    for (size_t t = 0; t < triangleCount; t++)
+        shuffled.insert(shuffled.end(), mesh.indices.begin() + order[t] * 3, mesh.indices.begin() + order[t] * 3 + 3);
+    mesh.indices.swap(shuffled);
+}
+
+// pixels that passed the depth test / pixels covered, averaged over the views
+// back faces are culled and triangles drawn in index buffer order, like the GPU would
+static float analyzeOverdraw(const MeshData& mesh)
+{
+    std::vector<glm::vec3> views;
+    for (int x = -1; x <= 1; x++)
+        for (int y = -1; y <= 1; y++)
+            for (int z = -1; z <= 1; z++)
+                if ((x != 0) + (y != 0) + (z != 0) == 1 || (x != 0 && y != 0 && z != 0))
+                    views.push_back(glm::normalize(glm::vec3((float)x, (float)y, (float)z)));
+
+    const int size = OVERDRAW_RESOLUTION;
+    std::vector<float> depth(size * size);
+    size_t shaded = 0;
+    size_t covered = 0;
+    for (size_t v = 0; v < views.size(); v++) {
+        glm::vec3 forward = views[v];
+        glm::vec3 right = anyPerpendicular(forward);
+        glm::vec3 up = glm::cross(right, forward);
+        std::fill(depth.begin(), depth.end(), 1e30f);
+
+        for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3) {
+            glm::vec3 screen[3];
+            for (int c = 0; c < 3; c++) {
+                const GLfloat* p = &mesh.vertices[(size_t)mesh.indices[t + c] * VERTEX_FLOATS];
+                glm::vec3 position(p[0], p[1], p[2]);
+                // mesh fits in [-1.3, 1.3], map it onto the viewport
+                screen[c] = glm::vec3((glm::dot(position, right) / 2.6f + 0.5f) * size,
+                    (glm::dot(position, up) / 2.6f + 0.5f) * size, glm::dot(position, forward));
+            }
+            float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) -
+                (screen[1].y - screen[0].y) * (screen[2].x - screen[0].x);
+            if (area <= 0.0f)
+                continue;
+
+            int minX = std::max(0, (int)std::floor(std::min(screen[0].x, std::min(screen[1].x, screen[2].x))));
+            int maxX = std::min(size - 1, (int)std::ceil(std::max(screen[0].x, std::max(screen[1].x, screen[2].x))));
+            int minY = std::max(0, (int)std::floor(std::min(screen[0].y, std::min(screen[1].y, screen[2].y))));
+            int maxY = std::min(size - 1, (int)std::ceil(std::max(screen[0].y, std::max(screen[1].y, screen[2].y))));
+            for (int y = minY; y <= maxY; y++) {
+                for (int x = minX; x <= maxX; x++) {
+                    float px = x + 0.5f, py = y + 0.5f;
+                    float w0 = (screen[2].x - screen[1].x) * (py - screen[1].y) - (screen[2].y - screen[1].y) * (px - screen[1].x);
+                    float w1 = (screen[0].x - screen[2].x) * (py - screen[2].y) - (screen[0].y - screen[2].y) * (px - screen[2].x);
+                    float w2 = (screen[1].x - screen[0].x) * (py - screen[0].y) - (screen[1].y - screen[0].y) * (px - screen[0].x);
+                    if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                        continue;
+                    float z = (w0 * screen[0].z + w1 * screen[1].z + w2 * screen[2].z) / area;
+                    float& stored = depth[y * size + x];
+                    if (stored == 1e30f)
+                        covered++;
+                    if (z < stored) {
+                        stored = z;
+                        shaded++;
+                    }
+                }
+            }
+        }
+    }
+    return covered ? (float)shaded / (float)covered : 0.0f;
+}
+
+static void report(const char* label, const MeshData& mesh)
+{
+    VertexCacheStats stats = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount());
+    printf("%-22s ACMR %.3f  ATVR %.3f  overdraw %.3f\n", label, stats.acmr, stats.atvr, analyzeOverdraw(mesh));
+}
+
+int main()
+{
+    MeshData source = makeBumpySphere(200, 400, 0.3f);
+    shuffleTriangles(source, 1234);
+    printf("%u vertices, %u triangles, FIFO %u\n\n", source.vertexCount(),
+        (unsigned int)(source.indices.size() / 3), VERTEX_CACHE_SIMULATED_SIZE);
+    report("shuffled", source);
+
+    MeshData cacheOnly = source;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    optimizeVertexCache(cacheOnly.indices, cacheOnly.vertexCount());
+    double cacheMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    report("vertex cache", cacheOnly);
+
+    MeshData overdraw = cacheOnly;
+    start = std::chrono::steady_clock::now();
+    optimizeOverdraw(overdraw.indices, overdraw.vertices);
+    double overdrawMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    report("+ overdraw", overdraw);
+
+    MeshData full = source;
+    start = std::chrono::steady_clock::now();
+    MeshOptimizationReport result = optimizeMesh(full);
+    double fullMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    report("optimizeMesh", full);
+
+    // the passes only reorder: every triangle must survive with its winding
+    size_t triangleCount = source.indices.size() / 3;
+    std::vector<std::vector<float> > sourceTriangles(triangleCount), fullTriangles(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++) {
+        // rotate each triangle so its smallest key comes first, keeping the winding
+        for (int pass = 0; pass < 2; pass++) {
+            const MeshData& mesh = pass == 0 ? source : full;
+            std::vector<float>& key = pass == 0 ? sourceTriangles[t] : fullTriangles[t];
+            std::vector<float> corners[3];
+            for (int c = 0; c < 3; c++) {
+                const GLfloat* p = &mesh.vertices[(size_t)mesh.indices[t * 3 + c] * VERTEX_FLOATS];
+                corners[c].assign(p, p + VERTEX_FLOATS);
+            }
+            int first = 0;
+            for (int c = 1; c < 3; c++)
+                if (corners[c] < corners[first])
+                    first = c;
+            for (int c = 0; c < 3; c++)
+                key.insert(key.end(), corners[(first + c) % 3].begin(), corners[(first + c) % 3].end());
+        }
+    }
+    std::sort(sourceTriangles.begin(), sourceTriangles.end());
+    std::sort(fullTriangles.begin(), fullTriangles.end());
+    // and only the vertices no triangle uses (the sphere's pole corners) are dropped
+    std::vector<unsigned char> referenced(source.vertexCount(), 0);
+    for (size_t i = 0; i < source.indices.size(); i++)
+        referenced[source.indices[i]] = 1;
+    size_t referencedCount = std::count(referenced.begin(), referenced.end(), 1);
+    bool same = sourceTriangles == fullTriangles && full.vertexCount() == referencedCount;
+
+    printf("\noptimizeVertexCache %.1f ms, optimizeOverdraw %.1f ms, optimizeMesh %.1f ms\n", cacheMs, overdrawMs, fullMs);
+    printf("report: %s\n", describeVertexCache(result).c_str());
+    printf("triangles preserved: %s\n", same ? "yes" : "NO");
+    return same ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+// Compares peak memory of the two OBJ importers on a generated scan-like grid:
+// "full" is loadMeshCached (LoadObjParallel + the whole buildModel pipeline),
+// "stream" is loadMeshStreamed from mesh_stream.h. Peak memory is the process's,
+// so each mode runs in its own process. "check" imports a small grid both ways
+// without the optimisation passes and compares the packed vertices byte for byte.
+//
+// build (from the repository root):
+//   g++ -O2 -std=c++14 -I. -IDependencies/include benchmarks/mesh_stream_bench.cpp -o mesh_stream_bench -lpthread
+//   cl /O2 /EHsc /I. /IDependencies\include benchmarks\mesh_stream_bench.cpp
+// run:
+//   mesh_stream_bench check
+//   mesh_stream_bench stream 2000000
+//   mesh_stream_bench full 2000000
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+#include "mesh_stream.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+static double peakMegabytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+    return usage.ru_maxrss / 1024.0;
+#endif
+#endif
+}
+
+// a wavy height field with one vertex/normal/uv record per grid point, like a scan export
+static bool writeGrid(const char* path, int side)
+{
+    FILE* file = std::fopen(path, "w");
+    if (!file)
+        return false;
+    for (int y = 0; y <= side; y++) {
+        for (int x = 0; x <= side; x++) {
+            float u = (float)x / side, v = (float)y / side;
+            float h = 0.05f * std::sin(u * 40.0f) * std::cos(v * 31.0f);
+            std::fprintf(file, "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n",
+                u, h, v, u, v, -2.0f * std::cos(u * 40.0f) * std::cos(v * 31.0f), 1.0f, 0.0f);
+        }
+    }
+    for (int y = 0; y < side; y++) {
+        for (int x = 0; x < side; x++) {
+            int a = y * (side + 1) + x + 1;
+            int b = a + side + 1;
+            std::fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, b + 1, b + 1, b + 1, a + 1, a + 1, a + 1);
+        }
+    }
+    return std::fclose(file) == 0;
+}
+
+// the in-memory importer's packed vertices without optimisation, the reference for the streamed ones
+static PackedVertices referenceVertices(const char* path, VertexFormat format, MeshData& mesh)
+{
+    tinyobj::attrib_t attributes;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warning, error;
+    tinyobj::LoadObj(&attributes, &shapes, &materials, &warning, &error, path);
+    mesh = buildIndexedMesh(attributes, shapes[0].mesh);
+    return packVertices(mesh, format);
+}
+
+int main(int argc, char** argv)
+{
+    std::string mode = argc > 1 ? argv[1] : "check";
+    long triangles = argc > 2 ? std::atol(argv[2]) : 2000000;
+    const char* path = "mesh_stream_bench.obj";
+    std::string cachePath = std::string(path) + ".meshcache";
+
+    if (mode == "check") {
+        bool same = true;
+        for (int f = 0; f < 2; f++) {
+            VertexFormat format = f == 0 ? VERTEX_FORMAT_FLOAT : VERTEX_FORMAT_COMPACT;
+            writeGrid(path, 60);
+            std::remove(cachePath.c_str());
+            CachedMesh streamed;
+            std::string warning, error;
+            if (!loadMeshStreamed(path, streamed, &warning, &error, format)) {
+                printf("stream import failed: %s\n", error.c_str());
+                return 1;
+            }
+            MeshData mesh;
+            PackedVertices reference = referenceVertices(path, format, mesh);
+            std::vector<unsigned char> indices = packIndices(mesh);
+            bool vertices = reference.bytes.size() == streamed.vertexBytes() &&
+                std::memcmp(reference.bytes.data(), streamed.vertexData(), streamed.vertexBytes()) == 0;
+            bool sameIndices = indices.size() == streamed.indexBytes() &&
+                std::memcmp(indices.data(), streamed.indexData(), streamed.indexBytes()) == 0;
+            printf("%-7s %u vertices, %u indices: vertices %s, indices %s\n", f == 0 ? "float" : "compact",
+                streamed.vertexCount(), streamed.indexCount(), vertices ? "identical" : "DIFFER",
+                sameIndices ? "identical" : "DIFFER");
+            same = same && vertices && sameIndices;
+        }
+        std::remove(path);
+        std::remove(cachePath.c_str());
+        return same ? 0 : 1;
+    }
+
+    int side = (int)std::sqrt(triangles / 2.0);
+    if (!writeGrid(path, side)) {
+        printf("cannot write %s\n", path);
+        return 1;
+    }
+    std::remove(cachePath.c_str());
+    double before = peakMegabytes();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    CachedMesh mesh;
+    std::string warning, error;
+    MeshStreamStats stats = { 0, 0 };
+    bool loaded = mode == "stream" ? loadMeshStreamed(path, mesh, &warning, &error, VERTEX_FORMAT_COMPACT, &stats) :
+        loadMeshCached(path, mesh, &warning, &error, VERTEX_FORMAT_COMPACT);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!loaded) {
+        printf("import failed: %s\n", error.c_str());
+        return 1;
+    }
+
+    double output = (mesh.vertexBytes() + mesh.indexBytes()) / (1024.0 * 1024.0);
+    printf("%s: %d triangles, %u vertices in %.2f s\n", mode.c_str(), side * side * 2, mesh.vertexCount(), seconds);
+    printf("peak RSS %.1f MB (%.1f MB before import), GPU buffers %.1f MB\n", peakMegabytes(), before, output);
+    if (mode == "stream")
+        printf("importer arenas at peak %.1f MB\n", stats.peakBytes / (1024.0 * 1024.0));
+    std::remove(path);
+    std::remove(cachePath.c_str());
+    return 0;
+}
@@ -0,0 +1,110 @@
+// Builds meshlets for a bumpy sphere and culls them from a few cameras, checking the
+// culling is conservative: every triangle that faces the camera with a corner inside
+// the frustum has to belong to a surviving meshlet.
+//
+// build (from the repository root):
+//   g++ -O2 -std=c++14 -I. -IDependencies/include benchmarks/meshlet_bench.cpp -o meshlet_bench
+//   cl /O2 /EHsc /I. /IDependencies\include benchmarks\meshlet_bench.cpp
+
+// mesh.h expects the tinyobj declarations
+#include "tiny_obj_loader.h"
+#include "meshlet.h"
+#include "bench_mesh.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+static bool insideClip(const glm::mat4& mvp, glm::vec3 p)
+{
+    glm::vec4 clip = mvp * glm::vec4(p, 1.0f);
+    return std::fabs(clip.x) <= clip.w && std::fabs(clip.y) <= clip.w && std::fabs(clip.z) <= clip.w;
+}
+
+int main()
+{
+    MeshData mesh = makeBumpySphere(300, 600, 0.1f);
+    optimizeMesh(mesh);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    buildMeshlets(mesh);
+    double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    size_t triangleCount = mesh.indices.size() / 3;
+    double vertices = 0.0;
+    unsigned int cones = 0;
+    for (size_t i = 0; i < mesh.meshlets.size(); i++) {
+        std::vector<GLuint> unique(mesh.indices.begin() + mesh.meshlets[i].firstIndex,
+            mesh.indices.begin() + mesh.meshlets[i].firstIndex + mesh.meshlets[i].indexCount);
+        std::sort(unique.begin(), unique.end());
+        vertices += std::unique(unique.begin(), unique.end()) - unique.begin();
+        cones += mesh.meshlets[i].coneCutoff < 1.0f;
+    }
+    printf("%u triangles -> %u meshlets in %.1f ms: %.1f triangles, %.1f vertices each, %u with a usable cone\n\n",
+        (unsigned int)triangleCount, (unsigned int)mesh.meshlets.size(), buildMs,
+        (double)triangleCount / mesh.meshlets.size(), vertices / mesh.meshlets.size(), cones);
+
+    // triangle -> meshlet
+    std::vector<unsigned int> owner(triangleCount);
+    for (size_t i = 0; i < mesh.meshlets.size(); i++)
+        for (unsigned int t = mesh.meshlets[i].firstIndex / 3; t < (mesh.meshlets[i].firstIndex + mesh.meshlets[i].indexCount) / 3; t++)
+            owner[t] = static_cast<unsigned int>(i);
+
+    struct View { const char* name; glm::vec3 eye; float fov; };
+    View views[] = {
+        { "whole sphere, 60 deg", glm::vec3(0.0f, 0.0f, 4.0f), 60.0f },
+        { "close up, 60 deg", glm::vec3(0.0f, 0.0f, 1.6f), 60.0f },
+        { "tight, 15 deg", glm::vec3(0.0f, 0.5f, 3.0f), 15.0f },
+    };
+    glm::mat4 model = glm::scale(glm::mat4(1.0f), glm::vec3(2.0f));
+    bool ok = true;
+    for (size_t v = 0; v < sizeof(views) / sizeof(views[0]); v++) {
+        glm::vec3 eye = views[v].eye * 2.0f;
+        glm::mat4 viewMatrix = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 projection = glm::perspective(glm::radians(views[v].fov), 1.0f, 0.1f, 100.0f);
+        glm::mat4 viewProjection = projection * viewMatrix;
+
+        std::vector<GLsizei> counts;
+        std::vector<const void*> offsets;
+        start = std::chrono::steady_clock::now();
+        unsigned int visible = 0;
+        const int repeats = 100;
+        for (int i = 0; i < repeats; i++)
+            visible = cullMeshlets(mesh.meshlets, model, viewProjection, eye, GL_UNSIGNED_INT, counts, offsets);
+        double cullUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / repeats;
+
+        std::vector<unsigned char> survived(mesh.meshlets.size(), 0);
+        size_t submitted = 0;
+        for (size_t r = 0; r < counts.size(); r++) {
+            unsigned int first = (unsigned int)((size_t)offsets[r] / sizeof(GLuint));
+            submitted += counts[r];
+            for (size_t i = 0; i < mesh.meshlets.size(); i++)
+                if (mesh.meshlets[i].firstIndex >= first && mesh.meshlets[i].firstIndex < first + counts[r])
+                    survived[i] = 1;
+        }
+
+        // brute force: which triangles actually face the camera inside the frustum
+        unsigned int needed = 0, missed = 0;
+        for (size_t t = 0; t < triangleCount; t++) {
+            glm::vec3 p[3];
+            for (int c = 0; c < 3; c++)
+                p[c] = glm::vec3(model * glm::vec4(meshletPosition(mesh, mesh.indices[t * 3 + c]), 1.0f));
+            bool facing = glm::dot(glm::cross(p[1] - p[0], p[2] - p[0]), eye - p[0]) > 0.0f;
+            bool inside = insideClip(viewProjection, p[0]) || insideClip(viewProjection, p[1]) || insideClip(viewProjection, p[2]);
+            if (facing && inside) {
+                needed++;
+                if (!survived[owner[t]])
+                    missed++;
+            }
+        }
+        printf("%-22s %5u / %u meshlets, %u ranges, %5.1f%% of the indices (%.1f%% needed), %.0f us, %u visible triangles culled\n",
+            views[v].name, visible, (unsigned int)mesh.meshlets.size(), (unsigned int)counts.size(),
+            100.0 * submitted / mesh.indices.size(), 100.0 * needed / triangleCount, cullUs, missed);
+        ok = ok && missed == 0;
+    }
+    printf("\n%s\n", ok ? "culling conservative" : "CULLING DROPPED VISIBLE TRIANGLES");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,215 @@
+// Microbenchmark for tinyobj::tryParseDouble against the loader's previous
+// digit-loop + std::pow implementation, on a synthetic million-vertex .obj.
+// Also checks that every parsed value is bit-identical to strtod.
+//
+// build (from the repository root):
+//   g++ -O2 -std=c++14 -I. benchmarks/obj_float_bench.cpp -o obj_float_bench
+//   cl /O2 /EHsc /I. benchmarks\obj_float_bench.cpp
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// the parser tiny_obj_loader.h shipped with before the fast path
+static bool legacyParseDouble(const char* s, const char* s_end, double* result)
+{
+    if (s >= s_end)
+        return false;
+
+    double mantissa = 0.0;
+    int exponent = 0;
+    char sign = '+';
+    char exp_sign = '+';
+    const char* curr = s;
+    int read = 0;
+    bool end_not_reached = false;
+    bool leading_decimal_dots = false;
+
+    if (*curr == '+' || *curr == '-') {
+        sign = *curr;
+        curr++;
+        if ((curr != s_end) && (*curr == '.'))
+            leading_decimal_dots = true;
+    }
+    else if (IS_DIGIT(*curr)) {
+    }
+    else if (*curr == '.') {
+        leading_decimal_dots = true;
+    }
+    else {
+        return false;
+    }
+
+    end_not_reached = (curr != s_end);
+    if (!leading_decimal_dots) {
+        while (end_not_reached && IS_DIGIT(*curr)) {
+            mantissa *= 10;
+            mantissa += static_cast<int>(*curr - 0x30);
+            curr++;
+            read++;
+            end_not_reached = (curr != s_end);
+        }
+        if (read == 0)
+            return false;
+    }
+
+    if (!end_not_reached)
+        goto assemble;
+
+    if (*curr == '.') {
+        curr++;
+        read = 1;
+        end_not_reached = (curr != s_end);
+        while (end_not_reached && IS_DIGIT(*curr)) {
+            static const double pow_lut[] = {
+                1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001,
+            };
+            const int lut_entries = sizeof pow_lut / sizeof pow_lut[0];
+            mantissa += static_cast<int>(*curr - 0x30) *
+                (read < lut_entries ? pow_lut[read] : std::pow(10.0, -read));
+            read++;
+            curr++;
+            end_not_reached = (curr != s_end);
+        }
+    }
+    else if (*curr == 'e' || *curr == 'E') {
+    }
+    else {
+        goto assemble;
+    }
+
+    if (!end_not_reached)
+        goto assemble;
+
+    if (*curr == 'e' || *curr == 'E') {
+        curr++;
+        end_not_reached = (curr != s_end);
+        if (end_not_reached && (*curr == '+' || *curr == '-')) {
+            exp_sign = *curr;
+            curr++;
+        }
+        else if (IS_DIGIT(*curr)) {
+        }
+        else {
+            return false;
+        }
+
+        read = 0;
+        end_not_reached = (curr != s_end);
+        while (end_not_reached && IS_DIGIT(*curr)) {
+            if (exponent > (2147483647 / 10))
+                return false;
+            exponent *= 10;
+            exponent += static_cast<int>(*curr - 0x30);
+            curr++;
+            read++;
+            end_not_reached = (curr != s_end);
+        }
+        exponent *= (exp_sign == '+' ? 1 : -1);
+        if (read == 0)
+            return false;
+    }
+
+assemble:
+    *result = (sign == '+' ? 1 : -1) *
+        (exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent) : mantissa);
+    return true;
+}
+
+// one million "v x y z" lines in the styles exporters actually write
+static std::string makeSyntheticObj(int vertexCount)
+{
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<double> coord(-100.0, 100.0);
+    std::string obj;
+    obj.reserve(vertexCount * 40);
+    char line[128];
+    for (int i = 0; i < vertexCount; i++) {
+        switch (i % 4) {
+        case 0: snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", coord(rng), coord(rng), coord(rng)); break;
+        case 1: snprintf(line, sizeof(line), "v %.9g %.9g %.9g\n", coord(rng), coord(rng), coord(rng)); break;
+        case 2: snprintf(line, sizeof(line), "v %.17g %.17g %.17g\n", coord(rng), coord(rng), coord(rng)); break;
+        default: snprintf(line, sizeof(line), "v %.4e %.4e %.4e\n", coord(rng), coord(rng), coord(rng)); break;
+        }
+        obj += line;
+    }
+    return obj;
+}
+
+// [begin, end) of every number token in the file
+static void tokenize(const std::string& obj, std::vector<const char*>& begins, std::vector<const char*>& ends)
+{
+    const char* p = obj.c_str();
+    const char* end = p + obj.size();
+    while (p < end) {
+        if (*p == 'v' || *p == ' ' || *p == '\n') {
+            p++;
+            continue;
+        }
+        const char* tokenEnd = p + strcspn(p, " \n");
+        begins.push_back(p);
+        ends.push_back(tokenEnd);
+        p = tokenEnd;
+    }
+}
+
+template <typename Parser>
+static double timeParser(Parser parse, const std::vector<const char*>& begins,
+    const std::vector<const char*>& ends, double* checksum)
+{
+    double best = 1e30;
+    for (int run = 0; run < 5; run++) {
+        double sum = 0.0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < begins.size(); i++) {
+            double value = 0.0;
+            parse(begins[i], ends[i], &value);
+            sum += value;
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed.count() < best)
+            best = elapsed.count();
+        *checksum = sum;
+    }
+    return best;
+}
+
+int main(int argc, char** argv)
+{
+    int vertexCount = argc > 1 ? atoi(argv[1]) : 1000000;
+    std::string obj = makeSyntheticObj(vertexCount);
+
+    std::vector<const char*> begins, ends;
+    tokenize(obj, begins, ends);
+
+    size_t legacyMismatches = 0, fastMismatches = 0;
+    for (size_t i = 0; i < begins.size(); i++) {
+        std::string text(begins[i], ends[i]);
+        double expected = strtod(text.c_str(), NULL);
+        double legacy = 0.0, fast = 0.0;
+        legacyParseDouble(begins[i], ends[i], &legacy);
+        tinyobj::tryParseDouble(begins[i], ends[i], &fast);
+        legacyMismatches += memcmp(&legacy, &expected, sizeof(double)) != 0;
+        fastMismatches += memcmp(&fast, &expected, sizeof(double)) != 0;
+    }
+
+    double legacySum = 0.0, fastSum = 0.0;
+    double legacyMs = timeParser(legacyParseDouble, begins, ends, &legacySum);
+    double fastMs = timeParser(tinyobj::tryParseDouble, begins, ends, &fastSum);
+
+    std::cout << vertexCount << " vertices, " << begins.size() << " floats, "
+        << obj.size() / (1024 * 1024) << " MB\n";
+    std::cout << "legacy:  " << legacyMs << " ms, " << legacyMismatches << " values differ from strtod\n";
+    std::cout << "current: " << fastMs << " ms, " << fastMismatches << " values differ from strtod\n";
+    std::cout << "speedup: " << legacyMs / fastMs << "x\n";
+    return fastMismatches == 0 ? 0 : 1;
+}
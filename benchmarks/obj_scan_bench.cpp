@@ -0,0 +1,236 @@
+// Microbenchmark for tinyobj::LineScanner against the loader's previous
+// safeGetline + strspn/strcspn line splitting, on a synthetic mesh .obj.
+// Also checks that both split every line into the same tokens, that
+// LoadObjParallel gives the same attributes and shapes as LoadObj (on the
+// synthetic mesh and on small group/object/smoothing edge cases such as a
+// bare `g`), and times the full LoadObj on the same text.
+//
+// build (from the repository root):
+//   g++ -O2 -std=c++14 -I. benchmarks/obj_scan_bench.cpp -o obj_scan_bench
+//   g++ -O2 -mavx2 -std=c++14 -I. benchmarks/obj_scan_bench.cpp -o obj_scan_bench
+//   cl /O2 /EHsc /I. benchmarks\obj_scan_bench.cpp
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// v/vn/vt blocks followed by faces, roughly what a scanned mesh export looks like
+static std::string makeSyntheticObj(int vertexCount)
+{
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<double> coord(-100.0, 100.0);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::uniform_int_distribution<int> index(1, vertexCount);
+    std::string obj;
+    obj.reserve(vertexCount * 140);
+    char line[160];
+    for (int i = 0; i < vertexCount; i++) {
+        snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", coord(rng), coord(rng), coord(rng));
+        obj += line;
+        snprintf(line, sizeof(line), "vn %.4f %.4f %.4f\n", unit(rng), unit(rng), unit(rng));
+        obj += line;
+        snprintf(line, sizeof(line), "vt %.6f %.6f\n", unit(rng), unit(rng));
+        obj += line;
+    }
+    for (int i = 0; i < vertexCount * 2; i++) {
+        int a = index(rng), b = index(rng), c = index(rng);
+        snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, c, c, c);
+        obj += line;
+    }
+    return obj;
+}
+
+// the splitting LoadObj did before the scanner: one std::string per line,
+// then strspn/strcspn per token
+static size_t legacySplit(const std::string& obj, std::vector<size_t>* offsets)
+{
+    std::istringstream stream(obj);
+    std::string linebuf;
+    size_t tokens = 0;
+    while (stream.peek() != -1) {
+        tinyobj::safeGetline(stream, linebuf);
+        if (!linebuf.empty() && linebuf[linebuf.size() - 1] == '\r')
+            linebuf.erase(linebuf.size() - 1);
+        const char* token = linebuf.c_str();
+        token += strspn(token, " \t");
+        while (*token) {
+            size_t length = strcspn(token, " \t\r");
+            if (offsets)
+                offsets->push_back(length);
+            tokens++;
+            token += length;
+            token += strspn(token, " \t\r");
+        }
+    }
+    return tokens;
+}
+
+static size_t scannerSplit(const std::string& obj, std::vector<size_t>* offsets)
+{
+    tinyobj::LineScanner scanner(obj.data(), obj.data() + obj.size());
+    size_t tokens = 0;
+    while (scanner.NextLine()) {
+        const std::vector<tinyobj::token_span_t>& line = scanner.tokens();
+        for (size_t i = 0; i < line.size(); i++) {
+            if (offsets)
+                offsets->push_back(static_cast<size_t>(line[i].end - line[i].begin));
+        }
+        tokens += line.size();
+    }
+    return tokens;
+}
+
+template <typename Splitter>
+static double timeSplit(Splitter split, const std::string& obj, size_t* tokens)
+{
+    double best = 1e30;
+    for (int run = 0; run < 5; run++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        *tokens = split(obj, NULL);
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed.count() < best)
+            best = elapsed.count();
+    }
+    return best;
+}
+
+static double timeLoadObj(const std::string& obj)
+{
+    double best = 1e30;
+    for (int run = 0; run < 3; run++) {
+        std::istringstream stream(obj);
+        tinyobj::attrib_t attributes;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string warning, error;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        tinyobj::LoadObj(&attributes, &shapes, &materials, &warning, &error, &stream);
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed.count() < best)
+            best = elapsed.count();
+    }
+    return best;
+}
+
+struct ObjResult {
+    tinyobj::attrib_t attributes;
+    std::vector<tinyobj::shape_t> shapes;
+};
+
+static ObjResult loadSerial(const std::string& obj)
+{
+    ObjResult result;
+    std::istringstream stream(obj);
+    std::vector<tinyobj::material_t> materials;
+    std::string warning, error;
+    tinyobj::LoadObj(&result.attributes, &result.shapes, &materials, &warning, &error, &stream);
+    return result;
+}
+
+static ObjResult loadParallel(const std::string& obj)
+{
+    ObjResult result;
+    std::vector<tinyobj::material_t> materials;
+    std::string warning, error;
+    tinyobj::LoadObjParallel(&result.attributes, &result.shapes, &materials, &warning, &error, obj.data(),
+        obj.size());
+    return result;
+}
+
+static bool sameIndices(const std::vector<tinyobj::index_t>& a, const std::vector<tinyobj::index_t>& b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++)
+        if (a[i].vertex_index != b[i].vertex_index || a[i].normal_index != b[i].normal_index ||
+            a[i].texcoord_index != b[i].texcoord_index)
+            return false;
+    return true;
+}
+
+static bool sameResult(const ObjResult& a, const ObjResult& b)
+{
+    if (a.attributes.vertices != b.attributes.vertices || a.attributes.normals != b.attributes.normals ||
+        a.attributes.texcoords != b.attributes.texcoords || a.shapes.size() != b.shapes.size())
+        return false;
+    for (size_t i = 0; i < a.shapes.size(); i++) {
+        const tinyobj::mesh_t& meshA = a.shapes[i].mesh;
+        const tinyobj::mesh_t& meshB = b.shapes[i].mesh;
+        if (a.shapes[i].name != b.shapes[i].name || !sameIndices(meshA.indices, meshB.indices) ||
+            meshA.num_face_vertices != meshB.num_face_vertices || meshA.material_ids != meshB.material_ids ||
+            meshA.smoothing_group_ids != meshB.smoothing_group_ids)
+            return false;
+    }
+    return true;
+}
+
+// LoadObj only takes g/o/s/mtllib when something follows the keyword; a bare one must not start a shape
+static bool checkParallelEquivalence(const std::string& synthetic)
+{
+    const char* vertices = "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\n";
+    struct Case {
+        const char* name;
+        std::string obj;
+    } cases[] = {
+        { "bare g", std::string("g first\n") + vertices + "f 1 2 3\ng\nf 1 2 4\n" },
+        { "bare g, trailing blank", std::string("g first\n") + vertices + "f 1 2 3\ng \t\nf 1 2 4\n" },
+        { "bare g, CRLF", std::string("g first\r\n") + vertices + "f 1 2 3\r\ng\r\nf 1 2 4\r\n" },
+        { "bare o", std::string("o first\n") + vertices + "f 1 2 3\no\nf 1 2 4\n" },
+        { "bare s", std::string("s 1\n") + vertices + "f 1 2 3\ns\nf 1 2 4\ns off\nf 2 3 4\n" },
+        { "bare mtllib at the end", std::string(vertices) + "f 1 2 3\nmtllib" },
+        { "named groups", std::string("o thing\n") + vertices + "g a b\ns 2\nf 1 2 3\ng c\nf -4 -3 -1\n" },
+        { "synthetic mesh", synthetic },
+    };
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        ObjResult serial = loadSerial(cases[i].obj);
+        ObjResult parallel = loadParallel(cases[i].obj);
+        bool same = sameResult(serial, parallel);
+        std::cout << "LoadObjParallel, " << cases[i].name << ": " << parallel.shapes.size() << " shapes (LoadObj "
+            << serial.shapes.size() << "): " << (same ? "same" : "DIFFER") << "\n";
+        ok = ok && same;
+    }
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    int vertexCount = argc > 1 ? atoi(argv[1]) : 1000000;
+    std::string obj = makeSyntheticObj(vertexCount);
+    double megabytes = obj.size() / (1024.0 * 1024.0);
+
+    std::vector<size_t> legacyTokens, scannerTokens;
+    legacySplit(obj, &legacyTokens);
+    scannerSplit(obj, &scannerTokens);
+    bool same = legacyTokens == scannerTokens;
+    bool parallelSame = checkParallelEquivalence(obj);
+
+    size_t legacyCount = 0, scannerCount = 0;
+    double legacyMs = timeSplit(legacySplit, obj, &legacyCount);
+    double scannerMs = timeSplit(scannerSplit, obj, &scannerCount);
+    double loadMs = timeLoadObj(obj);
+
+#if defined(TINYOBJ_SCAN_AVX2)
+    const char* isa = "AVX2";
+#elif defined(TINYOBJ_SCAN_SSE2)
+    const char* isa = "SSE2";
+#else
+    const char* isa = "SWAR";
+#endif
+
+    std::cout << vertexCount << " vertices, " << scannerCount << " tokens, "
+        << static_cast<int>(megabytes) << " MB, scanner " << isa << "\n";
+    std::cout << "legacy split:  " << legacyMs << " ms, " << megabytes / (legacyMs / 1000.0) << " MB/s\n";
+    std::cout << "scanner split: " << scannerMs << " ms, " << megabytes / (scannerMs / 1000.0) << " MB/s\n";
+    std::cout << "speedup: " << legacyMs / scannerMs << "x, tokens " << (same ? "identical" : "DIFFER") << "\n";
+    std::cout << "LoadObj: " << loadMs << " ms, " << megabytes / (loadMs / 1000.0) << " MB/s\n";
+    return same && parallelSame ? 0 : 1;
+}
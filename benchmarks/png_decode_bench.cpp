@@ -0,0 +1,146 @@
+// Times stbi_load_from_memory on PNGs already read into memory, so only inflate and unfiltering are
+// measured, inflating the IDAT data alone too, and prints a hash of the decoded pixels. "check" decodes the repository's PNGs and compares
+// the hashes with the ones the stock stb_image 2.27 decoder produced, so the faster inflate and the SSE2
+// filters have to give the same pixels.
+//
+// build (from the repository root):
+//   g++ -O2 -std=c++14 -I. -IDependencies/include benchmarks/png_decode_bench.cpp -o png_decode_bench
+//   cl /O2 /EHsc /I. /IDependencies\include benchmarks\png_decode_bench.cpp
+// (add -DSTBI_NO_SIMD for the scalar filters; to time the stock decoder put its stb_image.h in a
+// directory named before -I.)
+// run (from the repository root):
+//   png_decode_bench check
+//   png_decode_bench Skybox/rainbow_rt.png 3D/12/yae.png 3D/12/grass.png
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "bench_files.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// the concatenated IDAT chunks: the zlib stream of the filtered rows
+static std::vector<char> idatStream(const std::vector<unsigned char>& png)
+{
+    std::vector<char> stream;
+    for (size_t at = 8; at + 12 <= png.size();) {
+        size_t length = (size_t)png[at] << 24 | png[at + 1] << 16 | png[at + 2] << 8 | png[at + 3];
+        if (at + 12 + length > png.size())
+            break;
+        if (std::memcmp(&png[at + 4], "IDAT", 4) == 0)
+            stream.insert(stream.end(), png.begin() + at + 8, png.begin() + at + 8 + length);
+        at += 12 + length;
+    }
+    return stream;
+}
+
+// best of the runs
+static double inflateMilliseconds(const std::vector<char>& stream, int size, int runs)
+{
+    double best = 0.0;
+    for (int run = 0; run < runs; run++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        int length = 0;
+        char* rows = stbi_zlib_decode_malloc_guesssize(stream.data(), (int)stream.size(), size, &length);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        STBI_FREE(rows);
+        if (run == 0 || ms < best)
+            best = ms;
+    }
+    return best;
+}
+
+struct Decode {
+    bool ok;
+    int width, height, channels;
+    unsigned int hash;
+    double milliseconds; // best of the runs
+};
+
+static Decode decode(const std::vector<unsigned char>& bytes, int runs)
+{
+    Decode result = { false, 0, 0, 0, 0, 0.0 };
+    for (int run = 0; run < runs; run++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        unsigned char* pixels = stbi_load_from_memory(bytes.data(), (int)bytes.size(), &result.width, &result.height,
+            &result.channels, 0);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (!pixels)
+            return result;
+        if (run == 0 || ms < result.milliseconds)
+            result.milliseconds = ms;
+        if (run == 0)
+            result.hash = hashPixels(pixels, (size_t)result.width * result.height * result.channels);
+        stbi_image_free(pixels);
+    }
+    result.ok = true;
+    return result;
+}
+
+static bool check()
+{
+    struct Expected {
+        const char* path;
+        unsigned int hash;
+    } expected[] = {
+        { "3D/12/gradient.png", 0x2b4a1f06u },
+        { "3D/12/grass.png", 0x70aa45fcu },
+        { "3D/12/yae.png", 0x4ec458c7u },
+        { "3D/ayaya.png", 0x29e91e6eu },
+        { "Skybox/rainbow_bk.png", 0x1ec6a687u },
+        { "Skybox/rainbow_dn.png", 0x6d587556u },
+        { "Skybox/rainbow_ft.png", 0xc45f53f7u },
+        { "Skybox/rainbow_lf.png", 0x777dd151u },
+        { "Skybox/rainbow_rt.png", 0xbb784e10u },
+        { "Skybox/rainbow_up.png", 0xbf1dc66bu },
+    };
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        std::vector<unsigned char> bytes;
+        if (!readFile(expected[i].path, bytes)) {
+            printf("%s: cannot read (run from the repository root)\n", expected[i].path);
+            ok = false;
+            continue;
+        }
+        Decode result = decode(bytes, 1);
+        bool same = result.ok && result.hash == expected[i].hash;
+        printf("%s: %08x (expect %08x): %s\n", expected[i].path, result.hash, expected[i].hash, same ? "ok" : "WRONG");
+        ok = ok && same;
+    }
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || std::string(argv[1]) == "check")
+        return check() ? 0 : 1;
+
+    double total = 0.0, totalInflate = 0.0;
+    for (int i = 1; i < argc; i++) {
+        std::vector<unsigned char> bytes;
+        if (!readFile(argv[i], bytes)) {
+            printf("%s: cannot read\n", argv[i]);
+            continue;
+        }
+        Decode result = decode(bytes, 20);
+        if (!result.ok) {
+            printf("%s: %s\n", argv[i], stbi_failure_reason());
+            continue;
+        }
+        // a filter byte starts every row
+        int rowsSize = (result.width * result.channels + 1) * result.height;
+        double inflate = inflateMilliseconds(idatStream(bytes), rowsSize, 20);
+        double megapixels = (double)result.width * result.height / 1e6;
+        printf("%s (%dx%dx%d, %zu KB): %.2f ms (inflate %.2f ms), %.0f Mpixel/s, hash %08x\n", argv[i], result.width,
+            result.height, result.channels, bytes.size() / 1024, result.milliseconds, inflate,
+            megapixels / (result.milliseconds / 1000.0), result.hash);
+        total += result.milliseconds;
+        totalInflate += inflate;
+    }
+    printf("total %.2f ms (inflate %.2f ms)\n", total, totalInflate);
+    return 0;
+}
@@ -0,0 +1,145 @@
+// Times loading a texture with its whole mip chain the two ways texture_container.h can:
+// decoding the image and filtering every level (first run), or mapping "<image>.texcache"
+// (every later run). The GPU side is not timed. "check" also verifies the filters on synthetic
+// images: a black/white checkerboard has to average to linear gray (sRGB 188, not 128), and a
+// normal map of alternating tilted normals to a unit +Z. There is no GL context, so no block format is
+// picked and the containers stay uncompressed; block_compression_bench times the encoders.
+// "batch" loads a set of images (a cube map's faces) one after the other and then with
+// loadTextureContainers, which spreads them over the hardware threads.
+//
+// build (from the repository root):
+//   g++ -O2 -std=c++14 -I. -IDependencies/include benchmarks/texture_container_bench.cpp glad.c -o texture_container_bench
+//   cl /O2 /EHsc /I. /IDependencies\include benchmarks\texture_container_bench.cpp glad.c
+// run:
+//   texture_container_bench check
+//   texture_container_bench 3D/Grass001_1K_Color.jpg 3D/Quiz_3/Models/brickwall_normal.jpg
+//   texture_container_bench batch Skybox/rainbow_rt.png Skybox/rainbow_lf.png Skybox/rainbow_up.png
+//       Skybox/rainbow_dn.png Skybox/rainbow_ft.png Skybox/rainbow_bk.png
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+#include "texture_container.h"
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+static bool check()
+{
+    const unsigned int size = 64;
+    std::vector<unsigned char> checker(size * size * 3);
+    for (unsigned int i = 0; i < size * size; i++)
+        for (int k = 0; k < 3; k++)
+            checker[i * 3 + k] = ((i % size) + (i / size)) % 2 ? 255 : 0;
+    std::vector<TextureLevel> levels;
+    std::vector<unsigned char> data;
+    buildMipChain(checker.data(), size, size, 3, TEXTURE_COLOR, levels, data);
+    const unsigned char* last = data.data() + levels.back().offset;
+    bool colorOk = levels.size() == 7 && levels.back().width == 1 && last[0] >= 187 && last[0] <= 189;
+    printf("color: %zu levels, 1x1 level %d (expect 188): %s\n", levels.size(), last[0], colorOk ? "ok" : "WRONG");
+
+    // +-45 degrees around y in a checkerboard: the average points straight out after renormalizing
+    std::vector<unsigned char> normals(size * size * 3);
+    for (unsigned int i = 0; i < size * size; i++) {
+        float x = ((i % size) + (i / size)) % 2 ? 0.7071f : -0.7071f;
+        normals[i * 3 + 0] = unitToByte(x * 0.5f + 0.5f);
+        normals[i * 3 + 1] = 128;
+        normals[i * 3 + 2] = unitToByte(0.7071f * 0.5f + 0.5f);
+    }
+    buildMipChain(normals.data(), size, size, 3, TEXTURE_NORMAL_MAP, levels, data);
+    const unsigned char* level1 = data.data() + levels[1].offset;
+    bool normalOk = level1[0] >= 127 && level1[0] <= 128 && level1[2] == 255;
+    printf("normal map: level 1 texel (%d, %d, %d) (expect 128, 128, 255): %s\n",
+        level1[0], level1[1], level1[2], normalOk ? "ok" : "WRONG");
+    return colorOk && normalOk;
+}
+
+static void removeContainers(const std::vector<std::string>& paths)
+{
+    for (size_t i = 0; i < paths.size(); i++)
+        std::remove((paths[i] + ".texcache").c_str());
+}
+
+// cold: decoded and filtered; warm: mapped
+static void batch(const std::vector<std::string>& paths)
+{
+    for (int warm = 0; warm < 2; warm++) {
+        double serial = 0.0, parallel = 0.0;
+        for (int pass = 0; pass < 2; pass++) {
+            if (!warm)
+                removeContainers(paths);
+            std::vector<TextureContainer> containers(paths.size());
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            size_t loaded = 0;
+            if (pass == 0) {
+                for (size_t i = 0; i < paths.size(); i++)
+                    loaded += loadTextureContainer(paths[i], false, TEXTURE_COLOR, containers[i], NULL) ? 1 : 0;
+            } else {
+                loaded = loadTextureContainers(paths.data(), paths.size(), false, TEXTURE_COLOR, containers.data(), NULL);
+            }
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            (pass == 0 ? serial : parallel) = ms;
+            if (loaded != paths.size())
+                printf("only %zu of %zu loaded\n", loaded, paths.size());
+        }
+        printf("%zu images, %s: one by one %.1f ms, loadTextureContainers %.1f ms (%.1fx)\n", paths.size(),
+            warm ? "mapped" : "decoded", serial, parallel, serial / parallel);
+    }
+    removeContainers(paths);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || std::string(argv[1]) == "check")
+        return check() ? 0 : 1;
+    if (std::string(argv[1]) == "batch") {
+        batch(std::vector<std::string>(argv + 2, argv + argc));
+        return 0;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        std::string path = argv[i];
+        TextureContent content = path.find("normal") != std::string::npos || path.find("_N.") != std::string::npos ?
+            TEXTURE_NORMAL_MAP : TEXTURE_COLOR;
+        std::string containerPath = path + ".texcache";
+        std::remove(containerPath.c_str());
+
+        // what the loader did before: decode, then glGenerateMipmap on the GPU (not timed here)
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        int width, height, channels;
+        unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &channels, 0);
+        double decode = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (!pixels) {
+            printf("%s: %s\n", path.c_str(), stbi_failure_reason());
+            continue;
+        }
+        stbi_image_free(pixels);
+
+        std::string error;
+        start = std::chrono::steady_clock::now();
+        TextureContainer built;
+        loadTextureContainer(path, false, content, built, &error);
+        double first = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        built.close();
+
+        // later runs: map, then touch every byte like the copy into the upload ring does
+        start = std::chrono::steady_clock::now();
+        TextureContainer mapped;
+        loadTextureContainer(path, false, content, mapped, &error);
+        unsigned long long sum = 0;
+        for (size_t b = 0; b < mapped.dataSize(); b += 64)
+            sum += mapped.data()[b];
+        double later = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        printf("%s (%dx%dx%d, %s, %u levels, %.1f MB): decode only %.1f ms, build %.1f ms, mapped %.2f ms (%llu)\n",
+            path.c_str(), width, height, channels, content == TEXTURE_NORMAL_MAP ? "normal map" : "color",
+            mapped.levelCount(), mapped.dataSize() / (1024.0 * 1024.0), decode, first, later, sum & 1);
+        mapped.close();
+        std::remove(containerPath.c_str());
+    }
+    return 0;
+}
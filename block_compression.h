@@ -0,0 +1,664 @@
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#if !defined(BLOCK_COMPRESSION_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define BLOCK_COMPRESSION_SSE2
+#include <emmintrin.h>
+#endif
+
+// encodes and decodes the GPU block formats the loader stores textures in: 4x4 texel blocks of 8 or 16
+// bytes that the GPU samples directly, so they take a quarter to an eighth of the memory and bandwidth of
+// RGB8/RGBA8 (which drivers pad to 4 bytes a texel). Every encoder fits endpoints along the block's principal
+// axis, picks the closest palette entry per texel (SSE2 when the compiler targets it, see fitPalette) and
+// refines the endpoints once by least squares. The decoders mirror the encoders so quality can be measured
+// without a GPU; BC7 decodes mode 6 only, the one mode encodeBC7Block writes.
+// Define BLOCK_COMPRESSION_NO_SIMD to force the scalar path.
+
+// bump whenever an encoder changes what it writes, cached blocks are rebuilt
+const unsigned int BLOCK_ENCODER_VERSION = 1;
+
+enum BlockFormat {
+    BLOCK_NONE, // uncompressed rows
+    BLOCK_BC1,  // rgb, 8 bytes a block
+    BLOCK_BC3,  // BC4 alpha then BC1 rgb, 16 bytes
+    BLOCK_BC5,  // BC4 red then BC4 green (normal map x and y), 16 bytes
+    BLOCK_BC7   // rgba, 16 bytes
+};
+
+// RGBA channels an error or a fit covers, bit 0 is red
+const unsigned int BLOCK_CHANNELS_RGB = 7;
+const unsigned int BLOCK_CHANNELS_RGBA = 15;
+
+inline size_t blockBytes(BlockFormat format)
+{
+    return format == BLOCK_BC1 ? 8 : 16;
+}
+
+// every level down to 1x1 takes at least one block
+inline size_t compressedSize(BlockFormat format, unsigned int width, unsigned int height)
+{
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+inline GLenum blockInternalFormat(BlockFormat format)
+{
+    switch (format) {
+    case BLOCK_BC1:
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BLOCK_BC3:
+        return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BLOCK_BC5:
+        return GL_COMPRESSED_RG_RGTC2;
+    case BLOCK_BC7:
+        return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    default:
+        return 0;
+    }
+}
+
+// whether the current context samples format; reads glad's flags only, so workers can ask too
+inline bool blockFormatSupported(BlockFormat format)
+{
+    switch (format) {
+    case BLOCK_BC1:
+    case BLOCK_BC3:
+        return GLAD_GL_EXT_texture_compression_s3tc != 0;
+    case BLOCK_BC5:
+        return GLAD_GL_VERSION_3_0 || GLAD_GL_ARB_texture_compression_rgtc || GLAD_GL_EXT_texture_compression_rgtc;
+    case BLOCK_BC7:
+        return GLAD_GL_VERSION_4_2 || GLAD_GL_ARB_texture_compression_bptc;
+    default:
+        return true;
+    }
+}
+
+// whether any texel of a 2 or 4 channel image is not fully opaque
+inline bool hasTranslucency(const unsigned char* pixels, size_t texels, unsigned int channels)
+{
+    if (channels != 2 && channels != 4)
+        return false;
+    for (size_t i = 0; i < texels; i++)
+        if (pixels[i * channels + channels - 1] != 255)
+            return true;
+    return false;
+}
+
+// the 4x4 block at (x, y) as RGBA, texels past the edge repeat the last row or column; gray fills rgb
+inline void loadBlock(const unsigned char* pixels, unsigned int width, unsigned int height, unsigned int channels,
+    unsigned int x, unsigned int y, unsigned char texels[64])
+{
+    for (unsigned int row = 0; row < 4; row++) {
+        unsigned int sy = std::min(y + row, height - 1);
+        for (unsigned int column = 0; column < 4; column++) {
+            unsigned int sx = std::min(x + column, width - 1);
+            const unsigned char* p = pixels + ((size_t)sy * width + sx) * channels;
+            unsigned char* t = texels + (row * 4 + column) * 4;
+            t[0] = p[0];
+            t[1] = channels >= 3 ? p[1] : p[0];
+            t[2] = channels >= 3 ? p[2] : p[0];
+            t[3] = channels == 4 ? p[3] : channels == 2 ? p[1] : 255;
+        }
+    }
+}
+
+// for every texel the first of entries RGBA palette colors closest in the masked channels;
+// returns the summed squared error
+inline unsigned int fitPaletteScalar(const unsigned char texels[64], const unsigned char* palette, int entries,
+    unsigned int channels, unsigned char indices[16])
+{
+    unsigned int total = 0;
+    for (int i = 0; i < 16; i++) {
+        const unsigned char* t = texels + i * 4;
+        unsigned int best = 0xffffffff;
+        for (int e = 0; e < entries; e++) {
+            unsigned int error = 0;
+            for (int c = 0; c < 4; c++) {
+                int d = (int)t[c] - palette[e * 4 + c];
+                error += channels >> c & 1 ? d * d : 0;
+            }
+            if (error < best) {
+                best = error;
+                indices[i] = (unsigned char)e;
+            }
+        }
+        total += best;
+    }
+    return total;
+}
+
+#ifdef BLOCK_COMPRESSION_SSE2
+// fitPaletteScalar four texels at a time, same results
+inline unsigned int fitPaletteSse2(const unsigned char texels[64], const unsigned char* palette, int entries,
+    unsigned int channels, unsigned char indices[16])
+{
+    __m128i zero = _mm_setzero_si128();
+    short m[4];
+    for (int c = 0; c < 4; c++)
+        m[c] = channels >> c & 1;
+    __m128i mask = _mm_set_epi16(m[3], m[2], m[1], m[0], m[3], m[2], m[1], m[0]);
+    unsigned int total = 0;
+    for (int group = 0; group < 4; group++) {
+        __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(texels + group * 16));
+        __m128i low = _mm_unpacklo_epi8(t, zero);
+        __m128i high = _mm_unpackhi_epi8(t, zero);
+        __m128i best = _mm_set1_epi32(0x7fffffff);
+        __m128i bestIndex = zero;
+        for (int e = 0; e < entries; e++) {
+            int color;
+            std::memcpy(&color, palette + e * 4, 4);
+            __m128i p = _mm_unpacklo_epi8(_mm_set1_epi32(color), zero);
+            __m128i dLow = _mm_sub_epi16(low, p);
+            __m128i dHigh = _mm_sub_epi16(high, p);
+            // r*r + g*g and b*b + a*a per texel, then the two halves added up
+            __m128i eLow = _mm_madd_epi16(dLow, _mm_mullo_epi16(dLow, mask));
+            __m128i eHigh = _mm_madd_epi16(dHigh, _mm_mullo_epi16(dHigh, mask));
+            __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(eLow), _mm_castsi128_ps(eHigh), _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(eLow), _mm_castsi128_ps(eHigh), _MM_SHUFFLE(3, 1, 3, 1));
+            __m128i error = _mm_add_epi32(_mm_castps_si128(even), _mm_castps_si128(odd));
+            __m128i better = _mm_cmplt_epi32(error, best);
+            best = _mm_or_si128(_mm_and_si128(better, error), _mm_andnot_si128(better, best));
+            bestIndex = _mm_or_si128(_mm_and_si128(better, _mm_set1_epi32(e)), _mm_andnot_si128(better, bestIndex));
+        }
+        int errors[4], picked[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(errors), best);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(picked), bestIndex);
+        for (int i = 0; i < 4; i++) {
+            total += errors[i];
+            indices[group * 4 + i] = (unsigned char)picked[i];
+        }
+    }
+    return total;
+}
+#endif
+
+inline unsigned int fitPalette(const unsigned char texels[64], const unsigned char* palette, int entries,
+    unsigned int channels, unsigned char indices[16])
+{
+#ifdef BLOCK_COMPRESSION_SSE2
+    return fitPaletteSse2(texels, palette, entries, channels, indices);
+#else
+    return fitPaletteScalar(texels, palette, entries, channels, indices);
+#endif
+}
+
+// mean and unit principal axis of the masked channels (power iteration); the axis is 0 for a flat block
+inline void principalAxis(const unsigned char texels[64], unsigned int channels, float mean[4], float axis[4])
+{
+    for (int c = 0; c < 4; c++) {
+        float sum = 0.0f;
+        for (int i = 0; i < 16; i++)
+            sum += texels[i * 4 + c];
+        mean[c] = sum / 16.0f;
+        axis[c] = 0.0f;
+    }
+    float covariance[4][4] = {};
+    for (int i = 0; i < 16; i++) {
+        float d[4];
+        for (int c = 0; c < 4; c++)
+            d[c] = channels >> c & 1 ? texels[i * 4 + c] - mean[c] : 0.0f;
+        for (int a = 0; a < 4; a++)
+            for (int b = 0; b < 4; b++)
+                covariance[a][b] += d[a] * d[b];
+    }
+    // starting from the widest channel's column never starts orthogonal to the answer
+    int widest = 0;
+    for (int c = 1; c < 4; c++)
+        if (covariance[c][c] > covariance[widest][widest])
+            widest = c;
+    if (covariance[widest][widest] <= 0.0f)
+        return;
+    for (int c = 0; c < 4; c++)
+        axis[c] = covariance[c][widest];
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[4];
+        float largest = 0.0f;
+        for (int a = 0; a < 4; a++) {
+            next[a] = 0.0f;
+            for (int b = 0; b < 4; b++)
+                next[a] += covariance[a][b] * axis[b];
+            largest = std::max(largest, std::fabs(next[a]));
+        }
+        if (largest <= 0.0f)
+            break;
+        for (int c = 0; c < 4; c++)
+            axis[c] = next[c] / largest;
+    }
+    float length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] + axis[3] * axis[3]);
+    for (int c = 0; c < 4; c++)
+        axis[c] = length > 0.0f ? axis[c] / length : 0.0f;
+}
+
+// the extremes of the block projected onto axis, in [0, 255]
+inline void axisEndpoints(const unsigned char texels[64], const float mean[4], const float axis[4], float low[4], float high[4])
+{
+    float minimum = 0.0f, maximum = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        float t = 0.0f;
+        for (int c = 0; c < 4; c++)
+            t += (texels[i * 4 + c] - mean[c]) * axis[c];
+        minimum = std::min(minimum, t);
+        maximum = std::max(maximum, t);
+    }
+    for (int c = 0; c < 4; c++) {
+        low[c] = std::min(std::max(mean[c] + axis[c] * minimum, 0.0f), 255.0f);
+        high[c] = std::min(std::max(mean[c] + axis[c] * maximum, 0.0f), 255.0f);
+    }
+}
+
+// endpoints a, b minimizing the squared error of every texel against a + (b - a) * weights[indices[i]];
+// false when the texels do not pin both down (all picked the same weight)
+inline bool fitEndpoints(const unsigned char texels[64], const unsigned char indices[16], const float* weights,
+    float a[4], float b[4])
+{
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[4] = {}, bx[4] = {};
+    for (int i = 0; i < 16; i++) {
+        float t = weights[indices[i]], s = 1.0f - t;
+        aa += s * s;
+        ab += s * t;
+        bb += t * t;
+        for (int c = 0; c < 4; c++) {
+            ax[c] += s * texels[i * 4 + c];
+            bx[c] += t * texels[i * 4 + c];
+        }
+    }
+    float determinant = aa * bb - ab * ab;
+    if (std::fabs(determinant) < 1e-6f)
+        return false;
+    for (int c = 0; c < 4; c++) {
+        a[c] = std::min(std::max((ax[c] * bb - bx[c] * ab) / determinant, 0.0f), 255.0f);
+        b[c] = std::min(std::max((bx[c] * aa - ax[c] * ab) / determinant, 0.0f), 255.0f);
+    }
+    return true;
+}
+
+// BC1: two RGB565 endpoints and a 2 bit index per texel
+
+inline unsigned short packRgb565(const float color[4])
+{
+    unsigned int r = (unsigned int)(color[0] * 31.0f / 255.0f + 0.5f);
+    unsigned int g = (unsigned int)(color[1] * 63.0f / 255.0f + 0.5f);
+    unsigned int b = (unsigned int)(color[2] * 31.0f / 255.0f + 0.5f);
+    return (unsigned short)(r << 11 | g << 5 | b);
+}
+
+inline void unpackRgb565(unsigned short color, unsigned char out[4])
+{
+    unsigned int r = color >> 11, g = color >> 5 & 63, b = color & 31;
+    out[0] = (unsigned char)(r << 3 | r >> 2);
+    out[1] = (unsigned char)(g << 2 | g >> 4);
+    out[2] = (unsigned char)(b << 3 | b >> 2);
+    out[3] = 255;
+}
+
+// in index order; c0 <= c1 is the three color mode with transparent black, which the encoder never writes
+inline void bc1Palette(unsigned short c0, unsigned short c1, unsigned char palette[16])
+{
+    unpackRgb565(c0, palette);
+    unpackRgb565(c1, palette + 4);
+    for (int c = 0; c < 3; c++) {
+        int a = palette[c], b = palette[4 + c];
+        palette[8 + c] = (unsigned char)(c0 > c1 ? (2 * a + b + 1) / 3 : (a + b) / 2);
+        palette[12 + c] = (unsigned char)(c0 > c1 ? (a + 2 * b + 1) / 3 : 0);
+    }
+    palette[11] = 255;
+    palette[15] = c0 > c1 ? 255 : 0;
+}
+
+// quantizes the endpoints into the four color mode (c0 > c1) and fits the indices
+inline unsigned int bc1Fit(const unsigned char texels[64], const float a[4], const float b[4],
+    unsigned short& c0, unsigned short& c1, unsigned char indices[16])
+{
+    c0 = packRgb565(a);
+    c1 = packRgb565(b);
+    bool swapped = c0 < c1;
+    if (swapped)
+        std::swap(c0, c1);
+    unsigned char palette[16];
+    bc1Palette(c0, c1, palette);
+    // c0 == c1 has a single color, and index 0 means the same in both modes
+    return fitPalette(texels, palette, c0 == c1 ? 1 : 4, BLOCK_CHANNELS_RGB, indices);
+}
+
+inline void encodeBC1Block(const unsigned char texels[64], unsigned char out[8])
+{
+    static const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+    float mean[4], axis[4], low[4], high[4];
+    principalAxis(texels, BLOCK_CHANNELS_RGB, mean, axis);
+    axisEndpoints(texels, mean, axis, low, high);
+    unsigned short c0, c1;
+    unsigned char indices[16];
+    unsigned int error = bc1Fit(texels, high, low, c0, c1, indices);
+
+    float a[4], b[4];
+    unsigned short r0, r1;
+    unsigned char refined[16];
+    if (error > 0 && fitEndpoints(texels, indices, weights, a, b) && bc1Fit(texels, a, b, r0, r1, refined) < error) {
+        c0 = r0;
+        c1 = r1;
+        std::memcpy(indices, refined, 16);
+    }
+
+    out[0] = (unsigned char)(c0 & 0xff);
+    out[1] = (unsigned char)(c0 >> 8);
+    out[2] = (unsigned char)(c1 & 0xff);
+    out[3] = (unsigned char)(c1 >> 8);
+    for (int i = 0; i < 4; i++)
+        out[4 + i] = (unsigned char)(indices[i * 4] | indices[i * 4 + 1] << 2 | indices[i * 4 + 2] << 4 | indices[i * 4 + 3] << 6);
+}
+
+inline void decodeBC1Block(const unsigned char in[8], unsigned char texels[64])
+{
+    unsigned char palette[16];
+    bc1Palette((unsigned short)(in[0] | in[1] << 8), (unsigned short)(in[2] | in[3] << 8), palette);
+    for (int i = 0; i < 16; i++)
+        std::memcpy(texels + i * 4, palette + (in[4 + i / 4] >> (i % 4 * 2) & 3) * 4, 4);
+}
+
+// BC4: one channel, two 8 bit endpoints and a 3 bit index per texel
+
+// a0 > a1 interpolates six values between them; otherwise four, then 0 and 255
+inline void bc4Palette(unsigned char a0, unsigned char a1, unsigned char values[8])
+{
+    values[0] = a0;
+    values[1] = a1;
+    if (a0 > a1) {
+        for (int i = 1; i < 7; i++)
+            values[1 + i] = (unsigned char)(((7 - i) * a0 + i * a1 + 3) / 7);
+    } else {
+        for (int i = 1; i < 5; i++)
+            values[1 + i] = (unsigned char)(((5 - i) * a0 + i * a1 + 2) / 5);
+        values[6] = 0;
+        values[7] = 255;
+    }
+}
+
+inline unsigned int bc4Fit(const unsigned char texels[64], int channel, unsigned char a0, unsigned char a1,
+    unsigned char indices[16])
+{
+    unsigned char values[8], palette[32] = {};
+    bc4Palette(a0, a1, values);
+    for (int i = 0; i < 8; i++)
+        palette[i * 4 + channel] = values[i];
+    return fitPalette(texels, palette, a0 == a1 ? 1 : 8, 1u << channel, indices);
+}
+
+// channel of the RGBA texels
+inline void encodeBC4Block(const unsigned char texels[64], int channel, unsigned char out[8])
+{
+    static const float weights[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+    int minimum = 255, maximum = 0, innerMinimum = 255, innerMaximum = 0;
+    bool extremes = false;
+    for (int i = 0; i < 16; i++) {
+        int v = texels[i * 4 + channel];
+        minimum = std::min(minimum, v);
+        maximum = std::max(maximum, v);
+        if (v == 0 || v == 255) {
+            extremes = true;
+        } else {
+            innerMinimum = std::min(innerMinimum, v);
+            innerMaximum = std::max(innerMaximum, v);
+        }
+    }
+    unsigned char a0 = (unsigned char)maximum, a1 = (unsigned char)minimum;
+    unsigned char indices[16], candidate[16];
+    unsigned int error = bc4Fit(texels, channel, a0, a1, indices);
+
+    float a[4], b[4];
+    if (error > 0 && fitEndpoints(texels, indices, weights, a, b)) {
+        // the fit may come out reversed, the indices are picked again anyway
+        unsigned char r0 = (unsigned char)(std::max(a[channel], b[channel]) + 0.5f);
+        unsigned char r1 = (unsigned char)(std::min(a[channel], b[channel]) + 0.5f);
+        unsigned int refined = r0 > r1 ? bc4Fit(texels, channel, r0, r1, candidate) : 0xffffffff;
+        if (refined < error) {
+            error = refined;
+            a0 = r0;
+            a1 = r1;
+            std::memcpy(indices, candidate, 16);
+        }
+    }
+    // cutout alpha: 0 and 255 come for free and the interpolation only has to cover the rest
+    if (error > 0 && extremes) {
+        unsigned char r0 = innerMinimum <= innerMaximum ? (unsigned char)innerMinimum : 0;
+        unsigned char r1 = innerMinimum <= innerMaximum ? (unsigned char)innerMaximum : 0;
+        unsigned char values[8], palette[32] = {};
+        bc4Palette(r0, r1, values);
+        for (int i = 0; i < 8; i++)
+            palette[i * 4 + channel] = values[i];
+        unsigned int sixValues = fitPalette(texels, palette, 8, 1u << channel, candidate);
+        if (sixValues < error) {
+            a0 = r0;
+            a1 = r1;
+            std::memcpy(indices, candidate, 16);
+        }
+    }
+
+    out[0] = a0;
+    out[1] = a1;
+    unsigned long long bits = 0;
+    for (int i = 0; i < 16; i++)
+        bits |= (unsigned long long)indices[i] << (i * 3);
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (unsigned char)(bits >> (i * 8));
+}
+
+// into channel of the RGBA texels
+inline void decodeBC4Block(const unsigned char in[8], int channel, unsigned char texels[64])
+{
+    unsigned char values[8];
+    bc4Palette(in[0], in[1], values);
+    unsigned long long bits = 0;
+    for (int i = 0; i < 6; i++)
+        bits |= (unsigned long long)in[2 + i] << (i * 8);
+    for (int i = 0; i < 16; i++)
+        texels[i * 4 + channel] = values[bits >> (i * 3) & 7];
+}
+
+// BC7 mode 6: one subset, RGBA endpoints of 7 bits plus a p-bit each, 4 bit indices
+
+const int BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+inline void bc7Palette(const unsigned char e0[4], const unsigned char e1[4], unsigned char palette[64])
+{
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 4; c++)
+            palette[i * 4 + c] = (unsigned char)(((64 - BC7_WEIGHTS4[i]) * e0[c] + BC7_WEIGHTS4[i] * e1[c] + 32) >> 6);
+}
+
+// an endpoint as 7 bit channels sharing the low bit pbit
+inline void bc7Quantize(const float endpoint[4], int pbit, unsigned char value[4])
+{
+    for (int c = 0; c < 4; c++) {
+        int q = (int)std::floor((endpoint[c] - pbit) * 0.5f + 0.5f);
+        value[c] = (unsigned char)(std::min(std::max(q, 0), 127) << 1 | pbit);
+    }
+}
+
+// the best of the four p-bit pairs for endpoints a, b
+inline unsigned int bc7Fit(const unsigned char texels[64], const float a[4], const float b[4],
+    unsigned char e0[4], unsigned char e1[4], unsigned char indices[16])
+{
+    unsigned int best = 0xffffffff;
+    for (int p = 0; p < 4; p++) {
+        unsigned char q0[4], q1[4], palette[64], candidate[16];
+        bc7Quantize(a, p & 1, q0);
+        bc7Quantize(b, p >> 1, q1);
+        bc7Palette(q0, q1, palette);
+        unsigned int error = fitPalette(texels, palette, 16, BLOCK_CHANNELS_RGBA, candidate);
+        if (error < best) {
+            best = error;
+            std::memcpy(e0, q0, 4);
+            std::memcpy(e1, q1, 4);
+            std::memcpy(indices, candidate, 16);
+        }
+    }
+    return best;
+}
+
+struct BlockBits {
+    unsigned char* data;
+    unsigned int position;
+
+    void write(unsigned int value, unsigned int bits)
+    {
+        for (unsigned int i = 0; i < bits; i++, position++)
+            if (value >> i & 1)
+                data[position >> 3] |= (unsigned char)(1 << (position & 7));
+    }
+
+    unsigned int read(unsigned int bits)
+    {
+        unsigned int value = 0;
+        for (unsigned int i = 0; i < bits; i++, position++)
+            value |= (unsigned int)(data[position >> 3] >> (position & 7) & 1) << i;
+        return value;
+    }
+};
+
+inline void encodeBC7Block(const unsigned char texels[64], unsigned char out[16])
+{
+    float weights[16];
+    for (int i = 0; i < 16; i++)
+        weights[i] = BC7_WEIGHTS4[i] / 64.0f;
+    float mean[4], axis[4], low[4], high[4];
+    principalAxis(texels, BLOCK_CHANNELS_RGBA, mean, axis);
+    axisEndpoints(texels, mean, axis, low, high);
+    unsigned char e0[4], e1[4], indices[16];
+    unsigned int error = bc7Fit(texels, low, high, e0, e1, indices);
+
+    float a[4], b[4];
+    unsigned char r0[4], r1[4], refined[16];
+    if (error > 0 && fitEndpoints(texels, indices, weights, a, b) && bc7Fit(texels, a, b, r0, r1, refined) < error) {
+        std::memcpy(e0, r0, 4);
+        std::memcpy(e1, r1, 4);
+        std::memcpy(indices, refined, 16);
+    }
+    // the first index is stored without its top bit, swapping the endpoints clears it
+    if (indices[0] & 8) {
+        for (int c = 0; c < 4; c++)
+            std::swap(e0[c], e1[c]);
+        for (int i = 0; i < 16; i++)
+            indices[i] = (unsigned char)(15 - indices[i]);
+    }
+
+    std::memset(out, 0, 16);
+    BlockBits bits = { out, 0 };
+    bits.write(1 << 6, 7);
+    for (int c = 0; c < 4; c++) {
+        bits.write(e0[c] >> 1, 7);
+        bits.write(e1[c] >> 1, 7);
+    }
+    bits.write(e0[0] & 1, 1);
+    bits.write(e1[0] & 1, 1);
+    bits.write(indices[0], 3);
+    for (int i = 1; i < 16; i++)
+        bits.write(indices[i], 4);
+}
+
+// false (and black) for the modes other than 6
+inline bool decodeBC7Block(const unsigned char in[16], unsigned char texels[64])
+{
+    unsigned char copy[16];
+    std::memcpy(copy, in, 16);
+    BlockBits bits = { copy, 0 };
+    if (bits.read(7) != 1 << 6) {
+        std::memset(texels, 0, 64);
+        return false;
+    }
+    unsigned char e0[4], e1[4];
+    for (int c = 0; c < 4; c++) {
+        e0[c] = (unsigned char)(bits.read(7) << 1);
+        e1[c] = (unsigned char)(bits.read(7) << 1);
+    }
+    unsigned int p0 = bits.read(1), p1 = bits.read(1);
+    for (int c = 0; c < 4; c++) {
+        e0[c] |= p0;
+        e1[c] |= p1;
+    }
+    unsigned char palette[64];
+    bc7Palette(e0, e1, palette);
+    for (int i = 0; i < 16; i++)
+        std::memcpy(texels + i * 4, palette + bits.read(i == 0 ? 3 : 4) * 4, 4);
+    return true;
+}
+
+// whole images
+
+// width x height x channels (1 to 4) into compressedSize(format, width, height) bytes at out
+inline void compressImage(const unsigned char* pixels, unsigned int width, unsigned int height, unsigned int channels,
+    BlockFormat format, unsigned char* out)
+{
+    unsigned char texels[64];
+    for (unsigned int y = 0; y < height; y += 4) {
+        for (unsigned int x = 0; x < width; x += 4) {
+            loadBlock(pixels, width, height, channels, x, y, texels);
+            switch (format) {
+            case BLOCK_BC1:
+                encodeBC1Block(texels, out);
+                break;
+            case BLOCK_BC3:
+                encodeBC4Block(texels, 3, out);
+                encodeBC1Block(texels, out + 8);
+                break;
+            case BLOCK_BC5:
+                encodeBC4Block(texels, 0, out);
+                encodeBC4Block(texels, 1, out + 8);
+                break;
+            case BLOCK_BC7:
+                encodeBC7Block(texels, out);
+                break;
+            default:
+                return;
+            }
+            out += blockBytes(format);
+        }
+    }
+}
+
+// into width x height RGBA texels the way the GPU samples them (BC5 as red, green, 0, 255);
+// false if a block could not be decoded
+inline bool decompressImage(const unsigned char* blocks, unsigned int width, unsigned int height, BlockFormat format,
+    unsigned char* rgba)
+{
+    bool decoded = true;
+    unsigned char texels[64];
+    for (unsigned int y = 0; y < height; y += 4) {
+        for (unsigned int x = 0; x < width; x += 4) {
+            switch (format) {
+            case BLOCK_BC1:
+                decodeBC1Block(blocks, texels);
+                break;
+            case BLOCK_BC3:
+                decodeBC1Block(blocks + 8, texels);
+                decodeBC4Block(blocks, 3, texels);
+                break;
+            case BLOCK_BC5:
+                for (int i = 0; i < 16; i++) {
+                    texels[i * 4 + 2] = 0;
+                    texels[i * 4 + 3] = 255;
+                }
+                decodeBC4Block(blocks, 0, texels);
+                decodeBC4Block(blocks + 8, 1, texels);
+                break;
+            case BLOCK_BC7:
+                decoded = decodeBC7Block(blocks, texels) && decoded;
+                break;
+            default:
+                return false;
+            }
+            blocks += blockBytes(format);
+            for (unsigned int row = 0; row < 4 && y + row < height; row++)
+                for (unsigned int column = 0; column < 4 && x + column < width; column++)
+                    std::memcpy(rgba + (((size_t)(y + row) * width + x + column) * 4), texels + (row * 4 + column) * 4, 4);
+        }
+    }
+    return decoded;
+}
+#endif
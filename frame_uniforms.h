@@ -0,0 +1,138 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstring>
+
+#include "light.h"
+
+// per frame state every program reads from the same two std140 uniform buffers instead of each program
+// getting its own copy uniform by uniform:
+//   layout (std140) uniform Camera { mat4 view; mat4 projection; vec3 viewPos; };
+//   layout (std140) uniform Lights { DirLight dirLight; SpotLight spotLight; PointLight pointLights[MAX_POINT_LIGHTS]; };
+// the blocks are declared the same way in every shader that reads them (see Shaders/MP_Light.frag)
+
+// binding points, fixed for all programs; the Shader constructor points the blocks at them
+const GLuint CAMERA_BLOCK_BINDING = 0;
+const GLuint LIGHTS_BLOCK_BINDING = 1;
+
+// length of pointLights in the Lights block; a variant adds the first NUM_POINT_LIGHTS (shader_variants.h)
+const int MAX_POINT_LIGHTS = 4;
+
+struct CameraBlock
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec3 viewPos;
+    float pad0;
+};
+
+struct LightsBlock
+{
+    DirLightBlock dirLight;
+    SpotLightBlock spotLight;
+    PointLightBlock pointLights[MAX_POINT_LIGHTS];
+};
+
+static_assert(sizeof(CameraBlock) == 144 && sizeof(LightsBlock) == 400, "frame blocks must match the std140 layout");
+
+// points the program's Camera and Lights blocks, where it has them, at their binding points; needed once
+// after linking (the binding is program state)
+inline void bindFrameBlocks(GLuint program)
+{
+    GLuint camera = glGetUniformBlockIndex(program, "Camera");
+    if (camera != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, camera, CAMERA_BLOCK_BINDING);
+    GLuint lights = glGetUniformBlockIndex(program, "Lights");
+    if (lights != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, lights, LIGHTS_BLOCK_BINDING);
+}
+
+// the two buffers, bound to their binding points for good; each set uploads its block with one
+// glBufferSubData, or not at all when it is the same as the last one
+class FrameUniforms {
+public:
+    FrameUniforms() : cameraBuffer(0), lightsBuffer(0), cameraSet(false), lightsSet(false) {}
+
+    ~FrameUniforms()
+    {
+        release();
+    }
+
+    // needs a current context
+    void create()
+    {
+        release();
+        cameraBuffer = createBuffer(CAMERA_BLOCK_BINDING, sizeof(CameraBlock));
+        lightsBuffer = createBuffer(LIGHTS_BLOCK_BINDING, sizeof(LightsBlock));
+    }
+
+    void release()
+    {
+        if (cameraBuffer)
+            glDeleteBuffers(1, &cameraBuffer);
+        if (lightsBuffer)
+            glDeleteBuffers(1, &lightsBuffer);
+        cameraBuffer = lightsBuffer = 0;
+        cameraSet = lightsSet = false;
+    }
+
+    void setCamera(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos)
+    {
+        CameraBlock block = CameraBlock();
+        block.view = view;
+        block.projection = projection;
+        block.viewPos = viewPos;
+        if (cameraSet && memcmp(&block, &camera, sizeof(block)) == 0)
+            return;
+        camera = block;
+        cameraSet = true;
+        upload(cameraBuffer, &camera, sizeof(camera));
+    }
+
+    // the point lights past count are zeroed, they add nothing
+    void setLights(const DirectionLight& dirLight, const SpotLight& spotLight, const PointLight* pointLights = NULL,
+        int count = 0)
+    {
+        LightsBlock block = LightsBlock();
+        block.dirLight = dirLight.toBlock();
+        block.spotLight = spotLight.toBlock();
+        for (int i = 0; i < count && i < MAX_POINT_LIGHTS; i++)
+            block.pointLights[i] = pointLights[i].toBlock();
+        if (lightsSet && memcmp(&block, &lights, sizeof(block)) == 0)
+            return;
+        lights = block;
+        lightsSet = true;
+        upload(lightsBuffer, &lights, sizeof(lights));
+    }
+
+private:
+    static GLuint createBuffer(GLuint binding, size_t size)
+    {
+        GLuint buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr)size, NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+        return buffer;
+    }
+
+    static void upload(GLuint buffer, const void* data, size_t size)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, (GLsizeiptr)size, data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    GLuint cameraBuffer;
+    GLuint lightsBuffer;
+    // what the buffers hold
+    CameraBlock camera;
+    LightsBlock lights;
+    bool cameraSet;
+    bool lightsSet;
+};
+#endif
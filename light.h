@@ -15,6 +15,49 @@ const glm::vec3 AMBIENT = glm::vec3(0.35f, 0.35f, 0.35f);
 const glm::vec3 DIFFUSE = glm::vec3(0.4f, 0.4f, 0.4f);
 const glm::vec3 SPECULAR = glm::vec3(0.5f, 0.5f, 0.5f);
 
+// std140 layouts of the light structs in the shaders' Lights block (frame_uniforms.h): every vec3 is
+// followed by a float that fills the rest of its 16 bytes, so these match member for member
+struct DirLightBlock
+{
+    glm::vec3 direction;
+    float pad0;
+    glm::vec3 ambient;
+    float pad1;
+    glm::vec3 diffuse;
+    float pad2;
+    glm::vec3 specular;
+    float pad3;
+};
+
+struct PointLightBlock
+{
+    glm::vec3 position;
+    float constant;
+    glm::vec3 ambient;
+    float linear;
+    glm::vec3 diffuse;
+    float quadratic;
+    glm::vec3 specular;
+    float pad0;
+};
+
+struct SpotLightBlock
+{
+    glm::vec3 position;
+    float cutOff;
+    glm::vec3 direction;
+    float outerCutOff;
+    glm::vec3 ambient;
+    float constant;
+    glm::vec3 diffuse;
+    float linear;
+    glm::vec3 specular;
+    float quadratic;
+};
+
+static_assert(sizeof(DirLightBlock) == 64 && sizeof(PointLightBlock) == 64 && sizeof(SpotLightBlock) == 80,
+    "light blocks must match the std140 layout");
+
 class Light
 {
 public:
@@ -54,6 +97,49 @@ public:
         diffuse = DIFFUSE;
         specular = SPECULAR;
     }
+
+    DirLightBlock toBlock() const
+    {
+        DirLightBlock block = DirLightBlock();
+        block.direction = direction;
+        block.ambient = ambient;
+        block.diffuse = diffuse;
+        block.specular = specular;
+        return block;
+    }
+};
+
+class PointLight : public Light
+{
+public:
+    glm::vec3 position;
+
+    // attenuation
+    float constant;
+    float linear;
+    float quadratic;
+
+    PointLight(glm::vec3 lightPos = glm::vec3(0.0f, 0.0f, 0.0f))
+    {
+        position = lightPos;
+
+        constant = 1.0f;
+        linear = 0.09f;
+        quadratic = 0.032f;
+    }
+
+    PointLightBlock toBlock() const
+    {
+        PointLightBlock block = PointLightBlock();
+        block.position = position;
+        block.constant = constant;
+        block.ambient = ambient;
+        block.linear = linear;
+        block.diffuse = diffuse;
+        block.quadratic = quadratic;
+        block.specular = specular;
+        return block;
+    }
 };
 
 
@@ -89,5 +175,21 @@ public:
         cutOff = glm::cos(glm::radians(12.5f));
         outerCutOff = glm::cos(glm::radians(15.0f));
     }
+
+    SpotLightBlock toBlock() const
+    {
+        SpotLightBlock block = SpotLightBlock();
+        block.position = position;
+        block.cutOff = cutOff;
+        block.direction = direction;
+        block.outerCutOff = outerCutOff;
+        block.ambient = ambient;
+        block.constant = constant;
+        block.diffuse = diffuse;
+        block.linear = linear;
+        block.specular = specular;
+        block.quadratic = quadratic;
+        return block;
+    }
 };
 #endif
\ No newline at end of file
@@ -7,9 +7,18 @@
 #include <iostream>
 
 #include "Model3D.h"
+#include "mesh.h"
+#include "mesh_cache.h"
+#include "mesh_stream.h"
+#include "asset_loader.h"
+#include "frame_uniforms.h"
+#include "material.h"
+#include "render_queue.h"
+#include "resource_manager.h"
 #include "camera.h" // camera
 #include "light.h"
 #include "shader_m.h" // source: learnopengl "multiple lights"
+#include "shader_variants.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -60,6 +69,17 @@ float dirLightStr;
 
 std::vector<Model3D> models;
 
+// what models[i] is drawn with
+struct ModelSource {
+    GpuMesh mesh;
+    std::vector<Material> materials; // indexed by SubMesh::material
+    unsigned int materialBase; // render queue sort id of materials[0]
+};
+std::vector<ModelSource> sources;
+
+// makes a loaded mesh asset models.back(); without textures its parts draw with the default material
+bool addModel(const MeshAsset& asset, glm::vec3 position, glm::vec3 scale, TextureCache* textures);
+
 glm::mat4 projection_matrix;
 glm::mat4 view_matrix;
 
@@ -82,202 +102,31 @@ int main(void)
 
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-    
-    stbi_set_flip_vertically_on_load(true);
 
-    Shader lightingShader("Shaders/sample.vert", "Shaders/MP_Light.frag");
+    // decoded on the loader's workers, uploaded by resources.update(); until then everything shows a placeholder
+    AssetLoader assets;
+    // textures, meshes and programs shared by path, and by content once loaded; anything loaded is used through
+    // its handle, a duplicate's is pointed at the original. Freed in resources.release()
+    ResourceManager resources(assets);
+
+    // one program per combination of material features and lights, compiled when first drawn with
+    ShaderVariants lightingShaders("Shaders/sample.vert", "Shaders/MP_Light.frag");
 
     // shader skybox
-    std::fstream skyboxVertSrc("Shaders/skybox.vert");
-    std::stringstream skyboxVertBuff;
-    skyboxVertBuff << skyboxVertSrc.rdbuf();
-    std::string skyboxVertS = skyboxVertBuff.str();
-    const char* sky_v = skyboxVertS.c_str();
-
-    std::fstream skyboxFragSrc("Shaders/skybox.frag");
-    std::stringstream skyboxFragBuff;
-    skyboxFragBuff << skyboxFragSrc.rdbuf();
-    std::string skyboxFragS = skyboxFragBuff.str();
-    const char* sky_f = skyboxFragS.c_str();
-
-    GLuint vertexShaderSkybox = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShaderSkybox, 1, &sky_v, NULL);
-    glCompileShader(vertexShaderSkybox);
-
-    GLuint fragShaderSkybox = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragShaderSkybox, 1, &sky_f, NULL);
-    glCompileShader(fragShaderSkybox);
-
-    GLuint skyboxShaderProg = glCreateProgram();
-    glAttachShader(skyboxShaderProg, vertexShaderSkybox);
-    glAttachShader(skyboxShaderProg, fragShaderSkybox);
-    glLinkProgram(skyboxShaderProg);
-
-    glDeleteShader(vertexShaderSkybox);
-    glDeleteShader(fragShaderSkybox);
+    Shader skyboxShader(resources.programName(resources.program("Shaders/skybox.vert", "Shaders/skybox.frag")));
 
     // Texture 1
-    int img_width, img_height, color_channels;
-
-    unsigned char* tex_bytes = stbi_load("3D/Quiz_3/Models/brickwall.jpg",
-        &img_width,
-        &img_height,
-        &color_channels,
-        0);
-
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture);
-
-    glTexImage2D(
-        GL_TEXTURE_2D,
-        0,
-        GL_RGB,    
-        img_width,
-        img_height,
-        0,
-        GL_RGB,
-        GL_UNSIGNED_BYTE,
-        tex_bytes
-    );
-    glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(tex_bytes);
-
+    TextureHandle texture = resources.texture("3D/Quiz_3/Models/brickwall.jpg", true);
 
     // object 1, UV
-    std::string path = "3D/Quiz_3/Models/plane.obj";
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> material;
-    std::string warning, error;
-    tinyobj::attrib_t attributes;
-    bool success = tinyobj::LoadObj(&attributes,
-        &shapes,
-        &material,
-        &warning,
-        &error,
-        path.c_str());
-
-    std::vector<GLuint> mesh_indices;
-    for (int i = 0; i < shapes[0].mesh.indices.size(); i++) {
-        mesh_indices.push_back(
-            shapes[0].mesh.indices[i].vertex_index
-        );
-    }
+    // parsed + welded once (streamed if the .obj is huge), then memory-mapped from plane.obj.meshcache on later runs
+    MeshHandle planeMesh = resources.mesh("3D/Quiz_3/Models/plane.obj", VERTEX_FORMAT_COMPACT);
+    int planeModel = -1; // index into models once the plane is in
+    bool planeAdded = false;
 
-    std::vector<glm::vec3> tangents;
-    std::vector<glm::vec3> bitangents;
-
-    for (int i = 0; i < shapes[0].mesh.indices.size(); i += 3) {
-        tinyobj::index_t vData1 = shapes[0].mesh.indices[i]; //vertex 1
-        tinyobj::index_t vData2 = shapes[0].mesh.indices[i + 1]; // vert 2
-        tinyobj::index_t vData3 = shapes[0].mesh.indices[i + 2]; // vert 3
-
-        // components of vertex 1, 2, 3
-        glm::vec3 v1 = glm::vec3(
-            attributes.vertices[vData1.vertex_index * 3],
-            attributes.vertices[vData1.vertex_index * 3 + 1],
-            attributes.vertices[vData1.vertex_index * 3 + 2]
-        );
-
-        glm::vec3 v2 = glm::vec3(
-            attributes.vertices[vData2.vertex_index * 3],
-            attributes.vertices[vData2.vertex_index * 3 + 1],
-            attributes.vertices[vData2.vertex_index * 3 + 2]
-        );
-
-        glm::vec3 v3 = glm::vec3(
-            attributes.vertices[vData3.vertex_index * 3],
-            attributes.vertices[vData3.vertex_index * 3 + 1],
-            attributes.vertices[vData3.vertex_index * 3 + 2]
-        );
-
-        // components of uv
-        glm::vec2 uv1 = glm::vec2(
-            attributes.texcoords[vData1.texcoord_index * 2],
-            attributes.texcoords[vData1.texcoord_index * 2 + 1]
-        );
-
-        glm::vec2 uv2 = glm::vec2(
-            attributes.texcoords[vData2.texcoord_index * 2],
-            attributes.texcoords[vData2.texcoord_index * 2 + 1]
-        );
-        glm::vec2 uv3 = glm::vec2(
-            attributes.texcoords[vData3.texcoord_index * 2],
-            attributes.texcoords[vData3.texcoord_index * 2 + 1]
-        );
-
-        glm::vec3 deltaPos1 = v2 - v1;
-        glm::vec3 deltaPos2 = v3 - v1;
-
-        glm::vec2 deltaUV1 = uv2 - uv1;
-        glm::vec2 deltaUV2 = uv3 - uv1;
-
-        float r = 1.f / ((deltaUV1.x * deltaUV2.y) - (deltaUV1.y * deltaUV2.x));
-
-        glm::vec3 tangent = (deltaPos1 * deltaUV2.y - deltaPos2 * deltaUV1.y) * r;
-        glm::vec3 bitangent = (deltaPos2 * deltaUV1.x - deltaPos1 * deltaUV2.x) * r;
-
-        tangents.push_back(tangent);
-        tangents.push_back(tangent);
-        tangents.push_back(tangent);
-
-        bitangents.push_back(bitangent);
-        bitangents.push_back(bitangent);
-        bitangents.push_back(bitangent);
-    }
-
-    std::vector <GLfloat> fullVertexData;
-    for (int i = 0; i < shapes[0].mesh.indices.size(); i++) {
-        tinyobj::index_t vData = shapes[0].mesh.indices[i];
-
-        fullVertexData.push_back(
-            attributes.vertices[(vData.vertex_index * 3)]
-        );
-        fullVertexData.push_back(
-            attributes.vertices[(vData.vertex_index * 3) + 1]
-        );
-        fullVertexData.push_back(
-            attributes.vertices[(vData.vertex_index * 3) + 2]
-        );
-
-        fullVertexData.push_back(
-            attributes.normals[(vData.normal_index * 3)]
-        );
-        fullVertexData.push_back(
-            attributes.normals[(vData.normal_index * 3) + 1]
-        );
-        fullVertexData.push_back(
-            attributes.normals[(vData.normal_index * 3) + 2]
-        );
-
-        fullVertexData.push_back(
-            attributes.texcoords[(vData.texcoord_index * 2)]
-        );
-        fullVertexData.push_back(
-            attributes.texcoords[(vData.texcoord_index * 2) + 1]
-        );
-
-        fullVertexData.push_back(
-            tangents[i].x
-        );
-        fullVertexData.push_back(
-            tangents[i].y
-        );
-        fullVertexData.push_back(
-            tangents[i].z
-        );
-
-        fullVertexData.push_back(
-            bitangents[i].x
-        );
-        fullVertexData.push_back(
-            bitangents[i].y
-        );
-        fullVertexData.push_back(
-            bitangents[i].z
-        );
-    }
+    // object 2, every shape and material of the OBJ in one buffer
+    MeshHandle eyeMesh = resources.mesh("3D/Objects/eyeball.obj", VERTEX_FORMAT_COMPACT);
+    bool eyeAdded = false;
 
         /*
       7--------6
@@ -321,87 +170,8 @@ int main(void)
         6,2,3
     };
 
-    // VAO 1
-    GLuint VAO, VBO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(
-        GL_ARRAY_BUFFER,
-        sizeof(GL_FLOAT)* fullVertexData.size(),
-        fullVertexData.data(),
-        GL_STATIC_DRAW
-    );
-    glVertexAttribPointer(
-        0,
-        3,
-        GL_FLOAT,
-        GL_FALSE,
-        14 * sizeof(GL_FLOAT),
-        (void*)0
-    );
-    GLintptr normPtr = 3 * sizeof(float);
-    glVertexAttribPointer(
-        1,
-        3,
-        GL_FLOAT,
-        GL_FALSE,
-        14 * sizeof(GL_FLOAT),
-        (void*)normPtr
-    );
-    GLintptr uvPtr = 6 * sizeof(float);
-    glVertexAttribPointer(
-        2,
-        2,
-        GL_FLOAT,
-        GL_FALSE,
-        14 * sizeof(GL_FLOAT),
-        (void*)uvPtr
-    );
-    GLintptr tangentPtr = 8 * sizeof(float);
-    glVertexAttribPointer(
-        3,
-        3,
-        GL_FLOAT,
-        GL_FALSE,
-        14 * sizeof(GL_FLOAT),
-        (void*)tangentPtr
-    );
-    GLintptr bitangentPtr = 11 * sizeof(float);
-    glVertexAttribPointer(
-        4,
-        3,
-        GL_FLOAT,
-        GL_FALSE,
-        14 * sizeof(GL_FLOAT),
-        (void*)bitangentPtr
-    );
-
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glEnableVertexAttribArray(2);
-    glEnableVertexAttribArray(3);
-    glEnableVertexAttribArray(4);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    
-    // skybox VAO VBO EBO
-    unsigned int skyboxVAO, skyboxVBO, skyboxEBO;
-    glGenVertexArrays(1, &skyboxVAO);
-    glGenBuffers(1, &skyboxVBO);
-    glGenBuffers(1, &skyboxEBO);
-    glBindVertexArray(skyboxVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
-    // add in skybox vertices to buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
-    // vertices only take xyz so only 3
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-
-    // skybox ebo
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, skyboxEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GL_INT) * 36, &skyboxIndices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
+    // skybox VAO VBO EBO, position only
+    GLuint skyboxVAO = resources.gpuMesh(resources.geometry(skyboxVertices, 8, skyboxIndices, 36))->vao;
 
     std::string facesSkybox[]{
         "Skybox/rainbow_rt.png",
@@ -412,50 +182,9 @@ int main(void)
         "Skybox/rainbow_bk.png",
     };
 
-    // skybox tex
-    unsigned int skyboxTex;
-    //generate skybox textures
-    glGenTextures(1, &skyboxTex);
-    //initialize as cube map
-    glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTex);
-    // this is to avoid skybox from pixelating when too big or small
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    // instead of st only- cubemaps rely on RST
-    // this is to make sure texture stretched to the edge
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-    for (unsigned int i = 0; i < 6; i++) {
-        // declare the width height and color channel of our skybox textures for later
-        int w, h, skyCChannel;
-        //temporarily disable flipping image
-        stbi_set_flip_vertically_on_load(false);
-        //load image as usual
-        unsigned char* data = stbi_load(facesSkybox[i].c_str(), &w, &h, &skyCChannel, 0);
-        
-        if (data) {
-            glTexImage2D(
-                //cubemap face address start at positive_X (Right)
-                //incrementing by 1
-                //right > left > top > bot > front > back
-                GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                0,
-                GL_RGB, // some pngs dont have alpha
-                w, // width
-                h, // height
-                0,
-                GL_RGB,
-                GL_UNSIGNED_BYTE, // data type
-                data // texture data itself
-            );
-            //cleanup
-            stbi_image_free(data);
-        }
-    }
-    stbi_set_flip_vertically_on_load(true);
-    
+    // skybox tex, sky blue until the faces are in
+    // faces are not flipped, cube maps address rows from the top
+    TextureHandle skyboxTex = resources.cubemap(facesSkybox, false, glm::vec4(0.53f, 0.81f, 0.92f, 1.0f));
 
     projection_matrix = glm::perspective(
         glm::radians(60.0f),
@@ -479,13 +208,31 @@ int main(void)
     float theta_x = 0.0f;
     float theta_y = 0.0f;
 
+    // parts without a material keep the brickwall look; its specular unit used to sample nothing (black)
+    TextureCache textures(resources);
+    Material defaultMaterial;
+    defaultMaterial.name = "default";
+    defaultMaterial.diffuseMap = texture;
+    defaultMaterial.specularMap = textures.solid(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    defaultMaterial.normalMap = textures.solid(glm::vec4(0.5f, 0.5f, 1.0f, 1.0f));
+    defaultMaterial.shininess = 32.0f;
+    defaultMaterial.alpha = 1.0f;
+    defaultMaterial.normalMapped = false;
+    defaultMaterial.alphaTested = false;
+
+    RenderQueue renderQueue(resources);
+
     // LIGHTING
     DirectionLight dirLight;
+    dirLight.ambient = glm::vec3(0.5f, 0.5f, 0.5f);
     SpotLight spotLight = SpotLight(persCam.Position, persCam.Front);
 
-    lightingShader.use();
-    lightingShader.setInt("material.diffuse", 0);
-    lightingShader.setInt("material.specular", 1);
+    // the Camera and Lights uniform blocks every program reads
+    FrameUniforms frameUniforms;
+    frameUniforms.create();
+
+    // the flashlight and no point lights; picks the lighting features of every variant drawn
+    ShaderVariantKey lighting = lightingFeatures(true, 0);
 
     while (!glfwWindowShouldClose(window))
     {
@@ -497,80 +244,55 @@ int main(void)
 
         //processInput(window);
 
-        glDepthMask(GL_FALSE);
-        glDepthFunc(GL_LEQUAL);
-        glUseProgram(skyboxShaderProg);
-
-        view_matrix = persCam.lookAtOrigin();
+        // uploads whatever the workers finished, within ASSET_UPLOAD_BUDGET_MS, and shares duplicates
+        resources.update();
+        const MeshAsset* planeAsset = resources.meshAsset(planeMesh);
+        const MeshAsset* eyeAsset = resources.meshAsset(eyeMesh);
+        if (!planeAdded && planeAsset->state != MESH_ASSET_LOADING) {
+            if (addModel(*planeAsset, glm::vec3(0.0f, 0.0f, -5.0f), glm::vec3(5.0f, 5.0f, 5.0f), NULL))
+                planeModel = (int)models.size() - 1;
+            planeAdded = true;
+        }
+        if (!eyeAdded && eyeAsset->state != MESH_ASSET_LOADING) {
+            addModel(*eyeAsset, glm::vec3(3.0f, 0.0f, -5.0f), glm::vec3(1.0f, 1.0f, 1.0f), &textures);
+            eyeAdded = true;
+        }
 
-        // initialize skybox's view matrix
-        glm::mat4 sky_view = glm::mat4(1.f);
-        sky_view = glm::mat4(
-            // cast same view matrix of camera
-            //turn it into mat3 to remove translations
-            glm::mat3(view_matrix)
-            // reconvert to mat4
-        );
+        view_matrix = glm::lookAt(persCam.Position, persCam.Position + persCam.Front, persCam.Up);
 
-        unsigned int skyboxViewLoc = glGetUniformLocation(skyboxShaderProg, "view");
-        glUniformMatrix4fv(skyboxViewLoc, 1, GL_FALSE, glm::value_ptr(sky_view));
+        // camera and lights for every program, uploaded once (and only when they changed)
+        frameUniforms.setCamera(view_matrix, projection_matrix, persCam.Position);
+        spotLight.position = persCam.Position;
+        spotLight.direction = persCam.Front;
+        frameUniforms.setLights(dirLight, spotLight);
 
-        unsigned int skyboxProjLoc = glGetUniformLocation(skyboxShaderProg, "projection");
-        glUniformMatrix4fv(skyboxProjLoc, 1, GL_FALSE, glm::value_ptr(projection_matrix));
+        // the skybox vertex shader drops the view's translation
+        glDepthMask(GL_FALSE);
+        glDepthFunc(GL_LEQUAL);
+        skyboxShader.use();
 
         glBindVertexArray(skyboxVAO);
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTex);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, resources.textureName(skyboxTex));
         glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
         glDepthMask(GL_TRUE);
         glDepthFunc(GL_LESS);
 
-        // remember to activate shader
-        lightingShader.use();
-        lightingShader.setVec3("viewPos", persCam.Position);
-        lightingShader.setFloat("material.shininess", 32.0f);
-        
-        // object 2 sword
-        glm::mat4 transformation_matrix = glm::mat4(1.0f);
-        view_matrix = glm::lookAt(persCam.Position, persCam.Position + persCam.Front, persCam.Up);
-
-        // transformation matrix
-        transformation_matrix = glm::translate(transformation_matrix, glm::vec3(0.0f, 0.0f, -5.0f));
-        transformation_matrix = glm::scale(transformation_matrix, glm::vec3(5.0f, 5.0f, 5.0f));
-        transformation_matrix = glm::rotate(transformation_matrix, glm::radians(theta_x), glm::normalize(glm::vec3(1, 0, 0))); // spin clockwise
+        // spin clockwise
+        if (planeModel >= 0)
+            models[planeModel].setRotation(theta_x, theta_y, theta_z);
         theta_x += 0.2;
-        transformation_matrix = glm::rotate(transformation_matrix, glm::radians(theta_y), glm::normalize(glm::vec3(0, 1, 0)));
-        transformation_matrix = glm::rotate(transformation_matrix, glm::radians(theta_z), glm::normalize(glm::vec3(0, 0, 1)));
-
-        // directional light
-        lightingShader.setVec3("dirLight.direction", dirLight.direction);
-        lightingShader.setVec3("dirLight.ambient", 0.5f,0.5f,0.5f);
-        lightingShader.setVec3("dirLight.diffuse", dirLight.diffuse);
-        lightingShader.setVec3("dirLight.specular", dirLight.specular);
-
-        // spotLight
-        lightingShader.setVec3("spotLight.position", persCam.Position);
-        lightingShader.setVec3("spotLight.direction", persCam.Front);
-        lightingShader.setVec3("spotLight.ambient", spotLight.ambient);
-        lightingShader.setVec3("spotLight.diffuse", spotLight.diffuse);
-        lightingShader.setVec3("spotLight.specular", spotLight.specular);
-        lightingShader.setFloat("spotLight.constant", spotLight.constant);
-        lightingShader.setFloat("spotLight.linear", spotLight.linear);
-        lightingShader.setFloat("spotLight.quadratic", spotLight.quadratic);
-        lightingShader.setFloat("spotLight.cutOff", spotLight.cutOff);
-        lightingShader.setFloat("spotLight.outerCutOff", spotLight.outerCutOff);
-
-        lightingShader.setMat4("transform", transformation_matrix);
-        lightingShader.setMat4("projection", projection_matrix);
-        lightingShader.setMat4("view", view_matrix);
-
-        // texture
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture);
-
-        glBindVertexArray(VAO);
 
-        glDrawArrays(GL_TRIANGLES, 0, fullVertexData.size() / 14);
+        // sorted by program, material and VAO; the queue sets the material, vertex decode and matrices,
+        // which each model rebuilds only when it or the camera moved
+        glm::mat4 viewProjection = projection_matrix * view_matrix;
+        for (size_t i = 0; i < models.size(); i++) {
+            models[i].updateLod(persCam.Position, projection_matrix, screenHeight);
+            models[i].cull(persCam.Position, viewProjection);
+            models[i].submit(renderQueue, viewProjection, lightingShaders, lighting, sources[i].mesh,
+                sources[i].materials, sources[i].materialBase, defaultMaterial);
+        }
+        renderQueue.flush();
 
         processInput(window);
 
@@ -578,14 +300,51 @@ int main(void)
 
         glfwPollEvents();
     }
-    // delete buffers
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
+    // delete buffers, textures and programs; the loader goes last, it still owns the mesh assets
+    frameUniforms.release();
+    lightingShaders.release();
+    textures.release();
+    resources.release();
+    assets.release();
 
     glfwTerminate();
     return 0;
 }
 
+bool addModel(const MeshAsset& asset, glm::vec3 position, glm::vec3 scale, TextureCache* textures)
+{
+    if (asset.state == MESH_ASSET_FAILED) {
+        std::cout << "ERROR::MESH::LOAD_FAILED: " << asset.path << "\n" << asset.error << std::endl;
+        return false;
+    }
+    const CachedMesh& mesh = asset.mesh;
+    std::cout << "MESH::FORMAT: " << asset.path << ": "
+        << describeVertexFormat(mesh.vertexFormat(), mesh.formatError()) << std::endl;
+    std::cout << "MESH::VERTEX_CACHE: " << asset.path << ": "
+        << describeVertexCache(mesh.vertexCacheReport()) << std::endl;
+    std::cout << "MESH::LODS: " << asset.path << ": " << describeLods(mesh.lods()) << std::endl;
+    std::cout << "MESH::MESHLETS: " << asset.path << ": " << mesh.meshlets().size() << std::endl;
+
+    ModelSource source;
+    source.mesh = asset.gpu;
+    if (textures) {
+        std::vector<MaterialRecord> records = mesh.materials();
+        for (size_t i = 0; i < records.size(); i++)
+            source.materials.push_back(makeMaterial(records[i], directoryOf(asset.path), *textures));
+        std::cout << "MESH::SUBMESHES: " << asset.path << ": " << mesh.submeshes().size()
+            << " submeshes, " << records.size() << " materials" << std::endl;
+    }
+    // sort id 0 is the default material and file materials start at 1, each source's after the previous ones
+    source.materialBase = 1;
+    for (size_t i = 0; i < sources.size(); i++)
+        source.materialBase += (unsigned int)sources[i].materials.size();
+
+    models.push_back(Model3D(position, scale, mesh.indexCount(), mesh.indexType()));
+    models.back().setSubMeshes(mesh.submeshes(), mesh.lods(), mesh.meshlets());
+    sources.push_back(source);
+    return true;
+}
+
 // glfw: whenever the mouse moves, this callback is called
 // -------------------------------------------------------
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
@@ -0,0 +1,128 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "model_import.h"
+#include "resource_manager.h"
+#include "shader_variants.h"
+#include "stb_image.h"
+
+// texture units MP_Light.frag reads the material from
+const int MATERIAL_DIFFUSE_UNIT = 0;
+const int MATERIAL_SPECULAR_UNIT = 1;
+const int MATERIAL_NORMAL_UNIT = 2;
+
+// the GL side of a MaterialRecord; untextured channels get a 1x1 texture of their constant color.
+// The maps are handles into the TextureCache's ResourceManager, resolved when the material is bound
+struct Material {
+    std::string name;
+    TextureHandle diffuseMap;
+    TextureHandle specularMap;
+    TextureHandle normalMap;
+    float shininess;
+    float alpha; // drawn after the opaque materials with blending when below 1
+    bool normalMapped; // normalMap is a file, not the flat 1x1 one
+    bool alphaTested;  // diffuseMap has an alpha channel, its transparent texels are discarded
+};
+
+// holds a reference on every material texture for as long as the materials are used; files are decoded
+// on the resources' loader workers and shared with everything else that loads them, so is a color
+class TextureCache {
+public:
+    explicit TextureCache(ResourceManager& resources) : resources(resources) {}
+
+    ~TextureCache()
+    {
+        release();
+    }
+
+    // shows placeholder until the file is in (and for good if it cannot be read), with OBJ orientation;
+    // content picks the mip filter and block format (see texture_container.h)
+    TextureHandle load(const std::string& path, glm::vec4 placeholder = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f),
+        TextureContent content = TEXTURE_COLOR)
+    {
+        std::map<std::string, TextureHandle>::iterator found = files.find(path);
+        if (found != files.end())
+            return found->second;
+        return files[path] = resources.texture(path, true, placeholder, content);
+    }
+
+    // a 1x1 texture of color, components in [0, 1]
+    TextureHandle solid(glm::vec4 color)
+    {
+        unsigned int key = 0;
+        for (int i = 0; i < 4; i++)
+            key |= (unsigned int)(glm::clamp(color[i], 0.0f, 1.0f) * 255.0f + 0.5f) << (i * 8);
+        std::map<unsigned int, TextureHandle>::iterator found = colors.find(key);
+        if (found != colors.end())
+            return found->second;
+        return colors[key] = resources.solid(color);
+    }
+
+    void release()
+    {
+        for (std::map<std::string, TextureHandle>::iterator it = files.begin(); it != files.end(); ++it)
+            resources.release(it->second);
+        for (std::map<unsigned int, TextureHandle>::iterator it = colors.begin(); it != colors.end(); ++it)
+            resources.release(it->second);
+        files.clear();
+        colors.clear();
+    }
+
+private:
+    // a copy would release the same handles
+    TextureCache(const TextureCache&);
+    TextureCache& operator=(const TextureCache&);
+
+    ResourceManager& resources;
+    std::map<std::string, TextureHandle> files;
+    std::map<unsigned int, TextureHandle> colors;
+};
+
+// texture paths in the records are relative to baseDir (the .obj's directory, ending in '/')
+inline Material makeMaterial(const MaterialRecord& record, const std::string& baseDir, TextureCache& textures)
+{
+    Material material;
+    material.name = record.name;
+    material.diffuseMap = record.diffuseTexture[0] ? textures.load(baseDir + record.diffuseTexture) :
+        textures.solid(glm::vec4(record.diffuse[0], record.diffuse[1], record.diffuse[2], 1.0f));
+    material.specularMap = record.specularTexture[0] ? textures.load(baseDir + record.specularTexture) :
+        textures.solid(glm::vec4(record.specular[0], record.specular[1], record.specular[2], 1.0f));
+    glm::vec4 flatNormal(0.5f, 0.5f, 1.0f, 1.0f); // +Z in tangent space
+    material.normalMap = record.normalTexture[0] ?
+        textures.load(baseDir + record.normalTexture, flatNormal, TEXTURE_NORMAL_MAP) : textures.solid(flatNormal);
+    // Ns 0 would turn pow() into a constant 1
+    material.shininess = record.shininess > 1.0f ? record.shininess : 1.0f;
+    material.alpha = record.dissolve;
+    material.normalMapped = record.normalTexture[0] != 0;
+    // only the header is read; the texture itself may still be loading
+    int width, height, channels = 0;
+    material.alphaTested = record.diffuseTexture[0] &&
+        stbi_info((baseDir + record.diffuseTexture).c_str(), &width, &height, &channels) && (channels == 2 || channels == 4);
+    return material;
+}
+
+// the variant features the material needs; the cheapest program for it is compiled with these and nothing else
+inline ShaderVariantKey materialFeatures(const Material& material)
+{
+    return (material.normalMapped ? SHADER_NORMAL_MAP : 0) | (material.alphaTested ? SHADER_ALPHA_TEST : 0);
+}
+
+// the names are looked up now, a map merged with another file of the same content has changed its own
+inline void bindMaterial(const Material& material, ResourceManager& resources)
+{
+    glActiveTexture(GL_TEXTURE0 + MATERIAL_DIFFUSE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, resources.textureName(material.diffuseMap));
+    glActiveTexture(GL_TEXTURE0 + MATERIAL_SPECULAR_UNIT);
+    glBindTexture(GL_TEXTURE_2D, resources.textureName(material.specularMap));
+    glActiveTexture(GL_TEXTURE0 + MATERIAL_NORMAL_UNIT);
+    glBindTexture(GL_TEXTURE_2D, resources.textureName(material.normalMap));
+    glActiveTexture(GL_TEXTURE0);
+}
+#endif
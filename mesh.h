@@ -0,0 +1,270 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "tangent_space.h"
+
+// tiny_obj_loader.h has to be included before this header (main.cpp owns the implementation)
+
+// interleaved layout: position(3) normal(3) uv(2) tangent(4)
+// tangent.w holds the bitangent sign, the vertex shader rebuilds the bitangent from it
+// this is the float layout every import pass works on; packVertices turns it into a VertexFormat
+const int VERTEX_FLOATS = 12;
+
+// VERTEX_FLOATS layout as seen by generateTangents
+const TangentLayout VERTEX_TANGENT_LAYOUT = { VERTEX_FLOATS, 0, 3, 6, 8 };
+
+// what ends up in the VBO
+enum VertexFormat {
+    // 48 bytes, the float layout as is
+    VERTEX_FORMAT_FLOAT = 0,
+    // 20 bytes: unorm16 position inside the mesh AABB with the bitangent sign in w,
+    // octahedral snorm16 normal and tangent, half float uv
+    VERTEX_FORMAT_COMPACT = 1
+};
+
+// one glVertexAttribPointer call; offset is in bytes from the start of the vertex
+struct VertexAttribute {
+    GLuint location;
+    GLint components;
+    GLenum type;
+    GLboolean normalized;
+    GLuint offset;
+};
+
+const int VERTEX_ATTRIBUTE_COUNT = 4;
+const VertexAttribute FLOAT_VERTEX_LAYOUT[VERTEX_ATTRIBUTE_COUNT] = {
+    { 0, 3, GL_FLOAT, GL_FALSE, 0 },  // position
+    { 1, 3, GL_FLOAT, GL_FALSE, 12 }, // normal
+    { 2, 2, GL_FLOAT, GL_FALSE, 24 }, // uv
+    { 3, 4, GL_FLOAT, GL_FALSE, 32 }  // tangent + bitangent sign
+};
+
+const VertexAttribute COMPACT_VERTEX_LAYOUT[VERTEX_ATTRIBUTE_COUNT] = {
+    { 0, 4, GL_UNSIGNED_SHORT, GL_TRUE, 0 }, // position in the AABB, w = (sign + 1) / 2
+    { 1, 2, GL_SHORT, GL_TRUE, 8 },          // octahedral normal
+    { 2, 2, GL_HALF_FLOAT, GL_FALSE, 12 },   // uv
+    { 3, 2, GL_SHORT, GL_TRUE, 16 }          // octahedral tangent
+};
+
+inline const VertexAttribute* vertexLayout(VertexFormat format)
+{
+    return format == VERTEX_FORMAT_COMPACT ? COMPACT_VERTEX_LAYOUT : FLOAT_VERTEX_LAYOUT;
+}
+
+// bytes per vertex
+inline GLsizei vertexStride(VertexFormat format)
+{
+    return format == VERTEX_FORMAT_COMPACT ? 20 : VERTEX_FLOATS * sizeof(GLfloat);
+}
+
+// points the bound VAO at the format's layout inside the bound GL_ARRAY_BUFFER
+inline void setVertexLayout(VertexFormat format)
+{
+    const VertexAttribute* layout = vertexLayout(format);
+    for (int i = 0; i < VERTEX_ATTRIBUTE_COUNT; i++) {
+        glVertexAttribPointer(
+            layout[i].location,
+            layout[i].components,
+            layout[i].type,
+            layout[i].normalized,
+            vertexStride(format),
+            (void*)(size_t)layout[i].offset
+        );
+        glEnableVertexAttribArray(layout[i].location);
+    }
+}
+
+// one level of detail: a range of the index buffer drawn over the shared vertices
+struct MeshLod {
+    unsigned int firstIndex;
+    unsigned int indexCount;
+    float error; // object space bound on how far the full mesh's vertices are from this level's surface, 0 for the full mesh
+};
+
+// full mesh + 50/25/12/6% levels
+const int MESH_MAX_LODS = 5;
+
+// a small cluster of the full mesh's triangles that is culled as a unit
+struct Meshlet {
+    unsigned int firstIndex;
+    unsigned int indexCount;
+    float center[3]; // object space bounding sphere
+    float radius;
+    float coneAxis[3]; // average facing of the triangles
+    float coneCutoff;  // sin of the cone's half angle, 1 when the triangles face every way
+};
+
+// the part of one OBJ shape drawn with one material, with its own LOD chain and meshlets
+struct SubMesh {
+    unsigned int shape;    // index into the OBJ's shapes
+    int material;          // index into the OBJ's materials, -1 when the faces have none
+    unsigned int firstLod; // into MeshData::lods
+    unsigned int lodCount;
+    unsigned int firstMeshlet; // into MeshData::meshlets
+    unsigned int meshletCount;
+    float boundsMin[3]; // object space AABB
+    float boundsMax[3];
+};
+
+// indexed mesh ready for a VBO + EBO
+struct MeshData {
+    std::vector<GLfloat> vertices; // VERTEX_FLOATS per vertex
+    std::vector<GLuint> indices;
+    glm::vec3 boundsMin; // object space AABB
+    glm::vec3 boundsMax;
+    std::vector<MeshLod> lods; // filled by generateLods, level 0 is the full mesh
+    std::vector<Meshlet> meshlets; // filled by buildMeshlets, they tile level 0
+    std::vector<SubMesh> submeshes; // filled by buildModel, each with its own range of lods and meshlets
+
+    unsigned int vertexCount() const
+    {
+        return static_cast<unsigned int>(vertices.size() / VERTEX_FLOATS);
+    }
+
+    // 16-bit indices are enough as long as every vertex fits in a GLushort
+    GLenum indexType() const
+    {
+        return vertexCount() <= 0xFFFF ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    }
+};
+
+// one OBJ corner plus the winding of its triangle's uv mapping, used to weld identical vertices
+// mirrored uv islands stay separate so their tangents are not averaged across the mirror
+struct CornerKey {
+    int vertex_index;
+    int normal_index;
+    int texcoord_index;
+    int uv_winding;
+
+    bool operator==(const CornerKey& other) const
+    {
+        return vertex_index == other.vertex_index &&
+            normal_index == other.normal_index &&
+            texcoord_index == other.texcoord_index &&
+            uv_winding == other.uv_winding;
+    }
+};
+
+struct CornerKeyHash {
+    size_t operator()(const CornerKey& key) const
+    {
+        // FNV-1a over the raw key bytes
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&key);
+        size_t hash = 2166136261u;
+        for (size_t i = 0; i < sizeof(CornerKey); i++) {
+            hash ^= bytes[i];
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+};
+
+// reads a vec3 from an attribute array, zero if the corner has none
+inline glm::vec3 fetchVec3(const std::vector<tinyobj::real_t>& data, int index)
+{
+    if (index < 0)
+        return glm::vec3(0.0f);
+    return glm::vec3(data[index * 3], data[index * 3 + 1], data[index * 3 + 2]);
+}
+
+inline glm::vec2 fetchVec2(const std::vector<tinyobj::real_t>& data, int index)
+{
+    if (index < 0)
+        return glm::vec2(0.0f);
+    return glm::vec2(data[index * 2], data[index * 2 + 1]);
+}
+
+// builds a welded, indexed mesh out of a triangulated OBJ shape
+// corners that share position, normal, uv and uv winding become one vertex,
+// then every vertex gets a smooth tangent from generateTangents
+inline MeshData buildIndexedMesh(const tinyobj::attrib_t& attributes, const tinyobj::mesh_t& mesh)
+{
+    MeshData out;
+    out.boundsMin = glm::vec3(0.0f);
+    out.boundsMax = glm::vec3(0.0f);
+    size_t cornerCount = mesh.indices.size();
+
+    std::unordered_map<CornerKey, GLuint, CornerKeyHash> welded;
+    welded.reserve(cornerCount);
+    out.indices.reserve(cornerCount);
+
+    for (size_t i = 0; i + 2 < cornerCount; i += 3) {
+        tinyobj::index_t vData[3] = {
+            mesh.indices[i],
+            mesh.indices[i + 1],
+            mesh.indices[i + 2]
+        };
+
+        int uvWinding = uvWindingSign(
+            fetchVec2(attributes.texcoords, vData[0].texcoord_index),
+            fetchVec2(attributes.texcoords, vData[1].texcoord_index),
+            fetchVec2(attributes.texcoords, vData[2].texcoord_index));
+
+        for (int c = 0; c < 3; c++) {
+            CornerKey key;
+            key.vertex_index = vData[c].vertex_index;
+            key.normal_index = vData[c].normal_index;
+            key.texcoord_index = vData[c].texcoord_index;
+            key.uv_winding = uvWinding;
+
+            std::unordered_map<CornerKey, GLuint, CornerKeyHash>::iterator found = welded.find(key);
+            if (found != welded.end()) {
+                out.indices.push_back(found->second);
+                continue;
+            }
+
+            GLuint newIndex = out.vertexCount();
+            welded.insert(std::make_pair(key, newIndex));
+            out.indices.push_back(newIndex);
+
+            glm::vec3 position = fetchVec3(attributes.vertices, key.vertex_index);
+            glm::vec3 normal = fetchVec3(attributes.normals, key.normal_index);
+            glm::vec2 uv = fetchVec2(attributes.texcoords, key.texcoord_index);
+
+            if (newIndex == 0) {
+                out.boundsMin = position;
+                out.boundsMax = position;
+            }
+            out.boundsMin = glm::min(out.boundsMin, position);
+            out.boundsMax = glm::max(out.boundsMax, position);
+
+            GLfloat vertex[VERTEX_FLOATS] = {
+                position.x, position.y, position.z,
+                normal.x, normal.y, normal.z,
+                uv.x, uv.y,
+                0.0f, 0.0f, 0.0f, 1.0f // filled in by generateTangents
+            };
+            out.vertices.insert(out.vertices.end(), vertex, vertex + VERTEX_FLOATS);
+        }
+    }
+
+    generateTangents(out.vertices.data(), out.vertexCount(), VERTEX_TANGENT_LAYOUT,
+        out.indices.data(), out.indices.size());
+    return out;
+}
+
+// index buffer contents in mesh.indexType(), ready for glBufferData
+inline std::vector<unsigned char> packIndices(const MeshData& mesh)
+{
+    std::vector<unsigned char> packed;
+    if (mesh.indexType() == GL_UNSIGNED_SHORT) {
+        packed.resize(sizeof(GLushort) * mesh.indices.size());
+        GLushort* out = reinterpret_cast<GLushort*>(packed.data());
+        for (size_t i = 0; i < mesh.indices.size(); i++)
+            out[i] = static_cast<GLushort>(mesh.indices[i]);
+    }
+    else {
+        packed.resize(sizeof(GLuint) * mesh.indices.size());
+        if (!packed.empty())
+            std::memcpy(packed.data(), mesh.indices.data(), packed.size());
+    }
+    return packed;
+}
+#endif
@@ -0,0 +1,454 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "mesh.h"
+#include "mesh_lod.h"
+#include "mesh_optimizer.h"
+#include "meshlet.h"
+#include "model_import.h"
+#include "vertex_format.h"
+
+// tiny_obj_loader.h has to be included before this header (main.cpp owns the implementation)
+
+// binary file layout: MeshCacheHeader, packed vertices in vertexFormat, indices in indexType,
+// then the SubMesh, MeshLod, Meshlet and MaterialRecord arrays
+const unsigned int MESH_CACHE_MAGIC = 0x4853454D; // "MESH"
+const unsigned int MESH_CACHE_FORMAT = 6;
+// bump whenever buildModel (or a pass it runs) or packVertices changes what ends up in the VBO
+const unsigned int MESH_IMPORTER_VERSION = 8;
+const int MESH_CACHE_MAX_ATTRIBUTES = 8;
+
+struct MeshCacheHeader {
+    unsigned int magic;
+    unsigned int format;
+    unsigned int importerVersion;
+    unsigned int vertexFormat;
+    unsigned int vertexStride;
+    unsigned int reserved;
+    unsigned long long sourceHash; // .obj + .mtl contents
+    unsigned int vertexCount;
+    unsigned int indexCount;
+    unsigned int indexType;
+    unsigned int attributeCount;
+    float boundsMin[3];
+    float boundsMax[3];
+    float positionOffset[3];
+    float positionScale[3];
+    VertexFormatError formatError;
+    MeshOptimizationReport vertexCache;
+    unsigned int submeshCount;
+    unsigned int lodCount;
+    unsigned int meshletCount;
+    unsigned int materialCount;
+    VertexAttribute attributes[MESH_CACHE_MAX_ATTRIBUTES];
+};
+
+// 64-bit hash that consumes 8 bytes per step, enough to tell model revisions apart
+inline unsigned long long hashBytes(const char* data, size_t size, unsigned long long seed)
+{
+    const unsigned long long prime = 0x9E3779B97F4A7C15ull;
+    unsigned long long hash = seed ^ (size * prime);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        unsigned long long word;
+        std::memcpy(&word, data + i, 8);
+        hash ^= word * prime;
+        hash = (hash << 31) | (hash >> 33);
+        hash *= 0xC2B2AE3D27D4EB4Full;
+    }
+    for (; i < size; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 0x100000001B3ull;
+    }
+    hash ^= hash >> 29;
+    hash *= prime;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+// directory part of a path including the trailing separator, "" for bare file names
+inline std::string directoryOf(const std::string& path)
+{
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+// file names listed on the "mtllib" lines of an .obj
+inline std::vector<std::string> findMaterialLibraries(const char* data, size_t size)
+{
+    std::vector<std::string> names;
+    const char* end = data + size;
+    const char* line = data;
+    while (line < end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        if (!lineEnd)
+            lineEnd = end;
+
+        const char* c = line;
+        while (c < lineEnd && (*c == ' ' || *c == '\t'))
+            c++;
+        if (lineEnd - c > 6 && std::strncmp(c, "mtllib", 6) == 0 && (c[6] == ' ' || c[6] == '\t')) {
+            c += 6;
+            while (c < lineEnd) {
+                while (c < lineEnd && (*c == ' ' || *c == '\t' || *c == '\r'))
+                    c++;
+                const char* nameStart = c;
+                while (c < lineEnd && *c != ' ' && *c != '\t' && *c != '\r')
+                    c++;
+                if (c > nameStart)
+                    names.push_back(std::string(nameStart, c));
+            }
+        }
+        line = lineEnd + 1;
+    }
+    return names;
+}
+
+// hash of the .obj, every .mtl it references and the importer version
+inline unsigned long long hashMeshSource(const std::string& objPath, const MappedFile& obj,
+    unsigned int importerVersion = MESH_IMPORTER_VERSION)
+{
+    unsigned long long hash = hashBytes(obj.data(), obj.size(), importerVersion);
+
+    std::vector<std::string> libraries = findMaterialLibraries(obj.data(), obj.size());
+    std::string baseDir = directoryOf(objPath);
+    for (size_t i = 0; i < libraries.size(); i++) {
+        hash = hashBytes(libraries[i].c_str(), libraries[i].size(), hash);
+        MappedFile mtl;
+        if (mtl.open((baseDir + libraries[i]).c_str()))
+            hash = hashBytes(mtl.data(), mtl.size(), hash);
+    }
+    return hash;
+}
+
+// header fields that only depend on the importer and the vertex format
+inline MeshCacheHeader makeMeshCacheHeader(VertexFormat format, unsigned long long sourceHash,
+    unsigned int importerVersion = MESH_IMPORTER_VERSION)
+{
+    MeshCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = MESH_CACHE_MAGIC;
+    header.format = MESH_CACHE_FORMAT;
+    header.importerVersion = importerVersion;
+    header.vertexFormat = format;
+    header.vertexStride = vertexStride(format);
+    header.sourceHash = sourceHash;
+    header.attributeCount = VERTEX_ATTRIBUTE_COUNT;
+    const VertexAttribute* layout = vertexLayout(format);
+    for (int i = 0; i < VERTEX_ATTRIBUTE_COUNT; i++)
+        header.attributes[i] = layout[i];
+    return header;
+}
+
+// one block of a cache file after the header, in file order
+struct MeshCacheSection {
+    const void* data;
+    size_t size;
+};
+
+// writes header + sections to a temporary first so a crash never leaves a half-written cache behind
+inline bool writeMeshCacheFile(const std::string& cachePath, const MeshCacheHeader& header,
+    const MeshCacheSection* sections, size_t sectionCount)
+{
+    std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream file(tempPath.c_str(), std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (size_t i = 0; i < sectionCount; i++)
+            if (sections[i].size)
+                file.write(static_cast<const char*>(sections[i].data), sections[i].size);
+        if (!file)
+            return false;
+    }
+    std::remove(cachePath.c_str());
+    return std::rename(tempPath.c_str(), cachePath.c_str()) == 0;
+}
+
+// writes a post-processed mesh next to its source; returns false if the file cannot be written
+inline bool writeMeshCache(const std::string& cachePath, const MeshData& mesh, const PackedVertices& vertices,
+    const std::vector<MaterialRecord>& materials, const MeshOptimizationReport& report, unsigned long long sourceHash)
+{
+    std::vector<unsigned char> indexBytes = packIndices(mesh);
+
+    MeshCacheHeader header = makeMeshCacheHeader(vertices.format, sourceHash);
+    header.vertexCount = mesh.vertexCount();
+    header.indexCount = static_cast<unsigned int>(mesh.indices.size());
+    header.indexType = mesh.indexType();
+    for (int i = 0; i < 3; i++) {
+        header.boundsMin[i] = mesh.boundsMin[i];
+        header.boundsMax[i] = mesh.boundsMax[i];
+        header.positionOffset[i] = vertices.positionOffset[i];
+        header.positionScale[i] = vertices.positionScale[i];
+    }
+    header.formatError = vertices.error;
+    header.vertexCache = report;
+    header.submeshCount = static_cast<unsigned int>(mesh.submeshes.size());
+    header.lodCount = static_cast<unsigned int>(mesh.lods.size());
+    header.meshletCount = static_cast<unsigned int>(mesh.meshlets.size());
+    header.materialCount = static_cast<unsigned int>(materials.size());
+
+    MeshCacheSection sections[] = {
+        { vertices.bytes.data(), vertices.bytes.size() },
+        { indexBytes.data(), indexBytes.size() },
+        { mesh.submeshes.data(), sizeof(SubMesh) * mesh.submeshes.size() },
+        { mesh.lods.data(), sizeof(MeshLod) * mesh.lods.size() },
+        { mesh.meshlets.data(), sizeof(Meshlet) * mesh.meshlets.size() },
+        { materials.data(), sizeof(MaterialRecord) * materials.size() }
+    };
+    return writeMeshCacheFile(cachePath, header, sections, sizeof(sections) / sizeof(sections[0]));
+}
+
+// a mesh read from its binary cache; vertex and index data point straight into the mapping
+class CachedMesh
+{
+public:
+    CachedMesh() : header(NULL), fallbackSourceHash(0) {}
+
+    // maps cachePath and checks it against the importer that wrote it, source hash and vertex format
+    bool open(const std::string& cachePath, unsigned long long sourceHash, VertexFormat format,
+        unsigned int importerVersion = MESH_IMPORTER_VERSION)
+    {
+        header = NULL;
+        if (!file.open(cachePath.c_str()) || file.size() < sizeof(MeshCacheHeader))
+            return false;
+
+        const MeshCacheHeader* candidate = reinterpret_cast<const MeshCacheHeader*>(file.data());
+        size_t indexSize = candidate->indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+        size_t expectedSize = sizeof(MeshCacheHeader) +
+            (size_t)vertexStride(format) * candidate->vertexCount +
+            indexSize * candidate->indexCount +
+            sizeof(SubMesh) * candidate->submeshCount +
+            sizeof(MeshLod) * candidate->lodCount +
+            sizeof(Meshlet) * candidate->meshletCount +
+            sizeof(MaterialRecord) * candidate->materialCount;
+
+        if (candidate->magic != MESH_CACHE_MAGIC ||
+            candidate->format != MESH_CACHE_FORMAT ||
+            candidate->importerVersion != importerVersion ||
+            candidate->vertexFormat != (unsigned int)format ||
+            candidate->vertexStride != (unsigned int)vertexStride(format) ||
+            candidate->sourceHash != sourceHash ||
+            candidate->attributeCount != VERTEX_ATTRIBUTE_COUNT ||
+            std::memcmp(candidate->attributes, vertexLayout(format), sizeof(VertexAttribute) * VERTEX_ATTRIBUTE_COUNT) != 0 ||
+            file.size() != expectedSize) {
+            file.close();
+            return false;
+        }
+        header = candidate;
+        return true;
+    }
+
+    // keeps an in-memory copy when the cache could not be written
+    void adopt(const MeshData& mesh, const PackedVertices& vertices, const std::vector<MaterialRecord>& materials,
+        const MeshOptimizationReport& report, unsigned long long sourceHash)
+    {
+        file.close();
+        header = NULL;
+        fallback = mesh;
+        fallbackVertices = vertices;
+        fallbackMaterials = materials;
+        fallbackReport = report;
+        fallbackSourceHash = sourceHash;
+        fallbackIndices = packIndices(mesh);
+    }
+
+    const void* vertexData() const
+    {
+        if (header)
+            return file.data() + sizeof(MeshCacheHeader);
+        return fallbackVertices.bytes.data();
+    }
+
+    const void* indexData() const
+    {
+        if (header)
+            return file.data() + sizeof(MeshCacheHeader) + vertexBytes();
+        return fallbackIndices.data();
+    }
+
+    unsigned int vertexCount() const { return header ? header->vertexCount : fallback.vertexCount(); }
+    unsigned int indexCount() const { return header ? header->indexCount : (unsigned int)fallback.indices.size(); }
+    GLenum indexType() const { return header ? header->indexType : fallback.indexType(); }
+    VertexFormat vertexFormat() const { return header ? (VertexFormat)header->vertexFormat : fallbackVertices.format; }
+    size_t vertexBytes() const { return (size_t)vertexStride(vertexFormat()) * vertexCount(); }
+    size_t indexBytes() const { return (indexType() == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint)) * indexCount(); }
+
+    glm::vec3 boundsMin() const
+    {
+        return header ? glm::vec3(header->boundsMin[0], header->boundsMin[1], header->boundsMin[2]) : fallback.boundsMin;
+    }
+
+    glm::vec3 boundsMax() const
+    {
+        return header ? glm::vec3(header->boundsMax[0], header->boundsMax[1], header->boundsMax[2]) : fallback.boundsMax;
+    }
+
+    // uniforms sample.vert needs to decode positions of this mesh
+    glm::vec3 positionOffset() const
+    {
+        return header ? glm::vec3(header->positionOffset[0], header->positionOffset[1], header->positionOffset[2]) :
+            fallbackVertices.positionOffset;
+    }
+
+    glm::vec3 positionScale() const
+    {
+        return header ? glm::vec3(header->positionScale[0], header->positionScale[1], header->positionScale[2]) :
+            fallbackVertices.positionScale;
+    }
+
+    VertexFormatError formatError() const { return header ? header->formatError : fallbackVertices.error; }
+
+    // simulated post-transform cache efficiency before and after the import-time reordering
+    MeshOptimizationReport vertexCacheReport() const { return header ? header->vertexCache : fallbackReport; }
+
+    // hashMeshSource of the .obj and .mtl files the mesh was imported from
+    unsigned long long sourceHash() const { return header ? header->sourceHash : fallbackSourceHash; }
+
+    // the arrays after the index data are copied out, 16-bit indices can leave them unaligned
+    std::vector<SubMesh> submeshes() const
+    {
+        return header ? copyArray<SubMesh>(0, header->submeshCount) : fallback.submeshes;
+    }
+
+    // every submesh's LOD chain, finest first, see SubMesh::firstLod
+    std::vector<MeshLod> lods() const
+    {
+        return header ? copyArray<MeshLod>(sizeof(SubMesh) * header->submeshCount, header->lodCount) : fallback.lods;
+    }
+
+    // every submesh's level 0 clusters, see SubMesh::firstMeshlet
+    std::vector<Meshlet> meshlets() const
+    {
+        return header ? copyArray<Meshlet>(sizeof(SubMesh) * header->submeshCount + sizeof(MeshLod) * header->lodCount,
+            header->meshletCount) : fallback.meshlets;
+    }
+
+    // indexed by SubMesh::material
+    std::vector<MaterialRecord> materials() const
+    {
+        return header ? copyArray<MaterialRecord>(sizeof(SubMesh) * header->submeshCount +
+            sizeof(MeshLod) * header->lodCount + sizeof(Meshlet) * header->meshletCount,
+            header->materialCount) : fallbackMaterials;
+    }
+
+private:
+    template <typename T>
+    std::vector<T> copyArray(size_t offset, unsigned int count) const
+    {
+        std::vector<T> out(count);
+        if (count)
+            std::memcpy(out.data(), file.data() + sizeof(MeshCacheHeader) + vertexBytes() + indexBytes() + offset,
+                sizeof(T) * count);
+        return out;
+    }
+
+    MappedFile file;
+    const MeshCacheHeader* header;
+    MeshData fallback;
+    PackedVertices fallbackVertices;
+    std::vector<MaterialRecord> fallbackMaterials;
+    MeshOptimizationReport fallbackReport;
+    unsigned long long fallbackSourceHash;
+    std::vector<unsigned char> fallbackIndices;
+};
+
+// a CachedMesh's buffers on the GPU plus what sample.vert needs to decode its vertices
+struct GpuMesh {
+    GLuint vao;
+    GLuint vbo;
+    GLuint ebo;
+    GLenum indexType;
+    VertexFormat format;
+    glm::vec3 positionOffset;
+    glm::vec3 positionScale;
+};
+
+inline GpuMesh uploadMesh(const CachedMesh& mesh)
+{
+    GpuMesh gpu;
+    glGenVertexArrays(1, &gpu.vao);
+    glGenBuffers(1, &gpu.vbo);
+    glGenBuffers(1, &gpu.ebo);
+    glBindVertexArray(gpu.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, gpu.vbo);
+    glBufferData(GL_ARRAY_BUFFER, mesh.vertexBytes(), mesh.vertexData(), GL_STATIC_DRAW);
+    // ebo stays bound to the VAO
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpu.ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBytes(), mesh.indexData(), GL_STATIC_DRAW);
+    setVertexLayout(mesh.vertexFormat());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    gpu.indexType = mesh.indexType();
+    gpu.format = mesh.vertexFormat();
+    gpu.positionOffset = mesh.positionOffset();
+    gpu.positionScale = mesh.positionScale();
+    return gpu;
+}
+
+inline void releaseMesh(GpuMesh& gpu)
+{
+    glDeleteVertexArrays(1, &gpu.vao);
+    glDeleteBuffers(1, &gpu.vbo);
+    glDeleteBuffers(1, &gpu.ebo);
+    gpu.vao = gpu.vbo = gpu.ebo = 0;
+}
+
+// loads objPath through "<objPath>.meshcache", rebuilding the cache when the .obj/.mtl, importer or format changed
+inline bool loadMeshCached(const std::string& objPath, CachedMesh& out, std::string* warning, std::string* error,
+    VertexFormat format = VERTEX_FORMAT_FLOAT)
+{
+    MappedFile obj;
+    if (!obj.open(objPath.c_str())) {
+        if (error)
+            *error = "cannot open " + objPath;
+        return false;
+    }
+
+    unsigned long long sourceHash = hashMeshSource(objPath, obj);
+    std::string cachePath = objPath + ".meshcache";
+    if (out.open(cachePath, sourceHash, format))
+        return true;
+
+    // cache miss: parse the mapping we already hold on every core
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    tinyobj::attrib_t attributes;
+    tinyobj::MaterialFileReader materialReader(directoryOf(objPath));
+    bool success = tinyobj::LoadObjParallel(&attributes,
+        &shapes,
+        &materials,
+        warning,
+        error,
+        obj.data(),
+        obj.size(),
+        &materialReader);
+    obj.close();
+    if (!success || shapes.empty())
+        return false;
+
+    MeshOptimizationReport report;
+    MeshData mesh = buildModel(attributes, shapes, &report);
+    std::vector<MaterialRecord> records;
+    for (size_t i = 0; i < materials.size(); i++)
+        records.push_back(makeMaterialRecord(materials[i]));
+    PackedVertices vertices = packVertices(mesh, format);
+    if (writeMeshCache(cachePath, mesh, vertices, records, report, sourceHash) && out.open(cachePath, sourceHash, format))
+        return true;
+
+    out.adopt(mesh, vertices, records, report, sourceHash);
+    return true;
+}
+#endif
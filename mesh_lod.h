@@ -0,0 +1,537 @@
+#ifndef MESH_LOD_H
+#define MESH_LOD_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mesh.h"
+#include "mesh_optimizer.h"
+
+// quadric error metric simplification (Garland & Heckbert) into a LOD chain that shares the
+// mesh's vertices: every level is only another index range appended to mesh.indices
+// collapses are half-edge (a vertex merges into a neighbour that stays put), so the VBO never changes
+
+// triangle count of each level relative to the full mesh
+const float MESH_LOD_RATIOS[MESH_MAX_LODS - 1] = { 0.5f, 0.25f, 0.125f, 0.0625f };
+// a level has to drop at least this fraction of its parent's triangles to be kept
+const float MESH_LOD_MIN_REDUCTION = 0.1f;
+// open borders resist collapses across them this much more than the surface itself
+const double MESH_LOD_BORDER_WEIGHT = 10.0;
+// a collapse may turn no triangle by more than acos of this (~78 degrees)
+const double MESH_LOD_MAX_NORMAL_TURN = 0.2;
+// ... nor shrink one below this fraction of its area, slivers have no reliable normal to check
+const double MESH_LOD_MIN_AREA_RATIO = 0.05;
+// per pass, collapses stop at the candidate cost at this quantile so cheap ones go first everywhere
+const float MESH_LOD_PASS_QUANTILE = 0.5f;
+// Model3D switches to the coarsest level whose error covers at most this many pixels
+const float LOD_MAX_PIXEL_ERROR = 1.0f;
+// ... but only moves to a coarser level once it fits this fraction below the limit, so it does not pop back and forth
+const float LOD_HYSTERESIS = 0.25f;
+
+// symmetric 4x4 error quadric, sum of weighted squared distances to planes
+struct Quadric {
+    double a2, ab, ac, ad;
+    double b2, bc, bd;
+    double c2, cd;
+    double d2;
+    double weight;
+};
+
+inline Quadric planeQuadric(glm::dvec3 normal, double distance, double weight)
+{
+    Quadric q;
+    q.a2 = weight * normal.x * normal.x;
+    q.ab = weight * normal.x * normal.y;
+    q.ac = weight * normal.x * normal.z;
+    q.ad = weight * normal.x * distance;
+    q.b2 = weight * normal.y * normal.y;
+    q.bc = weight * normal.y * normal.z;
+    q.bd = weight * normal.y * distance;
+    q.c2 = weight * normal.z * normal.z;
+    q.cd = weight * normal.z * distance;
+    q.d2 = weight * distance * distance;
+    q.weight = weight;
+    return q;
+}
+
+inline void addQuadric(Quadric& to, const Quadric& q)
+{
+    to.a2 += q.a2; to.ab += q.ab; to.ac += q.ac; to.ad += q.ad;
+    to.b2 += q.b2; to.bc += q.bc; to.bd += q.bd;
+    to.c2 += q.c2; to.cd += q.cd;
+    to.d2 += q.d2;
+    to.weight += q.weight;
+}
+
+// weighted sum of squared distances from p to the quadric's planes
+inline double quadricError(const Quadric& q, glm::dvec3 p)
+{
+    double error = q.a2 * p.x * p.x + q.b2 * p.y * p.y + q.c2 * p.z * p.z +
+        2.0 * (q.ab * p.x * p.y + q.ac * p.x * p.z + q.bc * p.y * p.z) +
+        2.0 * (q.ad * p.x + q.bd * p.y + q.cd * p.z) + q.d2;
+    return error > 0.0 ? error : 0.0;
+}
+
+// distance from p to the closest point of triangle abc (Ericson, Real-Time Collision Detection 5.1.5)
+inline double pointTriangleDistance(glm::dvec3 p, glm::dvec3 a, glm::dvec3 b, glm::dvec3 c)
+{
+    glm::dvec3 ab = b - a, ac = c - a, ap = p - a;
+    double d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    if (d1 <= 0.0 && d2 <= 0.0)
+        return glm::length(ap);
+    glm::dvec3 bp = p - b;
+    double d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+    if (d3 >= 0.0 && d4 <= d3)
+        return glm::length(bp);
+    double vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+        return glm::length(ap - ab * (d1 / (d1 - d3)));
+    glm::dvec3 cp = p - c;
+    double d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+    if (d6 >= 0.0 && d5 <= d6)
+        return glm::length(cp);
+    double vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+        return glm::length(ap - ac * (d2 / (d2 - d6)));
+    double va = d3 * d6 - d5 * d4;
+    if (va <= 0.0 && d4 - d3 >= 0.0 && d5 - d6 >= 0.0)
+        return glm::length(bp - (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))));
+    double denominator = va + vb + vc;
+    if (denominator <= 0.0) // degenerate triangle, the corners are all that is left
+        return std::min(glm::length(ap), std::min(glm::length(bp), glm::length(cp)));
+    return glm::length(ap - ab * (vb / denominator) - ac * (vc / denominator));
+}
+
+// what a vertex may do during simplification
+enum SimplifyVertexKind {
+    SIMPLIFY_MANIFOLD = 0, // interior vertex, may merge into any neighbour
+    SIMPLIFY_BORDER = 1,   // on an open border, may only slide along it
+    SIMPLIFY_LOCKED = 2    // uv/normal seam or non-manifold, never moves
+};
+
+// a candidate half-edge collapse
+struct EdgeCollapse {
+    GLuint from;
+    GLuint to;
+    double cost;
+};
+
+struct ByCollapseCost {
+    bool operator()(const EdgeCollapse& a, const EdgeCollapse& b) const { return a.cost < b.cost; }
+};
+
+// packs a position's float bits so seam duplicates of the same corner compare equal
+struct PositionKey {
+    float x, y, z;
+
+    bool operator==(const PositionKey& other) const
+    {
+        return std::memcmp(this, &other, sizeof(PositionKey)) == 0;
+    }
+};
+
+struct PositionKeyHash {
+    size_t operator()(const PositionKey& key) const
+    {
+        // FNV-1a over the raw key bytes
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&key);
+        size_t hash = 2166136261u;
+        for (size_t i = 0; i < sizeof(PositionKey); i++) {
+            hash ^= bytes[i];
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+};
+
+// collapses edges of one index range until it is down to targetIndexCount, or nothing else may collapse
+class MeshSimplifier
+{
+public:
+    MeshSimplifier(const std::vector<GLfloat>& vertices, const GLuint* indices, size_t indexCount)
+        : indices(indices, indices + indexCount), maxError(0.0)
+    {
+        size_t vertexCount = vertices.size() / VERTEX_FLOATS;
+        positions.resize(vertexCount);
+        representative.resize(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++) {
+            const GLfloat* p = &vertices[v * VERTEX_FLOATS];
+            positions[v] = glm::dvec3(p[0], p[1], p[2]);
+            representative[v] = static_cast<GLuint>(v);
+        }
+        classifyVertices(vertices);
+        used.resize(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+            used[v] = adjacency.live[v] > 0;
+        buildQuadrics();
+    }
+
+    const std::vector<GLuint>& result() const { return indices; }
+
+    // object space error of the current result: how far any vertex of the input is from the result's
+    // triangles around the vertex it merged into. The surviving vertices never move, so this bounds the
+    // distance from the full surface's vertices to the simplified one from above; the quadric cost only
+    // gives a weighted RMS distance to the merged planes, 1.5x smaller on mesh_lod_bench's sphere
+    float error() const
+    {
+        TriangleAdjacency current;
+        buildTriangleAdjacency(indices.data(), indices.size(), positions.size(), current);
+        double worst = maxError;
+        for (size_t v = 0; v < positions.size(); v++) {
+            GLuint r = representative[v];
+            if (!used[v] || r == v || current.live[r] == 0)
+                continue;
+            // the triangles around r, then (only while v could still raise worst) around its neighbours too
+            double nearest = nearestAround(current, positions[v], r);
+            if (nearest <= worst)
+                continue;
+            for (unsigned int k = current.first[r]; k < current.first[r] + current.live[r] && nearest > worst; k++) {
+                const GLuint* around = &indices[(size_t)current.triangles[k] * 3];
+                for (int c = 0; c < 3; c++)
+                    if (around[c] != r)
+                        nearest = std::min(nearest, nearestAround(current, positions[v], around[c]));
+            }
+            worst = std::max(worst, nearest);
+        }
+        return static_cast<float>(worst);
+    }
+
+    // returns false once no collapse is possible any more
+    bool simplify(size_t targetIndexCount)
+    {
+        while (indices.size() > targetIndexCount) {
+            if (!collapsePass(targetIndexCount))
+                return false;
+        }
+        return true;
+    }
+
+private:
+    std::vector<glm::dvec3> positions;
+    std::vector<GLuint> indices;
+    std::vector<unsigned char> kinds;
+    std::vector<Quadric> quadrics;
+    TriangleAdjacency adjacency;
+    double maxError; // largest RMS distance of a collapse to its merged planes
+    std::vector<GLuint> representative; // the vertex each input vertex has merged into, itself while it lives
+    std::vector<unsigned char> used;     // referenced by the input range
+
+    // distance from p to the nearest of the current triangles around v
+    double nearestAround(const TriangleAdjacency& current, glm::dvec3 p, GLuint v) const
+    {
+        double nearest = 1e300;
+        for (unsigned int k = current.first[v]; k < current.first[v] + current.live[v]; k++) {
+            const GLuint* t = &indices[(size_t)current.triangles[k] * 3];
+            nearest = std::min(nearest, pointTriangleDistance(p, positions[t[0]], positions[t[1]], positions[t[2]]));
+        }
+        return nearest;
+    }
+
+    // how many triangles around a contain b
+    unsigned int sharedTriangles(GLuint a, GLuint b) const
+    {
+        unsigned int count = 0;
+        for (unsigned int k = adjacency.first[a]; k < adjacency.first[a] + adjacency.live[a]; k++) {
+            const GLuint* t = &indices[(size_t)adjacency.triangles[k] * 3];
+            if (t[0] == b || t[1] == b || t[2] == b)
+                count++;
+        }
+        return count;
+    }
+
+    void neighbours(GLuint v, std::vector<GLuint>& out) const
+    {
+        out.clear();
+        for (unsigned int k = adjacency.first[v]; k < adjacency.first[v] + adjacency.live[v]; k++) {
+            const GLuint* t = &indices[(size_t)adjacency.triangles[k] * 3];
+            for (int c = 0; c < 3; c++) {
+                if (t[c] != v && std::find(out.begin(), out.end(), t[c]) == out.end())
+                    out.push_back(t[c]);
+            }
+        }
+    }
+
+    void classifyVertices(const std::vector<GLfloat>& vertices)
+    {
+        size_t vertexCount = positions.size();
+        kinds.assign(vertexCount, SIMPLIFY_MANIFOLD);
+        buildTriangleAdjacency(indices.data(), indices.size(), vertexCount, adjacency);
+
+        // welding split a corner wherever its normal or uv differ; those copies have to stay together
+        std::unordered_map<PositionKey, GLuint, PositionKeyHash> firstAtPosition;
+        for (size_t v = 0; v < vertexCount; v++) {
+            if (adjacency.live[v] == 0)
+                continue;
+            const GLfloat* p = &vertices[v * VERTEX_FLOATS];
+            PositionKey key = { p[0], p[1], p[2] };
+            std::pair<std::unordered_map<PositionKey, GLuint, PositionKeyHash>::iterator, bool> inserted =
+                firstAtPosition.insert(std::make_pair(key, static_cast<GLuint>(v)));
+            if (!inserted.second) {
+                kinds[v] = SIMPLIFY_LOCKED;
+                kinds[inserted.first->second] = SIMPLIFY_LOCKED;
+            }
+        }
+
+        // edges used by one triangle are open borders; more than two of them meet at non-manifold vertices
+        std::vector<GLuint> ring;
+        for (size_t v = 0; v < vertexCount; v++) {
+            if (kinds[v] == SIMPLIFY_LOCKED || adjacency.live[v] == 0)
+                continue;
+            neighbours(static_cast<GLuint>(v), ring);
+            unsigned int borderEdges = 0;
+            for (size_t n = 0; n < ring.size(); n++) {
+                unsigned int shared = sharedTriangles(static_cast<GLuint>(v), ring[n]);
+                if (shared == 1)
+                    borderEdges++;
+                else if (shared > 2)
+                    borderEdges += 3;
+            }
+            if (borderEdges == 2)
+                kinds[v] = SIMPLIFY_BORDER;
+            else if (borderEdges > 0)
+                kinds[v] = SIMPLIFY_LOCKED;
+        }
+    }
+
+    void buildQuadrics()
+    {
+        Quadric zero;
+        std::memset(&zero, 0, sizeof(zero));
+        quadrics.assign(positions.size(), zero);
+
+        for (size_t t = 0; t < indices.size() / 3; t++) {
+            const GLuint* corner = &indices[t * 3];
+            glm::dvec3 p0 = positions[corner[0]];
+            glm::dvec3 p1 = positions[corner[1]];
+            glm::dvec3 p2 = positions[corner[2]];
+            glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+            double area = glm::length(normal);
+            if (area <= 0.0)
+                continue;
+            normal /= area;
+            Quadric face = planeQuadric(normal, -glm::dot(normal, p0), area * 0.5);
+            for (int c = 0; c < 3; c++)
+                addQuadric(quadrics[corner[c]], face);
+
+            // border edges also get a plane standing on the edge, perpendicular to the face
+            for (int c = 0; c < 3; c++) {
+                GLuint a = corner[c];
+                GLuint b = corner[(c + 1) % 3];
+                if (kinds[a] == SIMPLIFY_MANIFOLD || kinds[b] == SIMPLIFY_MANIFOLD || sharedTriangles(a, b) != 1)
+                    continue;
+                glm::dvec3 edge = positions[b] - positions[a];
+                double length = glm::length(edge);
+                if (length <= 0.0)
+                    continue;
+                glm::dvec3 side = glm::normalize(glm::cross(edge, normal));
+                Quadric border = planeQuadric(side, -glm::dot(side, positions[a]),
+                    length * length * MESH_LOD_BORDER_WEIGHT);
+                addQuadric(quadrics[a], border);
+                addQuadric(quadrics[b], border);
+            }
+        }
+    }
+
+    bool canCollapse(GLuint from, GLuint to) const
+    {
+        if (kinds[from] == SIMPLIFY_LOCKED)
+            return false;
+        if (kinds[from] == SIMPLIFY_BORDER)
+            return kinds[to] != SIMPLIFY_MANIFOLD && sharedTriangles(from, to) == 1;
+        return true;
+    }
+
+    // the link condition and no triangle around from may flip once it moves onto to
+    bool collapseKeepsTopology(GLuint from, GLuint to, std::vector<GLuint>& ringFrom, std::vector<GLuint>& ringTo) const
+    {
+        neighbours(from, ringFrom);
+        neighbours(to, ringTo);
+        unsigned int common = 0;
+        for (size_t i = 0; i < ringFrom.size(); i++) {
+            if (std::find(ringTo.begin(), ringTo.end(), ringFrom[i]) != ringTo.end())
+                common++;
+        }
+        if (common > (kinds[from] == SIMPLIFY_BORDER ? 1u : 2u))
+            return false;
+
+        for (unsigned int k = adjacency.first[from]; k < adjacency.first[from] + adjacency.live[from]; k++) {
+            const GLuint* t = &indices[(size_t)adjacency.triangles[k] * 3];
+            if (t[0] == to || t[1] == to || t[2] == to)
+                continue;
+            glm::dvec3 p[3];
+            glm::dvec3 moved[3];
+            for (int c = 0; c < 3; c++) {
+                p[c] = positions[t[c]];
+                moved[c] = t[c] == from ? positions[to] : p[c];
+            }
+            glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+            glm::dvec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+            double beforeArea = glm::length(before);
+            double afterArea = glm::length(after);
+            if (afterArea < beforeArea * MESH_LOD_MIN_AREA_RATIO ||
+                glm::dot(before, after) <= MESH_LOD_MAX_NORMAL_TURN * beforeArea * afterArea)
+                return false;
+        }
+        return true;
+    }
+
+    bool collapsePass(size_t targetIndexCount)
+    {
+        size_t vertexCount = positions.size();
+        buildTriangleAdjacency(indices.data(), indices.size(), vertexCount, adjacency);
+
+        // cheapest direction of every edge, each edge seen once from its lower vertex
+        std::vector<EdgeCollapse> candidates;
+        candidates.reserve(indices.size());
+        for (size_t t = 0; t < indices.size() / 3; t++) {
+            for (int c = 0; c < 3; c++) {
+                GLuint a = indices[t * 3 + c];
+                GLuint b = indices[t * 3 + (c + 1) % 3];
+                if (a > b && sharedTriangles(a, b) > 1)
+                    continue; // interior edge, its twin triangle adds it with a < b
+                Quadric merged = quadrics[a];
+                addQuadric(merged, quadrics[b]);
+                EdgeCollapse best = { a, b, -1.0 };
+                if (canCollapse(a, b))
+                    best.cost = quadricError(merged, positions[b]);
+                if (canCollapse(b, a)) {
+                    double cost = quadricError(merged, positions[a]);
+                    if (best.cost < 0.0 || cost < best.cost) {
+                        best.from = b;
+                        best.to = a;
+                        best.cost = cost;
+                    }
+                }
+                if (best.cost >= 0.0)
+                    candidates.push_back(best);
+            }
+        }
+        if (candidates.empty())
+            return false;
+        std::sort(candidates.begin(), candidates.end(), ByCollapseCost());
+        double costLimit = candidates[(size_t)((candidates.size() - 1) * MESH_LOD_PASS_QUANTILE)].cost;
+
+        std::vector<GLuint> remap(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+            remap[v] = static_cast<GLuint>(v);
+        std::vector<unsigned char> touched(vertexCount, 0);
+        std::vector<GLuint> ringFrom, ringTo;
+        size_t triangles = indices.size() / 3;
+        size_t targetTriangles = targetIndexCount / 3;
+        size_t collapses = 0;
+
+        for (size_t i = 0; i < candidates.size() && triangles > targetTriangles; i++) {
+            const EdgeCollapse& collapse = candidates[i];
+            if (collapse.cost > costLimit && collapses > 0)
+                break;
+            if (touched[collapse.from] || touched[collapse.to])
+                continue;
+            if (!collapseKeepsTopology(collapse.from, collapse.to, ringFrom, ringTo))
+                continue;
+
+            // nothing around from may change again this pass, the adjacency is from its start
+            touched[collapse.from] = 1;
+            touched[collapse.to] = 1;
+            for (size_t n = 0; n < ringFrom.size(); n++)
+                touched[ringFrom[n]] = 1;
+
+            triangles -= sharedTriangles(collapse.from, collapse.to);
+            remap[collapse.from] = collapse.to;
+            addQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+            double weight = quadrics[collapse.to].weight;
+            if (weight > 0.0)
+                maxError = std::max(maxError, std::sqrt(collapse.cost / weight));
+            collapses++;
+        }
+        if (collapses == 0)
+            return false;
+        for (size_t v = 0; v < vertexCount; v++)
+            representative[v] = remap[representative[v]];
+
+        // apply the pass and drop the triangles that collapsed to lines
+        size_t kept = 0;
+        for (size_t t = 0; t < indices.size() / 3; t++) {
+            GLuint a = remap[indices[t * 3]];
+            GLuint b = remap[indices[t * 3 + 1]];
+            GLuint c = remap[indices[t * 3 + 2]];
+            if (a == b || b == c || c == a)
+                continue;
+            indices[kept * 3] = a;
+            indices[kept * 3 + 1] = b;
+            indices[kept * 3 + 2] = c;
+            kept++;
+        }
+        indices.resize(kept * 3);
+        return true;
+    }
+};
+
+// appends MESH_LOD_RATIOS levels of mesh.indices to the index buffer and records them in mesh.lods
+// expects the full mesh already ordered by optimizeMesh; each level gets its own vertex cache order
+inline void generateLods(MeshData& mesh)
+{
+    mesh.lods.clear();
+    MeshLod full = { 0, static_cast<unsigned int>(mesh.indices.size()), 0.0f };
+    mesh.lods.push_back(full);
+    if (mesh.indices.size() < 3)
+        return;
+
+    // one progressive run, every level is a snapshot of it
+    MeshSimplifier simplifier(mesh.vertices, mesh.indices.data(), mesh.indices.size());
+    size_t fullTriangles = mesh.indices.size() / 3;
+    for (int level = 0; level < MESH_MAX_LODS - 1; level++) {
+        size_t target = (size_t)(fullTriangles * MESH_LOD_RATIOS[level]) * 3;
+        bool reached = simplifier.simplify(target);
+
+        std::vector<GLuint> lod = simplifier.result();
+        size_t parentCount = mesh.lods.back().indexCount;
+        if (lod.empty() || lod.size() > parentCount * (1.0f - MESH_LOD_MIN_REDUCTION))
+            break;
+        optimizeVertexCache(lod, mesh.vertexCount());
+
+        // never below the parent's, selectLod expects the error to grow with the level
+        MeshLod entry = { static_cast<unsigned int>(mesh.indices.size()), static_cast<unsigned int>(lod.size()),
+            std::max(simplifier.error(), mesh.lods.back().error) };
+        mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+        mesh.lods.push_back(entry);
+        if (!reached)
+            break;
+    }
+}
+
+// the coarsest level whose error, projected at distance, stays under maxPixels
+// pixelsPerUnit is the screen size of one world unit at distance 1 (projection[1][1] * viewportHeight / 2)
+inline int selectLod(const std::vector<MeshLod>& lods, float worldScale, float distance, float pixelsPerUnit,
+    float maxPixels)
+{
+    int level = 0;
+    for (size_t i = 1; i < lods.size(); i++) {
+        float pixels = lods[i].error * worldScale * pixelsPerUnit / std::max(distance, 1e-4f);
+        if (pixels > maxPixels)
+            break;
+        level = static_cast<int>(i);
+    }
+    return level;
+}
+
+// one line for the log, e.g. "5 levels: 20000 tris, 10000 tris (error 0.0012), ..."
+inline std::string describeLods(const std::vector<MeshLod>& lods)
+{
+    std::stringstream text;
+    text << lods.size() << (lods.size() == 1 ? " level: " : " levels: ");
+    for (size_t i = 0; i < lods.size(); i++) {
+        text << (i ? ", " : "") << lods[i].indexCount / 3 << " tris";
+        if (i > 0)
+            text << " (error " << lods[i].error << ")";
+    }
+    return text.str();
+}
+#endif
@@ -0,0 +1,369 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "mesh.h"
+
+// import-time reordering of an indexed triangle list:
+// optimizeVertexCache (Forsyth) -> optimizeOverdraw (cluster sort) -> optimizeVertexFetch
+// none of them change what is drawn, only the order triangles and vertices are stored in
+
+// FIFO size the simulator assumes for the post-transform cache
+const unsigned int VERTEX_CACHE_SIMULATED_SIZE = 16;
+// LRU size Forsyth's scoring is tuned for
+const int FORSYTH_CACHE_SIZE = 32;
+// overdraw clusters may cost this much more ACMR than the cache-optimal order
+const float OVERDRAW_ACMR_THRESHOLD = 1.05f;
+
+// post-transform cache efficiency of an index buffer
+struct VertexCacheStats {
+    float acmr; // vertex shader runs per triangle, 0.5 is ideal on big regular meshes
+    float atvr; // vertex shader runs per referenced vertex, 1.0 is ideal
+};
+
+// before/after numbers for the log and the mesh cache
+struct MeshOptimizationReport {
+    VertexCacheStats before;
+    VertexCacheStats after;
+};
+
+// CPU simulation of a FIFO post-transform cache holding cacheSize vertices
+inline VertexCacheStats analyzeVertexCache(const GLuint* indices, size_t indexCount, size_t vertexCount,
+    unsigned int cacheSize = VERTEX_CACHE_SIMULATED_SIZE)
+{
+    VertexCacheStats stats = { 0.0f, 0.0f };
+    if (indexCount < 3)
+        return stats;
+
+    // a vertex is cached while fewer than cacheSize misses happened since it was loaded
+    std::vector<unsigned int> loadedAt(vertexCount, 0);
+    std::vector<unsigned char> referenced(vertexCount, 0);
+    unsigned int misses = 0;
+    size_t unique = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        GLuint v = indices[i];
+        if (!referenced[v]) {
+            referenced[v] = 1;
+            unique++;
+        }
+        if (loadedAt[v] == 0 || misses + 1 - loadedAt[v] >= cacheSize) {
+            misses++;
+            loadedAt[v] = misses;
+        }
+    }
+    stats.acmr = (float)misses / (float)(indexCount / 3);
+    stats.atvr = (float)misses / (float)unique;
+    return stats;
+}
+
+// vertex -> triangle adjacency as offsets + flat list
+struct TriangleAdjacency {
+    std::vector<unsigned int> first; // vertexCount + 1
+    std::vector<unsigned int> triangles;
+    std::vector<unsigned int> live; // per vertex, triangles not emitted yet (they are kept at the front)
+};
+
+inline void buildTriangleAdjacency(const GLuint* indices, size_t indexCount, size_t vertexCount,
+    TriangleAdjacency& adjacency)
+{
+    adjacency.first.assign(vertexCount + 1, 0);
+    for (size_t i = 0; i < indexCount; i++)
+        adjacency.first[indices[i] + 1]++;
+    for (size_t v = 0; v < vertexCount; v++)
+        adjacency.first[v + 1] += adjacency.first[v];
+
+    adjacency.triangles.resize(indexCount);
+    adjacency.live.assign(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; i++) {
+        GLuint v = indices[i];
+        adjacency.triangles[adjacency.first[v] + adjacency.live[v]++] = static_cast<unsigned int>(i / 3);
+    }
+}
+
+// Forsyth, "Linear-Speed Vertex Cache Optimisation": vertices score by LRU position and by how
+// few triangles still need them, the next triangle is the best scoring one touching the cache
+inline float forsythVertexScore(int cachePosition, unsigned int remaining)
+{
+    if (remaining == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3)
+            score = 0.75f; // the triangle just drawn; a fixed score keeps strips from being favoured
+        else
+            score = std::pow(1.0f - (cachePosition - 3) / (float)(FORSYTH_CACHE_SIZE - 3), 1.5f);
+    }
+    return score + 2.0f / std::sqrt((float)remaining);
+}
+
+inline void optimizeVertexCache(std::vector<GLuint>& indices, size_t vertexCount)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    TriangleAdjacency adjacency;
+    buildTriangleAdjacency(indices.data(), triangleCount * 3, vertexCount, adjacency);
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        vertexScore[v] = forsythVertexScore(-1, adjacency.live[v]);
+
+    std::vector<unsigned char> emitted(triangleCount, 0);
+
+    std::vector<GLuint> out;
+    out.reserve(triangleCount * 3);
+    std::vector<GLuint> cache;
+    std::vector<GLuint> newCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    size_t deadEndCursor = 0;
+    int best = -1;
+    for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+        if (best < 0) {
+            // nothing in the cache has work left; restart from the next triangle in input order
+            while (emitted[deadEndCursor])
+                deadEndCursor++;
+            best = static_cast<int>(deadEndCursor);
+        }
+
+        const GLuint* triangle = &indices[(size_t)best * 3];
+        out.insert(out.end(), triangle, triangle + 3);
+        emitted[best] = 1;
+
+        // drop the triangle from its vertices' live lists
+        for (int c = 0; c < 3; c++) {
+            GLuint v = triangle[c];
+            unsigned int* live = &adjacency.triangles[adjacency.first[v]];
+            unsigned int count = adjacency.live[v];
+            for (unsigned int k = 0; k < count; k++) {
+                if (live[k] == (unsigned int)best) {
+                    live[k] = live[count - 1];
+                    adjacency.live[v]--;
+                    break;
+                }
+            }
+        }
+
+        // LRU update: the triangle's vertices move to the front
+        newCache.assign(triangle, triangle + 3);
+        for (size_t k = 0; k < cache.size(); k++) {
+            GLuint v = cache[k];
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                newCache.push_back(v);
+        }
+        for (size_t k = FORSYTH_CACHE_SIZE; k < newCache.size(); k++) {
+            cachePosition[newCache[k]] = -1;
+            vertexScore[newCache[k]] = forsythVertexScore(-1, adjacency.live[newCache[k]]);
+        }
+        if (newCache.size() > (size_t)FORSYTH_CACHE_SIZE)
+            newCache.resize(FORSYTH_CACHE_SIZE);
+        cache.swap(newCache);
+
+        for (size_t k = 0; k < cache.size(); k++) {
+            cachePosition[cache[k]] = static_cast<int>(k);
+            vertexScore[cache[k]] = forsythVertexScore(static_cast<int>(k), adjacency.live[cache[k]]);
+        }
+
+        // the next triangle is the best one that touches the cache
+        best = -1;
+        float bestScore = -1.0f;
+        for (size_t k = 0; k < cache.size(); k++) {
+            GLuint v = cache[k];
+            const unsigned int* live = &adjacency.triangles[adjacency.first[v]];
+            for (unsigned int n = 0; n < adjacency.live[v]; n++) {
+                unsigned int t = live[n];
+                float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] +
+                    vertexScore[indices[t * 3 + 2]];
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = static_cast<int>(t);
+                }
+            }
+        }
+    }
+
+    indices.swap(out);
+}
+
+// a run of triangles in cache order that the overdraw pass moves as a unit
+struct TriangleCluster {
+    size_t first;
+    size_t count;
+    float sortKey;
+};
+
+// Sander, Nehab, Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw":
+// the cache-ordered list is cut into clusters wherever restarting the cache costs at most
+// threshold x the ACMR, then clusters facing away from the mesh centre are drawn first so
+// they occlude the rest from most view directions
+inline void optimizeOverdraw(std::vector<GLuint>& indices, const std::vector<GLfloat>& vertices,
+    float threshold = OVERDRAW_ACMR_THRESHOLD)
+{
+    size_t triangleCount = indices.size() / 3;
+    size_t vertexCount = vertices.size() / VERTEX_FLOATS;
+    if (triangleCount < 2)
+        return;
+
+    // hard boundaries: a triangle that misses the cache on all three corners starts over anyway
+    std::vector<unsigned int> loadedAt(vertexCount, 0);
+    unsigned int misses = 0;
+    std::vector<size_t> hardStarts;
+    for (size_t t = 0; t < triangleCount; t++) {
+        unsigned int triangleMisses = 0;
+        for (int c = 0; c < 3; c++) {
+            GLuint v = indices[t * 3 + c];
+            if (loadedAt[v] == 0 || misses + 1 - loadedAt[v] >= VERTEX_CACHE_SIMULATED_SIZE) {
+                misses++;
+                loadedAt[v] = misses;
+                triangleMisses++;
+            }
+        }
+        if (t == 0 || triangleMisses == 3)
+            hardStarts.push_back(t);
+    }
+    hardStarts.push_back(triangleCount);
+
+    // soft boundaries inside each hard cluster, simulated with a cold cache at every cut
+    std::vector<TriangleCluster> clusters;
+    for (size_t h = 0; h + 1 < hardStarts.size(); h++) {
+        size_t begin = hardStarts[h];
+        size_t end = hardStarts[h + 1];
+        float clusterAcmr = analyzeVertexCache(&indices[begin * 3], (end - begin) * 3, vertexCount).acmr;
+
+        size_t start = begin;
+        std::fill(loadedAt.begin(), loadedAt.end(), 0);
+        misses = 0;
+        unsigned int startMisses = 0;
+        for (size_t t = begin; t < end; t++) {
+            for (int c = 0; c < 3; c++) {
+                GLuint v = indices[t * 3 + c];
+                if (loadedAt[v] == 0 || misses + 1 - loadedAt[v] >= VERTEX_CACHE_SIMULATED_SIZE) {
+                    misses++;
+                    loadedAt[v] = misses;
+                }
+            }
+            size_t length = t + 1 - start;
+            float acmr = (float)(misses - startMisses) / (float)length;
+            if (t + 1 < end && length >= 8 && acmr <= clusterAcmr * threshold) {
+                TriangleCluster cluster = { start, length, 0.0f };
+                clusters.push_back(cluster);
+                start = t + 1;
+                // the next cluster might be drawn after anything else, so it starts cold
+                std::fill(loadedAt.begin(), loadedAt.end(), 0);
+                misses = 0;
+                startMisses = 0;
+            }
+        }
+        if (start < end) {
+            TriangleCluster cluster = { start, end - start, 0.0f };
+            clusters.push_back(cluster);
+        }
+    }
+    if (clusters.size() < 2)
+        return;
+
+    // area weighted centroid and normal per cluster, and for the whole mesh
+    std::vector<glm::vec3> centroids(clusters.size());
+    std::vector<glm::vec3> normals(clusters.size());
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t k = 0; k < clusters.size(); k++) {
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = clusters[k].first; t < clusters[k].first + clusters[k].count; t++) {
+            const GLfloat* a = &vertices[(size_t)indices[t * 3] * VERTEX_FLOATS];
+            const GLfloat* b = &vertices[(size_t)indices[t * 3 + 1] * VERTEX_FLOATS];
+            const GLfloat* c = &vertices[(size_t)indices[t * 3 + 2] * VERTEX_FLOATS];
+            glm::vec3 p0(a[0], a[1], a[2]);
+            glm::vec3 p1(b[0], b[1], b[2]);
+            glm::vec3 p2(c[0], c[1], c[2]);
+            glm::vec3 scaledNormal = glm::cross(p1 - p0, p2 - p0);
+            float triangleArea = glm::length(scaledNormal);
+            centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+            normal += scaledNormal;
+            area += triangleArea;
+        }
+        meshCentroid += centroid;
+        meshArea += area;
+        centroids[k] = area > 0.0f ? centroid / area : centroid;
+        float normalLength = glm::length(normal);
+        normals[k] = normalLength > 0.0f ? normal / normalLength : normal;
+    }
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    for (size_t k = 0; k < clusters.size(); k++)
+        clusters[k].sortKey = glm::dot(centroids[k] - meshCentroid, normals[k]);
+
+    struct ByDescendingKey {
+        bool operator()(const TriangleCluster& a, const TriangleCluster& b) const { return a.sortKey > b.sortKey; }
+    };
+    std::stable_sort(clusters.begin(), clusters.end(), ByDescendingKey());
+
+    std::vector<GLuint> out;
+    out.reserve(indices.size());
+    for (size_t k = 0; k < clusters.size(); k++)
+        out.insert(out.end(), indices.begin() + clusters[k].first * 3,
+            indices.begin() + (clusters[k].first + clusters[k].count) * 3);
+    indices.swap(out);
+}
+
+// renumbers vertices in the order the index buffer first uses them, so the VBO is read front to back
+// vertices no triangle references are dropped
+inline void optimizeVertexFetch(MeshData& mesh)
+{
+    size_t vertexCount = mesh.vertexCount();
+    const GLuint unused = 0xFFFFFFFFu;
+    std::vector<GLuint> remap(vertexCount, unused);
+    std::vector<GLfloat> vertices;
+    vertices.reserve(mesh.vertices.size());
+
+    GLuint next = 0;
+    for (size_t i = 0; i < mesh.indices.size(); i++) {
+        GLuint v = mesh.indices[i];
+        if (remap[v] == unused) {
+            remap[v] = next++;
+            vertices.insert(vertices.end(), mesh.vertices.begin() + (size_t)v * VERTEX_FLOATS,
+                mesh.vertices.begin() + (size_t)(v + 1) * VERTEX_FLOATS);
+        }
+        mesh.indices[i] = remap[v];
+    }
+    mesh.vertices.swap(vertices);
+}
+
+// all three passes, in the order each one expects
+inline MeshOptimizationReport optimizeMesh(MeshData& mesh)
+{
+    MeshOptimizationReport report;
+    report.before = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount());
+    optimizeVertexCache(mesh.indices, mesh.vertexCount());
+    optimizeOverdraw(mesh.indices, mesh.vertices);
+    optimizeVertexFetch(mesh);
+    report.after = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount());
+    return report;
+}
+
+// one line for the log, e.g. "ACMR 1.52 -> 0.68, ATVR 2.31 -> 1.04 (FIFO 16)"
+inline std::string describeVertexCache(const MeshOptimizationReport& report)
+{
+    std::stringstream text;
+    text << "ACMR " << report.before.acmr << " -> " << report.after.acmr
+        << ", ATVR " << report.before.atvr << " -> " << report.after.atvr
+        << " (FIFO " << VERTEX_CACHE_SIMULATED_SIZE << ")";
+    return text.str();
+}
+#endif
@@ -0,0 +1,491 @@
+#ifndef MESH_STREAM_H
+#define MESH_STREAM_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "mesh.h"
+#include "mesh_cache.h"
+#include "mesh_optimizer.h"
+#include "model_import.h"
+#include "tangent_space.h"
+#include "vertex_format.h"
+
+// tiny_obj_loader.h has to be included before this header (main.cpp owns the implementation)
+
+// low-memory import for very large OBJs such as scans, built on LoadObjWithCallback:
+// pass 1 only counts records, so every array after it is allocated once at its final size;
+// pass 2 fills them, welds corners on the fly and writes indices straight into their
+// material's range; vertices are then encoded directly into the cache's packed layout.
+// No attrib_t, mesh_t or float MeshData is built. The vertex cache, overdraw, meshlet and LOD
+// passes need whole-mesh adjacency and are skipped: every SubMesh has one level and no meshlets.
+
+// kept apart from MESH_IMPORTER_VERSION so a cache written by one importer is rebuilt by the other
+const unsigned int MESH_STREAM_IMPORTER_VERSION = 0x10000 | 1;
+
+// .obj files at least this big go through the streaming importer in loadMesh
+const size_t MESH_STREAM_MIN_FILE_SIZE = (size_t)256 << 20;
+
+// the .obj is read through a buffer this big
+const size_t MESH_STREAM_BUFFER_SIZE = 1 << 20;
+
+const unsigned int STREAM_NO_VERTEX = 0xFFFFFFFFu;
+
+// heap the importer held at its worst moment against what it wrote, in bytes
+struct MeshStreamStats {
+    size_t peakBytes;
+    size_t outputBytes;
+};
+
+// pass 1: record counts; triangles are per material slot, slot 0 is "no material", slot i is id i - 1
+struct ObjRecordCounts {
+    size_t positions;
+    size_t normals;
+    size_t texcoords;
+    std::vector<size_t> triangles;
+    int material;
+    std::vector<tinyobj::material_t> materials;
+};
+
+// one welded vertex: the OBJ corner it came from and the next vertex sharing its position
+struct StreamVertex {
+    unsigned int position;
+    int normal;
+    int texcoord;
+    int uvWinding;
+    unsigned int next;
+};
+
+// pass 2: arenas sized from ObjRecordCounts
+struct ObjStreamState {
+    const ObjRecordCounts* counts;
+    std::vector<float> positions; // 3 per record
+    std::vector<float> normals;   // 3 per record
+    std::vector<float> texcoords; // 2 per record
+    size_t positionCount, normalCount, texcoordCount; // records read so far
+    std::vector<unsigned int> firstVertex; // per position, head of its StreamVertex chain
+    std::vector<StreamVertex> vertices;
+    std::vector<GLuint> indices;
+    std::vector<size_t> cursor; // per material slot, next index to write
+    std::vector<tinyobj::index_t> face; // the current face's resolved corners
+    int material;
+    std::string failure;
+};
+
+inline size_t materialSlot(int material)
+{
+    return material < 0 ? 0 : (size_t)material + 1;
+}
+
+// OBJ indices are 1-based, negative ones count back from the last record read, 0 means absent
+// returns -1 for absent and -2 for out of range
+inline int resolveObjIndex(int raw, size_t readSoFar, size_t total)
+{
+    if (raw == 0)
+        return -1;
+    long long index = raw > 0 ? (long long)raw - 1 : (long long)readSoFar + raw;
+    return index >= 0 && index < (long long)total ? (int)index : -2;
+}
+
+inline void countPosition(void* user, tinyobj::real_t, tinyobj::real_t, tinyobj::real_t, tinyobj::real_t)
+{
+    static_cast<ObjRecordCounts*>(user)->positions++;
+}
+
+inline void countNormal(void* user, tinyobj::real_t, tinyobj::real_t, tinyobj::real_t)
+{
+    static_cast<ObjRecordCounts*>(user)->normals++;
+}
+
+inline void countTexcoord(void* user, tinyobj::real_t, tinyobj::real_t, tinyobj::real_t)
+{
+    static_cast<ObjRecordCounts*>(user)->texcoords++;
+}
+
+inline void countFace(void* user, tinyobj::index_t*, int cornerCount)
+{
+    ObjRecordCounts* counts = static_cast<ObjRecordCounts*>(user);
+    if (cornerCount < 3)
+        return;
+    size_t slot = materialSlot(counts->material);
+    if (counts->triangles.size() <= slot)
+        counts->triangles.resize(slot + 1, 0);
+    counts->triangles[slot] += cornerCount - 2;
+}
+
+inline void countUseMaterial(void* user, const char*, int material)
+{
+    static_cast<ObjRecordCounts*>(user)->material = material;
+}
+
+inline void countMaterialLibrary(void* user, const tinyobj::material_t* materials, int count)
+{
+    static_cast<ObjRecordCounts*>(user)->materials.assign(materials, materials + count);
+}
+
+inline void streamPosition(void* user, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t z, tinyobj::real_t)
+{
+    ObjStreamState* state = static_cast<ObjStreamState*>(user);
+    float* out = &state->positions[state->positionCount++ * 3];
+    out[0] = x;
+    out[1] = y;
+    out[2] = z;
+}
+
+inline void streamNormal(void* user, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t z)
+{
+    ObjStreamState* state = static_cast<ObjStreamState*>(user);
+    float* out = &state->normals[state->normalCount++ * 3];
+    out[0] = x;
+    out[1] = y;
+    out[2] = z;
+}
+
+inline void streamTexcoord(void* user, tinyobj::real_t u, tinyobj::real_t v, tinyobj::real_t)
+{
+    ObjStreamState* state = static_cast<ObjStreamState*>(user);
+    float* out = &state->texcoords[state->texcoordCount++ * 2];
+    out[0] = u;
+    out[1] = v;
+}
+
+inline void streamUseMaterial(void* user, const char*, int material)
+{
+    static_cast<ObjStreamState*>(user)->material = material;
+}
+
+inline glm::vec2 streamTexcoordAt(const ObjStreamState& state, int texcoord)
+{
+    return texcoord < 0 ? glm::vec2(0.0f) : glm::vec2(state.texcoords[texcoord * 2], state.texcoords[texcoord * 2 + 1]);
+}
+
+// the welded vertex of a corner, added if this (position, normal, uv, uv winding) is new
+inline GLuint weldStreamCorner(ObjStreamState& state, int position, int normal, int texcoord, int uvWinding)
+{
+    unsigned int* link = &state.firstVertex[position];
+    while (*link != STREAM_NO_VERTEX) {
+        const StreamVertex& vertex = state.vertices[*link];
+        if (vertex.normal == normal && vertex.texcoord == texcoord && vertex.uvWinding == uvWinding)
+            return *link;
+        link = &state.vertices[*link].next;
+    }
+    StreamVertex vertex = { (unsigned int)position, normal, texcoord, uvWinding, STREAM_NO_VERTEX };
+    *link = static_cast<unsigned int>(state.vertices.size());
+    state.vertices.push_back(vertex);
+    return *link;
+}
+
+// quads follow LoadObj's triangulation, larger polygons are fanned from their first corner
+inline void streamFace(void* user, tinyobj::index_t* corners, int cornerCount)
+{
+    ObjStreamState* state = static_cast<ObjStreamState*>(user);
+    if (cornerCount < 3 || !state->failure.empty())
+        return;
+
+    std::vector<tinyobj::index_t>& resolved = state->face;
+    resolved.resize(cornerCount);
+    for (int c = 0; c < cornerCount; c++) {
+        resolved[c].vertex_index = resolveObjIndex(corners[c].vertex_index, state->positionCount, state->counts->positions);
+        resolved[c].normal_index = resolveObjIndex(corners[c].normal_index, state->normalCount, state->counts->normals);
+        resolved[c].texcoord_index = resolveObjIndex(corners[c].texcoord_index, state->texcoordCount,
+            state->counts->texcoords);
+        if (resolved[c].vertex_index < 0 || resolved[c].normal_index == -2 || resolved[c].texcoord_index == -2) {
+            state->failure = "face index out of range";
+            return;
+        }
+    }
+
+    // quads split along their shorter diagonal like LoadObj does, once their positions are known
+    bool splitAt13 = false;
+    if (cornerCount == 4) {
+        bool known = true;
+        glm::vec3 p[4];
+        for (int c = 0; c < 4 && known; c++) {
+            known = resolved[c].vertex_index < (int)state->positionCount;
+            if (known) {
+                const float* position = &state->positions[(size_t)resolved[c].vertex_index * 3];
+                p[c] = glm::vec3(position[0], position[1], position[2]);
+            }
+        }
+        splitAt13 = known && glm::dot(p[2] - p[0], p[2] - p[0]) >= glm::dot(p[3] - p[1], p[3] - p[1]);
+    }
+
+    size_t& cursor = state->cursor[materialSlot(state->material)];
+    for (int k = 1; k + 1 < cornerCount; k++) {
+        int corner[3] = { 0, k, k + 1 };
+        if (splitAt13) {
+            // [0, 1, 3], [1, 2, 3]
+            corner[0] = k - 1;
+            corner[1] = k;
+            corner[2] = 3;
+        }
+        const tinyobj::index_t* triangle[3] = { &resolved[corner[0]], &resolved[corner[1]], &resolved[corner[2]] };
+        int uvWinding = uvWindingSign(streamTexcoordAt(*state, triangle[0]->texcoord_index),
+            streamTexcoordAt(*state, triangle[1]->texcoord_index),
+            streamTexcoordAt(*state, triangle[2]->texcoord_index));
+        for (int c = 0; c < 3; c++)
+            state->indices[cursor++] = weldStreamCorner(*state, triangle[c]->vertex_index, triangle[c]->normal_index,
+                triangle[c]->texcoord_index, uvWinding);
+    }
+}
+
+// runs LoadObjWithCallback over objPath with its own read buffer
+inline bool streamObjPass(const std::string& objPath, const tinyobj::callback_t& callbacks, void* user,
+    std::string* warning, std::string* error)
+{
+    std::vector<char> buffer(MESH_STREAM_BUFFER_SIZE);
+    std::ifstream file;
+    file.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    file.open(objPath.c_str(), std::ios::binary);
+    if (!file) {
+        if (error)
+            *error = "cannot open " + objPath;
+        return false;
+    }
+    tinyobj::MaterialFileReader materialReader(directoryOf(objPath));
+    return tinyobj::LoadObjWithCallback(file, callbacks, user, &materialReader, warning, error);
+}
+
+// imports objPath into cachePath in the mesh cache layout without holding the parsed OBJ in memory
+inline bool streamObjToMeshCache(const std::string& objPath, const std::string& cachePath,
+    unsigned long long sourceHash, VertexFormat format, std::string* warning, std::string* error,
+    MeshStreamStats* stats = NULL)
+{
+    ObjRecordCounts counts;
+    counts.positions = counts.normals = counts.texcoords = 0;
+    counts.material = -1;
+    tinyobj::callback_t countCallbacks;
+    countCallbacks.vertex_cb = countPosition;
+    countCallbacks.normal_cb = countNormal;
+    countCallbacks.texcoord_cb = countTexcoord;
+    countCallbacks.index_cb = countFace;
+    countCallbacks.usemtl_cb = countUseMaterial;
+    countCallbacks.mtllib_cb = countMaterialLibrary;
+    if (!streamObjPass(objPath, countCallbacks, &counts, warning, error))
+        return false;
+
+    size_t triangleCount = 0;
+    for (size_t i = 0; i < counts.triangles.size(); i++)
+        triangleCount += counts.triangles[i];
+    if (triangleCount == 0 || triangleCount * 3 > 0xFFFFFFFFu || counts.positions >= STREAM_NO_VERTEX) {
+        if (error)
+            *error = triangleCount == 0 ? "no faces in " + objPath : "too many faces in " + objPath;
+        return false;
+    }
+
+    ObjStreamState state;
+    state.counts = &counts;
+    state.positions.resize(counts.positions * 3);
+    state.normals.resize(counts.normals * 3);
+    state.texcoords.resize(counts.texcoords * 2);
+    state.positionCount = state.normalCount = state.texcoordCount = 0;
+    state.firstVertex.assign(counts.positions, STREAM_NO_VERTEX);
+    // most scans share one index for position, normal and uv, more vertices than that is the rare case
+    state.vertices.reserve(glm::max(counts.positions, glm::max(counts.normals, counts.texcoords)));
+    state.indices.resize(triangleCount * 3);
+    state.cursor.resize(counts.triangles.size());
+    size_t first = 0;
+    for (size_t i = 0; i < counts.triangles.size(); i++) {
+        state.cursor[i] = first;
+        first += counts.triangles[i] * 3;
+    }
+    state.material = -1;
+
+    tinyobj::callback_t streamCallbacks;
+    streamCallbacks.vertex_cb = streamPosition;
+    streamCallbacks.normal_cb = streamNormal;
+    streamCallbacks.texcoord_cb = streamTexcoord;
+    streamCallbacks.index_cb = streamFace;
+    streamCallbacks.usemtl_cb = streamUseMaterial;
+    // warnings were already reported by pass 1
+    if (!streamObjPass(objPath, streamCallbacks, &state, NULL, error))
+        return false;
+    if (!state.failure.empty()) {
+        if (error)
+            *error = state.failure + " in " + objPath;
+        return false;
+    }
+
+    size_t arenaBytes = sizeof(float) * (state.positions.size() + state.normals.size() + state.texcoords.size()) +
+        sizeof(StreamVertex) * state.vertices.capacity() + sizeof(GLuint) * state.indices.size();
+    size_t peak = arenaBytes + sizeof(unsigned int) * state.firstVertex.size();
+    std::vector<unsigned int>().swap(state.firstVertex);
+    size_t vertexCount = state.vertices.size();
+
+    glm::vec3 boundsMin(0.0f), boundsMax(0.0f);
+    for (size_t v = 0; v < vertexCount; v++) {
+        const float* p = &state.positions[(size_t)state.vertices[v].position * 3];
+        glm::vec3 position(p[0], p[1], p[2]);
+        boundsMin = v == 0 ? position : glm::min(boundsMin, position);
+        boundsMax = v == 0 ? position : glm::max(boundsMax, position);
+    }
+
+    // angle weighted tangent sums, the same frames generateTangents builds
+    std::vector<glm::vec3> tangentSums(vertexCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> bitangentSums(vertexCount, glm::vec3(0.0f));
+    for (size_t t = 0; t < triangleCount; t++) {
+        const GLuint* corner = &state.indices[t * 3];
+        glm::vec3 p[3];
+        glm::vec2 uv[3];
+        for (int c = 0; c < 3; c++) {
+            const StreamVertex& vertex = state.vertices[corner[c]];
+            const float* position = &state.positions[(size_t)vertex.position * 3];
+            p[c] = glm::vec3(position[0], position[1], position[2]);
+            uv[c] = streamTexcoordAt(state, vertex.texcoord);
+        }
+        glm::vec3 tangent, bitangent;
+        float angles[3];
+        if (!triangleTangentFrame(p[0], p[1], p[2], uv[0], uv[1], uv[2], tangent, bitangent, angles))
+            continue;
+        for (int c = 0; c < 3; c++) {
+            tangentSums[corner[c]] += angles[c] * tangent;
+            bitangentSums[corner[c]] += angles[c] * bitangent;
+        }
+    }
+
+    // straight into the layout the cache stores
+    glm::vec3 positionOffset = format == VERTEX_FORMAT_FLOAT ? glm::vec3(0.0f) : boundsMin;
+    glm::vec3 positionScale = format == VERTEX_FORMAT_FLOAT ? glm::vec3(1.0f) : boundsMax - boundsMin;
+    VertexFormatError formatError;
+    std::memset(&formatError, 0, sizeof(formatError));
+    size_t stride = vertexStride(format);
+    std::vector<unsigned char> packed(stride * vertexCount);
+    peak = glm::max(peak, arenaBytes + sizeof(glm::vec3) * 2 * vertexCount + packed.size());
+    for (size_t v = 0; v < vertexCount; v++) {
+        const StreamVertex& vertex = state.vertices[v];
+        const float* p = &state.positions[(size_t)vertex.position * 3];
+        glm::vec3 normal = vertex.normal < 0 ? glm::vec3(0.0f) :
+            glm::vec3(state.normals[vertex.normal * 3], state.normals[vertex.normal * 3 + 1], state.normals[vertex.normal * 3 + 2]);
+        packVertex(format, glm::vec3(p[0], p[1], p[2]), normal, streamTexcoordAt(state, vertex.texcoord),
+            finishTangent(normal, tangentSums[v], bitangentSums[v]), positionOffset, positionScale,
+            &packed[v * stride], formatError);
+    }
+    std::vector<glm::vec3>().swap(tangentSums);
+    std::vector<glm::vec3>().swap(bitangentSums);
+
+    // one SubMesh per material in id order like buildModel, each a single full-detail level
+    std::vector<SubMesh> submeshes;
+    std::vector<MeshLod> lods;
+    first = 0;
+    for (size_t slot = 0; slot < counts.triangles.size(); slot++) {
+        size_t indexCount = counts.triangles[slot] * 3;
+        if (indexCount == 0)
+            continue;
+        SubMesh submesh;
+        std::memset(&submesh, 0, sizeof(submesh));
+        submesh.material = (int)slot - 1;
+        submesh.firstLod = static_cast<unsigned int>(lods.size());
+        submesh.lodCount = 1;
+        for (size_t i = first; i < first + indexCount; i++) {
+            const float* p = &state.positions[(size_t)state.vertices[state.indices[i]].position * 3];
+            for (int axis = 0; axis < 3; axis++) {
+                submesh.boundsMin[axis] = i == first ? p[axis] : glm::min(submesh.boundsMin[axis], p[axis]);
+                submesh.boundsMax[axis] = i == first ? p[axis] : glm::max(submesh.boundsMax[axis], p[axis]);
+            }
+        }
+        MeshLod lod = { (unsigned int)first, (unsigned int)indexCount, 0.0f };
+        lods.push_back(lod);
+        submeshes.push_back(submesh);
+        first += indexCount;
+    }
+    std::vector<float>().swap(state.positions);
+    std::vector<float>().swap(state.normals);
+    std::vector<float>().swap(state.texcoords);
+    std::vector<StreamVertex>().swap(state.vertices);
+
+    MeshOptimizationReport report;
+    report.before = analyzeVertexCache(state.indices.data(), state.indices.size(), vertexCount);
+    report.after = report.before;
+
+    // 16-bit indices narrowed in place, each write lands at or before the value it replaces
+    GLenum indexType = vertexCount <= 0xFFFF ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    size_t indexBytes = state.indices.size() * sizeof(GLuint);
+    if (indexType == GL_UNSIGNED_SHORT) {
+        GLushort* narrow = reinterpret_cast<GLushort*>(state.indices.data());
+        for (size_t i = 0; i < state.indices.size(); i++)
+            narrow[i] = static_cast<GLushort>(state.indices[i]);
+        indexBytes = state.indices.size() * sizeof(GLushort);
+    }
+
+    std::vector<MaterialRecord> materials;
+    for (size_t i = 0; i < counts.materials.size(); i++)
+        materials.push_back(makeMaterialRecord(counts.materials[i]));
+
+    MeshCacheHeader header = makeMeshCacheHeader(format, sourceHash, MESH_STREAM_IMPORTER_VERSION);
+    header.vertexCount = static_cast<unsigned int>(vertexCount);
+    header.indexCount = static_cast<unsigned int>(state.indices.size());
+    header.indexType = indexType;
+    for (int i = 0; i < 3; i++) {
+        header.boundsMin[i] = boundsMin[i];
+        header.boundsMax[i] = boundsMax[i];
+        header.positionOffset[i] = positionOffset[i];
+        header.positionScale[i] = positionScale[i];
+    }
+    header.formatError = formatError;
+    header.vertexCache = report;
+    header.submeshCount = static_cast<unsigned int>(submeshes.size());
+    header.lodCount = static_cast<unsigned int>(lods.size());
+    header.materialCount = static_cast<unsigned int>(materials.size());
+
+    MeshCacheSection sections[] = {
+        { packed.data(), packed.size() },
+        { state.indices.data(), indexBytes },
+        { submeshes.data(), sizeof(SubMesh) * submeshes.size() },
+        { lods.data(), sizeof(MeshLod) * lods.size() },
+        { materials.data(), sizeof(MaterialRecord) * materials.size() }
+    };
+    if (stats) {
+        stats->peakBytes = peak;
+        stats->outputBytes = packed.size() + indexBytes;
+    }
+    if (!writeMeshCacheFile(cachePath, header, sections, sizeof(sections) / sizeof(sections[0]))) {
+        if (error)
+            *error = "cannot write " + cachePath;
+        return false;
+    }
+    return true;
+}
+
+// loadMeshCached for OBJs too big to parse in memory; the result is always read back from
+// "<objPath>.meshcache", so it fails if that file cannot be written
+inline bool loadMeshStreamed(const std::string& objPath, CachedMesh& out, std::string* warning, std::string* error,
+    VertexFormat format = VERTEX_FORMAT_FLOAT, MeshStreamStats* stats = NULL)
+{
+    MappedFile obj;
+    if (!obj.open(objPath.c_str())) {
+        if (error)
+            *error = "cannot open " + objPath;
+        return false;
+    }
+    unsigned long long sourceHash = hashMeshSource(objPath, obj, MESH_STREAM_IMPORTER_VERSION);
+    obj.close();
+
+    std::string cachePath = objPath + ".meshcache";
+    if (out.open(cachePath, sourceHash, format, MESH_STREAM_IMPORTER_VERSION))
+        return true;
+    if (!streamObjToMeshCache(objPath, cachePath, sourceHash, format, warning, error, stats))
+        return false;
+    if (out.open(cachePath, sourceHash, format, MESH_STREAM_IMPORTER_VERSION))
+        return true;
+    if (error)
+        *error = "cannot map " + cachePath;
+    return false;
+}
+
+// loadMeshCached, or loadMeshStreamed once the .obj reaches MESH_STREAM_MIN_FILE_SIZE
+inline bool loadMesh(const std::string& objPath, CachedMesh& out, std::string* warning, std::string* error,
+    VertexFormat format = VERTEX_FORMAT_FLOAT)
+{
+    MappedFile obj;
+    bool large = obj.open(objPath.c_str()) && obj.size() >= MESH_STREAM_MIN_FILE_SIZE;
+    obj.close();
+    return large ? loadMeshStreamed(objPath, out, warning, error, format) :
+        loadMeshCached(objPath, out, warning, error, format);
+}
+#endif
@@ -0,0 +1,289 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "mesh.h"
+#include "mesh_optimizer.h"
+
+// meshlets: the full mesh's index buffer regrouped into clusters of nearby, similarly facing
+// triangles, each with a bounding sphere and a normal cone so whole clusters can be culled on the CPU
+
+// a meshlet closes once either limit would be exceeded (the sizes mesh shader hardware likes)
+const unsigned int MESHLET_MAX_VERTICES = 64;
+const unsigned int MESHLET_MAX_TRIANGLES = 124;
+// how much a new vertex costs against facing away from the meshlet's average normal when growing
+const float MESHLET_NORMAL_WEIGHT = 0.5f;
+// ... and against leaving behind triangles whose vertices have many unassigned triangles,
+// so the pass fills gaps instead of stranding small islands
+const float MESHLET_LIVE_WEIGHT = 0.05f;
+// non-uniform scale skews the normal cone; above this max/min scale ratio only the spheres are tested
+const float MESHLET_MAX_CONE_SCALE_RATIO = 1.01f;
+
+inline glm::vec3 meshletPosition(const MeshData& mesh, GLuint v)
+{
+    const GLfloat* p = &mesh.vertices[(size_t)v * VERTEX_FLOATS];
+    return glm::vec3(p[0], p[1], p[2]);
+}
+
+// bounding sphere and normal cone of the given triangles (ids into mesh.indices)
+inline void computeMeshletBounds(const MeshData& mesh, const std::vector<unsigned int>& triangles, Meshlet& meshlet)
+{
+    glm::vec3 boxMin(1e30f), boxMax(-1e30f);
+    glm::vec3 normalSum(0.0f);
+    std::vector<glm::vec3> normals;
+    normals.reserve(triangles.size());
+    for (size_t i = 0; i < triangles.size(); i++) {
+        const GLuint* t = &mesh.indices[(size_t)triangles[i] * 3];
+        glm::vec3 p0 = meshletPosition(mesh, t[0]);
+        glm::vec3 p1 = meshletPosition(mesh, t[1]);
+        glm::vec3 p2 = meshletPosition(mesh, t[2]);
+        boxMin = glm::min(boxMin, glm::min(p0, glm::min(p1, p2)));
+        boxMax = glm::max(boxMax, glm::max(p0, glm::max(p1, p2)));
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(normal);
+        if (length > 0.0f) {
+            normals.push_back(normal / length);
+            normalSum += normal / length;
+        }
+    }
+
+    glm::vec3 center = (boxMin + boxMax) * 0.5f;
+    float radius = 0.0f;
+    for (size_t i = 0; i < triangles.size(); i++) {
+        const GLuint* t = &mesh.indices[(size_t)triangles[i] * 3];
+        for (int c = 0; c < 3; c++)
+            radius = std::max(radius, glm::length(meshletPosition(mesh, t[c]) - center));
+    }
+
+    // the cone holds every triangle normal; cutoff 1 means it can never be culled
+    glm::vec3 axis(0.0f, 0.0f, 1.0f);
+    float cutoff = 1.0f;
+    float sumLength = glm::length(normalSum);
+    if (sumLength > 0.0f) {
+        axis = normalSum / sumLength;
+        float minDot = 1.0f;
+        for (size_t i = 0; i < normals.size(); i++)
+            minDot = std::min(minDot, glm::dot(normals[i], axis));
+        if (minDot > 0.0f)
+            cutoff = std::sqrt(1.0f - minDot * minDot);
+    }
+
+    for (int i = 0; i < 3; i++) {
+        meshlet.center[i] = center[i];
+        meshlet.coneAxis[i] = axis[i];
+    }
+    meshlet.radius = radius;
+    meshlet.coneCutoff = cutoff;
+}
+
+// regroups the full mesh (mesh.indices as optimizeMesh left it) into meshlets stored back to back,
+// so each one is a single index range; must run before generateLods appends its levels
+// meshlets grow across shared edges, preferring triangles that add no new vertices and face the same way
+inline void buildMeshlets(MeshData& mesh)
+{
+    mesh.meshlets.clear();
+    size_t triangleCount = mesh.indices.size() / 3;
+    size_t vertexCount = mesh.vertexCount();
+    if (triangleCount == 0)
+        return;
+
+    TriangleAdjacency adjacency;
+    buildTriangleAdjacency(mesh.indices.data(), mesh.indices.size(), vertexCount, adjacency);
+
+    std::vector<glm::vec3> triangleNormals(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++) {
+        glm::vec3 p0 = meshletPosition(mesh, mesh.indices[t * 3]);
+        glm::vec3 p1 = meshletPosition(mesh, mesh.indices[t * 3 + 1]);
+        glm::vec3 p2 = meshletPosition(mesh, mesh.indices[t * 3 + 2]);
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(normal);
+        triangleNormals[t] = length > 0.0f ? normal / length : glm::vec3(0.0f);
+    }
+
+    std::vector<unsigned char> used(triangleCount, 0);
+    // unassigned triangles per vertex
+    std::vector<unsigned int> live(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        live[v] = adjacency.first[v + 1] - adjacency.first[v];
+    // meshlet a vertex was last added to, + 1
+    std::vector<unsigned int> vertexMeshlet(vertexCount, 0);
+    std::vector<GLuint> out;
+    out.reserve(mesh.indices.size());
+    std::vector<unsigned int> triangles;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> frontier;
+    size_t seedCursor = 0;
+
+    while (true) {
+        // continue next to the previous meshlet so the mesh is tiled as a front instead of leaving islands
+        unsigned int seed = 0xFFFFFFFFu;
+        for (size_t i = 0; i < frontier.size() && seed == 0xFFFFFFFFu; i++) {
+            if (!used[frontier[i]])
+                seed = frontier[i];
+        }
+        if (seed == 0xFFFFFFFFu) {
+            while (seedCursor < triangleCount && used[seedCursor])
+                seedCursor++;
+            if (seedCursor == triangleCount)
+                break;
+            seed = static_cast<unsigned int>(seedCursor);
+        }
+
+        unsigned int meshletId = static_cast<unsigned int>(mesh.meshlets.size()) + 1;
+        unsigned int vertices = 0;
+        glm::vec3 normalSum(0.0f);
+        triangles.clear();
+        candidates.clear();
+        unsigned int next = seed;
+
+        while (true) {
+            const GLuint* t = &mesh.indices[(size_t)next * 3];
+            used[next] = 1;
+            live[t[0]]--;
+            live[t[1]]--;
+            live[t[2]]--;
+            triangles.push_back(next);
+            normalSum += triangleNormals[next];
+            for (int c = 0; c < 3; c++) {
+                if (vertexMeshlet[t[c]] == meshletId)
+                    continue;
+                vertexMeshlet[t[c]] = meshletId;
+                vertices++;
+                for (unsigned int k = adjacency.first[t[c]]; k < adjacency.first[t[c] + 1]; k++) {
+                    if (!used[adjacency.triangles[k]])
+                        candidates.push_back(adjacency.triangles[k]);
+                }
+            }
+            if (triangles.size() == MESHLET_MAX_TRIANGLES)
+                break;
+
+            // best neighbour that still fits
+            glm::vec3 axis = glm::length(normalSum) > 0.0f ? glm::normalize(normalSum) : glm::vec3(0.0f);
+            float bestScore = 1e30f;
+            bool found = false;
+            size_t best = 0;
+            size_t kept = 0;
+            for (size_t i = 0; i < candidates.size(); i++) {
+                unsigned int candidate = candidates[i];
+                if (used[candidate])
+                    continue;
+                candidates[kept++] = candidate;
+                const GLuint* ct = &mesh.indices[(size_t)candidate * 3];
+                unsigned int added = (vertexMeshlet[ct[0]] != meshletId) + (vertexMeshlet[ct[1]] != meshletId) +
+                    (vertexMeshlet[ct[2]] != meshletId);
+                if (vertices + added > MESHLET_MAX_VERTICES)
+                    continue;
+                float score = added + MESHLET_NORMAL_WEIGHT * (1.0f - glm::dot(triangleNormals[candidate], axis)) +
+                    MESHLET_LIVE_WEIGHT * (live[ct[0]] + live[ct[1]] + live[ct[2]]);
+                if (score < bestScore) {
+                    bestScore = score;
+                    best = kept - 1;
+                    found = true;
+                }
+            }
+            candidates.resize(kept);
+            if (!found)
+                break;
+            next = candidates[best];
+        }
+
+        frontier.swap(candidates);
+
+        Meshlet meshlet;
+        meshlet.firstIndex = static_cast<unsigned int>(out.size());
+        meshlet.indexCount = static_cast<unsigned int>(triangles.size() * 3);
+        computeMeshletBounds(mesh, triangles, meshlet);
+        mesh.meshlets.push_back(meshlet);
+        for (size_t i = 0; i < triangles.size(); i++)
+            out.insert(out.end(), &mesh.indices[(size_t)triangles[i] * 3], &mesh.indices[(size_t)triangles[i] * 3] + 3);
+    }
+
+    mesh.indices.swap(out);
+}
+
+// the six planes of a view-projection matrix (Gribb & Hartmann), normalised, inside is positive
+struct Frustum {
+    glm::vec4 planes[6];
+};
+
+inline Frustum extractFrustum(const glm::mat4& viewProjection)
+{
+    glm::mat4 m = glm::transpose(viewProjection); // rows of viewProjection as columns
+    Frustum frustum;
+    frustum.planes[0] = m[3] + m[0]; // left
+    frustum.planes[1] = m[3] - m[0]; // right
+    frustum.planes[2] = m[3] + m[1]; // bottom
+    frustum.planes[3] = m[3] - m[1]; // top
+    frustum.planes[4] = m[3] + m[2]; // near
+    frustum.planes[5] = m[3] - m[2]; // far
+    for (int i = 0; i < 6; i++)
+        frustum.planes[i] /= glm::length(glm::vec3(frustum.planes[i]));
+    return frustum;
+}
+
+inline bool sphereOutside(const Frustum& frustum, glm::vec3 center, float radius)
+{
+    for (int i = 0; i < 6; i++) {
+        if (glm::dot(glm::vec3(frustum.planes[i]), center) + frustum.planes[i].w < -radius)
+            return true;
+    }
+    return false;
+}
+
+// true when no triangle of the meshlet can face a camera at cameraPos (all world space)
+inline bool coneBackfacing(glm::vec3 center, float radius, glm::vec3 axis, float cutoff, glm::vec3 cameraPos)
+{
+    glm::vec3 toCenter = center - cameraPos;
+    return glm::dot(toCenter, axis) >= cutoff * glm::length(toCenter) + radius;
+}
+
+// draw ranges of the meshlets a camera can see, adjacent survivors merged into one range
+// model is the object's transform, viewProjection = projection * view of the camera
+// returns how many meshlets survived
+inline unsigned int cullMeshlets(const std::vector<Meshlet>& meshlets, const glm::mat4& model,
+    const glm::mat4& viewProjection, glm::vec3 cameraPos, GLenum indexType,
+    std::vector<GLsizei>& counts, std::vector<const void*>& offsets)
+{
+    counts.clear();
+    offsets.clear();
+    Frustum frustum = extractFrustum(viewProjection);
+
+    glm::vec3 scale(glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])));
+    float maxScale = std::max(scale.x, std::max(scale.y, scale.z));
+    float minScale = std::min(scale.x, std::min(scale.y, scale.z));
+    bool coneCulling = minScale > 0.0f && maxScale <= minScale * MESHLET_MAX_CONE_SCALE_RATIO;
+    glm::mat3 rotation = glm::mat3(model);
+
+    size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+    unsigned int visible = 0;
+    unsigned int rangeEnd = 0xFFFFFFFFu;
+    for (size_t i = 0; i < meshlets.size(); i++) {
+        const Meshlet& meshlet = meshlets[i];
+        glm::vec3 center = glm::vec3(model * glm::vec4(meshlet.center[0], meshlet.center[1], meshlet.center[2], 1.0f));
+        float radius = meshlet.radius * maxScale;
+        if (sphereOutside(frustum, center, radius))
+            continue;
+        if (coneCulling && meshlet.coneCutoff < 1.0f) {
+            glm::vec3 axis = glm::normalize(rotation * glm::vec3(meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2]));
+            if (coneBackfacing(center, radius, axis, meshlet.coneCutoff, cameraPos))
+                continue;
+        }
+
+        visible++;
+        if (meshlet.firstIndex == rangeEnd) {
+            counts.back() += meshlet.indexCount;
+        } else {
+            counts.push_back(meshlet.indexCount);
+            offsets.push_back((const void*)(meshlet.firstIndex * indexSize));
+        }
+        rangeEnd = meshlet.firstIndex + meshlet.indexCount;
+    }
+    return visible;
+}
+#endif
@@ -0,0 +1,169 @@
+#ifndef MODEL_IMPORT_H
+#define MODEL_IMPORT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "mesh.h"
+#include "mesh_lod.h"
+#include "mesh_optimizer.h"
+#include "meshlet.h"
+
+// tiny_obj_loader.h has to be included before this header (main.cpp owns the implementation)
+
+// every shape of an OBJ, split by material into SubMeshes that share one vertex and index buffer
+
+const int MATERIAL_NAME_LENGTH = 64;
+const int MATERIAL_PATH_LENGTH = 256;
+
+// what the renderer needs from a .mtl entry, fixed size so it can live in the mesh cache
+// texture paths are relative to the .obj's directory with '/' separators, empty when unset
+struct MaterialRecord {
+    char name[MATERIAL_NAME_LENGTH];
+    char diffuseTexture[MATERIAL_PATH_LENGTH];  // map_Kd
+    char specularTexture[MATERIAL_PATH_LENGTH]; // map_Ks
+    char normalTexture[MATERIAL_PATH_LENGTH];   // norm, or map_Bump when there is none
+    float diffuse[3];  // Kd
+    float specular[3]; // Ks
+    float shininess;   // Ns
+    float dissolve;    // d, 1 is opaque
+};
+
+// copies text into a fixed buffer, always terminated; exporters write "tex\\a.jpg" as well as "tex\a.jpg"
+inline void copyMaterialPath(char* out, size_t size, const std::string& text, bool isPath)
+{
+    size_t length = 0;
+    for (size_t i = 0; i < text.size() && length + 1 < size; i++) {
+        char c = text[i];
+        if (isPath && c == '\\')
+            c = '/';
+        if (isPath && c == '/' && length > 0 && out[length - 1] == '/')
+            continue;
+        out[length++] = c;
+    }
+    out[length] = '\0';
+}
+
+inline MaterialRecord makeMaterialRecord(const tinyobj::material_t& material)
+{
+    MaterialRecord record;
+    std::memset(&record, 0, sizeof(record));
+    copyMaterialPath(record.name, sizeof(record.name), material.name, false);
+    copyMaterialPath(record.diffuseTexture, sizeof(record.diffuseTexture), material.diffuse_texname, true);
+    copyMaterialPath(record.specularTexture, sizeof(record.specularTexture), material.specular_texname, true);
+    copyMaterialPath(record.normalTexture, sizeof(record.normalTexture),
+        material.normal_texname.empty() ? material.bump_texname : material.normal_texname, true);
+    for (int i = 0; i < 3; i++) {
+        record.diffuse[i] = static_cast<float>(material.diffuse[i]);
+        record.specular[i] = static_cast<float>(material.specular[i]);
+    }
+    record.shininess = static_cast<float>(material.shininess);
+    record.dissolve = static_cast<float>(material.dissolve);
+    return record;
+}
+
+// the faces of one shape grouped by material id, ordered by id
+inline std::map<int, tinyobj::mesh_t> splitByMaterial(const tinyobj::mesh_t& mesh)
+{
+    std::map<int, tinyobj::mesh_t> parts;
+    size_t offset = 0;
+    for (size_t f = 0; f < mesh.num_face_vertices.size(); f++) {
+        size_t corners = mesh.num_face_vertices[f];
+        int material = f < mesh.material_ids.size() ? mesh.material_ids[f] : -1;
+        tinyobj::mesh_t& part = parts[material];
+        part.indices.insert(part.indices.end(), mesh.indices.begin() + offset, mesh.indices.begin() + offset + corners);
+        part.num_face_vertices.push_back(mesh.num_face_vertices[f]);
+        part.material_ids.push_back(material);
+        offset += corners;
+    }
+    return parts;
+}
+
+// appends an optimised part (own vertices, lods and meshlets) to model as a new SubMesh
+inline void appendSubMesh(MeshData& model, const MeshData& part, unsigned int shape, int material)
+{
+    GLuint baseVertex = model.vertexCount();
+    unsigned int baseIndex = static_cast<unsigned int>(model.indices.size());
+
+    SubMesh submesh;
+    submesh.shape = shape;
+    submesh.material = material;
+    submesh.firstLod = static_cast<unsigned int>(model.lods.size());
+    submesh.lodCount = static_cast<unsigned int>(part.lods.size());
+    submesh.firstMeshlet = static_cast<unsigned int>(model.meshlets.size());
+    submesh.meshletCount = static_cast<unsigned int>(part.meshlets.size());
+    for (int i = 0; i < 3; i++) {
+        submesh.boundsMin[i] = part.boundsMin[i];
+        submesh.boundsMax[i] = part.boundsMax[i];
+    }
+
+    if (model.submeshes.empty()) {
+        model.boundsMin = part.boundsMin;
+        model.boundsMax = part.boundsMax;
+    }
+    model.boundsMin = glm::min(model.boundsMin, part.boundsMin);
+    model.boundsMax = glm::max(model.boundsMax, part.boundsMax);
+
+    model.vertices.insert(model.vertices.end(), part.vertices.begin(), part.vertices.end());
+    model.indices.reserve(model.indices.size() + part.indices.size());
+    for (size_t i = 0; i < part.indices.size(); i++)
+        model.indices.push_back(part.indices[i] + baseVertex);
+    for (size_t i = 0; i < part.lods.size(); i++) {
+        MeshLod lod = part.lods[i];
+        lod.firstIndex += baseIndex;
+        model.lods.push_back(lod);
+    }
+    for (size_t i = 0; i < part.meshlets.size(); i++) {
+        Meshlet meshlet = part.meshlets[i];
+        meshlet.firstIndex += baseIndex;
+        model.meshlets.push_back(meshlet);
+    }
+    model.submeshes.push_back(submesh);
+}
+
+// welds, optimises, clusters and simplifies every (shape, material) part on its own, then packs them
+// into one MeshData; report sums the parts' simulated vertex cache, weighted by triangles and vertices
+inline MeshData buildModel(const tinyobj::attrib_t& attributes, const std::vector<tinyobj::shape_t>& shapes,
+    MeshOptimizationReport* report)
+{
+    MeshData model;
+    model.boundsMin = glm::vec3(0.0f);
+    model.boundsMax = glm::vec3(0.0f);
+    double triangles = 0.0, vertices = 0.0;
+    double missesBefore = 0.0, missesAfter = 0.0;
+
+    for (size_t s = 0; s < shapes.size(); s++) {
+        std::map<int, tinyobj::mesh_t> parts = splitByMaterial(shapes[s].mesh);
+        for (std::map<int, tinyobj::mesh_t>::const_iterator it = parts.begin(); it != parts.end(); ++it) {
+            MeshData part = buildIndexedMesh(attributes, it->second);
+            if (part.indices.empty())
+                continue;
+            MeshOptimizationReport partReport = optimizeMesh(part);
+            buildMeshlets(part);
+            // meshlets regroup the optimised order, report what is actually drawn
+            partReport.after = analyzeVertexCache(part.indices.data(), part.indices.size(), part.vertexCount());
+            generateLods(part);
+
+            double partTriangles = part.lods[0].indexCount / 3.0;
+            triangles += partTriangles;
+            vertices += part.vertexCount();
+            missesBefore += partReport.before.acmr * partTriangles;
+            missesAfter += partReport.after.acmr * partTriangles;
+            appendSubMesh(model, part, static_cast<unsigned int>(s), it->first);
+        }
+    }
+
+    if (report) {
+        report->before.acmr = triangles > 0.0 ? (float)(missesBefore / triangles) : 0.0f;
+        report->after.acmr = triangles > 0.0 ? (float)(missesAfter / triangles) : 0.0f;
+        report->before.atvr = vertices > 0.0 ? (float)(missesBefore / vertices) : 0.0f;
+        report->after.atvr = vertices > 0.0 ? (float)(missesAfter / vertices) : 0.0f;
+    }
+    return model;
+}
+#endif
@@ -0,0 +1,35 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// calls body(begin, end) on disjoint ranges covering [0, count), one range per hardware thread
+// ranges never get smaller than minGrain items, so small inputs stay on the calling thread
+template <typename Body>
+inline void parallelFor(size_t count, size_t minGrain, const Body& body)
+{
+    if (count == 0)
+        return;
+
+    size_t threads = std::thread::hardware_concurrency();
+    if (threads == 0)
+        threads = 1;
+    size_t maxThreads = minGrain > 0 ? (count + minGrain - 1) / minGrain : count;
+    if (threads > maxThreads)
+        threads = maxThreads;
+    if (threads <= 1) {
+        body(0, count);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (size_t i = 1; i < threads; i++)
+        workers.push_back(std::thread(body, count * i / threads, count * (i + 1) / threads));
+    body(0, count / threads);
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+}
+#endif
@@ -0,0 +1,145 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// linked programs are kept on disk next to their fragment shader as the driver's own binary, so later runs
+// hand it to glProgramBinary instead of compiling; needs GL 4.1 (ARB_get_program_binary)
+// file layout: ProgramCacheHeader, then the binary
+const unsigned int PROGRAM_CACHE_MAGIC = 0x474F5250; // "PROG"
+const unsigned int PROGRAM_CACHE_FORMAT = 1;
+
+struct ProgramCacheHeader {
+    unsigned int magic;
+    unsigned int format;
+    unsigned long long key; // programCacheKey
+    unsigned int binaryFormat;
+    unsigned int binarySize;
+};
+
+inline bool programBinarySupported()
+{
+    return GLAD_GL_VERSION_4_1 != 0;
+}
+
+// 64-bit FNV-1a, the sources are short enough that speed doesn't matter
+inline unsigned long long hashProgramBytes(const char* data, size_t size, unsigned long long hash)
+{
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ull;
+    return hash;
+}
+
+inline unsigned long long hashProgramString(const char* text, unsigned long long hash)
+{
+    // glGetString returns NULL without a context; the 0xFF after each string keeps "ab"+"c" apart from "a"+"bc"
+    if (text)
+        hash = hashProgramBytes(text, std::strlen(text), hash);
+    return (hash ^ 0xFF) * 1099511628211ull;
+}
+
+// "<fragment>.<vertex file name>.progbin", one file per pair of shaders; variants compiled with defines
+// get "<fragment>.<vertex file name>.<hash of the defines>.progbin" so they don't replace each other
+inline std::string programCachePath(const std::string& vertexPath, const std::string& fragmentPath,
+    const std::string& defines = std::string())
+{
+    size_t slash = vertexPath.find_last_of("/\\");
+    std::string path = fragmentPath + "." + (slash == std::string::npos ? vertexPath : vertexPath.substr(slash + 1));
+    if (!defines.empty()) {
+        unsigned long long hash = hashProgramBytes(defines.c_str(), defines.size(), 14695981039346656037ull);
+        char name[20];
+        std::snprintf(name, sizeof(name), ".%016llx", hash);
+        path += name;
+    }
+    return path + ".progbin";
+}
+
+// the exact sources handed to the compiler (after anything was injected into them), the driver that
+// compiles them and the binary formats it can take back; any change makes a cached binary stale
+inline unsigned long long programCacheKey(const std::string& vertexCode, const std::string& fragmentCode)
+{
+    unsigned long long hash = 14695981039346656037ull ^ PROGRAM_CACHE_FORMAT;
+    hash = hashProgramString(vertexCode.c_str(), hash);
+    hash = hashProgramString(fragmentCode.c_str(), hash);
+    hash = hashProgramString(reinterpret_cast<const char*>(glGetString(GL_VENDOR)), hash);
+    hash = hashProgramString(reinterpret_cast<const char*>(glGetString(GL_RENDERER)), hash);
+    hash = hashProgramString(reinterpret_cast<const char*>(glGetString(GL_VERSION)), hash);
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    if (formatCount > 0) {
+        std::vector<GLint> formats(formatCount);
+        glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, &formats[0]);
+        hash = hashProgramBytes(reinterpret_cast<const char*>(&formats[0]), formats.size() * sizeof(GLint), hash);
+    }
+    return hash;
+}
+
+// a new program from the cached binary, 0 when there is none for key or the driver rejects it
+// (GL is allowed to, e.g. after a driver update that kept the version string)
+inline GLuint loadProgramBinary(const std::string& cachePath, unsigned long long key)
+{
+    std::ifstream file(cachePath.c_str(), std::ios::binary);
+    if (!file)
+        return 0;
+    ProgramCacheHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != PROGRAM_CACHE_MAGIC ||
+        header.format != PROGRAM_CACHE_FORMAT || header.key != key || header.binarySize == 0)
+        return 0;
+    std::vector<char> binary(header.binarySize);
+    if (!file.read(&binary[0], binary.size()))
+        return 0;
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.binaryFormat, &binary[0], (GLsizei)binary.size());
+    GLint linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+// program has to be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set; written to a temporary first so a
+// crash never leaves a half-written binary behind
+inline bool saveProgramBinary(const std::string& cachePath, unsigned long long key, GLuint program)
+{
+    GLint size = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size <= 0)
+        return false;
+    std::vector<char> binary(size);
+    GLsizei length = 0;
+    GLenum binaryFormat = 0;
+    glGetProgramBinary(program, size, &length, &binaryFormat, &binary[0]);
+    if (length <= 0)
+        return false;
+
+    ProgramCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = PROGRAM_CACHE_MAGIC;
+    header.format = PROGRAM_CACHE_FORMAT;
+    header.key = key;
+    header.binaryFormat = binaryFormat;
+    header.binarySize = (unsigned int)length;
+
+    std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream file(tempPath.c_str(), std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(&binary[0], length);
+        if (!file)
+            return false;
+    }
+    std::remove(cachePath.c_str());
+    return std::rename(tempPath.c_str(), cachePath.c_str()) == 0;
+}
+#endif
@@ -0,0 +1,211 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "material.h"
+#include "mesh_cache.h"
+#include "shader_m.h"
+#include "shader_variants.h"
+
+// collects a frame's draws, sorts them by program, then material, then VAO and submits them
+// binding each state only when it changes; translucent materials sort after everything opaque
+
+// an object's matrices as sample.vert takes them, built on the CPU once per change instead of per vertex
+struct ObjectTransform {
+    glm::mat4 model;
+    glm::mat3 normal; // inverse transpose of model's upper 3x3, for normals and tangents
+    glm::mat4 mvp;    // projection * view * model
+};
+
+inline glm::mat3 normalMatrix(const glm::mat4& model)
+{
+    return glm::transpose(glm::inverse(glm::mat3(model)));
+}
+
+// one submesh draw: ranges of the mesh's EBO drawn with one transform
+struct DrawCommand {
+    unsigned long long key;
+    const Shader* shader;
+    const Material* material;
+    const GpuMesh* mesh;
+    ObjectTransform transform;
+    size_t firstRange; // into RenderQueue's rangeCounts/rangeOffsets
+    size_t rangeCount;
+};
+
+struct RenderQueueStats {
+    unsigned int draws;
+    unsigned int programBinds;
+    unsigned int materialBinds;
+    unsigned int vaoBinds;
+};
+
+// most significant first: translucent, program, material, VAO; GL names and ids are small
+inline unsigned long long makeDrawKey(bool translucent, GLuint program, unsigned int materialId, GLuint vao)
+{
+    return (unsigned long long)translucent << 63 |
+        (unsigned long long)(program & 0x7FFF) << 48 |
+        (unsigned long long)(materialId & 0xFFFFFF) << 24 |
+        (unsigned long long)(vao & 0xFFFFFF);
+}
+
+class RenderQueue {
+public:
+    // materials' textures are looked up through resources when they are bound
+    explicit RenderQueue(ResourceManager& resources) : resources(resources) {}
+
+    // materialId orders the materials, e.g. their index in the owning vector
+    // counts/offsets are copied, so they can be reused by the caller before flush(); shader has to live until
+    // then, and the queue sets its uniforms only through it
+    void submit(const Shader& shader, const Material& material, unsigned int materialId, const GpuMesh& mesh,
+        const ObjectTransform& transform, const GLsizei* counts, const void* const* offsets, size_t rangeCount)
+    {
+        if (rangeCount == 0)
+            return;
+        DrawCommand command;
+        command.key = makeDrawKey(material.alpha < 1.0f, shader.ID, materialId, mesh.vao);
+        command.shader = &shader;
+        command.material = &material;
+        command.mesh = &mesh;
+        command.transform = transform;
+        command.firstRange = rangeCounts.size();
+        command.rangeCount = rangeCount;
+        rangeCounts.insert(rangeCounts.end(), counts, counts + rangeCount);
+        rangeOffsets.insert(rangeOffsets.end(), offsets, offsets + rangeCount);
+        commands.push_back(command);
+    }
+
+    // a program without a Shader of its own is wrapped the first time it is submitted
+    void submit(GLuint program, const Material& material, unsigned int materialId, const GpuMesh& mesh,
+        const ObjectTransform& transform, const GLsizei* counts, const void* const* offsets, size_t rangeCount)
+    {
+        if (rangeCount == 0)
+            return;
+        submit(programShader(program), material, materialId, mesh, transform, counts, offsets, rangeCount);
+    }
+
+    // with the cheapest variant of shaders that covers the material under lighting (lightingFeatures)
+    void submit(ShaderVariants& shaders, ShaderVariantKey lighting, const Material& material, unsigned int materialId,
+        const GpuMesh& mesh, const ObjectTransform& transform, const GLsizei* counts, const void* const* offsets,
+        size_t rangeCount)
+    {
+        if (rangeCount == 0)
+            return;
+        submit(shaders.variant(lighting | materialFeatures(material)), material, materialId, mesh, transform, counts,
+            offsets, rangeCount);
+    }
+
+    // draws everything submitted since the last flush; per frame state (camera, lights) comes from the
+    // FrameUniforms blocks, the queue only sets the object's matrices, the vertex decode and the material
+    RenderQueueStats flush()
+    {
+        RenderQueueStats stats = RenderQueueStats();
+        // stable: equal keys keep their submission order
+        std::stable_sort(commands.begin(), commands.end(), byKey);
+
+        const Shader* shader = NULL;
+        const Material* material = NULL;
+        const GpuMesh* mesh = NULL;
+        bool blending = false;
+        for (size_t i = 0; i < commands.size(); i++) {
+            const DrawCommand& command = commands[i];
+            if (command.shader != shader) {
+                shader = command.shader;
+                shader->use();
+                // samplers at the material units; only sent the first time this Shader is drawn with, since
+                // it remembers what it set (a program linked under a reused name comes with a new Shader)
+                shader->setInt(UNIFORM_ID("material.diffuse"), MATERIAL_DIFFUSE_UNIT);
+                shader->setInt(UNIFORM_ID("material.specular"), MATERIAL_SPECULAR_UNIT);
+                shader->setInt(UNIFORM_ID("material.normal"), MATERIAL_NORMAL_UNIT);
+                // uniforms are per program, the next material and mesh have to set theirs again (the shader
+                // skips the ones this program already holds)
+                material = NULL;
+                mesh = NULL;
+                stats.programBinds++;
+            }
+            if (command.material != material) {
+                material = command.material;
+                bindMaterial(*material, resources);
+                shader->setFloat(UNIFORM_ID("material.shininess"), material->shininess);
+                shader->setFloat(UNIFORM_ID("material.alpha"), material->alpha);
+                bool translucent = material->alpha < 1.0f;
+                if (translucent != blending) {
+                    blending = translucent;
+                    setBlending(blending);
+                }
+                stats.materialBinds++;
+            }
+            if (command.mesh != mesh) {
+                mesh = command.mesh;
+                glBindVertexArray(mesh->vao);
+                shader->setVec3(UNIFORM_ID("positionOffset"), mesh->positionOffset);
+                shader->setVec3(UNIFORM_ID("positionScale"), mesh->positionScale);
+                shader->setBool(UNIFORM_ID("octEncoded"), mesh->format == VERTEX_FORMAT_COMPACT);
+                stats.vaoBinds++;
+            }
+            // parts of one object share theirs, the shader skips sending them again
+            shader->setMat4(UNIFORM_ID("transform"), command.transform.model);
+            shader->setMat3(UNIFORM_ID("normalMatrix"), command.transform.normal);
+            shader->setMat4(UNIFORM_ID("mvp"), command.transform.mvp);
+            const GLsizei* counts = &rangeCounts[command.firstRange];
+            const void* const* offsets = &rangeOffsets[command.firstRange];
+            if (command.rangeCount == 1) {
+                glDrawElements(GL_TRIANGLES, counts[0], mesh->indexType, offsets[0]);
+            } else if (GLAD_GL_VERSION_1_4) {
+                glMultiDrawElements(GL_TRIANGLES, counts, mesh->indexType, offsets, (GLsizei)command.rangeCount);
+            } else {
+                for (size_t r = 0; r < command.rangeCount; r++)
+                    glDrawElements(GL_TRIANGLES, counts[r], mesh->indexType, offsets[r]);
+            }
+            stats.draws++;
+        }
+        if (blending)
+            setBlending(false);
+        glBindVertexArray(0);
+
+        commands.clear();
+        rangeCounts.clear();
+        rangeOffsets.clear();
+        return stats;
+    }
+
+private:
+    static bool byKey(const DrawCommand& a, const DrawCommand& b)
+    {
+        return a.key < b.key;
+    }
+
+    static void setBlending(bool enabled)
+    {
+        if (enabled) {
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glDepthMask(GL_FALSE);
+        } else {
+            glDisable(GL_BLEND);
+            glDepthMask(GL_TRUE);
+        }
+    }
+
+    // programs submitted by name, wrapped once
+    const Shader& programShader(GLuint program)
+    {
+        std::map<GLuint, Shader>::iterator found = shaders.find(program);
+        if (found != shaders.end())
+            return found->second;
+        return shaders.insert(std::make_pair(program, Shader(program))).first->second;
+    }
+
+    ResourceManager& resources;
+    std::vector<DrawCommand> commands;
+    std::vector<GLsizei> rangeCounts;
+    std::vector<const void*> rangeOffsets;
+    std::map<GLuint, Shader> shaders;
+};
+#endif
@@ -0,0 +1,500 @@
+#ifndef RESOURCE_MANAGER_H
+#define RESOURCE_MANAGER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "asset_loader.h"
+#include "mapped_file.h"
+#include "mesh_cache.h"
+#include "shader_m.h"
+
+// textures, meshes and shader programs shared between requests, so each is decoded and uploaded once.
+// Files the loader reads are keyed by path, size and modification time, which costs the render thread a
+// stat instead of reading them; the same bytes under another path are caught by the loader's workers
+// (AssetLoader::shareContent), which drop the copy before it is uploaded, and update() points its handles
+// at the original. Geometry, solid colors and programs are keyed by content right away. Callers hold
+// refcounted handles and look the GL names up through them when they bind, since a handle's name changes
+// when it is merged; the GL objects go away when the last handle is released, or in release() for whatever
+// is still held. A handle carries the generation of its slot, so one that outlived its resource is
+// rejected instead of reaching whatever reuses the slot.
+
+// seeds keep the kinds apart when the bytes are the same
+const unsigned long long RESOURCE_TEXTURE_SEED = 0x7465787475726531ull;
+const unsigned long long RESOURCE_CUBEMAP_SEED = 0x637562656D617031ull;
+const unsigned long long RESOURCE_MESH_SEED = 0x6D65736866696C65ull;
+const unsigned long long RESOURCE_GEOMETRY_SEED = 0x67656F6D65747279ull;
+const unsigned long long RESOURCE_PROGRAM_SEED = 0x70726F6772616D31ull;
+const unsigned long long RESOURCE_SOLID_SEED = 0x736F6C6964636F6Cull;
+const unsigned long long RESOURCE_MISSING_SEED = 0x6D697373696E6731ull; // unreadable files, keyed by path
+
+// T only tags the handle, so a texture handle cannot be passed where a mesh is expected
+template <typename T>
+struct ResourceHandle {
+    unsigned int index;
+    unsigned int generation; // 0 never refers to anything
+
+    ResourceHandle() : index(0), generation(0) {}
+    ResourceHandle(unsigned int index, unsigned int generation) : index(index), generation(generation) {}
+
+    bool valid() const
+    {
+        return generation != 0;
+    }
+};
+
+// slots of T with a refcount each, looked up by key; a slot merged into another resolves to that one
+template <typename T>
+class ResourcePool {
+public:
+    typedef ResourceHandle<T> Handle;
+
+    // a new reference to the resource stored under key, or an invalid handle
+    Handle find(unsigned long long key)
+    {
+        typename std::map<unsigned long long, unsigned int>::iterator found = byKey.find(key);
+        if (found == byKey.end())
+            return Handle();
+        Slot& slot = slots[found->second];
+        slot.refs++;
+        return Handle(found->second, slot.generation);
+    }
+
+    // stores value under key with one reference
+    Handle insert(unsigned long long key, const T& value)
+    {
+        unsigned int index;
+        if (!freeSlots.empty()) {
+            index = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            index = (unsigned int)slots.size();
+            slots.push_back(Slot());
+            slots.back().generation = 0;
+        }
+        Slot& slot = slots[index];
+        slot.value = value;
+        slot.key = key;
+        slot.target = index;
+        slot.refs = 1;
+        slot.generation++;
+        if (slot.generation == 0) // wrapped, 0 means invalid
+            slot.generation = 1;
+        byKey[key] = index;
+        return Handle(index, slot.generation);
+    }
+
+    // NULL for stale and invalid handles
+    T* get(Handle handle)
+    {
+        if (!handle.valid() || handle.index >= slots.size())
+            return NULL;
+        Slot& slot = slots[handle.index];
+        return slot.refs > 0 && slot.generation == handle.generation ? &slots[slot.target].value : NULL;
+    }
+
+    // duplicate's resource turned out to be a copy of original's and is gone: duplicate (and every copy of
+    // it) resolves to original from now on, holding a reference on it until its own last release
+    bool merge(Handle duplicate, Handle original)
+    {
+        if (!get(duplicate) || !get(original) || slots[duplicate.index].target == slots[original.index].target)
+            return false;
+        Slot& slot = slots[duplicate.index];
+        slot.target = slots[original.index].target;
+        slots[slot.target].refs++;
+        return true;
+    }
+
+    bool addRef(Handle handle)
+    {
+        if (!get(handle))
+            return false;
+        slots[handle.index].refs++;
+        return true;
+    }
+
+    // drops one reference; appends the resource to freed when it was the last one (for a merged slot, the
+    // last one of the slot it was merged into)
+    void release(Handle handle, std::vector<T>& freed)
+    {
+        if (!get(handle))
+            return;
+        unsigned int index = handle.index;
+        while (--slots[index].refs == 0) {
+            Slot& slot = slots[index];
+            byKey.erase(slot.key);
+            freeSlots.push_back(index);
+            if (slot.target == index) {
+                freed.push_back(slot.value);
+                break;
+            }
+            index = slot.target;
+        }
+    }
+
+    // every live resource, for shutdown; empties the pool
+    std::vector<T> takeAll()
+    {
+        std::vector<T> live;
+        for (size_t i = 0; i < slots.size(); i++) {
+            if (slots[i].refs > 0) {
+                if (slots[i].target == i)
+                    live.push_back(slots[i].value);
+                slots[i].refs = 0;
+                freeSlots.push_back((unsigned int)i);
+            }
+        }
+        byKey.clear();
+        return live;
+    }
+
+    size_t live() const
+    {
+        return byKey.size();
+    }
+
+private:
+    struct Slot {
+        T value;
+        unsigned long long key;
+        unsigned int target; // the slot itself, or the one it was merged into (its own value is gone then)
+        unsigned int refs;
+        unsigned int generation;
+    };
+
+    std::vector<Slot> slots;
+    std::vector<unsigned int> freeSlots;
+    std::map<unsigned long long, unsigned int> byKey;
+};
+
+struct TextureResource {
+    GLuint texture;
+};
+
+struct MeshResource {
+    MeshAsset* asset; // NULL for geometry built from memory
+    GpuMesh gpu;      // geometry built from memory; an asset's lives in the asset
+};
+
+struct ProgramResource {
+    GLuint program;
+};
+
+typedef ResourceHandle<TextureResource> TextureHandle;
+typedef ResourceHandle<MeshResource> MeshHandle;
+typedef ResourceHandle<ProgramResource> ProgramHandle;
+
+struct ResourceStats {
+    unsigned int requests; // texture, mesh and program requests
+    unsigned int shared;   // requests served by something already loaded
+    unsigned int merged;   // loads dropped for having the content of one already loaded
+};
+
+// hash of a whole file; false when it cannot be read
+inline bool hashFile(const std::string& path, unsigned long long seed, unsigned long long& hash)
+{
+    MappedFile file;
+    if (!file.open(path.c_str()))
+        return false;
+    hash = hashBytes(file.data(), file.size(), seed);
+    return true;
+}
+
+// render thread only
+class ResourceManager {
+public:
+    explicit ResourceManager(AssetLoader& loader) : loader(loader)
+    {
+        stats.requests = 0;
+        stats.shared = 0;
+        stats.merged = 0;
+        loader.shareContent(true);
+    }
+
+    ~ResourceManager()
+    {
+        release();
+    }
+
+    // a 2D texture through the loader, shared with every earlier request for the same file, flip and content
+    TextureHandle texture(const std::string& path, bool flip, glm::vec4 placeholder = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f),
+        TextureContent content = TEXTURE_COLOR)
+    {
+        unsigned long long key = pathKey(path, RESOURCE_TEXTURE_SEED ^ flip ^ (unsigned long long)content << 1);
+        TextureHandle handle = requested(textures.find(key));
+        if (handle.valid())
+            return handle;
+        TextureResource resource;
+        resource.texture = loader.loadTexture(path, flip, placeholder, content);
+        handle = textures.insert(key, resource);
+        loadedTextures[resource.texture] = handle;
+        return handle;
+    }
+
+    // faces +X -X +Y -Y +Z -Z
+    TextureHandle cubemap(const std::string faces[6], bool flip, glm::vec4 placeholder = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f))
+    {
+        unsigned long long key = RESOURCE_CUBEMAP_SEED ^ flip;
+        for (int i = 0; i < 6; i++)
+            key = pathKey(faces[i], key);
+        TextureHandle handle = requested(textures.find(key));
+        if (handle.valid())
+            return handle;
+        TextureResource resource;
+        resource.texture = loader.loadCubemap(faces, flip, placeholder);
+        handle = textures.insert(key, resource);
+        loadedTextures[resource.texture] = handle;
+        return handle;
+    }
+
+    // a 1x1 texture of color, components in [0, 1]; for material channels without a file
+    TextureHandle solid(glm::vec4 color)
+    {
+        unsigned char texel[4];
+        for (int i = 0; i < 4; i++)
+            texel[i] = (unsigned char)(glm::clamp(color[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+        unsigned long long key = hashBytes((const char*)texel, sizeof(texel), RESOURCE_SOLID_SEED);
+        TextureHandle handle = requested(textures.find(key));
+        if (handle.valid())
+            return handle;
+        TextureResource resource;
+        glGenTextures(1, &resource.texture);
+        glBindTexture(GL_TEXTURE_2D, resource.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        return textures.insert(key, resource);
+    }
+
+    // an OBJ through the loader; keyed by the .obj alone (the mesh cache still notices edited .mtl files),
+    // the loader merges it by the .obj and its .mtl files like the mesh cache
+    MeshHandle mesh(const std::string& objPath, VertexFormat format)
+    {
+        unsigned long long key = pathKey(objPath, RESOURCE_MESH_SEED ^ format);
+        MeshHandle handle = requested(meshes.find(key));
+        if (handle.valid())
+            return handle;
+        MeshResource resource;
+        resource.asset = loader.loadMesh(objPath, format);
+        resource.gpu = GpuMesh();
+        handle = meshes.insert(key, resource);
+        loadedMeshes[resource.asset] = handle;
+        return handle;
+    }
+
+    // position-only indexed geometry (3 floats per vertex, 32-bit indices), uploaded right away
+    MeshHandle geometry(const float* positions, size_t vertexCount, const unsigned int* indices, size_t indexCount)
+    {
+        unsigned long long key = hashBytes((const char*)positions, vertexCount * 3 * sizeof(float), RESOURCE_GEOMETRY_SEED);
+        key = hashBytes((const char*)indices, indexCount * sizeof(unsigned int), key);
+        MeshHandle handle = requested(meshes.find(key));
+        if (handle.valid())
+            return handle;
+        MeshResource resource;
+        resource.asset = NULL;
+        resource.gpu = GpuMesh();
+        resource.gpu.format = VERTEX_FORMAT_FLOAT;
+        resource.gpu.indexType = GL_UNSIGNED_INT;
+        resource.gpu.positionOffset = glm::vec3(0.0f);
+        resource.gpu.positionScale = glm::vec3(1.0f);
+        glGenVertexArrays(1, &resource.gpu.vao);
+        glGenBuffers(1, &resource.gpu.vbo);
+        glGenBuffers(1, &resource.gpu.ebo);
+        glBindVertexArray(resource.gpu.vao);
+        glBindBuffer(GL_ARRAY_BUFFER, resource.gpu.vbo);
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * 3 * sizeof(float), positions, GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, resource.gpu.ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+        glBindVertexArray(0);
+        return meshes.insert(key, resource);
+    }
+
+    // render thread, once per frame in place of the loader's update(): uploads within budgetMs, then points
+    // the handles of every duplicate the loader dropped at what it duplicates
+    AssetUploadStats update(double budgetMs = ASSET_UPLOAD_BUDGET_MS)
+    {
+        AssetUploadStats uploads = loader.update(budgetMs);
+        std::vector<DuplicateAsset> duplicates = loader.takeDuplicates();
+        for (size_t i = 0; i < duplicates.size(); i++) {
+            const DuplicateAsset& duplicate = duplicates[i];
+            bool merged;
+            if (duplicate.kind == ASSET_MESH) {
+                merged = meshes.merge(slotOf(loadedMeshes, duplicate.mesh), slotOf(loadedMeshes, duplicate.originalMesh));
+                loadedMeshes.erase(duplicate.mesh);
+            } else {
+                merged = textures.merge(slotOf(loadedTextures, duplicate.texture), slotOf(loadedTextures, duplicate.original));
+                loadedTextures.erase(duplicate.texture);
+            }
+            if (merged)
+                stats.merged++;
+        }
+        return uploads;
+    }
+
+    // compiled and linked once per distinct pair of sources (loaded from the driver's binary after the first run)
+    ProgramHandle program(const std::string& vertexPath, const std::string& fragmentPath)
+    {
+        unsigned long long key = fileKey(vertexPath, RESOURCE_PROGRAM_SEED);
+        key = fileKey(fragmentPath, key);
+        ProgramHandle handle = requested(programs.find(key));
+        if (handle.valid())
+            return handle;
+        ProgramResource resource;
+        resource.program = Shader(vertexPath.c_str(), fragmentPath.c_str()).ID;
+        return programs.insert(key, resource);
+    }
+
+    // 0 / NULL for stale handles
+    GLuint textureName(TextureHandle handle)
+    {
+        TextureResource* resource = textures.get(handle);
+        return resource ? resource->texture : 0;
+    }
+
+    GLuint programName(ProgramHandle handle)
+    {
+        ProgramResource* resource = programs.get(handle);
+        return resource ? resource->program : 0;
+    }
+
+    // NULL for geometry and stale handles; poll its state until it is ready
+    const MeshAsset* meshAsset(MeshHandle handle)
+    {
+        MeshResource* resource = meshes.get(handle);
+        return resource ? resource->asset : NULL;
+    }
+
+    // NULL until the mesh is ready
+    const GpuMesh* gpuMesh(MeshHandle handle)
+    {
+        MeshResource* resource = meshes.get(handle);
+        if (!resource)
+            return NULL;
+        if (!resource->asset)
+            return &resource->gpu;
+        return resource->asset->state == MESH_ASSET_READY ? &resource->asset->gpu : NULL;
+    }
+
+    // another owner for a handle someone else requested
+    bool addRef(TextureHandle handle) { return textures.addRef(handle); }
+    bool addRef(MeshHandle handle) { return meshes.addRef(handle); }
+    bool addRef(ProgramHandle handle) { return programs.addRef(handle); }
+
+    // the last release frees the GL objects; stale handles are ignored
+    void release(TextureHandle handle)
+    {
+        std::vector<TextureResource> freed;
+        textures.release(handle, freed);
+        for (size_t i = 0; i < freed.size(); i++)
+            freeTexture(freed[i]);
+    }
+
+    void release(MeshHandle handle)
+    {
+        std::vector<MeshResource> freed;
+        meshes.release(handle, freed);
+        for (size_t i = 0; i < freed.size(); i++)
+            freeMesh(freed[i]);
+    }
+
+    void release(ProgramHandle handle)
+    {
+        std::vector<ProgramResource> freed;
+        programs.release(handle, freed);
+        for (size_t i = 0; i < freed.size(); i++)
+            glDeleteProgram(freed[i].program);
+    }
+
+    // frees everything still held; call before the loader and the GL context go away
+    void release()
+    {
+        std::vector<TextureResource> liveTextures = textures.takeAll();
+        for (size_t i = 0; i < liveTextures.size(); i++)
+            freeTexture(liveTextures[i]);
+        std::vector<MeshResource> liveMeshes = meshes.takeAll();
+        for (size_t i = 0; i < liveMeshes.size(); i++)
+            freeMesh(liveMeshes[i]);
+        std::vector<ProgramResource> livePrograms = programs.takeAll();
+        for (size_t i = 0; i < livePrograms.size(); i++)
+            glDeleteProgram(livePrograms[i].program);
+    }
+
+    ResourceStats statistics() const
+    {
+        return stats;
+    }
+
+private:
+    // the path with the file's size and modification time, so an edited file is loaded again; a stat is
+    // all it costs the render thread. Unreadable files are keyed by path alone (the loader reports them)
+    static unsigned long long pathKey(const std::string& path, unsigned long long seed)
+    {
+        struct stat status;
+        if (stat(path.c_str(), &status) != 0)
+            return hashBytes(path.c_str(), path.size(), seed ^ RESOURCE_MISSING_SEED);
+        unsigned long long stamp[2] = { (unsigned long long)status.st_size, (unsigned long long)status.st_mtime };
+        unsigned long long key = hashBytes(path.c_str(), path.size(), seed);
+        return hashBytes((const char*)stamp, sizeof(stamp), key);
+    }
+
+    // content hash, or the path's when the file cannot be read; for the shader sources, which are read
+    // on this thread anyway
+    static unsigned long long fileKey(const std::string& path, unsigned long long seed)
+    {
+        unsigned long long key;
+        if (!hashFile(path, seed, key))
+            key = hashBytes(path.c_str(), path.size(), seed ^ RESOURCE_MISSING_SEED);
+        return key;
+    }
+
+    template <typename Key, typename Handle>
+    static Handle slotOf(const std::map<Key, Handle>& slots, Key key)
+    {
+        typename std::map<Key, Handle>::const_iterator found = slots.find(key);
+        return found != slots.end() ? found->second : Handle();
+    }
+
+    template <typename Handle>
+    Handle requested(Handle found)
+    {
+        stats.requests++;
+        if (found.valid())
+            stats.shared++;
+        return found;
+    }
+
+    void freeTexture(const TextureResource& resource)
+    {
+        loadedTextures.erase(resource.texture);
+        loader.deleteTexture(resource.texture);
+    }
+
+    void freeMesh(MeshResource& resource)
+    {
+        if (resource.asset) {
+            loadedMeshes.erase(resource.asset);
+            loader.deleteMesh(resource.asset);
+        } else
+            releaseMesh(resource.gpu);
+    }
+
+    AssetLoader& loader;
+    ResourcePool<TextureResource> textures;
+    ResourcePool<MeshResource> meshes;
+    ResourcePool<ProgramResource> programs;
+    // what the loader gave each request, so update() finds the slots of duplicates and originals
+    std::map<GLuint, TextureHandle> loadedTextures;
+    std::map<const MeshAsset*, MeshHandle> loadedMeshes;
+    ResourceStats stats;
+};
+#endif
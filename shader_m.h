@@ -6,18 +6,47 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <algorithm>
+#include <cstring>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <type_traits>
+#include <vector>
+
+#include "frame_uniforms.h"
+#include "program_cache.h"
+
+// a uniform name hashed (64-bit FNV-1a), the set functions look it up in the program's active uniforms
+// instead of asking GL for the location every call
+struct UniformId
+{
+    unsigned long long hash;
+};
+
+constexpr unsigned long long hashUniformName(const char* name, unsigned long long hash = 14695981039346656037ull)
+{
+    return *name ? hashUniformName(name + 1, (hash ^ (unsigned char)*name) * 1099511628211ull) : hash;
+}
+
+constexpr UniformId uniformId(const char* name)
+{
+    return UniformId{ hashUniformName(name) };
+}
+
+// the id of a literal name, hashed at compile time even in unoptimized builds
+#define UNIFORM_ID(name) (UniformId{ std::integral_constant<unsigned long long, hashUniformName(name)>::value })
 
 class Shader
 {
 public:
     unsigned int ID;
     // constructor generates the shader on the fly
+    // features are "NAME" or "NAME=value" keys, defined in both stages right after their #version line
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath)
+    Shader(const char* vertexPath, const char* fragmentPath,
+        const std::vector<std::string>& features = std::vector<std::string>())
     {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
@@ -47,30 +76,34 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << e.what() << std::endl;
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char* fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        
+        std::string defines = featureDefines(features);
+        vertexCode = injectDefines(vertexCode, defines);
+        fragmentCode = injectDefines(fragmentCode, defines);
+        // 2. a binary the driver linked on an earlier run, when it still takes it; every variant has its own
+        std::string cachePath = programCachePath(vertexPath, fragmentPath, defines);
+        unsigned long long cacheKey = 0;
+        bool cached = programBinarySupported();
+        ID = 0;
+        if (cached)
+        {
+            cacheKey = programCacheKey(vertexCode, fragmentCode);
+            ID = loadProgramBinary(cachePath, cacheKey);
+        }
+        if (!ID)
+        {
+            ID = compile(vertexCode, fragmentCode, cached);
+            if (cached && linked())
+                saveProgramBinary(cachePath, cacheKey, ID);
+        }
+        // block bindings and uniform values are not part of the binary
+        bindFrameBlocks(ID);
+        resolveUniforms();
+    }
+    // wraps a program that is already linked (e.g. one owned by a ResourceManager), without taking ownership
+    // ------------------------------------------------------------------------
+    explicit Shader(unsigned int program) : ID(program)
+    {
+        resolveUniforms();
     }
     // activate the shader
     // ------------------------------------------------------------------------
@@ -79,65 +112,303 @@ public:
         glUseProgram(ID);
     }
     // utility uniform functions
+    // the program has to be in use; a value equal to the last one set through this Shader is not sent again,
+    // names the program doesn't use are ignored like GL does with location -1
     // ------------------------------------------------------------------------
+    void setBool(UniformId id, bool value) const
+    {
+        setInt(id, (int)value);
+    }
     void setBool(const std::string& name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        setInt(uniformId(name.c_str()), (int)value);
     }
     // ------------------------------------------------------------------------
+    void setInt(UniformId id, int value) const
+    {
+        GLint location;
+        if (changed(id, &value, sizeof(value), location))
+            glUniform1i(location, value);
+    }
     void setInt(const std::string& name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        setInt(uniformId(name.c_str()), value);
     }
     // ------------------------------------------------------------------------
+    void setFloat(UniformId id, float value) const
+    {
+        GLint location;
+        if (changed(id, &value, sizeof(value), location))
+            glUniform1f(location, value);
+    }
     void setFloat(const std::string& name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        setFloat(uniformId(name.c_str()), value);
     }
     // ------------------------------------------------------------------------
+    void setVec2(UniformId id, const glm::vec2& value) const
+    {
+        GLint location;
+        if (changed(id, &value[0], sizeof(value), location))
+            glUniform2fv(location, 1, &value[0]);
+    }
     void setVec2(const std::string& name, const glm::vec2& value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setVec2(uniformId(name.c_str()), value);
     }
     void setVec2(const std::string& name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        setVec2(uniformId(name.c_str()), glm::vec2(x, y));
     }
     // ------------------------------------------------------------------------
+    void setVec3(UniformId id, const glm::vec3& value) const
+    {
+        GLint location;
+        if (changed(id, &value[0], sizeof(value), location))
+            glUniform3fv(location, 1, &value[0]);
+    }
     void setVec3(const std::string& name, const glm::vec3& value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setVec3(uniformId(name.c_str()), value);
     }
     void setVec3(const std::string& name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        setVec3(uniformId(name.c_str()), glm::vec3(x, y, z));
     }
     // ------------------------------------------------------------------------
+    void setVec4(UniformId id, const glm::vec4& value) const
+    {
+        GLint location;
+        if (changed(id, &value[0], sizeof(value), location))
+            glUniform4fv(location, 1, &value[0]);
+    }
     void setVec4(const std::string& name, const glm::vec4& value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setVec4(uniformId(name.c_str()), value);
     }
     void setVec4(const std::string& name, float x, float y, float z, float w) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        setVec4(uniformId(name.c_str()), glm::vec4(x, y, z, w));
     }
     // ------------------------------------------------------------------------
+    void setMat2(UniformId id, const glm::mat2& mat) const
+    {
+        GLint location;
+        if (changed(id, &mat[0][0], sizeof(mat), location))
+            glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
+    }
     void setMat2(const std::string& name, const glm::mat2& mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat2(uniformId(name.c_str()), mat);
     }
     // ------------------------------------------------------------------------
+    void setMat3(UniformId id, const glm::mat3& mat) const
+    {
+        GLint location;
+        if (changed(id, &mat[0][0], sizeof(mat), location))
+            glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+    }
     void setMat3(const std::string& name, const glm::mat3& mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat3(uniformId(name.c_str()), mat);
     }
     // ------------------------------------------------------------------------
+    void setMat4(UniformId id, const glm::mat4& mat) const
+    {
+        GLint location;
+        if (changed(id, &mat[0][0], sizeof(mat), location))
+            glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
+    }
     void setMat4(const std::string& name, const glm::mat4& mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat4(uniformId(name.c_str()), mat);
+    }
+    // location of an active uniform, -1 when the program doesn't use it
+    // ------------------------------------------------------------------------
+    GLint location(UniformId id) const
+    {
+        UniformValue* value = find(id);
+        return value ? value->location : -1;
+    }
+    // call after setting this program's uniforms with glUniform* directly (or through another Shader
+    // wrapping the same program), so the next set sends its value whatever the shadow copy says
+    // ------------------------------------------------------------------------
+    void forgetValues() const
+    {
+        for (size_t i = 0; i < values.size(); i++)
+            values[i].size = 0;
     }
 
 private:
+    // an active uniform's location and a copy of the last value set through this Shader; the program keeps
+    // its uniforms while others are in use, so the copy stays valid across use() calls
+    struct UniformValue
+    {
+        GLint location;
+        size_t size; // bytes used, 0 before the first set
+        unsigned char bytes[sizeof(glm::mat4)];
+    };
+
+    // a name for one; an array's bare name and "name[0]" share theirs
+    struct Uniform
+    {
+        unsigned long long id;
+        size_t value; // into values
+    };
+
+    static bool byId(const Uniform& a, const Uniform& b)
+    {
+        return a.id < b.id;
+    }
+
+    static bool idBefore(const Uniform& uniform, unsigned long long id)
+    {
+        return uniform.id < id;
+    }
+
+    // every active uniform outside a block, once after linking; array elements are listed by GL as the
+    // first one, "name[0]", and get an entry each plus the bare name
+    // ------------------------------------------------------------------------
+    void resolveUniforms()
+    {
+        uniforms.clear();
+        values.clear();
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> buffer(maxLength > 0 ? maxLength : 1);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(ID, (GLuint)i, (GLsizei)buffer.size(), &length, &size, &type, &buffer[0]);
+            std::string name(&buffer[0], length);
+            bool array = name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0;
+            if (!array)
+            {
+                addUniform(name);
+                continue;
+            }
+            std::string bare = name.substr(0, name.size() - 3);
+            if (addUniform(name))
+            {
+                Uniform alias = { uniformId(bare.c_str()).hash, uniforms.back().value };
+                uniforms.push_back(alias);
+            }
+            for (GLint element = 1; element < size; element++)
+                addUniform(bare + "[" + std::to_string(element) + "]");
+        }
+        std::sort(uniforms.begin(), uniforms.end(), byId);
+        for (size_t i = 1; i < uniforms.size(); i++)
+            if (uniforms[i].id == uniforms[i - 1].id)
+                std::cout << "ERROR::SHADER::UNIFORM_ID_COLLISION: two uniforms of program " << ID
+                    << " hash the same, rename one" << std::endl;
+    }
+
+    // false for block members and built-ins, they have no location
+    bool addUniform(const std::string& name)
+    {
+        UniformValue value;
+        value.location = glGetUniformLocation(ID, name.c_str());
+        value.size = 0;
+        if (value.location < 0)
+            return false;
+        Uniform uniform = { uniformId(name.c_str()).hash, values.size() };
+        values.push_back(value);
+        uniforms.push_back(uniform);
+        return true;
+    }
+
+    UniformValue* find(UniformId id) const
+    {
+        std::vector<Uniform>::const_iterator found = std::lower_bound(uniforms.begin(), uniforms.end(), id.hash, idBefore);
+        return found != uniforms.end() && found->id == id.hash ? &values[found->value] : NULL;
+    }
+
+    // false when the program doesn't use the uniform or it already holds value; otherwise value becomes the
+    // shadow copy and location is where to send it
+    bool changed(UniformId id, const void* value, size_t size, GLint& location) const
+    {
+        UniformValue* shadow = find(id);
+        if (!shadow || (shadow->size == size && memcmp(shadow->bytes, value, size) == 0))
+            return false;
+        memcpy(shadow->bytes, value, size);
+        shadow->size = size;
+        location = shadow->location;
+        return true;
+    }
+
+    std::vector<Uniform> uniforms; // sorted by id
+    mutable std::vector<UniformValue> values;
+
+    // "#define NAME value" lines for the feature keys
+    // ------------------------------------------------------------------------
+    static std::string featureDefines(const std::vector<std::string>& features)
+    {
+        std::string defines;
+        for (size_t i = 0; i < features.size(); i++)
+        {
+            size_t equals = features[i].find('=');
+            defines += "#define " + (equals == std::string::npos ? features[i] :
+                features[i].substr(0, equals) + " " + features[i].substr(equals + 1)) + "\n";
+        }
+        return defines;
+    }
+
+    // GLSL wants #version before anything but comments, so the defines go on the line after it
+    // ------------------------------------------------------------------------
+    static std::string injectDefines(const std::string& code, const std::string& defines)
+    {
+        if (defines.empty())
+            return code;
+        size_t version = code.find("#version");
+        if (version == std::string::npos)
+            return defines + code;
+        size_t lineEnd = code.find('\n', version);
+        if (lineEnd == std::string::npos)
+            return code + "\n" + defines;
+        return code.substr(0, lineEnd + 1) + defines + code.substr(lineEnd + 1);
+    }
+
+    // 3. compile shaders and link them into a new program, retrievable with glGetProgramBinary when asked
+    // ------------------------------------------------------------------------
+    unsigned int compile(const std::string& vertexCode, const std::string& fragmentCode, bool retrievable)
+    {
+        const char* vShaderCode = vertexCode.c_str();
+        const char* fShaderCode = fragmentCode.c_str();
+        unsigned int vertex, fragment;
+        // vertex shader
+        vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertex, 1, &vShaderCode, NULL);
+        glCompileShader(vertex);
+        checkCompileErrors(vertex, "VERTEX");
+        // fragment Shader
+        fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragment, 1, &fShaderCode, NULL);
+        glCompileShader(fragment);
+        checkCompileErrors(fragment, "FRAGMENT");
+        // shader Program
+        unsigned int program = glCreateProgram();
+        glAttachShader(program, vertex);
+        glAttachShader(program, fragment);
+        if (retrievable)
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(program);
+        checkCompileErrors(program, "PROGRAM");
+        // delete the shaders as they're linked into our program now and no longer necessery
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+        return program;
+    }
+
+    bool linked() const
+    {
+        GLint success = 0;
+        glGetProgramiv(ID, GL_LINK_STATUS, &success);
+        return success != 0;
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
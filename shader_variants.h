@@ -0,0 +1,104 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <glad/glad.h>
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "frame_uniforms.h"
+#include "shader_m.h"
+
+// feature keys Shaders/MP_Light.frag (and sample.vert) are written against; a program compiled without
+// one leaves that work out instead of doing it with neutral inputs:
+//   NORMAL_MAP          perturb the normal with material.normal, otherwise the interpolated vertex normal
+//   ALPHA_TEST          discard texels whose diffuse alpha is below 0.1
+//   SPOTLIGHT           add the spot light of the Lights block
+//   NUM_POINT_LIGHTS=N  add the first N point lights of the Lights block
+// a variant key holds the flags in its low bits and N above SHADER_POINT_LIGHT_SHIFT
+typedef unsigned int ShaderVariantKey;
+
+const ShaderVariantKey SHADER_NORMAL_MAP = 1u << 0;
+const ShaderVariantKey SHADER_ALPHA_TEST = 1u << 1;
+const ShaderVariantKey SHADER_SPOTLIGHT = 1u << 2;
+const int SHADER_POINT_LIGHT_SHIFT = 8;
+
+// the lighting half of a key, the material half comes from materialFeatures (material.h)
+inline ShaderVariantKey lightingFeatures(bool spotLight, int pointLights)
+{
+    if (pointLights < 0)
+        pointLights = 0;
+    if (pointLights > MAX_POINT_LIGHTS)
+        pointLights = MAX_POINT_LIGHTS;
+    return (spotLight ? SHADER_SPOTLIGHT : 0) | (ShaderVariantKey)pointLights << SHADER_POINT_LIGHT_SHIFT;
+}
+
+inline std::vector<std::string> shaderFeatureKeys(ShaderVariantKey key)
+{
+    std::vector<std::string> features;
+    if (key & SHADER_NORMAL_MAP)
+        features.push_back("NORMAL_MAP");
+    if (key & SHADER_ALPHA_TEST)
+        features.push_back("ALPHA_TEST");
+    if (key & SHADER_SPOTLIGHT)
+        features.push_back("SPOTLIGHT");
+    char pointLights[32];
+    std::snprintf(pointLights, sizeof(pointLights), "NUM_POINT_LIGHTS=%u", key >> SHADER_POINT_LIGHT_SHIFT);
+    features.push_back(pointLights);
+    return features;
+}
+
+// the programs one pair of shader files is compiled into, one per variant key; a variant is compiled (or
+// loaded from its program binary) the first time it is asked for and kept, with its uniform table, until
+// release(). Set a variant's uniforms through variant() so its copies of the values stay right
+class ShaderVariants {
+public:
+    ShaderVariants(const std::string& vertexPath, const std::string& fragmentPath)
+        : vertexPath(vertexPath), fragmentPath(fragmentPath)
+    {
+    }
+
+    ~ShaderVariants()
+    {
+        release();
+    }
+
+    // needs a current context; the reference stays valid until release()
+    const Shader& variant(ShaderVariantKey key)
+    {
+        std::map<ShaderVariantKey, Shader>::iterator found = variants.find(key);
+        if (found != variants.end())
+            return found->second;
+        Shader shader(vertexPath.c_str(), fragmentPath.c_str(), shaderFeatureKeys(key));
+        return variants.insert(std::make_pair(key, shader)).first->second;
+    }
+
+    GLuint program(ShaderVariantKey key)
+    {
+        return variant(key).ID;
+    }
+
+    size_t variantCount() const
+    {
+        return variants.size();
+    }
+
+    void release()
+    {
+        for (std::map<ShaderVariantKey, Shader>::iterator it = variants.begin(); it != variants.end(); ++it)
+            glDeleteProgram(it->second.ID);
+        variants.clear();
+    }
+
+private:
+    // a copy would delete the same programs
+    ShaderVariants(const ShaderVariants&);
+    ShaderVariants& operator=(const ShaderVariants&);
+
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::map<ShaderVariantKey, Shader> variants;
+};
+#endif
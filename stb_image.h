@@ -48,6 +48,8 @@ LICENSE
 
 RECENT REVISION HISTORY:
 
+      local              faster inflate: 64-bit bit buffer, two literals per lookup, 8 byte match
+                         copies; SSE2 Sub/Avg/Paeth PNG filters for 3 and 4 byte pixels
       2.27  (2021-07-11) document stbi_info better, 16-bit PNM support, bug fixes
       2.26  (2020-07-13) many minor fixes
       2.25  (2020-02-02) fix warnings
@@ -271,6 +273,13 @@ RECENT REVISION HISTORY:
 // you have issues compiling it, you can disable it entirely by
 // defining STBI_NO_SIMD.
 //
+// Where SSE2 is used, the JPEG IDCT, 2x2 upsampling and YCbCr-to-RGB(A)
+// kernels also have AVX2 versions. Only those functions are compiled for
+// AVX2 (with a target attribute on GCC/Clang), and they are picked by a
+// run-time CPU test, so the rest of the library still runs on any SSE2
+// CPU. Like the SSE2 kernels they give bit-identical results to the generic
+// C code. Define STBI_NO_AVX2 to leave them out.
+//
 // ===========================================================================
 //
 // HDR image support   (disable by defining STBI_NO_HDR)
@@ -640,12 +649,14 @@ typedef unsigned short stbi__uint16;
 typedef   signed short stbi__int16;
 typedef unsigned int   stbi__uint32;
 typedef   signed int   stbi__int32;
+typedef unsigned __int64 stbi__uint64;
 #else
 #include <stdint.h>
 typedef uint16_t stbi__uint16;
 typedef int16_t  stbi__int16;
 typedef uint32_t stbi__uint32;
 typedef int32_t  stbi__int32;
+typedef uint64_t stbi__uint64;
 #endif
 
 // should produce compiler error if size is wrong
@@ -747,7 +758,7 @@ static int stbi__cpuid3(void)
 
 #define STBI_SIMD_ALIGN(type, name) __declspec(align(16)) type name
 
-#if !defined(STBI_NO_JPEG) && defined(STBI_SSE2)
+#if (!defined(STBI_NO_JPEG) || !defined(STBI_NO_PNG)) && defined(STBI_SSE2)
 static int stbi__sse2_available(void)
 {
    int info3 = stbi__cpuid3();
@@ -758,7 +769,7 @@ static int stbi__sse2_available(void)
 #else // assume GCC-style if not VC++
 #define STBI_SIMD_ALIGN(type, name) type name __attribute__((aligned(16)))
 
-#if !defined(STBI_NO_JPEG) && defined(STBI_SSE2)
+#if (!defined(STBI_NO_JPEG) || !defined(STBI_NO_PNG)) && defined(STBI_SSE2)
 static int stbi__sse2_available(void)
 {
    // If we're even attempting to compile this on GCC/Clang, that means
@@ -771,6 +782,39 @@ static int stbi__sse2_available(void)
 #endif
 #endif
 
+// AVX2, JPEG kernels only, picked at run time; needs a compiler that can
+// target AVX2 per function (GCC 4.9+, Clang, VC++ 2012+)
+#if defined(STBI_SSE2) && !defined(STBI_NO_AVX2) && !defined(STBI_NO_JPEG)
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define STBI_AVX2
+#define STBI__AVX2_TARGET __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && _MSC_VER >= 1700
+#define STBI_AVX2
+#define STBI__AVX2_TARGET
+#endif
+#endif
+
+#ifdef STBI_AVX2
+#include <immintrin.h>
+static int stbi__avx2_available(void)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+   int info[4];
+   __cpuid(info,0);
+   if (info[0] < 7) return 0;
+   // OSXSAVE and AVX, and the OS saves the ymm registers
+   __cpuid(info,1);
+   if (((info[2] >> 27) & 3) != 3) return 0;
+   if ((_xgetbv(0) & 6) != 6) return 0;
+   __cpuidex(info,7,0);
+   return ((info[1] >> 5) & 1) != 0;
+#else
+   // checks the OS side too
+   return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
 // ARM NEON
 #if defined(STBI_NO_SIMD) && defined(STBI_NEON)
 #undef STBI_NEON
@@ -2670,6 +2714,171 @@ static void stbi__idct_simd(stbi_uc *out, int out_stride, short data[64])
 
 #endif // STBI_SSE2
 
+#ifdef STBI_AVX2
+// the sse2 IDCT with each row's 32-bit intermediates in one 256-bit register
+// instead of two halves; same arithmetic, so still bit-identical to the
+// generic C version.
+STBI__AVX2_TARGET static void stbi__idct_avx2(stbi_uc *out, int out_stride, short data[64])
+{
+   __m128i row0, row1, row2, row3, row4, row5, row6, row7;
+   __m128i tmp;
+
+   // dot product constant: even elems=x, odd elems=y
+   #define dct_const(x,y)  _mm256_setr_epi16((x),(y),(x),(y),(x),(y),(x),(y),(x),(y),(x),(y),(x),(y),(x),(y))
+
+   // out(0) = c0[even]*x + c0[odd]*y   (c0, x, y 16-bit, out 32-bit)
+   // out(1) = c1[even]*x + c1[odd]*y
+   #define dct_rot(out0,out1, x,y,c0,c1) \
+      __m256i c0##xy = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi16((x),(y))), \
+                                               _mm_unpackhi_epi16((x),(y)), 1); \
+      __m256i out0 = _mm256_madd_epi16(c0##xy, c0); \
+      __m256i out1 = _mm256_madd_epi16(c0##xy, c1)
+
+   // out = in << 12  (in 16-bit, out 32-bit)
+   #define dct_widen(out, in) \
+      __m256i out = _mm256_slli_epi32(_mm256_cvtepi16_epi32(in), 12)
+
+   // butterfly a/b, add bias, then shift by "s" and pack
+   #define dct_bfly32o(out0, out1, a,b,bias,s) \
+      { \
+         __m256i abiased = _mm256_add_epi32(a, bias); \
+         __m256i sum = _mm256_srai_epi32(_mm256_add_epi32(abiased, b), s); \
+         __m256i dif = _mm256_srai_epi32(_mm256_sub_epi32(abiased, b), s); \
+         /* packs works per 128-bit half: s0-3 d0-3 s4-7 d4-7 */ \
+         __m256i sd = _mm256_permute4x64_epi64(_mm256_packs_epi32(sum, dif), 0xd8); \
+         out0 = _mm256_castsi256_si128(sd); \
+         out1 = _mm256_extracti128_si256(sd, 1); \
+      }
+
+   // 8-bit interleave step (for transposes)
+   #define dct_interleave8(a, b) \
+      tmp = a; \
+      a = _mm_unpacklo_epi8(a, b); \
+      b = _mm_unpackhi_epi8(tmp, b)
+
+   // 16-bit interleave step (for transposes)
+   #define dct_interleave16(a, b) \
+      tmp = a; \
+      a = _mm_unpacklo_epi16(a, b); \
+      b = _mm_unpackhi_epi16(tmp, b)
+
+   #define dct_pass(bias,shift) \
+      { \
+         /* even part */ \
+         dct_rot(t2e,t3e, row2,row6, rot0_0,rot0_1); \
+         __m128i sum04 = _mm_add_epi16(row0, row4); \
+         __m128i dif04 = _mm_sub_epi16(row0, row4); \
+         dct_widen(t0e, sum04); \
+         dct_widen(t1e, dif04); \
+         __m256i x0 = _mm256_add_epi32(t0e, t3e); \
+         __m256i x3 = _mm256_sub_epi32(t0e, t3e); \
+         __m256i x1 = _mm256_add_epi32(t1e, t2e); \
+         __m256i x2 = _mm256_sub_epi32(t1e, t2e); \
+         /* odd part */ \
+         dct_rot(y0o,y2o, row7,row3, rot2_0,rot2_1); \
+         dct_rot(y1o,y3o, row5,row1, rot3_0,rot3_1); \
+         __m128i sum17 = _mm_add_epi16(row1, row7); \
+         __m128i sum35 = _mm_add_epi16(row3, row5); \
+         dct_rot(y4o,y5o, sum17,sum35, rot1_0,rot1_1); \
+         __m256i x4 = _mm256_add_epi32(y0o, y4o); \
+         __m256i x5 = _mm256_add_epi32(y1o, y5o); \
+         __m256i x6 = _mm256_add_epi32(y2o, y5o); \
+         __m256i x7 = _mm256_add_epi32(y3o, y4o); \
+         dct_bfly32o(row0,row7, x0,x7,bias,shift); \
+         dct_bfly32o(row1,row6, x1,x6,bias,shift); \
+         dct_bfly32o(row2,row5, x2,x5,bias,shift); \
+         dct_bfly32o(row3,row4, x3,x4,bias,shift); \
+      }
+
+   __m256i rot0_0 = dct_const(stbi__f2f(0.5411961f), stbi__f2f(0.5411961f) + stbi__f2f(-1.847759065f));
+   __m256i rot0_1 = dct_const(stbi__f2f(0.5411961f) + stbi__f2f( 0.765366865f), stbi__f2f(0.5411961f));
+   __m256i rot1_0 = dct_const(stbi__f2f(1.175875602f) + stbi__f2f(-0.899976223f), stbi__f2f(1.175875602f));
+   __m256i rot1_1 = dct_const(stbi__f2f(1.175875602f), stbi__f2f(1.175875602f) + stbi__f2f(-2.562915447f));
+   __m256i rot2_0 = dct_const(stbi__f2f(-1.961570560f) + stbi__f2f( 0.298631336f), stbi__f2f(-1.961570560f));
+   __m256i rot2_1 = dct_const(stbi__f2f(-1.961570560f), stbi__f2f(-1.961570560f) + stbi__f2f( 3.072711026f));
+   __m256i rot3_0 = dct_const(stbi__f2f(-0.390180644f) + stbi__f2f( 2.053119869f), stbi__f2f(-0.390180644f));
+   __m256i rot3_1 = dct_const(stbi__f2f(-0.390180644f), stbi__f2f(-0.390180644f) + stbi__f2f( 1.501321110f));
+
+   // rounding biases in column/row passes, see stbi__idct_block for explanation.
+   __m256i bias_0 = _mm256_set1_epi32(512);
+   __m256i bias_1 = _mm256_set1_epi32(65536 + (128<<17));
+
+   // load
+   row0 = _mm_load_si128((const __m128i *) (data + 0*8));
+   row1 = _mm_load_si128((const __m128i *) (data + 1*8));
+   row2 = _mm_load_si128((const __m128i *) (data + 2*8));
+   row3 = _mm_load_si128((const __m128i *) (data + 3*8));
+   row4 = _mm_load_si128((const __m128i *) (data + 4*8));
+   row5 = _mm_load_si128((const __m128i *) (data + 5*8));
+   row6 = _mm_load_si128((const __m128i *) (data + 6*8));
+   row7 = _mm_load_si128((const __m128i *) (data + 7*8));
+
+   // column pass
+   dct_pass(bias_0, 10);
+
+   {
+      // 16bit 8x8 transpose pass 1
+      dct_interleave16(row0, row4);
+      dct_interleave16(row1, row5);
+      dct_interleave16(row2, row6);
+      dct_interleave16(row3, row7);
+
+      // transpose pass 2
+      dct_interleave16(row0, row2);
+      dct_interleave16(row1, row3);
+      dct_interleave16(row4, row6);
+      dct_interleave16(row5, row7);
+
+      // transpose pass 3
+      dct_interleave16(row0, row1);
+      dct_interleave16(row2, row3);
+      dct_interleave16(row4, row5);
+      dct_interleave16(row6, row7);
+   }
+
+   // row pass
+   dct_pass(bias_1, 17);
+
+   {
+      // pack
+      __m128i p0 = _mm_packus_epi16(row0, row1); // a0a1a2a3...a7b0b1b2b3...b7
+      __m128i p1 = _mm_packus_epi16(row2, row3);
+      __m128i p2 = _mm_packus_epi16(row4, row5);
+      __m128i p3 = _mm_packus_epi16(row6, row7);
+
+      // 8bit 8x8 transpose pass 1
+      dct_interleave8(p0, p2); // a0e0a1e1...
+      dct_interleave8(p1, p3); // c0g0c1g1...
+
+      // transpose pass 2
+      dct_interleave8(p0, p1); // a0c0e0g0...
+      dct_interleave8(p2, p3); // b0d0f0h0...
+
+      // transpose pass 3
+      dct_interleave8(p0, p2); // a0b0c0d0...
+      dct_interleave8(p1, p3); // a4b4c4d4...
+
+      // store
+      _mm_storel_epi64((__m128i *) out, p0); out += out_stride;
+      _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi32(p0, 0x4e)); out += out_stride;
+      _mm_storel_epi64((__m128i *) out, p2); out += out_stride;
+      _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi32(p2, 0x4e)); out += out_stride;
+      _mm_storel_epi64((__m128i *) out, p1); out += out_stride;
+      _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi32(p1, 0x4e)); out += out_stride;
+      _mm_storel_epi64((__m128i *) out, p3); out += out_stride;
+      _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi32(p3, 0x4e));
+   }
+
+#undef dct_const
+#undef dct_rot
+#undef dct_widen
+#undef dct_bfly32o
+#undef dct_interleave8
+#undef dct_interleave16
+#undef dct_pass
+}
+#endif // STBI_AVX2
+
 #ifdef STBI_NEON
 
 // NEON integer IDCT. should produce bit-identical
@@ -3589,6 +3798,76 @@ static stbi_uc *stbi__resample_row_hv_2_simd(stbi_uc *out, stbi_uc *in_near, stb
 }
 #endif
 
+#ifdef STBI_AVX2
+// stbi__resample_row_hv_2_simd on 16 pixels at a time
+STBI__AVX2_TARGET static stbi_uc *stbi__resample_row_hv_2_avx2(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs)
+{
+   int i=0,t0,t1;
+
+   if (w == 1) {
+      out[0] = out[1] = stbi__div4(3*in_near[0] + in_far[0] + 2);
+      return out;
+   }
+
+   t1 = 3*in_near[0] + in_far[0];
+   // the last pixel in a row is again left to the boundary code below
+   for (; i < ((w-1) & ~15); i += 16) {
+      // vertical pass, 3*x + y = 4*x + (y - x)
+      __m256i farw  = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_far + i)));
+      __m256i nearw = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_near + i)));
+      __m256i diff  = _mm256_sub_epi16(farw, nearw);
+      __m256i nears = _mm256_slli_epi16(nearw, 2);
+      __m256i curr  = _mm256_add_epi16(nears, diff); // current row
+
+      // "prev" and "next" are the current row shifted by 1 pixel; byte
+      // shifts only work within 128-bit halves, so the half that crosses
+      // over comes from a lane permute
+      __m256i prv0 = _mm256_alignr_epi8(curr, _mm256_permute2x128_si256(curr, curr, 0x08), 14);
+      __m256i nxt0 = _mm256_alignr_epi8(_mm256_permute2x128_si256(curr, curr, 0x81), curr, 2);
+      __m256i prev = _mm256_insert_epi16(prv0, (short) t1, 0);
+      __m256i next = _mm256_insert_epi16(nxt0, (short) (3*in_near[i+16] + in_far[i+16]), 15);
+
+      // horizontal filter, polyphase like the sse2 version
+      __m256i bias = _mm256_set1_epi16(8);
+      __m256i curs = _mm256_slli_epi16(curr, 2);
+      __m256i prvd = _mm256_sub_epi16(prev, curr);
+      __m256i nxtd = _mm256_sub_epi16(next, curr);
+      __m256i curb = _mm256_add_epi16(curs, bias);
+      __m256i even = _mm256_add_epi16(prvd, curb);
+      __m256i odd  = _mm256_add_epi16(nxtd, curb);
+
+      // interleave even and odd pixels, then undo scaling; unpack and pack
+      // both stay within 128-bit halves, so the output comes out in order
+      __m256i int0 = _mm256_unpacklo_epi16(even, odd);
+      __m256i int1 = _mm256_unpackhi_epi16(even, odd);
+      __m256i de0  = _mm256_srli_epi16(int0, 4);
+      __m256i de1  = _mm256_srli_epi16(int1, 4);
+
+      __m256i outv = _mm256_packus_epi16(de0, de1);
+      _mm256_storeu_si256((__m256i *) (out + i*2), outv);
+
+      // "previous" value for next iter
+      t1 = 3*in_near[i+15] + in_far[i+15];
+   }
+
+   t0 = t1;
+   t1 = 3*in_near[i] + in_far[i];
+   out[i*2] = stbi__div16(3*t1 + t0 + 8);
+
+   for (++i; i < w; ++i) {
+      t0 = t1;
+      t1 = 3*in_near[i]+in_far[i];
+      out[i*2-1] = stbi__div16(3*t0 + t1 + 8);
+      out[i*2  ] = stbi__div16(3*t1 + t0 + 8);
+   }
+   out[w*2-1] = stbi__div4(t1+2);
+
+   STBI_NOTUSED(hs);
+
+   return out;
+}
+#endif
+
 static stbi_uc *stbi__resample_row_generic(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs)
 {
    // resample with nearest-neighbor
@@ -3763,6 +4042,83 @@ static void stbi__YCbCr_to_RGB_simd(stbi_uc *out, stbi_uc const *y, stbi_uc cons
 }
 #endif
 
+#ifdef STBI_AVX2
+// stbi__YCbCr_to_RGB_simd on 16 pixels at a time, and for step == 3 too:
+// loading the images with their own channel count gives 3-channel output,
+// and that's what the textures do
+STBI__AVX2_TARGET static void stbi__YCbCr_to_RGB_avx2(stbi_uc *out, stbi_uc const *y, stbi_uc const *pcb, stbi_uc const *pcr, int count, int step)
+{
+   int i = 0;
+
+   if (step == 3 || step == 4) {
+      __m256i signflip  = _mm256_set1_epi16(0x80);
+      __m256i cr_const0 = _mm256_set1_epi16(   (short) ( 1.40200f*4096.0f+0.5f));
+      __m256i cr_const1 = _mm256_set1_epi16( - (short) ( 0.71414f*4096.0f+0.5f));
+      __m256i cb_const0 = _mm256_set1_epi16( - (short) ( 0.34414f*4096.0f+0.5f));
+      __m256i cb_const1 = _mm256_set1_epi16(   (short) ( 1.77200f*4096.0f+0.5f));
+      __m256i y_bias = _mm256_set1_epi16(128);
+      __m256i xw = _mm256_set1_epi16(255); // alpha channel
+      // rgbx to rgb within each 16 bytes
+      __m256i drop_x = _mm256_setr_epi8(0,1,2,4,5,6,8,9,10,12,13,14,-1,-1,-1,-1,
+                                        0,1,2,4,5,6,8,9,10,12,13,14,-1,-1,-1,-1);
+      // step 3 stores 16 bytes for every 12, so the 4 bytes past the last
+      // pixel need at least two pixels after it that are written later
+      int end = step == 4 ? count-15 : count-17;
+
+      for (; i < end; i += 16) {
+         // load, widen to short and left-shift like the sse2 unpacks
+         __m256i y_words  = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (y+i)));
+         __m256i cr_words = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (pcr+i)));
+         __m256i cb_words = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (pcb+i)));
+         __m256i yw  = _mm256_or_si256(_mm256_slli_epi16(y_words, 8), y_bias);
+         __m256i crw = _mm256_slli_epi16(_mm256_xor_si256(cr_words, signflip), 8); // -128
+         __m256i cbw = _mm256_slli_epi16(_mm256_xor_si256(cb_words, signflip), 8); // -128
+
+         // color transform
+         __m256i yws = _mm256_srli_epi16(yw, 4);
+         __m256i cr0 = _mm256_mulhi_epi16(cr_const0, crw);
+         __m256i cb0 = _mm256_mulhi_epi16(cb_const0, cbw);
+         __m256i cb1 = _mm256_mulhi_epi16(cbw, cb_const1);
+         __m256i cr1 = _mm256_mulhi_epi16(crw, cr_const1);
+         __m256i rws = _mm256_add_epi16(cr0, yws);
+         __m256i gwt = _mm256_add_epi16(cb0, yws);
+         __m256i bws = _mm256_add_epi16(yws, cb1);
+         __m256i gws = _mm256_add_epi16(gwt, cr1);
+
+         // descale
+         __m256i rw = _mm256_srai_epi16(rws, 4);
+         __m256i bw = _mm256_srai_epi16(bws, 4);
+         __m256i gw = _mm256_srai_epi16(gws, 4);
+
+         // back to byte and interleave, within each 128-bit half: o0 has
+         // pixels 0-3 and 8-11, o1 pixels 4-7 and 12-15
+         __m256i brb = _mm256_packus_epi16(rw, bw);
+         __m256i gxb = _mm256_packus_epi16(gw, xw);
+         __m256i t0 = _mm256_unpacklo_epi8(brb, gxb);
+         __m256i t1 = _mm256_unpackhi_epi8(brb, gxb);
+         __m256i o0 = _mm256_unpacklo_epi16(t0, t1);
+         __m256i o1 = _mm256_unpackhi_epi16(t0, t1);
+
+         // store
+         if (step == 4) {
+            _mm256_storeu_si256((__m256i *) (out + 0), _mm256_permute2x128_si256(o0, o1, 0x20));
+            _mm256_storeu_si256((__m256i *) (out + 32), _mm256_permute2x128_si256(o0, o1, 0x31));
+         } else {
+            __m256i p0 = _mm256_shuffle_epi8(o0, drop_x);
+            __m256i p1 = _mm256_shuffle_epi8(o1, drop_x);
+            _mm_storeu_si128((__m128i *) (out + 0), _mm256_castsi256_si128(p0));
+            _mm_storeu_si128((__m128i *) (out + 12), _mm256_castsi256_si128(p1));
+            _mm_storeu_si128((__m128i *) (out + 24), _mm256_extracti128_si256(p0, 1));
+            _mm_storeu_si128((__m128i *) (out + 36), _mm256_extracti128_si256(p1, 1));
+         }
+         out += 16*step;
+      }
+   }
+
+   stbi__YCbCr_to_RGB_row(out, y+i, pcb+i, pcr+i, count-i, step);
+}
+#endif
+
 // set up the kernels
 static void stbi__setup_jpeg(stbi__jpeg *j)
 {
@@ -3778,6 +4134,14 @@ static void stbi__setup_jpeg(stbi__jpeg *j)
    }
 #endif
 
+#ifdef STBI_AVX2
+   if (stbi__avx2_available()) {
+      j->idct_block_kernel = stbi__idct_avx2;
+      j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_avx2;
+      j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_avx2;
+   }
+#endif
+
 #ifdef STBI_NEON
    j->idct_block_kernel = stbi__idct_simd;
    j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
@@ -4035,6 +4399,12 @@ static int stbi__jpeg_info(stbi__context *s, int *x, int *y, int *comp)
 #define STBI__ZFAST_MASK  ((1 << STBI__ZFAST_BITS) - 1)
 #define STBI__ZNSYMS 288 // number of symbols in literal/length alphabet
 
+// the inflate fast path looks literal/length codes up in a wider table, see stbi__zbuild_fast
+#define STBI__ZMULTI_BITS  11
+#define STBI__ZMULTI_MASK  ((1 << STBI__ZMULTI_BITS) - 1)
+// output the fast path needs free: the longest match, rounded up to whole 8 byte copies
+#define STBI__ZFAST_ROOM   (258 + 8)
+
 // zlib-style huffman encoding
 // (jpegs packs from left, zlib from right, so can't share code)
 typedef struct
@@ -4121,7 +4491,7 @@ typedef struct
 {
    stbi_uc *zbuffer, *zbuffer_end;
    int num_bits;
-   stbi__uint32 code_buffer;
+   stbi__uint64 code_buffer;
 
    char *zout;
    char *zout_start;
@@ -4129,6 +4499,7 @@ typedef struct
    int   z_expandable;
 
    stbi__zhuffman z_length, z_distance;
+   stbi__uint32 z_multi[1 << STBI__ZMULTI_BITS], z_dfast[1 << STBI__ZFAST_BITS]; // see stbi__zbuild_fast
 } stbi__zbuf;
 
 stbi_inline static int stbi__zeof(stbi__zbuf *z)
@@ -4141,14 +4512,42 @@ stbi_inline static stbi_uc stbi__zget8(stbi__zbuf *z)
    return stbi__zeof(z) ? 0 : *z->zbuffer++;
 }
 
+stbi_inline static stbi__uint64 stbi__zload64(const stbi_uc *p)
+{
+#if defined(STBI__X86_TARGET) || defined(STBI__X64_TARGET)
+   stbi__uint64 w; // little endian, unaligned loads are fine
+   memcpy(&w, p, 8);
+   return w;
+#else
+   return (stbi__uint64) p[0]       | (stbi__uint64) p[1] <<  8 | (stbi__uint64) p[2] << 16 | (stbi__uint64) p[3] << 24 |
+          (stbi__uint64) p[4] << 32 | (stbi__uint64) p[5] << 40 | (stbi__uint64) p[6] << 48 | (stbi__uint64) p[7] << 56;
+#endif
+}
+
+// tops code_buffer up to 56..63 bits with one load; needs 8 bytes of input left. only whole bytes are
+// taken, so the bits held always end on a byte boundary of the input
+stbi_inline static void stbi__zrefill(stbi__zbuf *z)
+{
+   int n = (63 - z->num_bits) >> 3;
+   z->code_buffer |= stbi__zload64(z->zbuffer) << z->num_bits;
+   z->zbuffer += n;
+   z->num_bits += n << 3;
+   z->code_buffer &= ((stbi__uint64) 1 << z->num_bits) - 1; // drop the bytes loaded but not taken
+}
+
 static void stbi__fill_bits(stbi__zbuf *z)
 {
+   if (z->zbuffer_end - z->zbuffer >= 8) {
+      stbi__zrefill(z);
+      return;
+   }
+   // near the end a byte at a time, past it zeros; this never holds more than 32 bits
    do {
-      if (z->code_buffer >= (1U << z->num_bits)) {
+      if (z->code_buffer >= ((stbi__uint64) 1 << z->num_bits)) {
         z->zbuffer = z->zbuffer_end;  /* treat this as EOF so we fail. */
         return;
       }
-      z->code_buffer |= (unsigned int) stbi__zget8(z) << z->num_bits;
+      z->code_buffer |= (stbi__uint64) stbi__zget8(z) << z->num_bits;
       z->num_bits += 8;
    } while (z->num_bits <= 24);
 }
@@ -4157,29 +4556,38 @@ stbi_inline static unsigned int stbi__zreceive(stbi__zbuf *z, int n)
 {
    unsigned int k;
    if (z->num_bits < n) stbi__fill_bits(z);
-   k = z->code_buffer & ((1 << n) - 1);
+   k = (unsigned int) (z->code_buffer & ((1 << n) - 1));
    z->code_buffer >>= n;
    z->num_bits -= n;
    return k;
 }
 
-static int stbi__zhuffman_decode_slowpath(stbi__zbuf *a, stbi__zhuffman *z)
+// k holds the next 16 bits of input; returns the symbol and sets *size, or -1
+static int stbi__zhuffman_symbol_slowpath(stbi__zhuffman *z, int k, int *size)
 {
-   int b,s,k;
+   int b,s;
    // not resolved by fast table, so compute it the slow way
    // use jpeg approach, which requires MSbits at top
-   k = stbi__bit_reverse(a->code_buffer, 16);
+   k = stbi__bit_reverse(k, 16);
    for (s=STBI__ZFAST_BITS+1; ; ++s)
       if (k < z->maxcode[s])
          break;
    if (s >= 16) return -1; // invalid code!
    // code size is s, so:
    b = (k >> (16-s)) - z->firstcode[s] + z->firstsymbol[s];
-   if (b >= STBI__ZNSYMS) return -1; // some data was corrupt somewhere!
+   if (b < 0 || b >= STBI__ZNSYMS) return -1; // some data was corrupt somewhere!
    if (z->size[b] != s) return -1;  // was originally an assert, but report failure instead.
+   *size = s;
+   return z->value[b];
+}
+
+static int stbi__zhuffman_decode_slowpath(stbi__zbuf *a, stbi__zhuffman *z)
+{
+   int s, v = stbi__zhuffman_symbol_slowpath(z, (int) (a->code_buffer & 0xffff), &s);
+   if (v < 0) return -1;
    a->code_buffer >>= s;
    a->num_bits -= s;
-   return z->value[b];
+   return v;
 }
 
 stbi_inline static int stbi__zhuffman_decode(stbi__zbuf *a, stbi__zhuffman *z)
@@ -4191,7 +4599,7 @@ stbi_inline static int stbi__zhuffman_decode(stbi__zbuf *a, stbi__zhuffman *z)
       }
       stbi__fill_bits(a);
    }
-   b = z->fast[a->code_buffer & STBI__ZFAST_MASK];
+   b = z->fast[(int) (a->code_buffer & STBI__ZFAST_MASK)];
    if (b) {
       s = b >> 9;
       a->code_buffer >>= s;
@@ -4237,11 +4645,197 @@ static const int stbi__zdist_base[32] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129
 static const int stbi__zdist_extra[32] =
 { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13};
 
+// the tables of the fast path resolve everything up to the copy in one lookup. literal/length entries:
+//    bits  0-3   length of the first code, 0 if longer than STBI__ZMULTI_BITS (or unused)
+//    bits  4-8   bits taken in all: the code and its extra bits, or the codes of both literals
+//    bits  9-17  literal, 256 for the end of the block, or the base of a length
+//    bits 18-19  literals decoded: one, or two when the next code fits too
+//    bit  20     a length
+//    bits 21-23  extra bits of the length
+//    bits 24-31  the second literal
+// distance entries (0 if the code is longer than STBI__ZFAST_BITS): bits 0-3 code length, 4-8 bits taken
+// in all, 9-12 extra bits, 16-31 the base distance
+#define STBI__ZLITERALS  (3 << 18)
+#define STBI__ZLENGTH    (1 << 20)
+
+// sizelist has passed stbi__zbuild_huffman for a->z_length, and a->z_distance is built
+static void stbi__zbuild_fast(stbi__zbuf *a, const stbi_uc *sizelist, int num)
+{
+   stbi__uint32 *multi = a->z_multi;
+   int i, code, next_code[16], sizes[16];
+
+   memset(sizes, 0, sizeof(sizes));
+   memset(multi, 0, sizeof(a->z_multi));
+   for (i=0; i < num; ++i)
+      ++sizes[sizelist[i]];
+   sizes[0] = 0;
+   code = 0;
+   for (i=1; i < 16; ++i) {
+      next_code[i] = code;
+      code = (code + sizes[i]) << 1;
+   }
+   for (i=0; i < num; ++i) {
+      int s = sizelist[i];
+      if (s) {
+         if (s <= STBI__ZMULTI_BITS && i < 286) { // 286 and 287 are unused
+            stbi__uint32 entry;
+            int j = stbi__bit_reverse(next_code[s],s);
+            if (i < 256)
+               entry = (stbi__uint32) (s | (s << 4) | (i << 9) | (1 << 18));
+            else if (i == 256)
+               entry = (stbi__uint32) (s | (s << 4) | (i << 9));
+            else {
+               int extra = stbi__zlength_extra[i - 257];
+               entry = (stbi__uint32) (s | ((s + extra) << 4) | (stbi__zlength_base[i - 257] << 9) | STBI__ZLENGTH | (extra << 21));
+            }
+            while (j < (1 << STBI__ZMULTI_BITS)) {
+               multi[j] = entry;
+               j += (1 << s);
+            }
+         }
+         ++next_code[s];
+      }
+   }
+   // pair a literal with the literal after it when that code fits in the bits left; looking it up with
+   // zeros shifted in for the missing bits finds it all the same
+   for (i=0; i < (1 << STBI__ZMULTI_BITS); ++i) {
+      stbi__uint32 first = multi[i], second;
+      int s = first & 15;
+      if (!(first & STBI__ZLITERALS) || s == STBI__ZMULTI_BITS) continue;
+      second = multi[i >> s];
+      if (!(second & STBI__ZLITERALS) || s + (int) (second & 15) > STBI__ZMULTI_BITS) continue;
+      multi[i] = (first & 0x3fe0f) | ((s + (second & 15)) << 4) | (2 << 18) | (((second >> 9) & 255) << 24);
+   }
+
+   for (i=0; i < (1 << STBI__ZFAST_BITS); ++i) {
+      int b = a->z_distance.fast[i], z = b & 511, s = b >> 9;
+      a->z_dfast[i] = b && z < 30 ? (stbi__uint32) (s | ((s + stbi__zdist_extra[z]) << 4) | (stbi__zdist_extra[z] << 9) | (stbi__zdist_base[z] << 16)) : 0;
+   }
+}
+
+// inflates while at least 8 bytes of input and STBI__ZFAST_ROOM bytes of output are left, so that one
+// refill covers a literal pair or a whole length/distance pair (48 bits at most) and nothing is bounds
+// checked. the state is kept in locals: stores through zout may alias a's fields.
+// returns 1 at the end of the block, 0 on error and 2 when the careful path has to take over
+static int stbi__parse_huffman_fast(stbi__zbuf *a)
+{
+   stbi__uint64 bits = a->code_buffer;
+   int num_bits = a->num_bits, result = 2;
+   const stbi_uc *in = a->zbuffer, *in_last = a->zbuffer_end - 8;
+   char *zout = a->zout, *zout_last = a->zout_end - STBI__ZFAST_ROOM, *zout_start = a->zout_start;
+   const stbi__uint32 *multi = a->z_multi;
+
+   while (in <= in_last && zout <= zout_last) {
+      stbi__uint32 e;
+      int z, s, len, dist;
+      char *end;
+      const char *p;
+
+      // top up to 56..63 bits with whole bytes; the bits above num_bits hold the following input
+      // already, so or-ing it in again at the next refill changes nothing
+      bits |= stbi__zload64(in) << num_bits;
+      in += (63 - num_bits) >> 3;
+      num_bits |= 56;
+
+      e = multi[(int) (bits & STBI__ZMULTI_MASK)];
+      if (e & STBI__ZLITERALS) {
+         // one or two literals; writing both either way saves a hard to predict branch
+         s = (e >> 4) & 31;
+         bits >>= s;
+         num_bits -= s;
+         zout[0] = (char) (e >> 9);
+         zout[1] = (char) (e >> 24);
+         zout += (e >> 18) & 3;
+         continue;
+      }
+      if (e & STBI__ZLENGTH) {
+         len = ((e >> 9) & 511) + (int) ((bits >> (e & 15)) & ((1 << ((e >> 21) & 7)) - 1));
+         s = (e >> 4) & 31;
+         bits >>= s;
+         num_bits -= s;
+      } else if (e & 15) { // end of block
+         s = e & 15;
+         bits >>= s;
+         num_bits -= s;
+         result = 1;
+         break;
+      } else {
+         z = stbi__zhuffman_symbol_slowpath(&a->z_length, (int) (bits & 0xffff), &s);
+         if (z < 0 || z >= 286) { result = stbi__err("bad huffman code","Corrupt PNG"); break; }
+         bits >>= s;
+         num_bits -= s;
+         if (z < 256) {
+            *zout++ = (char) z;
+            continue;
+         }
+         if (z == 256) {
+            result = 1;
+            break;
+         }
+         s = stbi__zlength_extra[z - 257];
+         len = stbi__zlength_base[z - 257] + (int) (bits & ((1 << s) - 1));
+         bits >>= s;
+         num_bits -= s;
+      }
+
+      e = a->z_dfast[(int) (bits & STBI__ZFAST_MASK)];
+      if (e) {
+         dist = (int) (e >> 16) + (int) ((bits >> (e & 15)) & ((1 << ((e >> 9) & 15)) - 1));
+         s = (e >> 4) & 31;
+      } else {
+         z = stbi__zhuffman_symbol_slowpath(&a->z_distance, (int) (bits & 0xffff), &s);
+         if (z < 0 || z >= 30) { result = stbi__err("bad huffman code","Corrupt PNG"); break; } // 30 and 31 are unused
+         bits >>= s;
+         num_bits -= s;
+         s = stbi__zdist_extra[z];
+         dist = stbi__zdist_base[z] + (int) (bits & ((1 << s) - 1));
+      }
+      bits >>= s;
+      num_bits -= s;
+      if (zout - zout_start < dist) { result = stbi__err("bad dist","Corrupt PNG"); break; }
+
+      p = zout - dist;
+      end = zout + len;
+      if (dist >= 8) {
+         // whole 8 byte copies, writing up to 15 bytes past the match; most matches are short enough
+         // for the first two
+         memcpy(zout, p, 8);
+         memcpy(zout + 8, p + 8, 8);
+         for (zout += 16, p += 16; zout < end; zout += 8, p += 8)
+            memcpy(zout, p, 8);
+      } else if (dist == 1) { // run of one byte; common in images.
+         memset(zout, *p, len);
+      } else {
+         // a match closer than 8 bytes repeats with its period: after the first 8 bytes copy from a
+         // whole number of periods back
+         int k;
+         for (k=0; k < 8; ++k) zout[k] = p[k];
+         zout += 8;
+         for (p = zout - (8 + dist - 1) / dist * dist; zout < end; zout += 8, p += 8)
+            memcpy(zout, p, 8);
+      }
+      zout = end;
+   }
+
+   a->code_buffer = bits & (((stbi__uint64) 1 << num_bits) - 1);
+   a->num_bits = num_bits;
+   a->zbuffer = (stbi_uc *) in;
+   a->zout = zout;
+   return result;
+}
+
 static int stbi__parse_huffman_block(stbi__zbuf *a)
 {
    char *zout = a->zout;
    for(;;) {
-      int z = stbi__zhuffman_decode(a, &a->z_length);
+      int z;
+      if (a->zbuffer_end - a->zbuffer >= 8 && a->zout_end - zout >= STBI__ZFAST_ROOM) {
+         a->zout = zout;
+         z = stbi__parse_huffman_fast(a);
+         if (z != 2) return z;
+         zout = a->zout;
+      }
+      z = stbi__zhuffman_decode(a, &a->z_length);
       if (z < 256) {
          if (z < 0) return stbi__err("bad huffman code","Corrupt PNG"); // error in huffman codes
          if (zout >= a->zout_end) {
@@ -4257,10 +4851,11 @@ static int stbi__parse_huffman_block(stbi__zbuf *a)
             return 1;
          }
          z -= 257;
+         if (z >= 29) return stbi__err("bad huffman code","Corrupt PNG"); // 286 and 287 are unused
          len = stbi__zlength_base[z];
          if (stbi__zlength_extra[z]) len += stbi__zreceive(a, stbi__zlength_extra[z]);
          z = stbi__zhuffman_decode(a, &a->z_distance);
-         if (z < 0) return stbi__err("bad huffman code","Corrupt PNG");
+         if (z < 0 || z >= 30) return stbi__err("bad huffman code","Corrupt PNG"); // 30 and 31 are unused
          dist = stbi__zdist_base[z];
          if (stbi__zdist_extra[z]) dist += stbi__zreceive(a, stbi__zdist_extra[z]);
          if (zout - a->zout_start < dist) return stbi__err("bad dist","Corrupt PNG");
@@ -4270,8 +4865,8 @@ static int stbi__parse_huffman_block(stbi__zbuf *a)
          }
          p = (stbi_uc *) (zout - dist);
          if (dist == 1) { // run of one byte; common in images.
-            stbi_uc v = *p;
-            if (len) { do *zout++ = v; while (--len); }
+            memset(zout, *p, len);
+            zout += len;
          } else {
             if (len) { do *zout++ = *p++; while (--len); }
          }
@@ -4326,6 +4921,7 @@ static int stbi__compute_huffman_codes(stbi__zbuf *a)
    if (n != ntot) return stbi__err("bad codelengths","Corrupt PNG");
    if (!stbi__zbuild_huffman(&a->z_length, lencodes, hlit)) return 0;
    if (!stbi__zbuild_huffman(&a->z_distance, lencodes+hlit, hdist)) return 0;
+   stbi__zbuild_fast(a, lencodes, hlit);
    return 1;
 }
 
@@ -4337,12 +4933,16 @@ static int stbi__parse_uncompressed_block(stbi__zbuf *a)
       stbi__zreceive(a, a->num_bits & 7); // discard
    // drain the bit-packed data into header
    k = 0;
-   while (a->num_bits > 0) {
+   while (a->num_bits > 0 && k < 4) {
       header[k++] = (stbi_uc) (a->code_buffer & 255); // suppress MSVC run-time check
       a->code_buffer >>= 8;
       a->num_bits -= 8;
    }
    if (a->num_bits < 0) return stbi__err("zlib corrupt","Corrupt PNG");
+   // more than 32 bits only come from stbi__zrefill, which takes real input bytes: give them back
+   a->zbuffer -= a->num_bits >> 3;
+   a->code_buffer = 0;
+   a->num_bits = 0;
    // now fill header the normal way
    while (k < 4)
       header[k++] = stbi__zget8(a);
@@ -4420,6 +5020,7 @@ static int stbi__parse_zlib(stbi__zbuf *a, int parse_header)
             // use fixed code lengths
             if (!stbi__zbuild_huffman(&a->z_length  , stbi__zdefault_length  , STBI__ZNSYMS)) return 0;
             if (!stbi__zbuild_huffman(&a->z_distance, stbi__zdefault_distance,  32)) return 0;
+            stbi__zbuild_fast(a, stbi__zdefault_length, STBI__ZNSYMS);
          } else {
             if (!stbi__compute_huffman_codes(a)) return 0;
          }
@@ -4588,6 +5189,78 @@ static int stbi__paeth(int a, int b, int c)
    return c;
 }
 
+#ifdef STBI_SSE2
+// the filters that add the pixel to the left, for 8-bit pixels of 3 or 4 bytes: the byte loops in
+// stbi__create_png_image_raw wait on a byte one pixel back, here a whole pixel goes at once in 16-bit lanes.
+// cur, raw and prior point at the second pixel of the row; n pixels follow. 3 byte pixels but the last
+// are moved as 4 bytes too, the extra byte is the next pixel's and written again with it
+stbi_inline static __m128i stbi__png_load_sse2(const stbi_uc *p, int size)
+{
+   int v;
+   if (size == 4) memcpy(&v, p, 4); else v = p[0] | (p[1] << 8) | (p[2] << 16);
+   return _mm_unpacklo_epi8(_mm_cvtsi32_si128(v), _mm_setzero_si128());
+}
+
+stbi_inline static void stbi__png_store_sse2(stbi_uc *p, __m128i x, int size)
+{
+   int v = _mm_cvtsi128_si32(_mm_packus_epi16(x, x));
+   if (size == 4) memcpy(p, &v, 4);
+   else {
+      p[0] = (stbi_uc) v;
+      p[1] = (stbi_uc) (v >> 8);
+      p[2] = (stbi_uc) (v >> 16);
+   }
+}
+
+static void stbi__unfilter_sse2(stbi_uc *cur, const stbi_uc *raw, const stbi_uc *prior, int n, int filter, int bpp)
+{
+   __m128i mask = _mm_set1_epi16(255);
+   __m128i a = stbi__png_load_sse2(cur - bpp, bpp);
+   int i, wide = bpp == 4 ? n : n - 1;
+   switch (filter) {
+      case STBI__F_sub:
+      case STBI__F_paeth_first: // with b = c = 0 paeth always picks a
+         for (i=0; i < n; ++i, cur += bpp, raw += bpp) {
+            int size = i < wide ? 4 : 3;
+            a = _mm_and_si128(_mm_add_epi16(stbi__png_load_sse2(raw, size), a), mask);
+            stbi__png_store_sse2(cur, a, size);
+         }
+         break;
+      case STBI__F_avg:
+      case STBI__F_avg_first:
+         for (i=0; i < n; ++i, cur += bpp, raw += bpp, prior += bpp) {
+            int size = i < wide ? 4 : 3;
+            __m128i b = filter == STBI__F_avg ? stbi__png_load_sse2(prior, size) : _mm_setzero_si128();
+            __m128i avg = _mm_srli_epi16(_mm_add_epi16(a, b), 1);
+            a = _mm_and_si128(_mm_add_epi16(stbi__png_load_sse2(raw, size), avg), mask);
+            stbi__png_store_sse2(cur, a, size);
+         }
+         break;
+      case STBI__F_paeth: {
+         __m128i c = stbi__png_load_sse2(prior - bpp, bpp);
+         for (i=0; i < n; ++i, cur += bpp, raw += bpp, prior += bpp) {
+            int size = i < wide ? 4 : 3;
+            __m128i b = stbi__png_load_sse2(prior, size);
+            // p = a + b - c, so p - a = b - c, p - b = a - c and p - c = (b - c) + (a - c)
+            __m128i bc = _mm_sub_epi16(b, c), ac = _mm_sub_epi16(a, c), abc = _mm_add_epi16(bc, ac);
+            __m128i pa = _mm_max_epi16(bc, _mm_sub_epi16(_mm_setzero_si128(), bc));
+            __m128i pb = _mm_max_epi16(ac, _mm_sub_epi16(_mm_setzero_si128(), ac));
+            __m128i pc = _mm_max_epi16(abc, _mm_sub_epi16(_mm_setzero_si128(), abc));
+            // b unless c is strictly closer, then a unless that is strictly farther than both
+            __m128i to_c = _mm_cmpgt_epi16(pb, pc);
+            __m128i pred = _mm_or_si128(_mm_and_si128(to_c, c), _mm_andnot_si128(to_c, b));
+            __m128i not_a = _mm_cmpgt_epi16(pa, _mm_min_epi16(pb, pc));
+            pred = _mm_or_si128(_mm_and_si128(not_a, pred), _mm_andnot_si128(not_a, a));
+            a = _mm_and_si128(_mm_add_epi16(stbi__png_load_sse2(raw, size), pred), mask);
+            stbi__png_store_sse2(cur, a, size);
+            c = b;
+         }
+         break;
+      }
+   }
+}
+#endif
+
 static const stbi_uc stbi__depth_scale_table[9] = { 0, 0xff, 0x55, 0, 0x11, 0,0,0, 0x01 };
 
 // create the png data from post-deflated data
@@ -4603,6 +5276,9 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
    int output_bytes = out_n*bytes;
    int filter_bytes = img_n*bytes;
    int width = x;
+#ifdef STBI_SSE2
+   int sse2 = stbi__sse2_available();
+#endif
 
    STBI_ASSERT(out_n == s->img_n || out_n == s->img_n+1);
    a->out = (stbi_uc *) stbi__malloc_mad3(x, y, output_bytes, 0); // extra bytes to write off the end into
@@ -4675,6 +5351,11 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
          #define STBI__CASE(f) \
              case f:     \
                 for (k=0; k < nk; ++k)
+#ifdef STBI_SSE2
+         if (sse2 && depth == 8 && filter_bytes >= 3 && filter != STBI__F_none && filter != STBI__F_up)
+            stbi__unfilter_sse2(cur, raw, prior, width - 1, filter, filter_bytes);
+         else
+#endif
          switch (filter) {
             // "none" filter turns into a memcpy here; make that explicit.
             case STBI__F_none:         memcpy(cur, raw, nk); break;
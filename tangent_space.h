@@ -0,0 +1,239 @@
+#ifndef TANGENT_SPACE_H
+#define TANGENT_SPACE_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "parallel.h"
+
+// per-vertex tangent frames in the spirit of MikkTSpace:
+// every triangle contributes a unit tangent/bitangent weighted by its corner angle,
+// the sum is Gram-Schmidt orthogonalised against the vertex normal and the bitangent
+// is reduced to a sign in tangent.w (bitangent = cross(normal, tangent.xyz) * tangent.w)
+
+// where each attribute lives inside an interleaved float vertex, in floats
+struct TangentLayout {
+    int stride;
+    int position; // vec3
+    int normal;   // vec3
+    int uv;       // vec2
+    int tangent;  // vec4 written by generateTangents
+};
+
+// triangles whose uv area is below this contribute nothing instead of dividing by ~0
+const float TANGENT_UV_EPSILON = 1e-20f;
+
+// triangles handed to one thread at a time; smaller meshes stay single threaded
+const size_t TANGENT_GRAIN = 16384;
+
+// +1 if the uv mapping keeps the triangle's winding, -1 if it is mirrored
+// degenerate mappings count as +1 so they weld with their neighbours
+inline int uvWindingSign(glm::vec2 uv0, glm::vec2 uv1, glm::vec2 uv2)
+{
+    glm::vec2 deltaUV1 = uv1 - uv0;
+    glm::vec2 deltaUV2 = uv2 - uv0;
+    return deltaUV1.x * deltaUV2.y - deltaUV1.y * deltaUV2.x < 0.0f ? -1 : 1;
+}
+
+// per-triangle results, one array per component
+struct TriangleFrames {
+    std::vector<float> tx, ty, tz; // unit tangent
+    std::vector<float> bx, by, bz; // unit bitangent
+    std::vector<float> angle;      // 3 per triangle, 0 when the uv mapping is degenerate
+};
+
+// any unit vector perpendicular to n, for vertices whose triangles carry no tangent
+inline glm::vec3 anyPerpendicular(glm::vec3 n)
+{
+    if (glm::dot(n, n) < 1e-12f)
+        return glm::vec3(1.0f, 0.0f, 0.0f);
+    glm::vec3 axis = std::fabs(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    return glm::normalize(axis - n * glm::dot(n, axis));
+}
+
+inline float cornerAngle(glm::vec3 a, glm::vec3 b)
+{
+    float lengths = glm::length(a) * glm::length(b);
+    if (lengths <= 0.0f)
+        return 0.0f;
+    float cosine = glm::dot(a, b) / lengths;
+    return std::acos(glm::clamp(cosine, -1.0f, 1.0f));
+}
+
+// unit tangent and bitangent of one triangle plus its three corner angles (the vertex weights)
+// returns false, with everything zero, when the uv mapping is degenerate
+inline bool triangleTangentFrame(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec2 uv0, glm::vec2 uv1, glm::vec2 uv2,
+    glm::vec3& tangent, glm::vec3& bitangent, float angles[3])
+{
+    glm::vec3 deltaPos1 = p1 - p0;
+    glm::vec3 deltaPos2 = p2 - p0;
+    glm::vec2 deltaUV1 = uv1 - uv0;
+    glm::vec2 deltaUV2 = uv2 - uv0;
+    float det = deltaUV1.x * deltaUV2.y - deltaUV1.y * deltaUV2.x;
+
+    tangent = glm::vec3(0.0f);
+    bitangent = glm::vec3(0.0f);
+    bool valid = std::fabs(det) > TANGENT_UV_EPSILON;
+    if (valid) {
+        // the 1/det scale cancels out once normalised, only its sign matters
+        float sign = det < 0.0f ? -1.0f : 1.0f;
+        tangent = (deltaPos1 * deltaUV2.y - deltaPos2 * deltaUV1.y) * sign;
+        bitangent = (deltaPos2 * deltaUV1.x - deltaPos1 * deltaUV2.x) * sign;
+        float tangentLength = glm::length(tangent);
+        float bitangentLength = glm::length(bitangent);
+        valid = tangentLength > 0.0f && bitangentLength > 0.0f;
+        if (valid) {
+            tangent /= tangentLength;
+            bitangent /= bitangentLength;
+        } else {
+            tangent = glm::vec3(0.0f);
+            bitangent = glm::vec3(0.0f);
+        }
+    }
+
+    angles[0] = valid ? cornerAngle(deltaPos1, deltaPos2) : 0.0f;
+    angles[1] = valid ? cornerAngle(p2 - p1, p0 - p1) : 0.0f;
+    angles[2] = valid ? cornerAngle(p0 - p2, p1 - p2) : 0.0f;
+    return valid;
+}
+
+// turns a vertex's weighted tangent and bitangent sums into tangent.xyz + handedness
+inline glm::vec4 finishTangent(glm::vec3 normal, glm::vec3 tangent, glm::vec3 bitangent)
+{
+    float normalLength = glm::length(normal);
+    if (normalLength > 0.0f)
+        normal /= normalLength;
+
+    // Gram-Schmidt against the normal
+    tangent -= normal * glm::dot(normal, tangent);
+    float tangentLength = glm::length(tangent);
+    if (tangentLength > 1e-6f)
+        tangent /= tangentLength;
+    else
+        tangent = anyPerpendicular(normal);
+
+    float handedness = glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+    return glm::vec4(tangent, handedness);
+}
+
+// pass 1: tangent, bitangent and corner angles of triangles [begin, end)
+struct TriangleFrameKernel {
+    const float* vertices;
+    const unsigned int* indices;
+    TangentLayout layout;
+    TriangleFrames* frames;
+
+    glm::vec3 vec3At(unsigned int vertex, int offset) const
+    {
+        const float* v = vertices + (size_t)vertex * layout.stride + offset;
+        return glm::vec3(v[0], v[1], v[2]);
+    }
+
+    glm::vec2 vec2At(unsigned int vertex, int offset) const
+    {
+        const float* v = vertices + (size_t)vertex * layout.stride + offset;
+        return glm::vec2(v[0], v[1]);
+    }
+
+    void operator()(size_t begin, size_t end) const
+    {
+        for (size_t t = begin; t < end; t++) {
+            const unsigned int* corner = indices + t * 3;
+            glm::vec3 p0 = vec3At(corner[0], layout.position);
+            glm::vec3 p1 = vec3At(corner[1], layout.position);
+            glm::vec3 p2 = vec3At(corner[2], layout.position);
+            glm::vec2 uv0 = vec2At(corner[0], layout.uv);
+            glm::vec2 uv1 = vec2At(corner[1], layout.uv);
+            glm::vec2 uv2 = vec2At(corner[2], layout.uv);
+
+            glm::vec3 tangent, bitangent;
+            triangleTangentFrame(p0, p1, p2, uv0, uv1, uv2, tangent, bitangent, &frames->angle[t * 3]);
+            frames->tx[t] = tangent.x;
+            frames->ty[t] = tangent.y;
+            frames->tz[t] = tangent.z;
+            frames->bx[t] = bitangent.x;
+            frames->by[t] = bitangent.y;
+            frames->bz[t] = bitangent.z;
+        }
+    }
+};
+
+// pass 2: gathers the triangles around vertices [begin, end) and writes tangent.xyzw
+struct VertexTangentKernel {
+    float* vertices;
+    TangentLayout layout;
+    const TriangleFrames* frames;
+    const unsigned int* firstCorner; // vertexCount + 1 offsets into corners
+    const unsigned int* corners;     // corner ids (triangle * 3 + k) grouped by vertex
+
+    void operator()(size_t begin, size_t end) const
+    {
+        for (size_t v = begin; v < end; v++) {
+            glm::vec3 tangent(0.0f);
+            glm::vec3 bitangent(0.0f);
+            for (unsigned int i = firstCorner[v]; i < firstCorner[v + 1]; i++) {
+                unsigned int corner = corners[i];
+                unsigned int t = corner / 3;
+                float weight = frames->angle[corner];
+                tangent += weight * glm::vec3(frames->tx[t], frames->ty[t], frames->tz[t]);
+                bitangent += weight * glm::vec3(frames->bx[t], frames->by[t], frames->bz[t]);
+            }
+
+            float* vertex = vertices + v * layout.stride;
+            glm::vec3 normal(vertex[layout.normal], vertex[layout.normal + 1], vertex[layout.normal + 2]);
+            glm::vec4 frame = finishTangent(normal, tangent, bitangent);
+            vertex[layout.tangent + 0] = frame.x;
+            vertex[layout.tangent + 1] = frame.y;
+            vertex[layout.tangent + 2] = frame.z;
+            vertex[layout.tangent + 3] = frame.w;
+        }
+    }
+};
+
+// fills the tangent vec4 of every vertex of an indexed triangle list
+// vertices must already be welded; seams in the uv mapping (including mirrored halves)
+// have to be separate vertices or their tangents get averaged together
+inline void generateTangents(float* vertices, size_t vertexCount, const TangentLayout& layout,
+    const unsigned int* indices, size_t indexCount)
+{
+    size_t triangleCount = indexCount / 3;
+
+    TriangleFrames frames;
+    frames.tx.resize(triangleCount);
+    frames.ty.resize(triangleCount);
+    frames.tz.resize(triangleCount);
+    frames.bx.resize(triangleCount);
+    frames.by.resize(triangleCount);
+    frames.bz.resize(triangleCount);
+    frames.angle.resize(triangleCount * 3);
+
+    TriangleFrameKernel triangleKernel;
+    triangleKernel.vertices = vertices;
+    triangleKernel.indices = indices;
+    triangleKernel.layout = layout;
+    triangleKernel.frames = &frames;
+    parallelFor(triangleCount, TANGENT_GRAIN, triangleKernel);
+
+    // vertex -> corner adjacency, built serially with a counting sort
+    std::vector<unsigned int> firstCorner(vertexCount + 1, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        firstCorner[indices[i] + 1]++;
+    for (size_t v = 0; v < vertexCount; v++)
+        firstCorner[v + 1] += firstCorner[v];
+    std::vector<unsigned int> corners(triangleCount * 3);
+    std::vector<unsigned int> fill(firstCorner.begin(), firstCorner.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        corners[fill[indices[i]]++] = static_cast<unsigned int>(i);
+
+    VertexTangentKernel vertexKernel;
+    vertexKernel.vertices = vertices;
+    vertexKernel.layout = layout;
+    vertexKernel.frames = &frames;
+    vertexKernel.firstCorner = firstCorner.data();
+    vertexKernel.corners = corners.data();
+    parallelFor(vertexCount, TANGENT_GRAIN, vertexKernel);
+}
+#endif
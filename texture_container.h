@@ -0,0 +1,383 @@
+#ifndef TEXTURE_CONTAINER_H
+#define TEXTURE_CONTAINER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "block_compression.h"
+#include "mapped_file.h"
+#include "mesh_cache.h"
+#include "parallel.h"
+#include "stb_image.h"
+
+// an image and its whole mip chain, built once from the source file and memory-mapped from
+// "<image>.texcache" afterwards, so starting up costs a read instead of a decode plus glGenerateMipmap.
+// Color mips are averaged in linear space (the sources are sRGB), normal map mips are averaged as
+// vectors and renormalized. Every level is then block compressed when the context samples the format
+// (see textureBlockFormat); otherwise rows are tightly packed, upload with GL_UNPACK_ALIGNMENT 1.
+
+// binary file layout: TextureContainerHeader, TextureLevel[levelCount], then the levels largest first,
+// each starting on a TEXTURE_CONTAINER_ALIGNMENT boundary of the data section
+const unsigned int TEXTURE_CONTAINER_MAGIC = 0x58455454; // "TTEX"
+const unsigned int TEXTURE_CONTAINER_FORMAT = 2;
+// bump whenever buildMipChain changes what ends up in the levels
+const unsigned int TEXTURE_MIP_BUILDER_VERSION = 1;
+const size_t TEXTURE_CONTAINER_ALIGNMENT = 16;
+// opaque color maps; BLOCK_BC1 halves them again at visibly lower quality (block_compression_bench),
+// BLOCK_NONE leaves them uncompressed. Translucent color is BC3 and normal maps BC5 either way
+const BlockFormat TEXTURE_COLOR_BLOCK_FORMAT = BLOCK_BC7;
+
+enum TextureContent {
+    TEXTURE_COLOR,     // sRGB color, alpha (if any) linear
+    TEXTURE_NORMAL_MAP // tangent space vectors in rgb
+};
+
+struct TextureContainerHeader {
+    unsigned int magic;
+    unsigned int format;
+    unsigned int builderVersion;
+    unsigned int content;
+    unsigned long long sourceHash; // image file bytes, flip and content
+    unsigned int width;
+    unsigned int height;
+    unsigned int channels;    // of the source image
+    unsigned int blockFormat; // BLOCK_NONE: levels of width x height x channels bytes
+    unsigned int levelCount;
+    unsigned long long dataSize;
+};
+
+struct TextureLevel {
+    unsigned int width;
+    unsigned int height;
+    unsigned long long offset; // into the data section
+    unsigned long long size;
+};
+
+// 1x1 is the last level
+inline unsigned int mipLevelCount(unsigned int width, unsigned int height)
+{
+    unsigned int levels = 1;
+    while (width > 1 || height > 1) {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        levels++;
+    }
+    return levels;
+}
+
+inline float srgbToLinear(float c)
+{
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+inline float linearToSrgb(float c)
+{
+    return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+}
+
+inline unsigned char unitToByte(float c)
+{
+    return (unsigned char)(glm::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+// every level of pixels (width x height x channels bytes) into levels and data, level 0 a copy of pixels
+inline void buildMipChain(const unsigned char* pixels, unsigned int width, unsigned int height, unsigned int channels,
+    TextureContent content, std::vector<TextureLevel>& levels, std::vector<unsigned char>& data)
+{
+    unsigned int levelCount = mipLevelCount(width, height);
+    levels.resize(levelCount);
+    unsigned long long offset = 0;
+    unsigned int w = width, h = height;
+    for (unsigned int i = 0; i < levelCount; i++) {
+        levels[i].width = w;
+        levels[i].height = h;
+        levels[i].offset = offset;
+        levels[i].size = (unsigned long long)w * h * channels;
+        offset += (levels[i].size + TEXTURE_CONTAINER_ALIGNMENT - 1) / TEXTURE_CONTAINER_ALIGNMENT * TEXTURE_CONTAINER_ALIGNMENT;
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+    }
+    data.assign((size_t)offset, 0);
+    std::memcpy(data.data(), pixels, (size_t)levels[0].size);
+
+    // channels that are averaged as sRGB: gray or rgb, never alpha
+    unsigned int colorChannels = channels >= 3 ? 3 : 1;
+    float toLinear[256];
+    for (int i = 0; i < 256; i++)
+        toLinear[i] = content == TEXTURE_NORMAL_MAP ? i / 255.0f * 2.0f - 1.0f : srgbToLinear(i / 255.0f);
+
+    // every level is filtered from the float copy of the one above, so rounding does not add up down the chain
+    std::vector<float> current((size_t)width * height * channels);
+    for (size_t i = 0; i < current.size(); i++) {
+        bool color = i % channels < colorChannels;
+        current[i] = color ? toLinear[pixels[i]] : pixels[i] / 255.0f;
+    }
+    std::vector<float> next;
+    for (unsigned int level = 1; level < levelCount; level++) {
+        unsigned int sw = levels[level - 1].width, sh = levels[level - 1].height;
+        unsigned int dw = levels[level].width, dh = levels[level].height;
+        next.assign((size_t)dw * dh * channels, 0.0f);
+        unsigned char* out = data.data() + levels[level].offset;
+        for (unsigned int y = 0; y < dh; y++) {
+            // a 1 texel dimension is not halved, its footprint repeats the texel
+            unsigned int y0 = sh > 1 ? y * 2 : y, y1 = sh > 1 ? y * 2 + 1 : y;
+            for (unsigned int x = 0; x < dw; x++) {
+                unsigned int x0 = sw > 1 ? x * 2 : x, x1 = sw > 1 ? x * 2 + 1 : x;
+                const float* a = &current[((size_t)y0 * sw + x0) * channels];
+                const float* b = &current[((size_t)y0 * sw + x1) * channels];
+                const float* c = &current[((size_t)y1 * sw + x0) * channels];
+                const float* d = &current[((size_t)y1 * sw + x1) * channels];
+                float* texel = &next[((size_t)y * dw + x) * channels];
+                for (unsigned int k = 0; k < channels; k++)
+                    texel[k] = (a[k] + b[k] + c[k] + d[k]) * 0.25f;
+
+                unsigned char* encoded = out + ((size_t)y * dw + x) * channels;
+                if (content == TEXTURE_NORMAL_MAP && channels >= 3) {
+                    glm::vec3 n(texel[0], texel[1], texel[2]);
+                    float length = glm::length(n);
+                    // opposite normals cancel out, fall back to the surface normal
+                    n = length > 1e-6f ? n / length : glm::vec3(0.0f, 0.0f, 1.0f);
+                    for (int k = 0; k < 3; k++) {
+                        texel[k] = n[k];
+                        encoded[k] = unitToByte(n[k] * 0.5f + 0.5f);
+                    }
+                } else {
+                    for (unsigned int k = 0; k < colorChannels; k++)
+                        encoded[k] = unitToByte(content == TEXTURE_NORMAL_MAP ? texel[k] * 0.5f + 0.5f : linearToSrgb(texel[k]));
+                }
+                for (unsigned int k = colorChannels; k < channels; k++)
+                    encoded[k] = unitToByte(texel[k]);
+            }
+        }
+        current.swap(next);
+    }
+}
+
+// the block format levels are stored in, BLOCK_NONE when the current context cannot sample any that fits
+inline BlockFormat textureBlockFormat(TextureContent content, bool translucent)
+{
+    BlockFormat format = content == TEXTURE_NORMAL_MAP ? BLOCK_BC5 : translucent ? BLOCK_BC3 : TEXTURE_COLOR_BLOCK_FORMAT;
+    if (format == BLOCK_BC7 && !blockFormatSupported(BLOCK_BC7))
+        format = BLOCK_BC1;
+    return blockFormatSupported(format) ? format : BLOCK_NONE;
+}
+
+// everything besides the image that decides how its container is encoded, for the source hash
+inline unsigned int textureEncodingKey(TextureContent content)
+{
+    return BLOCK_ENCODER_VERSION << 8 | textureBlockFormat(content, false) << 4 | textureBlockFormat(content, true);
+}
+
+// replaces levels of channels bytes a texel by their blocks
+inline void compressMipChain(unsigned int channels, BlockFormat format, std::vector<TextureLevel>& levels,
+    std::vector<unsigned char>& data)
+{
+    std::vector<TextureLevel> blockLevels(levels);
+    unsigned long long offset = 0;
+    for (size_t i = 0; i < blockLevels.size(); i++) {
+        blockLevels[i].offset = offset;
+        blockLevels[i].size = compressedSize(format, blockLevels[i].width, blockLevels[i].height);
+        offset += (blockLevels[i].size + TEXTURE_CONTAINER_ALIGNMENT - 1) / TEXTURE_CONTAINER_ALIGNMENT * TEXTURE_CONTAINER_ALIGNMENT;
+    }
+    std::vector<unsigned char> blocks((size_t)offset, 0);
+    for (size_t i = 0; i < levels.size(); i++)
+        compressImage(data.data() + levels[i].offset, levels[i].width, levels[i].height, channels, format,
+            blocks.data() + blockLevels[i].offset);
+    levels.swap(blockLevels);
+    data.swap(blocks);
+}
+
+// writes a container to a temporary first so a crash never leaves a half-written one behind;
+// the temporary is per thread, loader workers may build the same image at once
+inline bool writeTextureContainer(const std::string& containerPath, const TextureContainerHeader& header,
+    const std::vector<TextureLevel>& levels, const std::vector<unsigned char>& data)
+{
+    std::string tempPath = containerPath + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream file(tempPath.c_str(), std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(levels.data()), sizeof(TextureLevel) * levels.size());
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        if (!file)
+            return false;
+    }
+    std::remove(containerPath.c_str());
+    return std::rename(tempPath.c_str(), containerPath.c_str()) == 0;
+}
+
+// a container read from disk (level data points into the mapping) or kept in memory
+class TextureContainer
+{
+public:
+    TextureContainer() : header(NULL), levelTable(NULL), levelData(NULL) {}
+
+    // maps containerPath and checks it against the builder that wrote it and the source hash
+    bool open(const std::string& containerPath, unsigned long long sourceHash)
+    {
+        close();
+        if (!file.open(containerPath.c_str()) || file.size() < sizeof(TextureContainerHeader))
+            return false;
+        const TextureContainerHeader* candidate = reinterpret_cast<const TextureContainerHeader*>(file.data());
+        bool valid = candidate->magic == TEXTURE_CONTAINER_MAGIC &&
+            candidate->format == TEXTURE_CONTAINER_FORMAT &&
+            candidate->builderVersion == TEXTURE_MIP_BUILDER_VERSION &&
+            candidate->sourceHash == sourceHash &&
+            candidate->blockFormat <= BLOCK_BC7 &&
+            candidate->levelCount == mipLevelCount(candidate->width, candidate->height) &&
+            file.size() == sizeof(TextureContainerHeader) + sizeof(TextureLevel) * candidate->levelCount + candidate->dataSize;
+        if (!valid) {
+            file.close();
+            return false;
+        }
+        header = candidate;
+        levelTable = reinterpret_cast<const TextureLevel*>(file.data() + sizeof(TextureContainerHeader));
+        levelData = reinterpret_cast<const unsigned char*>(levelTable + header->levelCount);
+        return true;
+    }
+
+    // keeps an in-memory copy when the container could not be written
+    void adopt(const TextureContainerHeader& built, const std::vector<TextureLevel>& levels, std::vector<unsigned char>& data)
+    {
+        close();
+        fallbackHeader = built;
+        fallbackLevels = levels;
+        fallbackData.swap(data);
+        header = &fallbackHeader;
+        levelTable = fallbackLevels.data();
+        levelData = fallbackData.data();
+    }
+
+    void close()
+    {
+        file.close();
+        header = NULL;
+        levelTable = NULL;
+        levelData = NULL;
+        fallbackLevels.clear();
+        fallbackData.clear();
+    }
+
+    bool isOpen() const { return header != NULL; }
+    unsigned int width() const { return header->width; }
+    unsigned int height() const { return header->height; }
+    unsigned int channels() const { return header->channels; }
+    BlockFormat blockFormat() const { return (BlockFormat)header->blockFormat; }
+    unsigned int levelCount() const { return header->levelCount; }
+    const TextureLevel& level(unsigned int i) const { return levelTable[i]; }
+    // every level, back to back as in the file
+    const unsigned char* data() const { return levelData; }
+    size_t dataSize() const { return (size_t)header->dataSize; }
+    // hash of the image bytes, flip, content and builder the container was made from
+    unsigned long long sourceHash() const { return header->sourceHash; }
+
+private:
+    TextureContainer(const TextureContainer&);
+    TextureContainer& operator=(const TextureContainer&);
+
+    MappedFile file;
+    const TextureContainerHeader* header;
+    const TextureLevel* levelTable;
+    const unsigned char* levelData;
+    TextureContainerHeader fallbackHeader;
+    std::vector<TextureLevel> fallbackLevels;
+    std::vector<unsigned char> fallbackData;
+};
+
+// loads imagePath through "<imagePath>.texcache", rebuilding the container when the image, flip,
+// content, mip builder or block encoding changed; safe on worker threads (flips with the per-thread
+// stb_image flag). Needs glad loaded to pick a block format, without it levels stay uncompressed
+inline bool loadTextureContainer(const std::string& imagePath, bool flip, TextureContent content,
+    TextureContainer& out, std::string* error)
+{
+    MappedFile image;
+    if (!image.open(imagePath.c_str())) {
+        if (error)
+            *error = "cannot open " + imagePath;
+        return false;
+    }
+    unsigned long long seed = (unsigned long long)TEXTURE_MIP_BUILDER_VERSION << 32 |
+        (unsigned long long)textureEncodingKey(content) << 8 | (unsigned int)content << 1 | flip;
+    unsigned long long sourceHash = hashBytes(image.data(), image.size(), seed);
+    std::string containerPath = imagePath + ".texcache";
+    if (out.open(containerPath, sourceHash))
+        return true;
+
+    // cache miss: decode the mapping we already hold
+    int width, height, channels;
+    stbi_set_flip_vertically_on_load_thread(flip);
+    unsigned char* pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(image.data()), (int)image.size(),
+        &width, &height, &channels, 0);
+    if (!pixels) {
+        if (error)
+            *error = stbi_failure_reason();
+        return false;
+    }
+    std::vector<TextureLevel> levels;
+    std::vector<unsigned char> data;
+    buildMipChain(pixels, width, height, channels, content, levels, data);
+    BlockFormat blockFormat = textureBlockFormat(content, hasTranslucency(pixels, (size_t)width * height, channels));
+    stbi_image_free(pixels);
+    if (blockFormat != BLOCK_NONE)
+        compressMipChain(channels, blockFormat, levels, data);
+
+    TextureContainerHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = TEXTURE_CONTAINER_MAGIC;
+    header.format = TEXTURE_CONTAINER_FORMAT;
+    header.builderVersion = TEXTURE_MIP_BUILDER_VERSION;
+    header.content = content;
+    header.sourceHash = sourceHash;
+    header.width = width;
+    header.height = height;
+    header.channels = channels;
+    header.blockFormat = blockFormat;
+    header.levelCount = (unsigned int)levels.size();
+    header.dataSize = data.size();
+    if (writeTextureContainer(containerPath, header, levels, data) && out.open(containerPath, sourceHash))
+        return true;
+    out.adopt(header, levels, data);
+    return true;
+}
+
+// parallelFor body of loadTextureContainers, one image per item
+struct TextureContainerBatch {
+    const std::string* paths;
+    bool flip;
+    TextureContent content;
+    TextureContainer* out;
+    std::string* errors;
+    char* loaded;
+
+    void operator()(size_t begin, size_t end) const
+    {
+        for (size_t i = begin; i < end; i++)
+            loaded[i] = loadTextureContainer(paths[i], flip, content, out[i], errors ? &errors[i] : NULL);
+    }
+};
+
+// loadTextureContainer for count images at once, spread over the hardware threads; out[i] (and errors[i]
+// when errors is not NULL) belong to paths[i]. Returns how many loaded. The flip is per thread, so
+// loading on other threads at the same time is fine
+inline size_t loadTextureContainers(const std::string* paths, size_t count, bool flip, TextureContent content,
+    TextureContainer* out, std::string* errors)
+{
+    std::vector<char> loaded(count, 0);
+    TextureContainerBatch batch = { paths, flip, content, out, errors, loaded.data() };
+    parallelFor(count, 1, batch);
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++)
+        total += loaded[i] ? 1 : 0;
+    return total;
+}
+#endif
@@ -626,6 +626,21 @@ namespace tinyobj {
         MaterialReader* readMatFn = NULL, bool triangulate = true,
         bool default_vcols_fallback = true);
 
+    /// Loads .obj from an in-memory buffer(e.g. a memory-mapped file) on
+    /// `num_threads` worker threads(0 = one per hardware thread).
+    /// The buffer is split on newline boundaries; each chunk parses its
+    /// `v`/`vn`/`vt`/`f` records independently and the chunks are merged in
+    /// file order, rebasing relative(negative) indices onto the global arrays.
+    /// `o`/`g`/`usemtl`/`mtllib`/`s` are honoured at merge time.
+    /// Lines(`l`), points(`p`), tags(`t`) and skin weights(`vw`) are skipped
+    /// with a warning.
+    /// Returns true when loading .obj become success.
+    bool LoadObjParallel(attrib_t* attrib, std::vector<shape_t>* shapes,
+        std::vector<material_t>* materials, std::string* warn,
+        std::string* err, const char* buffer, size_t buffer_size,
+        MaterialReader* readMatFn = NULL, unsigned int num_threads = 0,
+        bool triangulate = true);
+
     /// Loads materials into std::map
     void LoadMtl(std::map<std::string, int>* material_map,
         std::vector<material_t>* materials, std::istream* inStream,
@@ -651,16 +666,36 @@ namespace tinyobj {
 #ifdef TINYOBJLOADER_IMPLEMENTATION
 #include <cassert>
 #include <cctype>
+#include <clocale>
 #include <cmath>
 #include <cstddef>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <limits>
+#include <locale>
 #include <set>
 #include <sstream>
+#include <thread>
 #include <utility>
 
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>  // _umul128, _BitScanForward64
+#endif
+
+// Line/token scanner instruction set. Define TINYOBJLOADER_NO_SIMD to force
+// the portable SWAR path.
+#if !defined(TINYOBJLOADER_NO_SIMD)
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TINYOBJ_SCAN_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TINYOBJ_SCAN_SSE2
+#endif
+#endif
+
 #ifdef TINYOBJLOADER_USE_MAPBOX_EARCUT
 
 #ifdef TINYOBJLOADER_DONOT_INCLUDE_MAPBOX_EARCUT
@@ -796,6 +831,239 @@ namespace tinyobj {
   (static_cast<unsigned int>((x) - '0') < static_cast<unsigned int>(10))
 #define IS_NEW_LINE(x) (((x) == '\r') || ((x) == '\n') || ((x) == '\0'))
 
+    static inline unsigned int trailingZeros64(unsigned long long x) {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned int>(__builtin_ctzll(x));
+#elif defined(_MSC_VER) && defined(_M_X64)
+        unsigned long i;
+        _BitScanForward64(&i, x);
+        return static_cast<unsigned int>(i);
+#else
+        unsigned int n = 0;
+        while (!(x & 1ull)) {
+            x >>= 1;
+            n++;
+        }
+        return n;
+#endif
+    }
+
+    // Byte classes of one 64-byte block; bit i describes byte i.
+    struct scan_masks_t {
+        unsigned long long cr;     // '\r'
+        unsigned long long lf;     // '\n'
+        unsigned long long blank;  // ' ' and '\t'
+    };
+
+#if !defined(TINYOBJ_SCAN_AVX2) && !defined(TINYOBJ_SCAN_SSE2)
+    // SWAR: one bit per byte of the little-endian `word` that equals `c`.
+    static inline unsigned long long byteEqualMask8(unsigned long long word,
+        unsigned char c) {
+        unsigned long long x = word ^ (0x0101010101010101ull * c);
+        // High bit set exactly where a byte of x is zero(no false positives).
+        unsigned long long zero =
+            ~(((x & 0x7F7F7F7F7F7F7F7Full) + 0x7F7F7F7F7F7F7F7Full) | x) &
+            0x8080808080808080ull;
+        return ((zero >> 7) * 0x0102040810204080ull) >> 56;
+    }
+#endif
+
+    static inline void classifyBlock64(const char* p, scan_masks_t* m) {
+#if defined(TINYOBJ_SCAN_AVX2)
+        const __m256i cr = _mm256_set1_epi8('\r');
+        const __m256i lf = _mm256_set1_epi8('\n');
+        const __m256i sp = _mm256_set1_epi8(' ');
+        const __m256i tab = _mm256_set1_epi8('\t');
+        m->cr = m->lf = m->blank = 0;
+        for (int half = 0; half < 2; half++) {
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * half));
+            unsigned int shift = 32u * static_cast<unsigned int>(half);
+            m->cr |= static_cast<unsigned long long>(static_cast<unsigned int>(
+                _mm256_movemask_epi8(_mm256_cmpeq_epi8(b, cr)))) << shift;
+            m->lf |= static_cast<unsigned long long>(static_cast<unsigned int>(
+                _mm256_movemask_epi8(_mm256_cmpeq_epi8(b, lf)))) << shift;
+            m->blank |= static_cast<unsigned long long>(static_cast<unsigned int>(
+                _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(b, sp),
+                    _mm256_cmpeq_epi8(b, tab))))) << shift;
+        }
+#elif defined(TINYOBJ_SCAN_SSE2)
+        const __m128i cr = _mm_set1_epi8('\r');
+        const __m128i lf = _mm_set1_epi8('\n');
+        const __m128i sp = _mm_set1_epi8(' ');
+        const __m128i tab = _mm_set1_epi8('\t');
+        m->cr = m->lf = m->blank = 0;
+        for (int quarter = 0; quarter < 4; quarter++) {
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * quarter));
+            unsigned int shift = 16u * static_cast<unsigned int>(quarter);
+            m->cr |= static_cast<unsigned long long>(
+                _mm_movemask_epi8(_mm_cmpeq_epi8(b, cr))) << shift;
+            m->lf |= static_cast<unsigned long long>(
+                _mm_movemask_epi8(_mm_cmpeq_epi8(b, lf))) << shift;
+            m->blank |= static_cast<unsigned long long>(_mm_movemask_epi8(
+                _mm_or_si128(_mm_cmpeq_epi8(b, sp), _mm_cmpeq_epi8(b, tab)))) << shift;
+        }
+#else
+        m->cr = m->lf = m->blank = 0;
+        for (int i = 0; i < 8; i++) {
+            unsigned long long word = 0;
+            for (int k = 7; k >= 0; k--) {  // little-endian regardless of host
+                word = (word << 8) | static_cast<unsigned char>(p[8 * i + k]);
+            }
+            unsigned int shift = 8u * static_cast<unsigned int>(i);
+            m->cr |= byteEqualMask8(word, '\r') << shift;
+            m->lf |= byteEqualMask8(word, '\n') << shift;
+            m->blank |= (byteEqualMask8(word, ' ') | byteEqualMask8(word, '\t')) << shift;
+        }
+#endif
+    }
+
+    // One blank-separated token inside the scanned buffer. `end` points at the
+    // separator that closed it(or the end of the buffer), so it is never
+    // NUL-terminated.
+    struct token_span_t {
+        const char* begin;
+        const char* end;
+    };
+
+    static inline bool tokenIs(const token_span_t& t, const char* keyword,
+        size_t len) {
+        return static_cast<size_t>(t.end - t.begin) == len &&
+            0 == memcmp(t.begin, keyword, len);
+    }
+
+    // Splits a buffer into lines and blank-separated tokens without copying.
+    // Each 64-byte block is classified once(AVX2/SSE2/SWAR) into newline and
+    // separator bitmasks; lines and token boundaries are then read off those
+    // masks with count-trailing-zeros instead of testing every byte.
+    // '\n', '\r\n' and a lone '\r' all end a line; ' ', '\t' and '\r' separate
+    // tokens, so tokens never include line endings or leading/trailing blanks.
+    class LineScanner {
+    public:
+        LineScanner(const char* begin, const char* end)
+            : base_(begin),
+            size_(begin < end ? static_cast<size_t>(end - begin) : 0),
+            block_(0),
+            breaks_(0),
+            starts_(0),
+            ends_(0),
+            prev_sep_(1),
+            prev_cr_(0),
+            done_(size_ == 0) {
+            if (!done_) LoadBlock();
+        }
+
+        // Advances to the next line; false once the buffer is exhausted. A
+        // trailing line without tokens is not reported.
+        bool NextLine() {
+            if (done_) return false;
+            tokens_.clear();
+            size_t open = 0;  // first token whose end has not been seen yet
+            for (;;) {
+                // Starts before the line break belong to this line; an end may
+                // sit on the break itself.
+                unsigned long long brk = breaks_ & (0ull - breaks_);
+                unsigned long long before = brk ? brk - 1 : ~0ull;
+                unsigned long long s = starts_ & before;
+                unsigned long long e = ends_ & (before | brk);
+                starts_ &= ~before;
+                ends_ &= ~(before | brk);
+
+                const char* block = base_ + block_;
+                for (; s; s &= s - 1) {
+                    token_span_t t;
+                    t.begin = block + trailingZeros64(s);
+                    t.end = base_ + size_;
+                    tokens_.push_back(t);
+                }
+                for (; e; e &= e - 1) {
+                    tokens_[open++].end = block + trailingZeros64(e);
+                }
+
+                if (brk) {
+                    breaks_ &= breaks_ - 1;
+                    return true;
+                }
+
+                block_ += 64;
+                if (block_ >= size_) {
+                    // Tokens still open run to the end of the buffer.
+                    done_ = true;
+                    return !tokens_.empty();
+                }
+                LoadBlock();
+            }
+        }
+
+        // Tokens of the current line, in order.
+        const std::vector<token_span_t>& tokens() const { return tokens_; }
+
+    private:
+        void LoadBlock() {
+            size_t n = size_ - block_;
+            scan_masks_t m;
+            unsigned long long valid = ~0ull;
+            if (n >= 64) {
+                classifyBlock64(base_ + block_, &m);
+            }
+            else {
+                char tail[64];
+                memset(tail, 0, sizeof(tail));
+                memcpy(tail, base_ + block_, n);
+                classifyBlock64(tail, &m);
+                valid = (1ull << n) - 1;
+            }
+
+            // The '\n' of a "\r\n" pair only separates; the '\r' ended the line.
+            unsigned long long crlf = m.lf & ((m.cr << 1) | prev_cr_);
+            unsigned long long sep = m.cr | m.lf | m.blank | ~valid;
+            unsigned long long prev = (sep << 1) | prev_sep_;
+            breaks_ = (m.cr | (m.lf & ~crlf)) & valid;
+            starts_ = ~sep & prev;
+            ends_ = sep & ~prev;
+            prev_sep_ = sep >> 63;
+            prev_cr_ = m.cr >> 63;
+        }
+
+        const char* base_;
+        size_t size_;
+        size_t block_;  // offset of the classified block
+        unsigned long long breaks_;
+        unsigned long long starts_;
+        unsigned long long ends_;
+        unsigned long long prev_sep_;  // bit 63 of the previous block
+        unsigned long long prev_cr_;
+        bool done_;
+        std::vector<token_span_t> tokens_;
+    };
+
+    // Reads what is left of `is` into one contiguous buffer for LineScanner.
+    static void ReadStreamToBuffer(std::istream* is, std::vector<char>* buf) {
+        buf->clear();
+        std::streambuf* sb = is->rdbuf();
+        if (!sb) return;
+
+        std::streampos here = sb->pubseekoff(0, std::ios::cur, std::ios::in);
+        std::streampos last = sb->pubseekoff(0, std::ios::end, std::ios::in);
+        if (here != std::streampos(-1)) {
+            if (last != std::streampos(-1) && last > here) {
+                // One spare block so the final short read does not reallocate.
+                buf->reserve(static_cast<size_t>(last - here) + (1 << 16));
+            }
+            sb->pubseekpos(here, std::ios::in);
+        }
+
+        const size_t block = 1 << 16;
+        for (;;) {
+            size_t used = buf->size();
+            buf->resize(used + block);
+            std::streamsize got =
+                sb->sgetn(&(*buf)[used], static_cast<std::streamsize>(block));
+            buf->resize(used + static_cast<size_t>(got > 0 ? got : 0));
+            if (got < static_cast<std::streamsize>(block)) break;
+        }
+        is->setstate(std::ios::eofbit);
+    }
+
     // Make index zero-base, and also support relative index.
     static inline bool fixIndex(int idx, int n, int* ret) {
         if (!ret) {
@@ -836,6 +1104,311 @@ namespace tinyobj {
         return i;
     }
 
+    // Returns true when the 8 bytes packed little-endian into `chunk` are all
+    // ASCII digits(SWAR: no byte may borrow below '0' or carry above '9').
+    static inline bool isEightDigits(unsigned long long chunk) {
+        return ((((chunk + 0x4646464646464646ull) |
+            (chunk - 0x3030303030303030ull)) &
+            0x8080808080808080ull) == 0);
+    }
+
+    // Converts 8 ASCII digits packed little-endian into their value with three
+    // multiplies instead of eight.
+    static inline unsigned int parseEightDigits(unsigned long long chunk) {
+        const unsigned long long mask = 0x000000FF000000FFull;
+        const unsigned long long mul1 = 0x000F424000000064ull;  // 100 + (1000000 << 32)
+        const unsigned long long mul2 = 0x0000271000000001ull;  // 1 + (10000 << 32)
+        chunk -= 0x3030303030303030ull;
+        chunk = (chunk * 10) + (chunk >> 8);
+        chunk = (((chunk & mask) * mul1) + (((chunk >> 16) & mask) * mul2)) >> 32;
+        return static_cast<unsigned int>(chunk);
+    }
+
+    static inline bool isLittleEndian() {
+        const unsigned int probe = 1;
+        unsigned char first;
+        memcpy(&first, &probe, 1);
+        return first == 1;
+    }
+
+    // Accumulates a run of digits into `mantissa`, 8 at a time where possible.
+    // Digits past the 19th no longer fit a 64-bit mantissa and only bump
+    // `dropped`.
+    static inline const char* readDigits(const char* curr, const char* s_end,
+        unsigned long long* mantissa, int* digits,
+        int* dropped) {
+        static const bool little_endian = isLittleEndian();
+        while (little_endian && (*digits + 8 <= 19) && (s_end - curr >= 8)) {
+            unsigned long long chunk;
+            memcpy(&chunk, curr, 8);
+            if (!isEightDigits(chunk)) break;
+            unsigned int value = parseEightDigits(chunk);
+            if (*mantissa) {
+                (*digits) += 8;
+            }
+            else {
+                // Leading zeros carry no precision.
+                for (unsigned int v = value; v; v /= 10) (*digits)++;
+            }
+            (*mantissa) = (*mantissa) * 100000000ull + value;
+            curr += 8;
+        }
+        while ((curr != s_end) && IS_DIGIT(*curr)) {
+            if (*digits < 19) {
+                (*mantissa) = (*mantissa) * 10 + static_cast<unsigned int>(*curr - '0');
+                // Leading zeros carry no precision.
+                if (*mantissa) (*digits)++;
+            }
+            else {
+                (*dropped)++;
+            }
+            curr++;
+        }
+        return curr;
+    }
+
+    // Full 64x64 -> 128 bit product.
+    static inline void mul64x64(unsigned long long a, unsigned long long b,
+        unsigned long long* hi, unsigned long long* lo) {
+#if defined(__SIZEOF_INT128__)
+        unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+        (*hi) = static_cast<unsigned long long>(product >> 64);
+        (*lo) = static_cast<unsigned long long>(product);
+#elif defined(_MSC_VER) && defined(_M_X64)
+        (*lo) = _umul128(a, b, hi);
+#else
+        unsigned long long a_lo = a & 0xFFFFFFFFull, a_hi = a >> 32;
+        unsigned long long b_lo = b & 0xFFFFFFFFull, b_hi = b >> 32;
+        unsigned long long lo_lo = a_lo * b_lo;
+        unsigned long long hi_lo = a_hi * b_lo;
+        unsigned long long lo_hi = a_lo * b_hi;
+        unsigned long long hi_hi = a_hi * b_hi;
+        unsigned long long cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFull) + lo_hi;
+        (*hi) = hi_hi + (hi_lo >> 32) + (cross >> 32);
+        (*lo) = (cross << 32) | (lo_lo & 0xFFFFFFFFull);
+#endif
+    }
+
+    static inline int leadingZeros64(unsigned long long x) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_clzll(x);
+#else
+        int n = 0;
+        while (!(x & 0x8000000000000000ull)) {
+            x <<= 1;
+            n++;
+        }
+        return n;
+#endif
+    }
+
+    // Eisel-Lemire: rounds w * 10^q(w != 0, at most 19 digits) to the nearest
+    // double using a 128-bit approximation of 5^q. Only the powers OBJ files
+    // realistically use are tabulated; returns false outside them and for
+    // subnormal results so the caller can fall back to strtod.
+    static bool eiselLemire(unsigned long long w, int q, double* result) {
+        // 128-bit truncated 5^q normalised to the top bit, q in [-64, 64]
+        // (same values as the fast_float / Lemire tables).
+        static const unsigned long long power_of_five_128[] = {
+            0xa87fea27a539e9a5ull, 0x3f2398d747b36224ull,  // 1e-64
+            0xd29fe4b18e88640eull, 0x8eec7f0d19a03aadull,  // 1e-63
+            0x83a3eeeef9153e89ull, 0x1953cf68300424acull,  // 1e-62
+            0xa48ceaaab75a8e2bull, 0x5fa8c3423c052dd7ull,  // 1e-61
+            0xcdb02555653131b6ull, 0x3792f412cb06794dull,  // 1e-60
+            0x808e17555f3ebf11ull, 0xe2bbd88bbee40bd0ull,  // 1e-59
+            0xa0b19d2ab70e6ed6ull, 0x5b6aceaeae9d0ec4ull,  // 1e-58
+            0xc8de047564d20a8bull, 0xf245825a5a445275ull,  // 1e-57
+            0xfb158592be068d2eull, 0xeed6e2f0f0d56712ull,  // 1e-56
+            0x9ced737bb6c4183dull, 0x55464dd69685606bull,  // 1e-55
+            0xc428d05aa4751e4cull, 0xaa97e14c3c26b886ull,  // 1e-54
+            0xf53304714d9265dfull, 0xd53dd99f4b3066a8ull,  // 1e-53
+            0x993fe2c6d07b7fabull, 0xe546a8038efe4029ull,  // 1e-52
+            0xbf8fdb78849a5f96ull, 0xde98520472bdd033ull,  // 1e-51
+            0xef73d256a5c0f77cull, 0x963e66858f6d4440ull,  // 1e-50
+            0x95a8637627989aadull, 0xdde7001379a44aa8ull,  // 1e-49
+            0xbb127c53b17ec159ull, 0x5560c018580d5d52ull,  // 1e-48
+            0xe9d71b689dde71afull, 0xaab8f01e6e10b4a6ull,  // 1e-47
+            0x9226712162ab070dull, 0xcab3961304ca70e8ull,  // 1e-46
+            0xb6b00d69bb55c8d1ull, 0x3d607b97c5fd0d22ull,  // 1e-45
+            0xe45c10c42a2b3b05ull, 0x8cb89a7db77c506aull,  // 1e-44
+            0x8eb98a7a9a5b04e3ull, 0x77f3608e92adb242ull,  // 1e-43
+            0xb267ed1940f1c61cull, 0x55f038b237591ed3ull,  // 1e-42
+            0xdf01e85f912e37a3ull, 0x6b6c46dec52f6688ull,  // 1e-41
+            0x8b61313bbabce2c6ull, 0x2323ac4b3b3da015ull,  // 1e-40
+            0xae397d8aa96c1b77ull, 0xabec975e0a0d081aull,  // 1e-39
+            0xd9c7dced53c72255ull, 0x96e7bd358c904a21ull,  // 1e-38
+            0x881cea14545c7575ull, 0x7e50d64177da2e54ull,  // 1e-37
+            0xaa242499697392d2ull, 0xdde50bd1d5d0b9e9ull,  // 1e-36
+            0xd4ad2dbfc3d07787ull, 0x955e4ec64b44e864ull,  // 1e-35
+            0x84ec3c97da624ab4ull, 0xbd5af13bef0b113eull,  // 1e-34
+            0xa6274bbdd0fadd61ull, 0xecb1ad8aeacdd58eull,  // 1e-33
+            0xcfb11ead453994baull, 0x67de18eda5814af2ull,  // 1e-32
+            0x81ceb32c4b43fcf4ull, 0x80eacf948770ced7ull,  // 1e-31
+            0xa2425ff75e14fc31ull, 0xa1258379a94d028dull,  // 1e-30
+            0xcad2f7f5359a3b3eull, 0x096ee45813a04330ull,  // 1e-29
+            0xfd87b5f28300ca0dull, 0x8bca9d6e188853fcull,  // 1e-28
+            0x9e74d1b791e07e48ull, 0x775ea264cf55347eull,  // 1e-27
+            0xc612062576589ddaull, 0x95364afe032a819eull,  // 1e-26
+            0xf79687aed3eec551ull, 0x3a83ddbd83f52205ull,  // 1e-25
+            0x9abe14cd44753b52ull, 0xc4926a9672793543ull,  // 1e-24
+            0xc16d9a0095928a27ull, 0x75b7053c0f178294ull,  // 1e-23
+            0xf1c90080baf72cb1ull, 0x5324c68b12dd6339ull,  // 1e-22
+            0x971da05074da7beeull, 0xd3f6fc16ebca5e04ull,  // 1e-21
+            0xbce5086492111aeaull, 0x88f4bb1ca6bcf585ull,  // 1e-20
+            0xec1e4a7db69561a5ull, 0x2b31e9e3d06c32e6ull,  // 1e-19
+            0x9392ee8e921d5d07ull, 0x3aff322e62439fd0ull,  // 1e-18
+            0xb877aa3236a4b449ull, 0x09befeb9fad487c3ull,  // 1e-17
+            0xe69594bec44de15bull, 0x4c2ebe687989a9b4ull,  // 1e-16
+            0x901d7cf73ab0acd9ull, 0x0f9d37014bf60a11ull,  // 1e-15
+            0xb424dc35095cd80full, 0x538484c19ef38c95ull,  // 1e-14
+            0xe12e13424bb40e13ull, 0x2865a5f206b06fbaull,  // 1e-13
+            0x8cbccc096f5088cbull, 0xf93f87b7442e45d4ull,  // 1e-12
+            0xafebff0bcb24aafeull, 0xf78f69a51539d749ull,  // 1e-11
+            0xdbe6fecebdedd5beull, 0xb573440e5a884d1cull,  // 1e-10
+            0x89705f4136b4a597ull, 0x31680a88f8953031ull,  // 1e-9
+            0xabcc77118461cefcull, 0xfdc20d2b36ba7c3eull,  // 1e-8
+            0xd6bf94d5e57a42bcull, 0x3d32907604691b4dull,  // 1e-7
+            0x8637bd05af6c69b5ull, 0xa63f9a49c2c1b110ull,  // 1e-6
+            0xa7c5ac471b478423ull, 0x0fcf80dc33721d54ull,  // 1e-5
+            0xd1b71758e219652bull, 0xd3c36113404ea4a9ull,  // 1e-4
+            0x83126e978d4fdf3bull, 0x645a1cac083126eaull,  // 1e-3
+            0xa3d70a3d70a3d70aull, 0x3d70a3d70a3d70a4ull,  // 1e-2
+            0xccccccccccccccccull, 0xcccccccccccccccdull,  // 1e-1
+            0x8000000000000000ull, 0x0000000000000000ull,  // 1e0
+            0xa000000000000000ull, 0x0000000000000000ull,  // 1e1
+            0xc800000000000000ull, 0x0000000000000000ull,  // 1e2
+            0xfa00000000000000ull, 0x0000000000000000ull,  // 1e3
+            0x9c40000000000000ull, 0x0000000000000000ull,  // 1e4
+            0xc350000000000000ull, 0x0000000000000000ull,  // 1e5
+            0xf424000000000000ull, 0x0000000000000000ull,  // 1e6
+            0x9896800000000000ull, 0x0000000000000000ull,  // 1e7
+            0xbebc200000000000ull, 0x0000000000000000ull,  // 1e8
+            0xee6b280000000000ull, 0x0000000000000000ull,  // 1e9
+            0x9502f90000000000ull, 0x0000000000000000ull,  // 1e10
+            0xba43b74000000000ull, 0x0000000000000000ull,  // 1e11
+            0xe8d4a51000000000ull, 0x0000000000000000ull,  // 1e12
+            0x9184e72a00000000ull, 0x0000000000000000ull,  // 1e13
+            0xb5e620f480000000ull, 0x0000000000000000ull,  // 1e14
+            0xe35fa931a0000000ull, 0x0000000000000000ull,  // 1e15
+            0x8e1bc9bf04000000ull, 0x0000000000000000ull,  // 1e16
+            0xb1a2bc2ec5000000ull, 0x0000000000000000ull,  // 1e17
+            0xde0b6b3a76400000ull, 0x0000000000000000ull,  // 1e18
+            0x8ac7230489e80000ull, 0x0000000000000000ull,  // 1e19
+            0xad78ebc5ac620000ull, 0x0000000000000000ull,  // 1e20
+            0xd8d726b7177a8000ull, 0x0000000000000000ull,  // 1e21
+            0x878678326eac9000ull, 0x0000000000000000ull,  // 1e22
+            0xa968163f0a57b400ull, 0x0000000000000000ull,  // 1e23
+            0xd3c21bcecceda100ull, 0x0000000000000000ull,  // 1e24
+            0x84595161401484a0ull, 0x0000000000000000ull,  // 1e25
+            0xa56fa5b99019a5c8ull, 0x0000000000000000ull,  // 1e26
+            0xcecb8f27f4200f3aull, 0x0000000000000000ull,  // 1e27
+            0x813f3978f8940984ull, 0x4000000000000000ull,  // 1e28
+            0xa18f07d736b90be5ull, 0x5000000000000000ull,  // 1e29
+            0xc9f2c9cd04674edeull, 0xa400000000000000ull,  // 1e30
+            0xfc6f7c4045812296ull, 0x4d00000000000000ull,  // 1e31
+            0x9dc5ada82b70b59dull, 0xf020000000000000ull,  // 1e32
+            0xc5371912364ce305ull, 0x6c28000000000000ull,  // 1e33
+            0xf684df56c3e01bc6ull, 0xc732000000000000ull,  // 1e34
+            0x9a130b963a6c115cull, 0x3c7f400000000000ull,  // 1e35
+            0xc097ce7bc90715b3ull, 0x4b9f100000000000ull,  // 1e36
+            0xf0bdc21abb48db20ull, 0x1e86d40000000000ull,  // 1e37
+            0x96769950b50d88f4ull, 0x1314448000000000ull,  // 1e38
+            0xbc143fa4e250eb31ull, 0x17d955a000000000ull,  // 1e39
+            0xeb194f8e1ae525fdull, 0x5dcfab0800000000ull,  // 1e40
+            0x92efd1b8d0cf37beull, 0x5aa1cae500000000ull,  // 1e41
+            0xb7abc627050305adull, 0xf14a3d9e40000000ull,  // 1e42
+            0xe596b7b0c643c719ull, 0x6d9ccd05d0000000ull,  // 1e43
+            0x8f7e32ce7bea5c6full, 0xe4820023a2000000ull,  // 1e44
+            0xb35dbf821ae4f38bull, 0xdda2802c8a800000ull,  // 1e45
+            0xe0352f62a19e306eull, 0xd50b2037ad200000ull,  // 1e46
+            0x8c213d9da502de45ull, 0x4526f422cc340000ull,  // 1e47
+            0xaf298d050e4395d6ull, 0x9670b12b7f410000ull,  // 1e48
+            0xdaf3f04651d47b4cull, 0x3c0cdd765f114000ull,  // 1e49
+            0x88d8762bf324cd0full, 0xa5880a69fb6ac800ull,  // 1e50
+            0xab0e93b6efee0053ull, 0x8eea0d047a457a00ull,  // 1e51
+            0xd5d238a4abe98068ull, 0x72a4904598d6d880ull,  // 1e52
+            0x85a36366eb71f041ull, 0x47a6da2b7f864750ull,  // 1e53
+            0xa70c3c40a64e6c51ull, 0x999090b65f67d924ull,  // 1e54
+            0xd0cf4b50cfe20765ull, 0xfff4b4e3f741cf6dull,  // 1e55
+            0x82818f1281ed449full, 0xbff8f10e7a8921a4ull,  // 1e56
+            0xa321f2d7226895c7ull, 0xaff72d52192b6a0dull,  // 1e57
+            0xcbea6f8ceb02bb39ull, 0x9bf4f8a69f764490ull,  // 1e58
+            0xfee50b7025c36a08ull, 0x02f236d04753d5b4ull,  // 1e59
+            0x9f4f2726179a2245ull, 0x01d762422c946590ull,  // 1e60
+            0xc722f0ef9d80aad6ull, 0x424d3ad2b7b97ef5ull,  // 1e61
+            0xf8ebad2b84e0d58bull, 0xd2e0898765a7deb2ull,  // 1e62
+            0x9b934c3b330c8577ull, 0x63cc55f49f88eb2full,  // 1e63
+            0xc2781f49ffcfa6d5ull, 0x3cbf6b71c76b25fbull,  // 1e64
+
+        };
+        const int smallest_power = -64;
+        const int largest_power = 64;
+        if (q < smallest_power || q > largest_power) return false;
+
+        int lz = leadingZeros64(w);
+        w <<= lz;
+
+        // 52 explicit bits + 3 guard bits; the second table word is only
+        // needed when the first product leaves those bits ambiguous.
+        size_t index = 2 * static_cast<size_t>(q - smallest_power);
+        unsigned long long hi, lo;
+        mul64x64(w, power_of_five_128[index], &hi, &lo);
+        const unsigned long long precision_mask = 0xFFFFFFFFFFFFFFFFull >> 55;
+        if ((hi & precision_mask) == precision_mask) {
+            unsigned long long hi2, lo2;
+            mul64x64(w, power_of_five_128[index + 1], &hi2, &lo2);
+            lo += hi2;
+            if (hi2 > lo) hi++;
+        }
+
+        int upperbit = static_cast<int>(hi >> 63);
+        int shift = upperbit + 64 - 52 - 3;
+        unsigned long long mantissa = hi >> shift;
+        // floor(log2(10^q)) + 63, then rebias to the IEEE exponent.
+        int power2 = (((152170 + 65536) * q) >> 16) + 63 + upperbit - lz + 1023;
+        if (power2 <= 0) return false;  // subnormal
+
+        // Exactly halfway between two doubles: round to even.
+        if ((lo <= 1) && (q >= -4) && (q <= 23) && ((mantissa & 3) == 1)) {
+            if ((mantissa << shift) == hi) {
+                mantissa &= ~1ull;
+            }
+        }
+        mantissa += (mantissa & 1);
+        mantissa >>= 1;
+        if (mantissa >= (2ull << 52)) {
+            mantissa = (1ull << 52);
+            power2++;
+        }
+        mantissa &= ~(1ull << 52);
+
+        unsigned long long bits =
+            mantissa | (static_cast<unsigned long long>(power2) << 52);
+        memcpy(result, &bits, sizeof(double));
+        return true;
+    }
+
+    // Correctly rounded fallback for inputs the fast path cannot prove exact.
+    // strtod follows the C locale's decimal point, so use a classic-locale
+    // stream when someone has switched it away from '.'.
+    static double parseDoubleSlow(const char* s, const char* s_end) {
+        size_t len = static_cast<size_t>(s_end - s);
+        if (localeconv()->decimal_point[0] == '.') {
+            char buf[64];
+            if (len < sizeof(buf)) {
+                memcpy(buf, s, len);
+                buf[len] = '\0';
+                return strtod(buf, NULL);
+            }
+            return strtod(std::string(s, s_end).c_str(), NULL);
+        }
+        std::istringstream iss(std::string(s, s_end));
+        iss.imbue(std::locale::classic());
+        double value = 0.0;
+        iss >> value;
+        return value;
+    }
+
     // Tries to parse a floating point number located at s.
     //
     // s_end should be a location in the string where reading should absolutely
@@ -855,6 +1428,12 @@ namespace tinyobj {
     // If the parsing is a success, result is set to the parsed value and true
     // is returned.
     //
+    // The digits are gathered into an exact 64-bit decimal mantissa and a
+    // power of ten(8 digits per step where the buffer allows). When the
+    // mantissa fits 53 bits and the power is within 10^±22 both are exact
+    // doubles, so one multiply or divide gives the correctly rounded(strtod)
+    // result. Everything else goes through parseDoubleSlow.
+    //
     // The function is greedy and will parse until any of the following happens:
     //  - a non-conforming character is encountered.
     //  - s_end is reached.
@@ -868,138 +1447,89 @@ namespace tinyobj {
             return false;
         }
 
-        double mantissa = 0.0;
-        // This exponent is base 2 rather than 10.
-        // However the exponent we parse is supposed to be one of ten,
-        // thus we must take care to convert the exponent/and or the
-        // mantissa to a * 2^E, where a is the mantissa and E is the
-        // exponent.
-        // To get the final double we will use ldexp, it requires the
-        // exponent to be in base 2.
-        int exponent = 0;
+        static const double pow10_exact[] = {
+            1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+        };
 
-        // NOTE: THESE MUST BE DECLARED HERE SINCE WE ARE NOT ALLOWED
-        // TO JUMP OVER DEFINITIONS.
-        char sign = '+';
-        char exp_sign = '+';
+        unsigned long long mantissa = 0;
+        int digits = 0;   // significant digits held in mantissa
+        int dropped = 0;  // digits that did not fit the mantissa
+        int exponent = 0;
+        bool negative = false;
         char const* curr = s;
 
-        // How many characters were read in a loop.
-        int read = 0;
-        // Tells whether a loop terminated due to reaching s_end.
-        bool end_not_reached = false;
-        bool leading_decimal_dots = false;
-
-        /*
-                BEGIN PARSING.
-        */
-
         // Find out what sign we've got.
         if (*curr == '+' || *curr == '-') {
-            sign = *curr;
+            negative = (*curr == '-');
             curr++;
-            if ((curr != s_end) && (*curr == '.')) {
-                // accept. Somethig like `.7e+2`, `-.5234`
-                leading_decimal_dots = true;
-            }
-        }
-        else if (IS_DIGIT(*curr)) { /* Pass through. */
-        }
-        else if (*curr == '.') {
-            // accept. Somethig like `.7e+2`, `-.5234`
-            leading_decimal_dots = true;
-        }
-        else {
-            goto fail;
         }
 
-        // Read the integer part.
-        end_not_reached = (curr != s_end);
-        if (!leading_decimal_dots) {
-            while (end_not_reached && IS_DIGIT(*curr)) {
-                mantissa *= 10;
-                mantissa += static_cast<int>(*curr - 0x30);
-                curr++;
-                read++;
-                end_not_reached = (curr != s_end);
-            }
-
-            // We must make sure we actually got something.
-            if (read == 0) goto fail;
+        // Read the integer part. A leading '.' is accepted, like `.7e+2`, `-.5234`
+        if (curr == s_end || !(IS_DIGIT(*curr) || *curr == '.')) {
+            return false;
         }
-
-        // We allow numbers of form "#", "###" etc.
-        if (!end_not_reached) goto assemble;
+        curr = readDigits(curr, s_end, &mantissa, &digits, &dropped);
+        // Dropped integer digits scale the mantissa up by ten each.
+        long long decimal_exponent = dropped;
 
         // Read the decimal part.
-        if (*curr == '.') {
+        if ((curr != s_end) && (*curr == '.')) {
             curr++;
-            read = 1;
-            end_not_reached = (curr != s_end);
-            while (end_not_reached && IS_DIGIT(*curr)) {
-                static const double pow_lut[] = {
-                    1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001,
-                };
-                const int lut_entries = sizeof pow_lut / sizeof pow_lut[0];
-
-                // NOTE: Don't use powf here, it will absolutely murder precision.
-                mantissa += static_cast<int>(*curr - 0x30) *
-                    (read < lut_entries ? pow_lut[read] : std::pow(10.0, -read));
-                read++;
-                curr++;
-                end_not_reached = (curr != s_end);
-            }
+            const char* frac_start = curr;
+            int frac_dropped = 0;
+            curr = readDigits(curr, s_end, &mantissa, &digits, &frac_dropped);
+            decimal_exponent -= static_cast<long long>(curr - frac_start) - frac_dropped;
+            dropped += frac_dropped;
         }
-        else if (*curr == 'e' || *curr == 'E') {
-        }
-        else {
-            goto assemble;
-        }
-
-        if (!end_not_reached) goto assemble;
 
         // Read the exponent part.
-        if (*curr == 'e' || *curr == 'E') {
+        if ((curr != s_end) && (*curr == 'e' || *curr == 'E')) {
             curr++;
-            // Figure out if a sign is present and if it is.
-            end_not_reached = (curr != s_end);
-            if (end_not_reached && (*curr == '+' || *curr == '-')) {
-                exp_sign = *curr;
+            bool exp_negative = false;
+            if ((curr != s_end) && (*curr == '+' || *curr == '-')) {
+                exp_negative = (*curr == '-');
                 curr++;
             }
-            else if (IS_DIGIT(*curr)) { /* Pass through. */
-            }
-            else {
-                // Empty E is not allowed.
-                goto fail;
+            // Empty E is not allowed.
+            if ((curr == s_end) || !IS_DIGIT(*curr)) {
+                return false;
             }
-
-            read = 0;
-            end_not_reached = (curr != s_end);
-            while (end_not_reached && IS_DIGIT(*curr)) {
+            while ((curr != s_end) && IS_DIGIT(*curr)) {
                 // To avoid annoying MSVC's min/max macro definiton,
                 // Use hardcoded int max value
                 if (exponent > (2147483647 / 10)) { // 2147483647 = std::numeric_limits<int>::max()
-                  // Integer overflow
-                    goto fail;
+                    // Integer overflow
+                    return false;
                 }
-                exponent *= 10;
-                exponent += static_cast<int>(*curr - 0x30);
+                exponent = exponent * 10 + static_cast<int>(*curr - '0');
                 curr++;
-                read++;
-                end_not_reached = (curr != s_end);
             }
-            exponent *= (exp_sign == '+' ? 1 : -1);
-            if (read == 0) goto fail;
+            if (exp_negative) exponent = -exponent;
+        }
+
+        if (mantissa == 0) {
+            *result = negative ? -0.0 : 0.0;
+            return true;
+        }
+
+        long long power = static_cast<long long>(exponent) + decimal_exponent;
+        if (!dropped && (mantissa <= (1ull << 53)) && (power >= -22) && (power <= 22)) {
+            double value = static_cast<double>(mantissa);
+            value = (power < 0) ? value / pow10_exact[-power] : value * pow10_exact[power];
+            *result = negative ? -value : value;
+            return true;
+        }
+
+        double value;
+        if (!dropped && (power >= -64) && (power <= 64) &&
+            eiselLemire(mantissa, static_cast<int>(power), &value)) {
+            *result = negative ? -value : value;
+            return true;
         }
 
-    assemble:
-        *result = (sign == '+' ? 1 : -1) *
-            (exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent)
-                : mantissa);
+        *result = parseDoubleSlow(s, curr);
         return true;
-    fail:
-        return false;
     }
 
     static inline real_t parseReal(const char** token, double default_value = 0.0) {
@@ -1233,6 +1763,127 @@ namespace tinyobj {
         return vi;
     }
 
+    // atoi over [s, end): optional sign followed by digits.
+    static inline int parseIndex(const char* s, const char* end) {
+        bool negative = false;
+        if (s != end && (*s == '-' || *s == '+')) {
+            negative = (*s == '-');
+            s++;
+        }
+        int value = 0;
+        for (; s != end && IS_DIGIT(*s); s++) {
+            value = value * 10 + (*s - '0');
+        }
+        return negative ? -value : value;
+    }
+
+    // Parse a raw triple held in one token span: i, i/j/k, i//k, i/j
+    static vertex_index_t parseRawTriple(const token_span_t& t) {
+        vertex_index_t vi(static_cast<int>(0));  // 0 is an invalid index in OBJ
+
+        const char* s = t.begin;
+        const char* slash = static_cast<const char*>(
+            memchr(s, '/', static_cast<size_t>(t.end - s)));
+        vi.v_idx = parseIndex(s, slash ? slash : t.end);
+        if (!slash) {
+            return vi;
+        }
+        s = slash + 1;
+
+        // i//k
+        if (s != t.end && *s == '/') {
+            vi.vn_idx = parseIndex(s + 1, t.end);
+            return vi;
+        }
+
+        // i/j/k or i/j
+        slash = static_cast<const char*>(
+            memchr(s, '/', static_cast<size_t>(t.end - s)));
+        vi.vt_idx = parseIndex(s, slash ? slash : t.end);
+        if (slash) {
+            vi.vn_idx = parseIndex(slash + 1, t.end);
+        }
+        return vi;
+    }
+
+    // Same as parseTriple, for a token span.
+    static bool parseTriple(const token_span_t& t, int vsize, int vnsize,
+        int vtsize, vertex_index_t* ret) {
+        vertex_index_t vi(-1);
+
+        const char* s = t.begin;
+        const char* slash = static_cast<const char*>(
+            memchr(s, '/', static_cast<size_t>(t.end - s)));
+        if (!fixIndex(parseIndex(s, slash ? slash : t.end), vsize, &(vi.v_idx))) {
+            return false;
+        }
+        if (!slash) {
+            (*ret) = vi;
+            return true;
+        }
+        s = slash + 1;
+
+        // i//k
+        if (s != t.end && *s == '/') {
+            if (!fixIndex(parseIndex(s + 1, t.end), vnsize, &(vi.vn_idx))) {
+                return false;
+            }
+            (*ret) = vi;
+            return true;
+        }
+
+        // i/j/k or i/j
+        slash = static_cast<const char*>(
+            memchr(s, '/', static_cast<size_t>(t.end - s)));
+        if (!fixIndex(parseIndex(s, slash ? slash : t.end), vtsize, &(vi.vt_idx))) {
+            return false;
+        }
+        if (slash && !fixIndex(parseIndex(slash + 1, t.end), vnsize, &(vi.vn_idx))) {
+            return false;
+        }
+        (*ret) = vi;
+        return true;
+    }
+
+    // parseReal for token `i` of a scanned line; missing tokens give the default.
+    static inline real_t parseReal(const std::vector<token_span_t>& tokens,
+        size_t i, double default_value = 0.0) {
+        double val = default_value;
+        if (i < tokens.size()) {
+            tryParseDouble(tokens[i].begin, tokens[i].end, &val);
+        }
+        return static_cast<real_t>(val);
+    }
+
+    static inline bool parseReal(const std::vector<token_span_t>& tokens,
+        size_t i, real_t* out) {
+        double val;
+        if (i >= tokens.size() ||
+            !tryParseDouble(tokens[i].begin, tokens[i].end, &val)) {
+            return false;
+        }
+        (*out) = static_cast<real_t>(val);
+        return true;
+    }
+
+    // parseVertexWithColor for a scanned `v` line(tokens[0] is the keyword).
+    static inline bool parseVertexWithColor(real_t* x, real_t* y, real_t* z,
+        real_t* r, real_t* g, real_t* b,
+        const std::vector<token_span_t>& tokens) {
+        (*x) = parseReal(tokens, 1);
+        (*y) = parseReal(tokens, 2);
+        (*z) = parseReal(tokens, 3);
+
+        const bool found_color = parseReal(tokens, 4, r) &&
+            parseReal(tokens, 5, g) && parseReal(tokens, 6, b);
+
+        if (!found_color) {
+            (*r) = (*g) = (*b) = 1.0;
+        }
+
+        return found_color;
+    }
+
     bool ParseTextureNameAndOption(std::string* texname, texture_option_t* texopt,
         const char* linebuf) {
         // @todo { write more robust lexer and parser. }
@@ -1981,38 +2632,22 @@ namespace tinyobj {
 
         std::stringstream warn_ss;
 
+        std::vector<char> buffer;
+        ReadStreamToBuffer(inStream, &buffer);
+        LineScanner scanner(buffer.data(), buffer.data() + buffer.size());
+
         size_t line_no = 0;
         std::string linebuf;
-        while (inStream->peek() != -1) {
-            safeGetline(*inStream, linebuf);
+        while (scanner.NextLine()) {
             line_no++;
 
-            // Trim trailing whitespace.
-            if (linebuf.size() > 0) {
-                linebuf = linebuf.substr(0, linebuf.find_last_not_of(" \t") + 1);
-            }
-
-            // Trim newline '\r\n' or '\n'
-            if (linebuf.size() > 0) {
-                if (linebuf[linebuf.size() - 1] == '\n')
-                    linebuf.erase(linebuf.size() - 1);
-            }
-            if (linebuf.size() > 0) {
-                if (linebuf[linebuf.size() - 1] == '\r')
-                    linebuf.erase(linebuf.size() - 1);
-            }
-
-            // Skip if empty line.
-            if (linebuf.empty()) {
-                continue;
-            }
+            const std::vector<token_span_t>& tokens = scanner.tokens();
+            if (tokens.empty()) continue;  // empty line
 
-            // Skip leading space.
+            // The token spans already exclude leading/trailing whitespace and
+            // the line ending. `linebuf` keeps its capacity across lines.
+            linebuf.assign(tokens.front().begin, tokens.back().end);
             const char* token = linebuf.c_str();
-            token += strspn(token, " \t");
-
-            assert(token);
-            if (token[0] == '\0') continue;  // empty line
 
             if (token[0] == '#') continue;  // comment line
 
@@ -2470,6 +3105,64 @@ namespace tinyobj {
             triangulate, default_vcols_fallback);
     }
 
+    // Loads the .mtl files listed on a `mtllib` line. `token` points just past
+    // "mtllib ".
+    static void LoadMtlLibraries(const char* token, size_t line_num,
+        MaterialReader* readMatFn,
+        std::vector<material_t>* materials,
+        std::map<std::string, int>* material_map,
+        std::set<std::string>* material_filenames,
+        std::string* warn, std::string* err) {
+        std::vector<std::string> filenames;
+        SplitString(std::string(token), ' ', '\\', filenames);
+
+        if (filenames.empty()) {
+            if (warn) {
+                std::stringstream ss;
+                ss << "Looks like empty filename for mtllib. Use default "
+                    "material (line "
+                    << line_num << ".)\n";
+
+                (*warn) += ss.str();
+            }
+        }
+        else {
+            bool found = false;
+            for (size_t s = 0; s < filenames.size(); s++) {
+                if (material_filenames->count(filenames[s]) > 0) {
+                    found = true;
+                    continue;
+                }
+
+                std::string warn_mtl;
+                std::string err_mtl;
+                bool ok = (*readMatFn)(filenames[s].c_str(), materials,
+                    material_map, &warn_mtl, &err_mtl);
+                if (warn && (!warn_mtl.empty())) {
+                    (*warn) += warn_mtl;
+                }
+
+                if (err && (!err_mtl.empty())) {
+                    (*err) += err_mtl;
+                }
+
+                if (ok) {
+                    found = true;
+                    material_filenames->insert(filenames[s]);
+                    break;
+                }
+            }
+
+            if (!found) {
+                if (warn) {
+                    (*warn) +=
+                        "Failed to load material file(s). Use default "
+                        "material.\n";
+                }
+            }
+        }
+    }
+
     bool LoadObj(attrib_t* attrib, std::vector<shape_t>* shapes,
         std::vector<material_t>* materials, std::string* warn,
         std::string* err, std::istream* inStream,
@@ -2503,44 +3196,30 @@ namespace tinyobj {
 
         bool found_all_colors = true;
 
+        std::vector<char> buffer;
+        ReadStreamToBuffer(inStream, &buffer);
+        LineScanner scanner(buffer.data(), buffer.data() + buffer.size());
+
         size_t line_num = 0;
         std::string linebuf;
-        while (inStream->peek() != -1) {
-            safeGetline(*inStream, linebuf);
-
+        while (scanner.NextLine()) {
             line_num++;
 
-            // Trim newline '\r\n' or '\n'
-            if (linebuf.size() > 0) {
-                if (linebuf[linebuf.size() - 1] == '\n')
-                    linebuf.erase(linebuf.size() - 1);
-            }
-            if (linebuf.size() > 0) {
-                if (linebuf[linebuf.size() - 1] == '\r')
-                    linebuf.erase(linebuf.size() - 1);
-            }
+            const std::vector<token_span_t>& tokens = scanner.tokens();
+            if (tokens.empty()) continue;  // empty line
 
-            // Skip if empty line.
-            if (linebuf.empty()) {
-                continue;
-            }
-
-            // Skip leading space.
-            const char* token = linebuf.c_str();
-            token += strspn(token, " \t");
+            const token_span_t& keyword = tokens[0];
+            if (keyword.begin[0] == '#') continue;  // comment line
 
-            assert(token);
-            if (token[0] == '\0') continue;  // empty line
-
-            if (token[0] == '#') continue;  // comment line
+            // v/vn/vt/f make up nearly every line and are parsed straight from
+            // the token spans.
 
             // vertex
-            if (token[0] == 'v' && IS_SPACE((token[1]))) {
-                token += 2;
+            if (tokenIs(keyword, "v", 1)) {
                 real_t x, y, z;
                 real_t r, g, b;
 
-                found_all_colors &= parseVertexWithColor(&x, &y, &z, &r, &g, &b, &token);
+                found_all_colors &= parseVertexWithColor(&x, &y, &z, &r, &g, &b, tokens);
 
                 v.push_back(x);
                 v.push_back(y);
@@ -2556,26 +3235,60 @@ namespace tinyobj {
             }
 
             // normal
-            if (token[0] == 'v' && token[1] == 'n' && IS_SPACE((token[2]))) {
-                token += 3;
-                real_t x, y, z;
-                parseReal3(&x, &y, &z, &token);
-                vn.push_back(x);
-                vn.push_back(y);
-                vn.push_back(z);
+            if (tokenIs(keyword, "vn", 2)) {
+                vn.push_back(parseReal(tokens, 1));
+                vn.push_back(parseReal(tokens, 2));
+                vn.push_back(parseReal(tokens, 3));
                 continue;
             }
 
             // texcoord
-            if (token[0] == 'v' && token[1] == 't' && IS_SPACE((token[2]))) {
-                token += 3;
-                real_t x, y;
-                parseReal2(&x, &y, &token);
-                vt.push_back(x);
-                vt.push_back(y);
+            if (tokenIs(keyword, "vt", 2)) {
+                vt.push_back(parseReal(tokens, 1));
+                vt.push_back(parseReal(tokens, 2));
                 continue;
             }
 
+            // face
+            if (tokenIs(keyword, "f", 1)) {
+                face_t face;
+
+                face.smoothing_group_id = current_smoothing_id;
+                face.vertex_indices.reserve(tokens.size() - 1);
+
+                for (size_t t = 1; t < tokens.size(); t++) {
+                    vertex_index_t vi;
+                    if (!parseTriple(tokens[t], static_cast<int>(v.size() / 3),
+                        static_cast<int>(vn.size() / 3),
+                        static_cast<int>(vt.size() / 2), &vi)) {
+                        if (err) {
+                            std::stringstream ss;
+                            ss << "Failed parse `f' line(e.g. zero value for face index. line "
+                                << line_num << ".)\n";
+                            (*err) += ss.str();
+                        }
+                        return false;
+                    }
+
+                    greatest_v_idx = greatest_v_idx > vi.v_idx ? greatest_v_idx : vi.v_idx;
+                    greatest_vn_idx =
+                        greatest_vn_idx > vi.vn_idx ? greatest_vn_idx : vi.vn_idx;
+                    greatest_vt_idx =
+                        greatest_vt_idx > vi.vt_idx ? greatest_vt_idx : vi.vt_idx;
+
+                    face.vertex_indices.push_back(vi);
+                }
+
+                // replace with emplace_back + std::move on C++11
+                prim_group.faceGroup.push_back(face);
+
+                continue;
+            }
+
+            // The remaining records are rare and expect a NUL-terminated line.
+            linebuf.assign(keyword.begin, tokens.back().end);
+            const char* token = linebuf.c_str();
+
             // skin weight. tinyobj extension
             if (token[0] == 'v' && token[1] == 'w' && IS_SPACE((token[2]))) {
                 token += 3;
@@ -2687,47 +3400,6 @@ namespace tinyobj {
                 continue;
             }
 
-            // face
-            if (token[0] == 'f' && IS_SPACE((token[1]))) {
-                token += 2;
-                token += strspn(token, " \t");
-
-                face_t face;
-
-                face.smoothing_group_id = current_smoothing_id;
-                face.vertex_indices.reserve(3);
-
-                while (!IS_NEW_LINE(token[0])) {
-                    vertex_index_t vi;
-                    if (!parseTriple(&token, static_cast<int>(v.size() / 3),
-                        static_cast<int>(vn.size() / 3),
-                        static_cast<int>(vt.size() / 2), &vi)) {
-                        if (err) {
-                            std::stringstream ss;
-                            ss << "Failed parse `f' line(e.g. zero value for face index. line "
-                                << line_num << ".)\n";
-                            (*err) += ss.str();
-                        }
-                        return false;
-                    }
-
-                    greatest_v_idx = greatest_v_idx > vi.v_idx ? greatest_v_idx : vi.v_idx;
-                    greatest_vn_idx =
-                        greatest_vn_idx > vi.vn_idx ? greatest_vn_idx : vi.vn_idx;
-                    greatest_vt_idx =
-                        greatest_vt_idx > vi.vt_idx ? greatest_vt_idx : vi.vt_idx;
-
-                    face.vertex_indices.push_back(vi);
-                    size_t n = strspn(token, " \t\r");
-                    token += n;
-                }
-
-                // replace with emplace_back + std::move on C++11
-                prim_group.faceGroup.push_back(face);
-
-                continue;
-            }
-
             // use mtl
             if ((0 == strncmp(token, "usemtl", 6))) {
                 token += 6;
@@ -2762,56 +3434,8 @@ namespace tinyobj {
             // load mtl
             if ((0 == strncmp(token, "mtllib", 6)) && IS_SPACE((token[6]))) {
                 if (readMatFn) {
-                    token += 7;
-
-                    std::vector<std::string> filenames;
-                    SplitString(std::string(token), ' ', '\\', filenames);
-
-                    if (filenames.empty()) {
-                        if (warn) {
-                            std::stringstream ss;
-                            ss << "Looks like empty filename for mtllib. Use default "
-                                "material (line "
-                                << line_num << ".)\n";
-
-                            (*warn) += ss.str();
-                        }
-                    }
-                    else {
-                        bool found = false;
-                        for (size_t s = 0; s < filenames.size(); s++) {
-                            if (material_filenames.count(filenames[s]) > 0) {
-                                found = true;
-                                continue;
-                            }
-
-                            std::string warn_mtl;
-                            std::string err_mtl;
-                            bool ok = (*readMatFn)(filenames[s].c_str(), materials,
-                                &material_map, &warn_mtl, &err_mtl);
-                            if (warn && (!warn_mtl.empty())) {
-                                (*warn) += warn_mtl;
-                            }
-
-                            if (err && (!err_mtl.empty())) {
-                                (*err) += err_mtl;
-                            }
-
-                            if (ok) {
-                                found = true;
-                                material_filenames.insert(filenames[s]);
-                                break;
-                            }
-                        }
-
-                        if (!found) {
-                            if (warn) {
-                                (*warn) +=
-                                    "Failed to load material file(s). Use default "
-                                    "material.\n";
-                            }
-                        }
-                    }
+                    LoadMtlLibraries(token + 7, line_num, readMatFn, materials,
+                        &material_map, &material_filenames, warn, err);
                 }
 
                 continue;
@@ -3039,6 +3663,404 @@ namespace tinyobj {
         return true;
     }
 
+    // Per-thread result of LoadObjParallel. Face indices are zero-based;
+    // corners flagged in `relative` were negative in the file and are still
+    // relative to the first vertex of this chunk.
+    struct obj_chunk_t {
+        std::vector<real_t> v;
+        std::vector<real_t> vn;
+        std::vector<real_t> vt;
+        std::vector<real_t> vc;
+        std::vector<vertex_index_t> corners;
+        std::vector<unsigned char> relative;  // bit 0 = v, bit 1 = vn, bit 2 = vt
+        std::vector<unsigned int> face_sizes;
+
+        // `o`, `g`, `usemtl`, `mtllib` and `s` lines, replayed in order at merge
+        // time. `face` is the number of faces parsed before the line.
+        struct event_t {
+            size_t face;
+            size_t line;
+            std::string text;
+        };
+        std::vector<event_t> events;
+
+        size_t num_lines;
+        size_t error_line;  // chunk-local line of a bad face, 0 = none
+        bool skipped;       // found records LoadObjParallel does not support
+
+        obj_chunk_t() : num_lines(0), error_line(0), skipped(false) {}
+    };
+
+    // Makes a raw OBJ index zero-based. Negative indices are resolved against
+    // the chunk-local count `n` and flagged with `bit` in `relative`.
+    static inline int fixChunkIndex(int idx, int n, unsigned char bit,
+        unsigned char* relative) {
+        if (idx > 0) return idx - 1;
+        if (idx < 0) {
+            (*relative) |= bit;
+            return n + idx;
+        }
+        return -1;
+    }
+
+    static void ParseObjChunk(const char* begin, const char* end,
+        obj_chunk_t* chunk) {
+        LineScanner scanner(begin, end);
+        while (scanner.NextLine()) {
+            chunk->num_lines++;
+
+            const std::vector<token_span_t>& tokens = scanner.tokens();
+            if (tokens.empty()) continue;  // empty line
+
+            const token_span_t& keyword = tokens[0];
+            if (keyword.begin[0] == '#') continue;  // comment line
+
+            // vertex
+            if (tokenIs(keyword, "v", 1)) {
+                real_t x, y, z;
+                real_t r, g, b;
+                parseVertexWithColor(&x, &y, &z, &r, &g, &b, tokens);
+                chunk->v.push_back(x);
+                chunk->v.push_back(y);
+                chunk->v.push_back(z);
+                chunk->vc.push_back(r);
+                chunk->vc.push_back(g);
+                chunk->vc.push_back(b);
+                continue;
+            }
+
+            // normal
+            if (tokenIs(keyword, "vn", 2)) {
+                chunk->vn.push_back(parseReal(tokens, 1));
+                chunk->vn.push_back(parseReal(tokens, 2));
+                chunk->vn.push_back(parseReal(tokens, 3));
+                continue;
+            }
+
+            // texcoord
+            if (tokenIs(keyword, "vt", 2)) {
+                chunk->vt.push_back(parseReal(tokens, 1));
+                chunk->vt.push_back(parseReal(tokens, 2));
+                continue;
+            }
+
+            // face
+            if (tokenIs(keyword, "f", 1)) {
+                int vsize = static_cast<int>(chunk->v.size() / 3);
+                int vnsize = static_cast<int>(chunk->vn.size() / 3);
+                int vtsize = static_cast<int>(chunk->vt.size() / 2);
+
+                for (size_t t = 1; t < tokens.size(); t++) {
+                    vertex_index_t raw = parseRawTriple(tokens[t]);
+                    if (raw.v_idx == 0) {
+                        // zero is not allowed according to the spec.
+                        chunk->error_line = chunk->num_lines;
+                        return;
+                    }
+
+                    unsigned char relative = 0;
+                    vertex_index_t vi;
+                    vi.v_idx = fixChunkIndex(raw.v_idx, vsize, 1, &relative);
+                    vi.vn_idx = fixChunkIndex(raw.vn_idx, vnsize, 2, &relative);
+                    vi.vt_idx = fixChunkIndex(raw.vt_idx, vtsize, 4, &relative);
+
+                    chunk->corners.push_back(vi);
+                    chunk->relative.push_back(relative);
+                }
+
+                chunk->face_sizes.push_back(static_cast<unsigned int>(tokens.size() - 1));
+                continue;
+            }
+
+            // LoadObj only takes mtllib/g/o/s with a separator after the keyword,
+            // and its line ends at the last token: a bare keyword is ignored.
+            const char* token = keyword.begin;
+            size_t keyword_len = static_cast<size_t>(keyword.end - keyword.begin);
+            bool has_argument = tokens.size() > 1;
+            if ((keyword_len >= 6 && 0 == strncmp(token, "usemtl", 6)) ||
+                (has_argument && (tokenIs(keyword, "mtllib", 6) || tokenIs(keyword, "g", 1) ||
+                tokenIs(keyword, "o", 1) || tokenIs(keyword, "s", 1)))) {
+                obj_chunk_t::event_t event;
+                event.face = chunk->face_sizes.size();
+                event.line = chunk->num_lines;
+                event.text.assign(keyword.begin, tokens.back().end);
+                chunk->events.push_back(event);
+                continue;
+            }
+
+            if (tokenIs(keyword, "l", 1) || tokenIs(keyword, "p", 1) ||
+                tokenIs(keyword, "t", 1) || tokenIs(keyword, "vw", 2)) {
+                chunk->skipped = true;
+            }
+
+            // Ignore unknown command.
+        }
+    }
+
+    template <typename T>
+    static void AppendChunkArray(std::vector<T>* dst, const std::vector<T>& src) {
+        dst->insert(dst->end(), src.begin(), src.end());
+    }
+
+    bool LoadObjParallel(attrib_t* attrib, std::vector<shape_t>* shapes,
+        std::vector<material_t>* materials, std::string* warn,
+        std::string* err, const char* buffer, size_t buffer_size,
+        MaterialReader* readMatFn /*= NULL*/, unsigned int num_threads,
+        bool triangulate) {
+        attrib->vertices.clear();
+        attrib->vertex_weights.clear();
+        attrib->normals.clear();
+        attrib->texcoords.clear();
+        attrib->texcoord_ws.clear();
+        attrib->colors.clear();
+        attrib->skin_weights.clear();
+        shapes->clear();
+
+        if (!buffer || buffer_size == 0) {
+            if (err) {
+                (*err) += "Empty .obj buffer\n";
+            }
+            return false;
+        }
+
+        // Keep chunks at 1MB or more so thread start-up stays negligible.
+        unsigned int num_chunks =
+            num_threads ? num_threads : std::thread::hardware_concurrency();
+        size_t max_chunks = buffer_size / (1024 * 1024) + 1;
+        if (num_chunks == 0) num_chunks = 1;
+        if (num_chunks > max_chunks) num_chunks = static_cast<unsigned int>(max_chunks);
+
+        // Split on newline boundaries.
+        const char* buffer_end = buffer + buffer_size;
+        std::vector<const char*> bounds(num_chunks + 1);
+        bounds[0] = buffer;
+        bounds[num_chunks] = buffer_end;
+        for (unsigned int i = 1; i < num_chunks; i++) {
+            const char* split = buffer + (buffer_size / num_chunks) * i;
+            if (split < bounds[i - 1]) split = bounds[i - 1];
+            const char* eol = static_cast<const char*>(
+                memchr(split, '\n', static_cast<size_t>(buffer_end - split)));
+            bounds[i] = eol ? eol + 1 : buffer_end;
+        }
+
+        std::vector<obj_chunk_t> chunks(num_chunks);
+        std::vector<std::thread> workers;
+        for (unsigned int i = 1; i < num_chunks; i++) {
+            workers.push_back(
+                std::thread(ParseObjChunk, bounds[i], bounds[i + 1], &chunks[i]));
+        }
+        ParseObjChunk(bounds[0], bounds[1], &chunks[0]);
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+
+        // Concatenate the attributes first so every face can see every vertex.
+        size_t total_v = 0, total_vn = 0, total_vt = 0;
+        bool skipped = false;
+        for (size_t c = 0; c < chunks.size(); c++) {
+            total_v += chunks[c].v.size();
+            total_vn += chunks[c].vn.size();
+            total_vt += chunks[c].vt.size();
+            skipped |= chunks[c].skipped;
+        }
+        attrib->vertices.reserve(total_v);
+        attrib->colors.reserve(total_v);
+        attrib->normals.reserve(total_vn);
+        attrib->texcoords.reserve(total_vt);
+
+        std::vector<int> v_base(chunks.size());
+        std::vector<int> vn_base(chunks.size());
+        std::vector<int> vt_base(chunks.size());
+        for (size_t c = 0; c < chunks.size(); c++) {
+            v_base[c] = static_cast<int>(attrib->vertices.size() / 3);
+            vn_base[c] = static_cast<int>(attrib->normals.size() / 3);
+            vt_base[c] = static_cast<int>(attrib->texcoords.size() / 2);
+            AppendChunkArray(&attrib->vertices, chunks[c].v);
+            AppendChunkArray(&attrib->colors, chunks[c].vc);
+            AppendChunkArray(&attrib->normals, chunks[c].vn);
+            AppendChunkArray(&attrib->texcoords, chunks[c].vt);
+        }
+
+        if (skipped && warn) {
+            (*warn) += "LoadObjParallel skips `l`, `p`, `t` and `vw` records.\n";
+        }
+
+        // Replay faces and state changes in file order.
+        std::set<std::string> material_filenames;
+        std::map<std::string, int> material_map;
+        int material = -1;
+        unsigned int current_smoothing_id = 0;
+        std::string name;
+        std::vector<tag_t> tags;
+        PrimGroup prim_group;
+        shape_t shape;
+
+        int greatest_v_idx = -1;
+        int greatest_vn_idx = -1;
+        int greatest_vt_idx = -1;
+
+        size_t line_base = 0;
+        for (size_t c = 0; c < chunks.size(); c++) {
+            const obj_chunk_t& chunk = chunks[c];
+
+            if (chunk.error_line) {
+                if (err) {
+                    std::stringstream ss;
+                    ss << "Failed parse `f' line(e.g. zero value for face index. line "
+                        << (line_base + chunk.error_line) << ".)\n";
+                    (*err) += ss.str();
+                }
+                return false;
+            }
+
+            size_t corner = 0;
+            size_t next_event = 0;
+            for (size_t f = 0; f <= chunk.face_sizes.size(); f++) {
+                for (; next_event < chunk.events.size() &&
+                    chunk.events[next_event].face == f; next_event++) {
+                    const obj_chunk_t::event_t& event = chunk.events[next_event];
+                    size_t line_num = line_base + event.line;
+                    const char* token = event.text.c_str();
+
+                    if (0 == strncmp(token, "usemtl", 6)) {
+                        token += 6;
+                        std::string namebuf = parseString(&token);
+                        std::map<std::string, int>::const_iterator it =
+                            material_map.find(namebuf);
+                        if (it != material_map.end()) {
+                            material = it->second;
+                        }
+                        else {
+                            material = -1;
+                            if (warn) {
+                                (*warn) += "material [ '" + namebuf + "' ] not found in .mtl\n";
+                            }
+                        }
+                    }
+                    else if (0 == strncmp(token, "mtllib", 6)) {
+                        if (readMatFn) {
+                            LoadMtlLibraries(token + 7, line_num, readMatFn, materials,
+                                &material_map, &material_filenames, warn, err);
+                        }
+                    }
+                    else if (token[0] == 'g' || token[0] == 'o') {
+                        if (shape.mesh.indices.size() > 0) {
+                            shapes->push_back(shape);
+                        }
+                        shape = shape_t();
+
+                        if (token[0] == 'o') {
+                            name = token + 2;
+                            continue;
+                        }
+
+                        std::vector<std::string> names;
+                        while (!IS_NEW_LINE(token[0])) {
+                            names.push_back(parseString(&token));
+                            token += strspn(token, " \t\r");
+                        }
+
+                        // names[0] is 'g'
+                        name = "";
+                        if (names.size() < 2) {
+                            if (warn) {
+                                std::stringstream ss;
+                                ss << "Empty group name. line: " << line_num << "\n";
+                                (*warn) += ss.str();
+                            }
+                        }
+                        else {
+                            name = names[1];
+                            for (size_t i = 2; i < names.size(); i++) {
+                                name += " " + names[i];
+                            }
+                        }
+                    }
+                    else if (token[0] == 's') {
+                        token += 2;
+                        token += strspn(token, " \t");
+                        if (0 == strncmp(token, "off", 3)) {
+                            current_smoothing_id = 0;
+                        }
+                        else if (token[0] != '\0') {
+                            int smGroupId = parseInt(&token);
+                            current_smoothing_id =
+                                smGroupId < 0 ? 0 : static_cast<unsigned int>(smGroupId);
+                        }
+                    }
+                }
+
+                if (f == chunk.face_sizes.size()) break;
+
+                size_t npolys = chunk.face_sizes[f];
+                face_t face;
+                face.smoothing_group_id = current_smoothing_id;
+                face.vertex_indices.resize(npolys);
+                for (size_t k = 0; k < npolys; k++, corner++) {
+                    vertex_index_t vi = chunk.corners[corner];
+                    unsigned char relative = chunk.relative[corner];
+                    if (relative & 1) vi.v_idx += v_base[c];
+                    if (relative & 2) vi.vn_idx += vn_base[c];
+                    if (relative & 4) vi.vt_idx += vt_base[c];
+
+                    greatest_v_idx = greatest_v_idx > vi.v_idx ? greatest_v_idx : vi.v_idx;
+                    greatest_vn_idx =
+                        greatest_vn_idx > vi.vn_idx ? greatest_vn_idx : vi.vn_idx;
+                    greatest_vt_idx =
+                        greatest_vt_idx > vi.vt_idx ? greatest_vt_idx : vi.vt_idx;
+
+                    face.vertex_indices[k] = vi;
+                }
+
+                if (npolys == 3 || (!triangulate && npolys > 3)) {
+                    // Nothing to triangulate; append the same way exportGroupsToShape does.
+                    shape.name = name;
+                    for (size_t k = 0; k < npolys; k++) {
+                        index_t idx;
+                        idx.vertex_index = face.vertex_indices[k].v_idx;
+                        idx.normal_index = face.vertex_indices[k].vn_idx;
+                        idx.texcoord_index = face.vertex_indices[k].vt_idx;
+                        shape.mesh.indices.push_back(idx);
+                    }
+                    shape.mesh.num_face_vertices.push_back(
+                        static_cast<unsigned char>(npolys));
+                    shape.mesh.material_ids.push_back(material);
+                    shape.mesh.smoothing_group_ids.push_back(current_smoothing_id);
+                }
+                else {
+                    prim_group.faceGroup.push_back(face);
+                    exportGroupsToShape(&shape, prim_group, tags, material, name,
+                        triangulate, attrib->vertices, warn);
+                    prim_group.clear();
+                }
+            }
+
+            line_base += chunk.num_lines;
+        }
+
+        if (greatest_v_idx >= static_cast<int>(attrib->vertices.size() / 3)) {
+            if (warn) {
+                (*warn) += "Vertex indices out of bounds.\n\n";
+            }
+        }
+        if (greatest_vn_idx >= static_cast<int>(attrib->normals.size() / 3)) {
+            if (warn) {
+                (*warn) += "Vertex normal indices out of bounds.\n\n";
+            }
+        }
+        if (greatest_vt_idx >= static_cast<int>(attrib->texcoords.size() / 2)) {
+            if (warn) {
+                (*warn) += "Vertex texcoord indices out of bounds.\n\n";
+            }
+        }
+
+        if (shape.mesh.indices.size()) {
+            shapes->push_back(shape);
+        }
+
+        return true;
+    }
+
     bool LoadObjWithCallback(std::istream& inStream, const callback_t& callback,
         void* user_data /*= NULL*/,
         MaterialReader* readMatFn /*= NULL*/,
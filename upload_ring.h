@@ -0,0 +1,240 @@
+#ifndef UPLOAD_RING_H
+#define UPLOAD_RING_H
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+// a GL_PIXEL_UNPACK_BUFFER that texture data is staged in, so glTexSubImage2D reads it asynchronously
+// instead of the driver copying client memory during the call.
+// With GL 4.4 / ARB_buffer_storage the buffer stays mapped and any thread can write into a reserve()d
+// region; the region comes back once the fence issued after its upload has passed. Without it the render
+// thread maps ranges one at a time and orphans the buffer when it runs out (map()/unmap()).
+
+// regions start on this boundary, enough for any pixel type and SIMD copies
+const size_t UPLOAD_RING_ALIGNMENT = 64;
+
+enum UploadRingMode {
+    UPLOAD_RING_OFF,        // no PBOs or no fences: upload from client memory
+    UPLOAD_RING_PERSISTENT, // mapped once, reserve() from any thread
+    UPLOAD_RING_ORPHANING   // render thread only, map() and unmap()
+};
+
+class UploadRing {
+public:
+    UploadRing() : buffer(0), capacity(0), mapped(NULL), head(0), ringMode(UPLOAD_RING_OFF), cancelled(false) {}
+
+    ~UploadRing()
+    {
+        release();
+    }
+
+    // render thread, needs a current context
+    void create(size_t size)
+    {
+        release();
+        bool fences = GLAD_GL_VERSION_3_2 || GLAD_GL_ARB_sync;
+        if (!GLAD_GL_VERSION_2_1 || !fences || size == 0)
+            return;
+        capacity = size;
+        head = 0;
+        cancelled = false;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        if (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)size, NULL, flags);
+            mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)size, flags);
+        }
+        if (mapped) {
+            ringMode = UPLOAD_RING_PERSISTENT;
+        } else {
+            // storage is immutable once glBufferStorage succeeded, start over with a mutable buffer
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)size, NULL, GL_STREAM_DRAW);
+            ringMode = UPLOAD_RING_ORPHANING;
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    // render thread; waits for nothing, pending uploads keep their own copy of the data
+    void release()
+    {
+        cancel();
+        for (size_t i = 0; i < regions.size(); i++)
+            if (regions[i].fence)
+                glDeleteSync(regions[i].fence);
+        regions.clear();
+        if (buffer) {
+            if (mapped) {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            }
+            glDeleteBuffers(1, &buffer);
+        }
+        buffer = 0;
+        mapped = NULL;
+        capacity = 0;
+        ringMode = UPLOAD_RING_OFF;
+    }
+
+    UploadRingMode mode() const
+    {
+        return ringMode;
+    }
+
+    GLuint name() const
+    {
+        return buffer;
+    }
+
+    size_t size() const
+    {
+        return capacity;
+    }
+
+    // UPLOAD_RING_PERSISTENT, any thread: bytes of mapped memory at offset into the buffer. With wait a
+    // full ring blocks until earlier uploads retire; a caller already holding an unfenced region must not
+    // wait, that region may be what keeps the ring full. NULL when it does not fit or after cancel()
+    unsigned char* reserve(size_t bytes, size_t& offset, bool wait)
+    {
+        bytes = alignedSize(bytes);
+        std::unique_lock<std::mutex> lock(mutex);
+        if (ringMode != UPLOAD_RING_PERSISTENT || bytes > capacity)
+            return NULL;
+        bool space;
+        while (!(space = fits(bytes, offset)) && wait && !cancelled)
+            retired.wait(lock);
+        if (cancelled || !space)
+            return NULL;
+        Region region = { offset, bytes, 0 };
+        regions.push_back(region);
+        head = offset + bytes;
+        return mapped + offset;
+    }
+
+    // render thread, after the glTexSubImage2D calls reading the region at offset (or instead of them)
+    void fence(size_t offset)
+    {
+        GLsync sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < regions.size(); i++) {
+            if (regions[i].offset == offset && !regions[i].fence) {
+                regions[i].fence = sync;
+                return;
+            }
+        }
+        glDeleteSync(sync);
+    }
+
+    // render thread, once per frame: hands regions whose uploads have finished back to reserve()
+    void retire()
+    {
+        bool freed = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            while (!regions.empty() && regions.front().fence) {
+                GLenum status = glClientWaitSync(regions.front().fence, 0, 0);
+                if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                    break;
+                glDeleteSync(regions.front().fence);
+                regions.pop_front();
+                freed = true;
+            }
+        }
+        if (freed)
+            retired.notify_all();
+    }
+
+    // wakes and fails every reserve(), now and later
+    void cancel()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            cancelled = true;
+        }
+        retired.notify_all();
+    }
+
+    // UPLOAD_RING_ORPHANING, render thread: maps bytes and leaves the buffer bound to
+    // GL_PIXEL_UNPACK_BUFFER; write, unmap(), then upload from offset. NULL if bytes exceed the ring
+    unsigned char* map(size_t bytes, size_t& offset)
+    {
+        bytes = alignedSize(bytes);
+        if (ringMode != UPLOAD_RING_ORPHANING || bytes > capacity)
+            return NULL;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        if (head + bytes > capacity) {
+            // the uploads still reading the old storage keep it, this gets fresh memory
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)capacity, NULL, GL_STREAM_DRAW);
+            head = 0;
+        }
+        offset = head;
+        head += bytes;
+        // nothing in flight overlaps [offset, offset + bytes) of this storage
+        GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+        unsigned char* memory = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, (GLintptr)offset,
+            (GLsizeiptr)bytes, access);
+        if (!memory)
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return memory;
+    }
+
+    // false when the driver lost the data (mode switch, ...); the upload has to fall back to client memory
+    bool unmap()
+    {
+        return glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+    }
+
+private:
+    struct Region {
+        size_t offset;
+        size_t size;
+        GLsync fence; // 0 until its upload is issued
+    };
+
+    static size_t alignedSize(size_t bytes)
+    {
+        return (bytes + UPLOAD_RING_ALIGNMENT - 1) / UPLOAD_RING_ALIGNMENT * UPLOAD_RING_ALIGNMENT;
+    }
+
+    // regions are handed out in ring order and retired oldest first, so the free space is
+    // [head, end) plus [0, oldest) once head has passed it, or [head, oldest) after a wrap
+    bool fits(size_t bytes, size_t& offset)
+    {
+        if (regions.empty()) {
+            offset = 0;
+            return true;
+        }
+        size_t tail = regions.front().offset;
+        if (head > tail) {
+            if (head + bytes <= capacity) {
+                offset = head;
+                return true;
+            }
+            offset = 0;
+            return bytes <= tail;
+        }
+        // head == tail with regions left means every byte is in use
+        offset = head;
+        return head < tail && head + bytes <= tail;
+    }
+
+    GLuint buffer;
+    size_t capacity;
+    unsigned char* mapped;
+    size_t head; // guarded by mutex in persistent mode
+    UploadRingMode ringMode;
+
+    std::mutex mutex;
+    std::condition_variable retired;
+    std::deque<Region> regions; // guarded by mutex
+    bool cancelled;             // guarded by mutex
+};
+#endif
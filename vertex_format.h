@@ -0,0 +1,184 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "mesh.h"
+
+// largest difference between the float vertices and what the vertex shader decodes
+struct VertexFormatError {
+    float position; // object space units
+    float normal;   // degrees
+    float tangent;  // degrees
+    float uv;       // texture coordinate units
+};
+
+// a mesh's vertices in one VertexFormat, ready for glBufferData
+struct PackedVertices {
+    VertexFormat format;
+    std::vector<unsigned char> bytes;
+    // sample.vert computes position = positionOffset + aPos.xyz * positionScale
+    glm::vec3 positionOffset;
+    glm::vec3 positionScale;
+    VertexFormatError error;
+};
+
+inline float signNotZero(float v)
+{
+    return v < 0.0f ? -1.0f : 1.0f;
+}
+
+// unit vector -> point on the octahedron unfolded into [-1, 1]^2
+inline glm::vec2 octEncode(glm::vec3 n)
+{
+    float l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    if (l1 <= 0.0f)
+        return glm::vec2(0.0f, 0.0f);
+    glm::vec2 p = glm::vec2(n.x, n.y) / l1;
+    if (n.z < 0.0f)
+        p = glm::vec2((1.0f - std::fabs(p.y)) * signNotZero(p.x), (1.0f - std::fabs(p.x)) * signNotZero(p.y));
+    return p;
+}
+
+// same as octDecode in sample.vert
+inline glm::vec3 octDecode(glm::vec2 e)
+{
+    glm::vec3 n(e.x, e.y, 1.0f - std::fabs(e.x) - std::fabs(e.y));
+    float t = glm::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+// what GL hands the shader for a normalized GL_SHORT
+inline float fromSnorm16(short v)
+{
+    return glm::max(v / 32767.0f, -1.0f);
+}
+
+// octahedral snorm16 pair; tries the four neighbouring grid points and keeps the most accurate
+inline void octEncodeSnorm16(glm::vec3 n, short out[2])
+{
+    glm::vec2 p = octEncode(n);
+    float baseX = std::floor(glm::clamp(p.x, -1.0f, 1.0f) * 32767.0f);
+    float baseY = std::floor(glm::clamp(p.y, -1.0f, 1.0f) * 32767.0f);
+    float best = -2.0f;
+    for (int i = 0; i < 4; i++) {
+        float x = glm::clamp(baseX + (i & 1), -32767.0f, 32767.0f);
+        float y = glm::clamp(baseY + (i >> 1), -32767.0f, 32767.0f);
+        float similarity = glm::dot(n, octDecode(glm::vec2(x, y) / 32767.0f));
+        if (similarity > best) {
+            best = similarity;
+            out[0] = static_cast<short>(x);
+            out[1] = static_cast<short>(y);
+        }
+    }
+}
+
+// atan2 form, acos of a float dot product cannot resolve angles below ~0.03 degrees
+inline float angleDegrees(glm::vec3 a, glm::vec3 b)
+{
+    return glm::degrees(std::atan2(glm::length(glm::cross(a, b)), glm::dot(a, b)));
+}
+
+// writes one vertex in format at out and widens error by its round trip error
+// positionOffset/positionScale are the mesh AABB for compact vertices, ignored for float ones
+inline void packVertex(VertexFormat format, glm::vec3 position, glm::vec3 normal, glm::vec2 uv, glm::vec4 tangent,
+    glm::vec3 positionOffset, glm::vec3 positionScale, unsigned char* out, VertexFormatError& error)
+{
+    if (format == VERTEX_FORMAT_FLOAT) {
+        GLfloat vertex[VERTEX_FLOATS] = {
+            position.x, position.y, position.z,
+            normal.x, normal.y, normal.z,
+            uv.x, uv.y,
+            tangent.x, tangent.y, tangent.z, tangent.w
+        };
+        std::memcpy(out, vertex, sizeof(vertex));
+        return;
+    }
+
+    // position: unorm16 per axis, flat axes collapse to 0
+    unsigned short quantized[4];
+    glm::vec3 decoded;
+    for (int axis = 0; axis < 3; axis++) {
+        float extent = positionScale[axis];
+        float t = extent > 0.0f ? (position[axis] - positionOffset[axis]) / extent : 0.0f;
+        quantized[axis] = static_cast<unsigned short>(std::floor(glm::clamp(t, 0.0f, 1.0f) * 65535.0f + 0.5f));
+        decoded[axis] = positionOffset[axis] + quantized[axis] / 65535.0f * extent;
+        error.position = glm::max(error.position, std::fabs(decoded[axis] - position[axis]));
+    }
+    quantized[3] = tangent.w < 0.0f ? 0 : 65535;
+    std::memcpy(out + 0, quantized, sizeof(quantized));
+
+    glm::vec3 tangentAxis(tangent);
+    short octNormal[2];
+    short octTangent[2];
+    octEncodeSnorm16(normal, octNormal);
+    octEncodeSnorm16(tangentAxis, octTangent);
+    std::memcpy(out + 8, octNormal, sizeof(octNormal));
+    std::memcpy(out + 16, octTangent, sizeof(octTangent));
+    if (glm::dot(normal, normal) > 0.0f) {
+        glm::vec3 decodedNormal = octDecode(glm::vec2(fromSnorm16(octNormal[0]), fromSnorm16(octNormal[1])));
+        error.normal = glm::max(error.normal, angleDegrees(normal, decodedNormal));
+    }
+    glm::vec3 decodedTangent = octDecode(glm::vec2(fromSnorm16(octTangent[0]), fromSnorm16(octTangent[1])));
+    error.tangent = glm::max(error.tangent, angleDegrees(tangentAxis, decodedTangent));
+
+    unsigned short halfUv[2] = { glm::packHalf1x16(uv.x), glm::packHalf1x16(uv.y) };
+    std::memcpy(out + 12, halfUv, sizeof(halfUv));
+    glm::vec2 decodedUv(glm::unpackHalf1x16(halfUv[0]), glm::unpackHalf1x16(halfUv[1]));
+    error.uv = glm::max(error.uv, glm::max(std::fabs(decodedUv.x - uv.x), std::fabs(decodedUv.y - uv.y)));
+}
+
+// encodes mesh.vertices (VERTEX_FLOATS each) into format and measures the round trip error
+inline PackedVertices packVertices(const MeshData& mesh, VertexFormat format)
+{
+    PackedVertices out;
+    out.format = format;
+    std::memset(&out.error, 0, sizeof(out.error));
+    unsigned int count = mesh.vertexCount();
+
+    if (format == VERTEX_FORMAT_FLOAT) {
+        out.positionOffset = glm::vec3(0.0f);
+        out.positionScale = glm::vec3(1.0f);
+        out.bytes.resize(sizeof(GLfloat) * mesh.vertices.size());
+        if (!out.bytes.empty())
+            std::memcpy(out.bytes.data(), mesh.vertices.data(), out.bytes.size());
+        return out;
+    }
+
+    out.positionOffset = mesh.boundsMin;
+    out.positionScale = mesh.boundsMax - mesh.boundsMin;
+    out.bytes.resize((size_t)vertexStride(format) * count);
+
+    for (unsigned int v = 0; v < count; v++) {
+        const GLfloat* in = &mesh.vertices[(size_t)v * VERTEX_FLOATS];
+        packVertex(format, glm::vec3(in[0], in[1], in[2]), glm::vec3(in[3], in[4], in[5]), glm::vec2(in[6], in[7]),
+            glm::vec4(in[8], in[9], in[10], in[11]), out.positionOffset, out.positionScale,
+            &out.bytes[(size_t)v * vertexStride(format)], out.error);
+    }
+    return out;
+}
+
+// one line for the log, e.g. "compact 20 B/vertex, max error: position 0.0001, normal 0.004 deg, ..."
+inline std::string describeVertexFormat(VertexFormat format, const VertexFormatError& error)
+{
+    std::stringstream text;
+    text << (format == VERTEX_FORMAT_COMPACT ? "compact " : "float ") << vertexStride(format) << " B/vertex";
+    if (format != VERTEX_FORMAT_FLOAT) {
+        text << ", max error: position " << error.position
+            << ", normal " << error.normal << " deg"
+            << ", tangent " << error.tangent << " deg"
+            << ", uv " << error.uv;
+    }
+    return text.str();
+}
+#endif